@@ -46,6 +46,13 @@ const std::string ROCKSDB_ENV_USAGE_SCENARIO_BULK_LOAD("bulk_load");
 /// manual_compact.once.bottommost_level_compaction=force       // optional, default force
 /// ```
 ///
+/// Split cleanup manual compaction: triggered only at the specified unix time, it removes the
+/// stale data which belongs to the other half partition after partition split, by compacting the
+/// whole key space range by range with the compaction filter.
+/// ```
+/// manual_compact.split_cleanup.trigger_time=1525930272        // required
+/// ```
+///
 /// Disable manual compaction:
 /// ```
 /// manual_compact.disabled=false                               // optional, default false
@@ -63,6 +70,11 @@ const std::string MANUAL_COMPACT_ONCE_KEY_PREFIX(MANUAL_COMPACT_KEY_PREFIX + "on
 const std::string MANUAL_COMPACT_ONCE_TRIGGER_TIME_KEY(MANUAL_COMPACT_ONCE_KEY_PREFIX +
                                                        "trigger_time");
 
+const std::string MANUAL_COMPACT_SPLIT_CLEANUP_KEY_PREFIX(MANUAL_COMPACT_KEY_PREFIX +
+                                                          "split_cleanup.");
+const std::string MANUAL_COMPACT_SPLIT_CLEANUP_TRIGGER_TIME_KEY(
+    MANUAL_COMPACT_SPLIT_CLEANUP_KEY_PREFIX + "trigger_time");
+
 // see more about the following two keys in rocksdb::CompactRangeOptions
 const std::string MANUAL_COMPACT_TARGET_LEVEL_KEY("target_level");
 
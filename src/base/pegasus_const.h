@@ -46,6 +46,9 @@ extern const std::string MANUAL_COMPACT_PERIODIC_TRIGGER_TIME_KEY;
 extern const std::string MANUAL_COMPACT_ONCE_KEY_PREFIX;
 extern const std::string MANUAL_COMPACT_ONCE_TRIGGER_TIME_KEY;
 
+extern const std::string MANUAL_COMPACT_SPLIT_CLEANUP_KEY_PREFIX;
+extern const std::string MANUAL_COMPACT_SPLIT_CLEANUP_TRIGGER_TIME_KEY;
+
 extern const std::string MANUAL_COMPACT_TARGET_LEVEL_KEY;
 
 extern const std::string MANUAL_COMPACT_BOTTOMMOST_LEVEL_COMPACTION_KEY;
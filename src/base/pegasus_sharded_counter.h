@@ -0,0 +1,82 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+
+#include <dsn/utility/rand.h>
+#include <dsn/utility/string_conv.h>
+#include <dsn/utility/string_view.h>
+
+namespace pegasus {
+
+// A sharded counter spreads the value of the counter <hash_key, sort_key> over `shard_count`
+// records, so that frequent increments of a hot counter are not all applied to a single key:
+//
+//   - shard 0 is the record <hash_key, sort_key> itself, thus a counter with only 1 shard is a
+//     normal counter, and a normal counter can be turned into a sharded one at any time.
+//   - shard i (i > 0) is the record <sharded_counter_hash_key(hash_key, i), sort_key>. The hash
+//     keys of the shards are different, so the shards are spread over the partitions.
+//
+// Each shard is a normal counter updated by incr, and the value of the counter is the sum of
+// all the shards. A missing shard is counted as 0.
+
+// The max number of shards of a sharded counter.
+const int kMaxShardedCounterShardCount = 1024;
+
+inline bool sharded_counter_shard_count_valid(int shard_count)
+{
+    return shard_count >= 1 && shard_count <= kMaxShardedCounterShardCount;
+}
+
+// The hash key of the shard `shard_index` of the counter whose hash key is `hash_key`. The '\0'
+// separator keeps the derived hash keys out of the printable keys used by most applications.
+inline std::string sharded_counter_hash_key(dsn::string_view hash_key, int shard_index)
+{
+    if (shard_index == 0) {
+        return std::string(hash_key.data(), hash_key.length());
+    }
+    std::string key;
+    key.reserve(hash_key.length() + 8);
+    key.append(hash_key.data(), hash_key.length());
+    key.push_back('\0');
+    key.push_back('#');
+    key.append(std::to_string(shard_index));
+    return key;
+}
+
+// The shard to be incremented by an increment. Each increment picks a shard randomly, so the
+// increments are spread over all the shards however few threads apply them.
+inline int sharded_counter_random_shard(int shard_count)
+{
+    return static_cast<int>(dsn::rand::next_u32(0, static_cast<uint32_t>(shard_count) - 1));
+}
+
+// Parse the value of a shard, an empty value is counted as 0 the same as incr.
+inline bool parse_sharded_counter_shard(dsn::string_view value, int64_t &result)
+{
+    if (value.empty()) {
+        result = 0;
+        return true;
+    }
+    return dsn::buf2int64(value, result);
+}
+
+} // namespace pegasus
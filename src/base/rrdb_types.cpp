@@ -70,6 +70,15 @@ const std::map<int, const char *> _mutate_operation_VALUES_TO_NAMES(
     ::apache::thrift::TEnumIterator(2, _kmutate_operationValues, _kmutate_operationNames),
     ::apache::thrift::TEnumIterator(-1, NULL, NULL));
 
+int _kduplicate_compression_typeValues[] = {duplicate_compression_type::DCT_NONE,
+                                            duplicate_compression_type::DCT_LZ4,
+                                            duplicate_compression_type::DCT_ZSTD};
+const char *_kduplicate_compression_typeNames[] = {"DCT_NONE", "DCT_LZ4", "DCT_ZSTD"};
+const std::map<int, const char *> _duplicate_compression_type_VALUES_TO_NAMES(
+    ::apache::thrift::TEnumIterator(
+        3, _kduplicate_compression_typeValues, _kduplicate_compression_typeNames),
+    ::apache::thrift::TEnumIterator(-1, NULL, NULL));
+
 update_request::~update_request() throw() {}
 
 void update_request::__set_key(const ::dsn::blob &val) { this->key = val; }
@@ -3712,6 +3721,12 @@ void get_scanner_request::__set_return_expire_ts(const bool val)
     __isset.return_expire_ts = true;
 }
 
+void get_scanner_request::__set_read_timestamp(const int64_t val)
+{
+    this->read_timestamp = val;
+    __isset.read_timestamp = true;
+}
+
 uint32_t get_scanner_request::read(::apache::thrift::protocol::TProtocol *iprot)
 {
 
@@ -3831,6 +3846,14 @@ uint32_t get_scanner_request::read(::apache::thrift::protocol::TProtocol *iprot)
                 xfer += iprot->skip(ftype);
             }
             break;
+        case 13:
+            if (ftype == ::apache::thrift::protocol::T_I64) {
+                xfer += iprot->readI64(this->read_timestamp);
+                this->__isset.read_timestamp = true;
+            } else {
+                xfer += iprot->skip(ftype);
+            }
+            break;
         default:
             xfer += iprot->skip(ftype);
             break;
@@ -3902,6 +3925,11 @@ uint32_t get_scanner_request::write(::apache::thrift::protocol::TProtocol *oprot
         xfer += oprot->writeBool(this->return_expire_ts);
         xfer += oprot->writeFieldEnd();
     }
+    if (this->__isset.read_timestamp) {
+        xfer += oprot->writeFieldBegin("read_timestamp", ::apache::thrift::protocol::T_I64, 13);
+        xfer += oprot->writeI64(this->read_timestamp);
+        xfer += oprot->writeFieldEnd();
+    }
     xfer += oprot->writeFieldStop();
     xfer += oprot->writeStructEnd();
     return xfer;
@@ -3922,6 +3950,7 @@ void swap(get_scanner_request &a, get_scanner_request &b)
     swap(a.sort_key_filter_pattern, b.sort_key_filter_pattern);
     swap(a.validate_partition_hash, b.validate_partition_hash);
     swap(a.return_expire_ts, b.return_expire_ts);
+    swap(a.read_timestamp, b.read_timestamp);
     swap(a.__isset, b.__isset);
 }
 
@@ -3939,6 +3968,7 @@ get_scanner_request::get_scanner_request(const get_scanner_request &other108)
     sort_key_filter_pattern = other108.sort_key_filter_pattern;
     validate_partition_hash = other108.validate_partition_hash;
     return_expire_ts = other108.return_expire_ts;
+    read_timestamp = other108.read_timestamp;
     __isset = other108.__isset;
 }
 get_scanner_request::get_scanner_request(get_scanner_request &&other109)
@@ -3955,6 +3985,7 @@ get_scanner_request::get_scanner_request(get_scanner_request &&other109)
     sort_key_filter_pattern = std::move(other109.sort_key_filter_pattern);
     validate_partition_hash = std::move(other109.validate_partition_hash);
     return_expire_ts = std::move(other109.return_expire_ts);
+    read_timestamp = std::move(other109.read_timestamp);
     __isset = std::move(other109.__isset);
 }
 get_scanner_request &get_scanner_request::operator=(const get_scanner_request &other110)
@@ -3971,6 +4002,7 @@ get_scanner_request &get_scanner_request::operator=(const get_scanner_request &o
     sort_key_filter_pattern = other110.sort_key_filter_pattern;
     validate_partition_hash = other110.validate_partition_hash;
     return_expire_ts = other110.return_expire_ts;
+    read_timestamp = other110.read_timestamp;
     __isset = other110.__isset;
     return *this;
 }
@@ -3988,6 +4020,7 @@ get_scanner_request &get_scanner_request::operator=(get_scanner_request &&other1
     sort_key_filter_pattern = std::move(other111.sort_key_filter_pattern);
     validate_partition_hash = std::move(other111.validate_partition_hash);
     return_expire_ts = std::move(other111.return_expire_ts);
+    read_timestamp = std::move(other111.read_timestamp);
     __isset = std::move(other111.__isset);
     return *this;
 }
@@ -4021,6 +4054,9 @@ void get_scanner_request::printTo(std::ostream &out) const
     out << ", "
         << "return_expire_ts=";
     (__isset.return_expire_ts ? (out << to_string(return_expire_ts)) : (out << "<null>"));
+    out << ", "
+        << "read_timestamp=";
+    (__isset.read_timestamp ? (out << to_string(read_timestamp)) : (out << "<null>"));
     out << ")";
 }
 
@@ -4133,6 +4169,12 @@ void scan_response::__set_partition_index(const int32_t val) { this->partition_i
 
 void scan_response::__set_server(const std::string &val) { this->server = val; }
 
+void scan_response::__set_read_timestamp(const int64_t val)
+{
+    this->read_timestamp = val;
+    __isset.read_timestamp = true;
+}
+
 uint32_t scan_response::read(::apache::thrift::protocol::TProtocol *iprot)
 {
 
@@ -4211,6 +4253,14 @@ uint32_t scan_response::read(::apache::thrift::protocol::TProtocol *iprot)
                 xfer += iprot->skip(ftype);
             }
             break;
+        case 7:
+            if (ftype == ::apache::thrift::protocol::T_I64) {
+                xfer += iprot->readI64(this->read_timestamp);
+                this->__isset.read_timestamp = true;
+            } else {
+                xfer += iprot->skip(ftype);
+            }
+            break;
         default:
             xfer += iprot->skip(ftype);
             break;
@@ -4261,6 +4311,11 @@ uint32_t scan_response::write(::apache::thrift::protocol::TProtocol *oprot) cons
     xfer += oprot->writeString(this->server);
     xfer += oprot->writeFieldEnd();
 
+    if (this->__isset.read_timestamp) {
+        xfer += oprot->writeFieldBegin("read_timestamp", ::apache::thrift::protocol::T_I64, 7);
+        xfer += oprot->writeI64(this->read_timestamp);
+        xfer += oprot->writeFieldEnd();
+    }
     xfer += oprot->writeFieldStop();
     xfer += oprot->writeStructEnd();
     return xfer;
@@ -4275,6 +4330,7 @@ void swap(scan_response &a, scan_response &b)
     swap(a.app_id, b.app_id);
     swap(a.partition_index, b.partition_index);
     swap(a.server, b.server);
+    swap(a.read_timestamp, b.read_timestamp);
     swap(a.__isset, b.__isset);
 }
 
@@ -4286,6 +4342,7 @@ scan_response::scan_response(const scan_response &other122)
     app_id = other122.app_id;
     partition_index = other122.partition_index;
     server = other122.server;
+    read_timestamp = other122.read_timestamp;
     __isset = other122.__isset;
 }
 scan_response::scan_response(scan_response &&other123)
@@ -4296,6 +4353,7 @@ scan_response::scan_response(scan_response &&other123)
     app_id = std::move(other123.app_id);
     partition_index = std::move(other123.partition_index);
     server = std::move(other123.server);
+    read_timestamp = std::move(other123.read_timestamp);
     __isset = std::move(other123.__isset);
 }
 scan_response &scan_response::operator=(const scan_response &other124)
@@ -4306,6 +4364,7 @@ scan_response &scan_response::operator=(const scan_response &other124)
     app_id = other124.app_id;
     partition_index = other124.partition_index;
     server = other124.server;
+    read_timestamp = other124.read_timestamp;
     __isset = other124.__isset;
     return *this;
 }
@@ -4317,6 +4376,7 @@ scan_response &scan_response::operator=(scan_response &&other125)
     app_id = std::move(other125.app_id);
     partition_index = std::move(other125.partition_index);
     server = std::move(other125.server);
+    read_timestamp = std::move(other125.read_timestamp);
     __isset = std::move(other125.__isset);
     return *this;
 }
@@ -4335,6 +4395,284 @@ void scan_response::printTo(std::ostream &out) const
         << "partition_index=" << to_string(partition_index);
     out << ", "
         << "server=" << to_string(server);
+    out << ", "
+        << "read_timestamp=";
+    (__isset.read_timestamp ? (out << to_string(read_timestamp)) : (out << "<null>"));
+    out << ")";
+}
+
+duplicate_entry::~duplicate_entry() throw() {}
+
+void duplicate_entry::__set_timestamp(const int64_t val)
+{
+    this->timestamp = val;
+    __isset.timestamp = true;
+}
+
+void duplicate_entry::__set_task_code(const ::dsn::task_code &val)
+{
+    this->task_code = val;
+    __isset.task_code = true;
+}
+
+void duplicate_entry::__set_raw_message(const ::dsn::blob &val)
+{
+    this->raw_message = val;
+    __isset.raw_message = true;
+}
+
+uint32_t duplicate_entry::read(::apache::thrift::protocol::TProtocol *iprot)
+{
+
+    apache::thrift::protocol::TInputRecursionTracker tracker(*iprot);
+    uint32_t xfer = 0;
+    std::string fname;
+    ::apache::thrift::protocol::TType ftype;
+    int16_t fid;
+
+    xfer += iprot->readStructBegin(fname);
+
+    using ::apache::thrift::protocol::TProtocolException;
+
+    while (true) {
+        xfer += iprot->readFieldBegin(fname, ftype, fid);
+        if (ftype == ::apache::thrift::protocol::T_STOP) {
+            break;
+        }
+        switch (fid) {
+        case 1:
+            if (ftype == ::apache::thrift::protocol::T_I64) {
+                xfer += iprot->readI64(this->timestamp);
+                this->__isset.timestamp = true;
+            } else {
+                xfer += iprot->skip(ftype);
+            }
+            break;
+        case 2:
+            if (ftype == ::apache::thrift::protocol::T_STRUCT) {
+                xfer += this->task_code.read(iprot);
+                this->__isset.task_code = true;
+            } else {
+                xfer += iprot->skip(ftype);
+            }
+            break;
+        case 3:
+            if (ftype == ::apache::thrift::protocol::T_STRUCT) {
+                xfer += this->raw_message.read(iprot);
+                this->__isset.raw_message = true;
+            } else {
+                xfer += iprot->skip(ftype);
+            }
+            break;
+        default:
+            xfer += iprot->skip(ftype);
+            break;
+        }
+        xfer += iprot->readFieldEnd();
+    }
+
+    xfer += iprot->readStructEnd();
+
+    return xfer;
+}
+
+uint32_t duplicate_entry::write(::apache::thrift::protocol::TProtocol *oprot) const
+{
+    uint32_t xfer = 0;
+    apache::thrift::protocol::TOutputRecursionTracker tracker(*oprot);
+    xfer += oprot->writeStructBegin("duplicate_entry");
+
+    if (this->__isset.timestamp) {
+        xfer += oprot->writeFieldBegin("timestamp", ::apache::thrift::protocol::T_I64, 1);
+        xfer += oprot->writeI64(this->timestamp);
+        xfer += oprot->writeFieldEnd();
+    }
+    if (this->__isset.task_code) {
+        xfer += oprot->writeFieldBegin("task_code", ::apache::thrift::protocol::T_STRUCT, 2);
+        xfer += this->task_code.write(oprot);
+        xfer += oprot->writeFieldEnd();
+    }
+    if (this->__isset.raw_message) {
+        xfer += oprot->writeFieldBegin("raw_message", ::apache::thrift::protocol::T_STRUCT, 3);
+        xfer += this->raw_message.write(oprot);
+        xfer += oprot->writeFieldEnd();
+    }
+    xfer += oprot->writeFieldStop();
+    xfer += oprot->writeStructEnd();
+    return xfer;
+}
+
+void swap(duplicate_entry &a, duplicate_entry &b)
+{
+    using ::std::swap;
+    swap(a.timestamp, b.timestamp);
+    swap(a.task_code, b.task_code);
+    swap(a.raw_message, b.raw_message);
+    swap(a.__isset, b.__isset);
+}
+
+duplicate_entry::duplicate_entry(const duplicate_entry &other134)
+{
+    timestamp = other134.timestamp;
+    task_code = other134.task_code;
+    raw_message = other134.raw_message;
+    __isset = other134.__isset;
+}
+duplicate_entry::duplicate_entry(duplicate_entry &&other135)
+{
+    timestamp = std::move(other135.timestamp);
+    task_code = std::move(other135.task_code);
+    raw_message = std::move(other135.raw_message);
+    __isset = std::move(other135.__isset);
+}
+duplicate_entry &duplicate_entry::operator=(const duplicate_entry &other136)
+{
+    timestamp = other136.timestamp;
+    task_code = other136.task_code;
+    raw_message = other136.raw_message;
+    __isset = other136.__isset;
+    return *this;
+}
+duplicate_entry &duplicate_entry::operator=(duplicate_entry &&other137)
+{
+    timestamp = std::move(other137.timestamp);
+    task_code = std::move(other137.task_code);
+    raw_message = std::move(other137.raw_message);
+    __isset = std::move(other137.__isset);
+    return *this;
+}
+void duplicate_entry::printTo(std::ostream &out) const
+{
+    using ::apache::thrift::to_string;
+    out << "duplicate_entry(";
+    out << "timestamp=";
+    (__isset.timestamp ? (out << to_string(timestamp)) : (out << "<null>"));
+    out << ", "
+        << "task_code=";
+    (__isset.task_code ? (out << to_string(task_code)) : (out << "<null>"));
+    out << ", "
+        << "raw_message=";
+    (__isset.raw_message ? (out << to_string(raw_message)) : (out << "<null>"));
+    out << ")";
+}
+
+duplicate_entries::~duplicate_entries() throw() {}
+
+void duplicate_entries::__set_entries(const std::vector<duplicate_entry> &val)
+{
+    this->entries = val;
+    __isset.entries = true;
+}
+
+uint32_t duplicate_entries::read(::apache::thrift::protocol::TProtocol *iprot)
+{
+
+    apache::thrift::protocol::TInputRecursionTracker tracker(*iprot);
+    uint32_t xfer = 0;
+    std::string fname;
+    ::apache::thrift::protocol::TType ftype;
+    int16_t fid;
+
+    xfer += iprot->readStructBegin(fname);
+
+    using ::apache::thrift::protocol::TProtocolException;
+
+    while (true) {
+        xfer += iprot->readFieldBegin(fname, ftype, fid);
+        if (ftype == ::apache::thrift::protocol::T_STOP) {
+            break;
+        }
+        switch (fid) {
+        case 1:
+            if (ftype == ::apache::thrift::protocol::T_LIST) {
+                {
+                    this->entries.clear();
+                    uint32_t _size145;
+                    ::apache::thrift::protocol::TType _etype148;
+                    xfer += iprot->readListBegin(_etype148, _size145);
+                    this->entries.resize(_size145);
+                    uint32_t _i149;
+                    for (_i149 = 0; _i149 < _size145; ++_i149) {
+                        xfer += this->entries[_i149].read(iprot);
+                    }
+                    xfer += iprot->readListEnd();
+                }
+                this->__isset.entries = true;
+            } else {
+                xfer += iprot->skip(ftype);
+            }
+            break;
+        default:
+            xfer += iprot->skip(ftype);
+            break;
+        }
+        xfer += iprot->readFieldEnd();
+    }
+
+    xfer += iprot->readStructEnd();
+
+    return xfer;
+}
+
+uint32_t duplicate_entries::write(::apache::thrift::protocol::TProtocol *oprot) const
+{
+    uint32_t xfer = 0;
+    apache::thrift::protocol::TOutputRecursionTracker tracker(*oprot);
+    xfer += oprot->writeStructBegin("duplicate_entries");
+
+    if (this->__isset.entries) {
+        xfer += oprot->writeFieldBegin("entries", ::apache::thrift::protocol::T_LIST, 1);
+        {
+            xfer += oprot->writeListBegin(::apache::thrift::protocol::T_STRUCT,
+                                          static_cast<uint32_t>(this->entries.size()));
+            std::vector<duplicate_entry>::const_iterator _iter150;
+            for (_iter150 = this->entries.begin(); _iter150 != this->entries.end(); ++_iter150) {
+                xfer += (*_iter150).write(oprot);
+            }
+            xfer += oprot->writeListEnd();
+        }
+        xfer += oprot->writeFieldEnd();
+    }
+    xfer += oprot->writeFieldStop();
+    xfer += oprot->writeStructEnd();
+    return xfer;
+}
+
+void swap(duplicate_entries &a, duplicate_entries &b)
+{
+    using ::std::swap;
+    swap(a.entries, b.entries);
+    swap(a.__isset, b.__isset);
+}
+
+duplicate_entries::duplicate_entries(const duplicate_entries &other151)
+{
+    entries = other151.entries;
+    __isset = other151.__isset;
+}
+duplicate_entries::duplicate_entries(duplicate_entries &&other152)
+{
+    entries = std::move(other152.entries);
+    __isset = std::move(other152.__isset);
+}
+duplicate_entries &duplicate_entries::operator=(const duplicate_entries &other153)
+{
+    entries = other153.entries;
+    __isset = other153.__isset;
+    return *this;
+}
+duplicate_entries &duplicate_entries::operator=(duplicate_entries &&other154)
+{
+    entries = std::move(other154.entries);
+    __isset = std::move(other154.__isset);
+    return *this;
+}
+void duplicate_entries::printTo(std::ostream &out) const
+{
+    using ::apache::thrift::to_string;
+    out << "duplicate_entries(";
+    out << "entries=";
+    (__isset.entries ? (out << to_string(entries)) : (out << "<null>"));
     out << ")";
 }
 
@@ -4370,6 +4708,18 @@ void duplicate_request::__set_verify_timetag(const bool val)
     __isset.verify_timetag = true;
 }
 
+void duplicate_request::__set_entries(const std::vector<duplicate_entry> &val)
+{
+    this->entries = val;
+    __isset.entries = true;
+}
+
+void duplicate_request::__set_compression_type(const duplicate_compression_type::type val)
+{
+    this->compression_type = val;
+    __isset.compression_type = true;
+}
+
 uint32_t duplicate_request::read(::apache::thrift::protocol::TProtocol *iprot)
 {
 
@@ -4429,6 +4779,35 @@ uint32_t duplicate_request::read(::apache::thrift::protocol::TProtocol *iprot)
                 xfer += iprot->skip(ftype);
             }
             break;
+        case 6:
+            if (ftype == ::apache::thrift::protocol::T_LIST) {
+                {
+                    this->entries.clear();
+                    uint32_t _size138;
+                    ::apache::thrift::protocol::TType _etype141;
+                    xfer += iprot->readListBegin(_etype141, _size138);
+                    this->entries.resize(_size138);
+                    uint32_t _i142;
+                    for (_i142 = 0; _i142 < _size138; ++_i142) {
+                        xfer += this->entries[_i142].read(iprot);
+                    }
+                    xfer += iprot->readListEnd();
+                }
+                this->__isset.entries = true;
+            } else {
+                xfer += iprot->skip(ftype);
+            }
+            break;
+        case 7:
+            if (ftype == ::apache::thrift::protocol::T_I32) {
+                int32_t ecast144;
+                xfer += iprot->readI32(ecast144);
+                this->compression_type = (duplicate_compression_type::type)ecast144;
+                this->__isset.compression_type = true;
+            } else {
+                xfer += iprot->skip(ftype);
+            }
+            break;
         default:
             xfer += iprot->skip(ftype);
             break;
@@ -4472,6 +4851,24 @@ uint32_t duplicate_request::write(::apache::thrift::protocol::TProtocol *oprot)
         xfer += oprot->writeBool(this->verify_timetag);
         xfer += oprot->writeFieldEnd();
     }
+    if (this->__isset.entries) {
+        xfer += oprot->writeFieldBegin("entries", ::apache::thrift::protocol::T_LIST, 6);
+        {
+            xfer += oprot->writeListBegin(::apache::thrift::protocol::T_STRUCT,
+                                          static_cast<uint32_t>(this->entries.size()));
+            std::vector<duplicate_entry>::const_iterator _iter143;
+            for (_iter143 = this->entries.begin(); _iter143 != this->entries.end(); ++_iter143) {
+                xfer += (*_iter143).write(oprot);
+            }
+            xfer += oprot->writeListEnd();
+        }
+        xfer += oprot->writeFieldEnd();
+    }
+    if (this->__isset.compression_type) {
+        xfer += oprot->writeFieldBegin("compression_type", ::apache::thrift::protocol::T_I32, 7);
+        xfer += oprot->writeI32((int32_t)this->compression_type);
+        xfer += oprot->writeFieldEnd();
+    }
     xfer += oprot->writeFieldStop();
     xfer += oprot->writeStructEnd();
     return xfer;
@@ -4485,6 +4882,8 @@ void swap(duplicate_request &a, duplicate_request &b)
     swap(a.raw_message, b.raw_message);
     swap(a.cluster_id, b.cluster_id);
     swap(a.verify_timetag, b.verify_timetag);
+    swap(a.entries, b.entries);
+    swap(a.compression_type, b.compression_type);
     swap(a.__isset, b.__isset);
 }
 
@@ -4495,6 +4894,8 @@ duplicate_request::duplicate_request(const duplicate_request &other126)
     raw_message = other126.raw_message;
     cluster_id = other126.cluster_id;
     verify_timetag = other126.verify_timetag;
+    entries = other126.entries;
+    compression_type = other126.compression_type;
     __isset = other126.__isset;
 }
 duplicate_request::duplicate_request(duplicate_request &&other127)
@@ -4504,6 +4905,8 @@ duplicate_request::duplicate_request(duplicate_request &&other127)
     raw_message = std::move(other127.raw_message);
     cluster_id = std::move(other127.cluster_id);
     verify_timetag = std::move(other127.verify_timetag);
+    entries = std::move(other127.entries);
+    compression_type = std::move(other127.compression_type);
     __isset = std::move(other127.__isset);
 }
 duplicate_request &duplicate_request::operator=(const duplicate_request &other128)
@@ -4513,6 +4916,8 @@ duplicate_request &duplicate_request::operator=(const duplicate_request &other12
     raw_message = other128.raw_message;
     cluster_id = other128.cluster_id;
     verify_timetag = other128.verify_timetag;
+    entries = other128.entries;
+    compression_type = other128.compression_type;
     __isset = other128.__isset;
     return *this;
 }
@@ -4523,6 +4928,8 @@ duplicate_request &duplicate_request::operator=(duplicate_request &&other129)
     raw_message = std::move(other129.raw_message);
     cluster_id = std::move(other129.cluster_id);
     verify_timetag = std::move(other129.verify_timetag);
+    entries = std::move(other129.entries);
+    compression_type = std::move(other129.compression_type);
     __isset = std::move(other129.__isset);
     return *this;
 }
@@ -4544,6 +4951,12 @@ void duplicate_request::printTo(std::ostream &out) const
     out << ", "
         << "verify_timetag=";
     (__isset.verify_timetag ? (out << to_string(verify_timetag)) : (out << "<null>"));
+    out << ", "
+        << "entries=";
+    (__isset.entries ? (out << to_string(entries)) : (out << "<null>"));
+    out << ", "
+        << "compression_type=";
+    (__isset.compression_type ? (out << to_string(compression_type)) : (out << "<null>"));
     out << ")";
 }
 
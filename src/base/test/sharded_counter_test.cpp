@@ -0,0 +1,74 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+
+#include "base/pegasus_sharded_counter.h"
+
+#include <algorithm>
+#include <set>
+#include <gtest/gtest.h>
+
+namespace pegasus {
+
+TEST(sharded_counter_test, shard_count_valid)
+{
+    ASSERT_FALSE(sharded_counter_shard_count_valid(-1));
+    ASSERT_FALSE(sharded_counter_shard_count_valid(0));
+    ASSERT_TRUE(sharded_counter_shard_count_valid(1));
+    ASSERT_TRUE(sharded_counter_shard_count_valid(kMaxShardedCounterShardCount));
+    ASSERT_FALSE(sharded_counter_shard_count_valid(kMaxShardedCounterShardCount + 1));
+}
+
+TEST(sharded_counter_test, hash_key)
+{
+    ASSERT_EQ("counter", sharded_counter_hash_key("counter", 0));
+    ASSERT_EQ(std::string("counter\0#1", 10), sharded_counter_hash_key("counter", 1));
+    ASSERT_EQ(std::string("\0#12", 4), sharded_counter_hash_key("", 12));
+
+    std::set<std::string> hash_keys;
+    for (int i = 0; i < kMaxShardedCounterShardCount; ++i) {
+        ASSERT_TRUE(hash_keys.insert(sharded_counter_hash_key("counter", i)).second);
+    }
+}
+
+TEST(sharded_counter_test, random_shard)
+{
+    for (int shard_count : {1, 2, 7, kMaxShardedCounterShardCount}) {
+        std::set<int> shards;
+        for (int i = 0; i < 10000; ++i) {
+            int shard = sharded_counter_random_shard(shard_count);
+            ASSERT_GE(shard, 0);
+            ASSERT_LT(shard, shard_count);
+            shards.insert(shard);
+        }
+        // the increments of a single thread are spread over the shards
+        ASSERT_EQ(std::min(shard_count, 7), std::min<int>(shards.size(), 7));
+    }
+}
+
+TEST(sharded_counter_test, parse_shard)
+{
+    int64_t value = -1;
+    ASSERT_TRUE(parse_sharded_counter_shard("", value));
+    ASSERT_EQ(0, value);
+    ASSERT_TRUE(parse_sharded_counter_shard("-123", value));
+    ASSERT_EQ(-123, value);
+    ASSERT_FALSE(parse_sharded_counter_shard("abc", value));
+    ASSERT_FALSE(parse_sharded_counter_shard("99999999999999999999", value));
+}
+
+} // namespace pegasus
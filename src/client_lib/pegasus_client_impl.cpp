@@ -17,6 +17,7 @@
  * under the License.
  */
 
+#include <atomic>
 #include <cctype>
 #include <algorithm>
 #include <string>
@@ -30,6 +31,7 @@
 #include <pegasus/error.h>
 #include "pegasus_client_impl.h"
 #include "base/pegasus_const.h"
+#include "base/pegasus_sharded_counter.h"
 
 using namespace ::dsn;
 
@@ -824,6 +826,185 @@ void pegasus_client_impl::async_incr(const std::string &hash_key,
                   partition_hash);
 }
 
+int pegasus_client_impl::incr_sharded_counter(const std::string &hash_key,
+                                              const std::string &sort_key,
+                                              int64_t increment,
+                                              int shard_count,
+                                              int timeout_milliseconds,
+                                              int ttl_seconds)
+{
+    if (!sharded_counter_shard_count_valid(shard_count)) {
+        derror("invalid shard count: should be in [1, %d], but %d",
+               kMaxShardedCounterShardCount,
+               shard_count);
+        return PERR_INVALID_ARGUMENT;
+    }
+    int64_t new_value = 0;
+    return incr(sharded_counter_hash_key(hash_key, sharded_counter_random_shard(shard_count)),
+                sort_key,
+                increment,
+                new_value,
+                timeout_milliseconds,
+                ttl_seconds);
+}
+
+int pegasus_client_impl::get_sharded_counter(const std::string &hash_key,
+                                             const std::string &sort_key,
+                                             int shard_count,
+                                             int64_t &value,
+                                             int timeout_milliseconds)
+{
+    ::dsn::utils::notify_event op_completed;
+    int ret = -1;
+    auto callback = [&](int err, int64_t _value) {
+        ret = err;
+        value = _value;
+        op_completed.notify();
+    };
+    async_get_sharded_counter(
+        hash_key, sort_key, shard_count, std::move(callback), timeout_milliseconds);
+    op_completed.wait();
+    return ret;
+}
+
+void pegasus_client_impl::async_get_sharded_counter(
+    const std::string &hash_key,
+    const std::string &sort_key,
+    int shard_count,
+    async_get_sharded_counter_callback_t &&callback,
+    int timeout_milliseconds)
+{
+    if (!sharded_counter_shard_count_valid(shard_count)) {
+        derror("invalid shard count: should be in [1, %d], but %d",
+               kMaxShardedCounterShardCount,
+               shard_count);
+        if (callback != nullptr)
+            callback(PERR_INVALID_ARGUMENT, 0);
+        return;
+    }
+
+    // each shard response is stored into its own slot, and the last one sums them up
+    struct get_context
+    {
+        std::vector<int> errors;
+        std::vector<int64_t> values;
+        std::atomic<int> pending_count;
+        async_get_sharded_counter_callback_t user_callback;
+    };
+    auto context = std::make_shared<get_context>();
+    context->errors.resize(shard_count, PERR_OK);
+    context->values.resize(shard_count, 0);
+    context->pending_count.store(shard_count);
+    context->user_callback = std::move(callback);
+
+    for (int i = 0; i < shard_count; ++i) {
+        auto shard_callback = [context, i](int err, std::string &&value, internal_info &&) {
+            if (err == PERR_OK && !parse_sharded_counter_shard(value, context->values[i])) {
+                err = PERR_INVALID_ARGUMENT;
+            }
+            context->errors[i] = err;
+            if (context->pending_count.fetch_sub(1) != 1 || context->user_callback == nullptr) {
+                return;
+            }
+
+            bool found = false;
+            int64_t sum = 0;
+            for (size_t j = 0; j < context->errors.size(); ++j) {
+                if (context->errors[j] == PERR_NOT_FOUND) {
+                    continue;
+                }
+                if (context->errors[j] != PERR_OK) {
+                    context->user_callback(context->errors[j], 0);
+                    return;
+                }
+                int64_t v = context->values[j];
+                if ((v > 0 && sum > INT64_MAX - v) || (v < 0 && sum < INT64_MIN - v)) {
+                    context->user_callback(PERR_INVALID_ARGUMENT, 0);
+                    return;
+                }
+                sum += v;
+                found = true;
+            }
+            context->user_callback(found ? PERR_OK : PERR_NOT_FOUND, sum);
+        };
+        async_get(sharded_counter_hash_key(hash_key, i),
+                  sort_key,
+                  std::move(shard_callback),
+                  timeout_milliseconds);
+    }
+}
+
+int pegasus_client_impl::fold_sharded_counter(const std::string &hash_key,
+                                              const std::string &sort_key,
+                                              int shard_count,
+                                              int timeout_milliseconds)
+{
+    if (!sharded_counter_shard_count_valid(shard_count)) {
+        derror("invalid shard count: should be in [1, %d], but %d",
+               kMaxShardedCounterShardCount,
+               shard_count);
+        return PERR_INVALID_ARGUMENT;
+    }
+
+    for (int i = 1; i < shard_count; ++i) {
+        std::string shard_hash_key = sharded_counter_hash_key(hash_key, i);
+        std::string value;
+        int ret = get(shard_hash_key, sort_key, value, timeout_milliseconds);
+        if (ret == PERR_NOT_FOUND) {
+            continue;
+        }
+        if (ret != PERR_OK) {
+            return ret;
+        }
+        int64_t shard_value = 0;
+        if (!parse_sharded_counter_shard(value, shard_value) || shard_value == INT64_MIN) {
+            return PERR_INVALID_ARGUMENT;
+        }
+
+        if (shard_value != 0) {
+            // Take the value out of the shard before adding it to the shard 0, so it's never
+            // counted twice. Both are relative increments, thus the concurrent increments of the
+            // shards are preserved.
+            int64_t new_value = 0;
+            ret = incr(shard_hash_key, sort_key, -shard_value, new_value, timeout_milliseconds);
+            if (ret != PERR_OK) {
+                return ret;
+            }
+            ret = incr(hash_key, sort_key, shard_value, new_value, timeout_milliseconds);
+            if (ret != PERR_OK) {
+                int err =
+                    incr(shard_hash_key, sort_key, shard_value, new_value, timeout_milliseconds);
+                if (err != PERR_OK) {
+                    derror("failed to restore %s to shard %d of sharded counter, error = %s",
+                           std::to_string(shard_value).c_str(),
+                           i,
+                           get_error_string(err));
+                }
+                return ret;
+            }
+        }
+
+        // Remove the shard if it's still 0, the check and the removal are atomic on the
+        // partition of the shard, so a concurrent increment is never lost.
+        mutations muts;
+        muts.del(sort_key);
+        check_and_mutate_options options;
+        check_and_mutate_results results;
+        ret = check_and_mutate(shard_hash_key,
+                               sort_key,
+                               cas_check_type::CT_VALUE_INT_EQUAL,
+                               "0",
+                               muts,
+                               options,
+                               results,
+                               timeout_milliseconds);
+        if (ret != PERR_OK && ret != PERR_TRY_AGAIN) {
+            return ret;
+        }
+    }
+    return PERR_OK;
+}
+
 int pegasus_client_impl::check_and_set(const std::string &hash_key,
                                        const std::string &check_sort_key,
                                        cas_check_type check_type,
@@ -1145,6 +1326,9 @@ int pegasus_client_impl::get_scanner(const std::string &hash_key,
     ::dsn::blob start;
     ::dsn::blob stop;
     scan_options o(options);
+    if (o.point_in_time && o.read_timestamp_us <= 0) {
+        o.read_timestamp_us = static_cast<int64_t>(dsn_now_us());
+    }
 
     // generate key range by start_sort_key and stop_sort_key
     pegasus_generate_key(start, hash_key, start_sort_key);
@@ -1179,11 +1363,79 @@ int pegasus_client_impl::get_scanner(const std::string &hash_key,
     if (c < 0 || (c == 0 && o.start_inclusive && o.stop_inclusive)) {
         v.push_back(pegasus_key_hash(start));
     }
+    if (o.point_in_time && !v.empty()) {
+        ::dsn::utils::notify_event op_completed;
+        int ret = PERR_OK;
+        async_pin_scan_snapshots(v, o, [&](int err) {
+            ret = err;
+            op_completed.notify();
+        });
+        op_completed.wait();
+        if (ret != PERR_OK) {
+            scanner = nullptr;
+            return ret;
+        }
+    }
     scanner = new pegasus_scanner_impl(_client, std::move(v), o, start, stop, false);
 
     return PERR_OK;
 }
 
+void pegasus_client_impl::async_pin_scan_snapshots(const std::vector<uint64_t> &hashes,
+                                                   const scan_options &options,
+                                                   std::function<void(int)> &&callback)
+{
+    // a scan of empty key range pins the snapshot of its read timestamp and returns nothing
+    ::dsn::apps::get_scanner_request req;
+    req.start_inclusive = false;
+    req.stop_inclusive = false;
+    req.batch_size = 0;
+    req.hash_key_filter_type = ::dsn::apps::filter_type::FT_NO_FILTER;
+    req.sort_key_filter_type = ::dsn::apps::filter_type::FT_NO_FILTER;
+    req.no_value = true;
+    req.__set_read_timestamp(options.read_timestamp_us);
+
+    struct pin_state
+    {
+        std::atomic<size_t> remaining;
+        std::atomic<int> error;
+        std::function<void(int)> callback;
+    };
+    auto state = std::make_shared<pin_state>();
+    state->remaining = hashes.size();
+    state->error = PERR_OK;
+    state->callback = std::move(callback);
+    for (uint64_t hash : hashes) {
+        _client->get_scanner(
+            req,
+            [state](::dsn::error_code err, dsn::message_ex *req, dsn::message_ex *resp) {
+                int ret = PERR_OK;
+                if (err == ERR_OK) {
+                    ::dsn::apps::scan_response response;
+                    ::dsn::unmarshall(resp, response);
+                    if (response.error != 0) {
+                        ret = get_client_error(get_rocksdb_server_error(response.error));
+                    } else if (!response.__isset.read_timestamp) {
+                        derror("point-in-time scan is not supported by server %s",
+                               response.server.c_str());
+                        ret = PERR_NOT_SUPPORTED;
+                    }
+                } else {
+                    ret = get_client_error(int(err));
+                }
+                if (ret != PERR_OK) {
+                    int expected = PERR_OK;
+                    state->error.compare_exchange_strong(expected, ret);
+                }
+                if (--state->remaining == 0) {
+                    state->callback(state->error.load());
+                }
+            },
+            std::chrono::milliseconds(options.timeout_ms),
+            hash);
+    }
+}
+
 DEFINE_TASK_CODE_RPC(RPC_CM_QUERY_PARTITION_CONFIG_BY_INDEX,
                      TASK_PRIORITY_COMMON,
                      ::dsn::THREAD_POOL_DEFAULT)
@@ -1203,7 +1455,13 @@ void pegasus_client_impl::async_get_unordered_scanners(
         return;
     }
 
-    auto new_callback = [ user_callback = std::move(callback), max_split_count, options, this ](
+    scan_options o(options);
+    if (o.point_in_time && o.read_timestamp_us <= 0) {
+        // all the partitions are read as of the same timestamp
+        o.read_timestamp_us = static_cast<int64_t>(dsn_now_us());
+    }
+
+    auto new_callback = [ user_callback = std::move(callback), max_split_count, options = o, this ](
         ::dsn::error_code err, dsn::message_ex * req, dsn::message_ex * resp)
     {
         std::vector<pegasus_scanner *> scanners;
@@ -1228,7 +1486,25 @@ void pegasus_client_impl::async_get_unordered_scanners(
             }
         }
         int ret = get_client_error(err == ERR_OK ? int(response.err) : int(err));
-        user_callback(ret, std::move(scanners));
+        if (ret != PERR_OK || !options.point_in_time || scanners.empty()) {
+            user_callback(ret, std::move(scanners));
+            return;
+        }
+
+        std::vector<uint64_t> hashes(response.partition_count);
+        for (int i = 0; i < response.partition_count; i++) {
+            hashes[i] = i;
+        }
+        async_pin_scan_snapshots(
+            hashes, options, [user_callback, scanners = std::move(scanners)](int err) mutable {
+                if (err != PERR_OK) {
+                    for (auto scanner : scanners) {
+                        delete scanner;
+                    }
+                    scanners.clear();
+                }
+                user_callback(err, std::move(scanners));
+            });
     };
 
     configuration_query_by_index_request req;
@@ -1259,6 +1535,14 @@ int pegasus_client_impl::get_unordered_scanners(int max_split_count,
     return ret;
 }
 
+int pegasus_client_impl::get_scanner_by_resume_token(const std::string &token,
+                                                     const scan_options &options,
+                                                     pegasus_scanner *&scanner)
+{
+    scanner = pegasus_scanner_impl::from_resume_token(_client, token, options);
+    return scanner == nullptr ? PERR_INVALID_ARGUMENT : PERR_OK;
+}
+
 void pegasus_client_impl::async_duplicate(dsn::apps::duplicate_rpc rpc,
                                           std::function<void(dsn::error_code)> &&callback,
                                           dsn::task_tracker *tracker)
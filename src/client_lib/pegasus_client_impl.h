@@ -169,6 +169,31 @@ public:
                             int timeout_milliseconds = 5000,
                             int ttl_seconds = 0) override;
 
+    virtual int incr_sharded_counter(const std::string &hashkey,
+                                     const std::string &sortkey,
+                                     int64_t increment,
+                                     int shard_count,
+                                     int timeout_milliseconds = 5000,
+                                     int ttl_seconds = 0) override;
+
+    virtual int get_sharded_counter(const std::string &hashkey,
+                                    const std::string &sortkey,
+                                    int shard_count,
+                                    int64_t &value,
+                                    int timeout_milliseconds = 5000) override;
+
+    virtual void
+    async_get_sharded_counter(const std::string &hashkey,
+                              const std::string &sortkey,
+                              int shard_count,
+                              async_get_sharded_counter_callback_t &&callback = nullptr,
+                              int timeout_milliseconds = 5000) override;
+
+    virtual int fold_sharded_counter(const std::string &hashkey,
+                                     const std::string &sortkey,
+                                     int shard_count,
+                                     int timeout_milliseconds = 5000) override;
+
     virtual int check_and_set(const std::string &hash_key,
                               const std::string &check_sort_key,
                               cas_check_type check_type,
@@ -236,6 +261,10 @@ public:
                                  const scan_options &options,
                                  async_get_unordered_scanners_callback_t &&callback) override;
 
+    virtual int get_scanner_by_resume_token(const std::string &token,
+                                            const scan_options &options,
+                                            pegasus_scanner *&scanner) override;
+
     /// \internal
     /// This is an internal function for duplication.
     /// \see pegasus::server::pegasus_mutation_duplicator
@@ -261,6 +290,8 @@ public:
 
         pegasus_scanner_wrapper get_smart_wrapper() override;
 
+        int get_resume_token(std::string &token) const override;
+
         ~pegasus_scanner_impl() override;
 
         pegasus_scanner_impl(::dsn::apps::rrdb_client *client,
@@ -274,6 +305,12 @@ public:
                              const ::dsn::blob &stop_key,
                              bool validate_partition_hash);
 
+        // Creates a scanner which continues from the position of the resume token, nullptr is
+        // returned if the token is invalid.
+        static pegasus_scanner_impl *from_resume_token(::dsn::apps::rrdb_client *client,
+                                                       const std::string &token,
+                                                       const scan_options &options);
+
     private:
         ::dsn::apps::rrdb_client *_client;
         ::dsn::blob _start_key;
@@ -326,6 +363,13 @@ private:
         }
     };
 
+    // Pins the snapshots of the point-in-time scan on the partitions of `hashes` before the scan
+    // goes on, so that the records updated since the read timestamp are not missing from the
+    // partitions scanned later. `callback` is called with the error after all of them are done.
+    void async_pin_scan_snapshots(const std::vector<uint64_t> &hashes,
+                                  const scan_options &options,
+                                  std::function<void(int)> &&callback);
+
 private:
     std::string _cluster_name;
     std::string _app_name;
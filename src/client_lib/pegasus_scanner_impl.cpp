@@ -17,6 +17,10 @@
  * under the License.
  */
 
+#include <cerrno>
+#include <cstdlib>
+#include <sstream>
+
 #include "pegasus_client_impl.h"
 #include "base/pegasus_const.h"
 
@@ -26,6 +30,78 @@ using namespace pegasus;
 namespace pegasus {
 namespace client {
 
+// The resume token is formatted as:
+//   <version>|<read_timestamp_us>|<validate_partition_hash>|<start_inclusive>|<stop_inclusive>|
+//   <start_key>|<stop_key>|<hashes of the partitions not started>|<hash of the partition in
+//   progress>|<the last key returned from the partition in progress>
+// the keys are hex-encoded, and the hashes are separated by ','. The hash of the partition in
+// progress is empty if there is no such partition.
+static const char *kResumeTokenVersion = "1";
+static const size_t kResumeTokenFieldCount = 10;
+
+static std::string encode_token_key(const ::dsn::blob &key)
+{
+    static const char *kHexDigits = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(key.length() * 2);
+    for (unsigned int i = 0; i < key.length(); ++i) {
+        auto c = static_cast<unsigned char>(key.data()[i]);
+        hex.push_back(kHexDigits[c >> 4]);
+        hex.push_back(kHexDigits[c & 0x0f]);
+    }
+    return hex;
+}
+
+static bool decode_token_key(const std::string &hex, ::dsn::blob &key)
+{
+    auto hex_value = [](char c) -> int {
+        if (c >= '0' && c <= '9') {
+            return c - '0';
+        }
+        if (c >= 'a' && c <= 'f') {
+            return c - 'a' + 10;
+        }
+        return -1;
+    };
+    if (hex.size() % 2 != 0) {
+        return false;
+    }
+    std::string data;
+    data.reserve(hex.size() / 2);
+    for (size_t i = 0; i < hex.size(); i += 2) {
+        int high = hex_value(hex[i]);
+        int low = hex_value(hex[i + 1]);
+        if (high < 0 || low < 0) {
+            return false;
+        }
+        data.push_back(static_cast<char>(high << 4 | low));
+    }
+    key = ::dsn::blob::create_from_bytes(std::move(data));
+    return true;
+}
+
+static bool parse_token_integer(const std::string &str, int64_t &value)
+{
+    if (str.empty()) {
+        return false;
+    }
+    char *end = nullptr;
+    errno = 0;
+    value = strtoll(str.c_str(), &end, 10);
+    return errno == 0 && *end == '\0';
+}
+
+static bool parse_token_hash(const std::string &str, uint64_t &hash)
+{
+    if (str.empty() || str[0] == '-') {
+        return false;
+    }
+    char *end = nullptr;
+    errno = 0;
+    hash = strtoull(str.c_str(), &end, 10);
+    return errno == 0 && *end == '\0';
+}
+
 pegasus_client_impl::pegasus_scanner_impl::pegasus_scanner_impl(::dsn::apps::rrdb_client *client,
                                                                 std::vector<uint64_t> &&hash,
                                                                 const scan_options &options,
@@ -108,6 +184,102 @@ pegasus_client_impl::pegasus_scanner_impl::get_smart_wrapper()
     return std::make_shared<pegasus_scanner_impl_wrapper>(this);
 }
 
+int pegasus_client_impl::pegasus_scanner_impl::get_resume_token(std::string &token) const
+{
+    ::dsn::zauto_lock l(_lock);
+
+    std::ostringstream out;
+    out << kResumeTokenVersion << '|'
+        << (_options.point_in_time ? _options.read_timestamp_us : 0) << '|'
+        << _validate_partition_hash << '|' << _options.start_inclusive << '|'
+        << _options.stop_inclusive << '|' << encode_token_key(_start_key) << '|'
+        << encode_token_key(_stop_key) << '|';
+    for (size_t i = 0; i < _splits_hash.size(); ++i) {
+        out << (i == 0 ? "" : ",") << _splits_hash[i];
+    }
+    out << '|';
+    // `_p` points to the last k-v returned from the partition in progress
+    if (_p >= 0 && static_cast<size_t>(_p) < _kvs.size()) {
+        out << _hash << '|' << encode_token_key(_kvs[_p].key);
+    } else {
+        out << '|';
+    }
+    token = out.str();
+    return PERR_OK;
+}
+
+/*static*/ pegasus_client_impl::pegasus_scanner_impl *
+pegasus_client_impl::pegasus_scanner_impl::from_resume_token(::dsn::apps::rrdb_client *client,
+                                                            const std::string &token,
+                                                            const scan_options &options)
+{
+    std::vector<std::string> fields;
+    std::istringstream in(token);
+    std::string field;
+    while (std::getline(in, field, '|')) {
+        fields.emplace_back(std::move(field));
+    }
+    // getline() drops the last empty field
+    if (!token.empty() && token.back() == '|') {
+        fields.emplace_back();
+    }
+    if (fields.size() != kResumeTokenFieldCount || fields[0] != kResumeTokenVersion) {
+        derror("invalid resume token: %s", token.c_str());
+        return nullptr;
+    }
+
+    int64_t read_timestamp_us = 0;
+    int64_t validate_partition_hash = 0;
+    int64_t start_inclusive = 0;
+    int64_t stop_inclusive = 0;
+    ::dsn::blob start_key, stop_key, last_key;
+    if (!parse_token_integer(fields[1], read_timestamp_us) || read_timestamp_us < 0 ||
+        !parse_token_integer(fields[2], validate_partition_hash) ||
+        !parse_token_integer(fields[3], start_inclusive) ||
+        !parse_token_integer(fields[4], stop_inclusive) ||
+        !decode_token_key(fields[5], start_key) || !decode_token_key(fields[6], stop_key) ||
+        !decode_token_key(fields[9], last_key)) {
+        derror("invalid resume token: %s", token.c_str());
+        return nullptr;
+    }
+
+    std::vector<uint64_t> hashes;
+    std::istringstream hash_in(fields[7]);
+    while (std::getline(hash_in, field, ',')) {
+        uint64_t hash = 0;
+        if (!parse_token_hash(field, hash)) {
+            derror("invalid resume token: %s", token.c_str());
+            return nullptr;
+        }
+        hashes.push_back(hash);
+    }
+    uint64_t hash_in_progress = 0;
+    bool in_progress = !fields[8].empty();
+    if (in_progress && !parse_token_hash(fields[8], hash_in_progress)) {
+        derror("invalid resume token: %s", token.c_str());
+        return nullptr;
+    }
+
+    scan_options o(options);
+    o.start_inclusive = start_inclusive != 0;
+    o.stop_inclusive = stop_inclusive != 0;
+    o.point_in_time = read_timestamp_us > 0;
+    o.read_timestamp_us = read_timestamp_us;
+    auto scanner = new pegasus_scanner_impl(
+        client, std::move(hashes), o, start_key, stop_key, validate_partition_hash != 0);
+    if (in_progress) {
+        // Continue the partition in progress just like its scan context is expired: the scan is
+        // restarted after the last key returned.
+        ::dsn::apps::key_value kv;
+        kv.key = std::move(last_key);
+        scanner->_hash = hash_in_progress;
+        scanner->_kvs.emplace_back(std::move(kv));
+        scanner->_p = 0;
+        scanner->_context = SCAN_CONTEXT_ID_NOT_EXIST;
+    }
+    return scanner;
+}
+
 // rpc won't be executed concurrently
 void pegasus_client_impl::pegasus_scanner_impl::_async_next_internal()
 {
@@ -225,6 +397,9 @@ void pegasus_client_impl::pegasus_scanner_impl::_start_scan()
     req.no_value = _options.no_value;
     req.__set_validate_partition_hash(_validate_partition_hash);
     req.__set_return_expire_ts(_options.return_expire_ts);
+    if (_options.point_in_time) {
+        req.__set_read_timestamp(_options.read_timestamp_us);
+    }
 
     dassert(!_rpc_started, "");
     _rpc_started = true;
@@ -244,6 +419,7 @@ void pegasus_client_impl::pegasus_scanner_impl::_on_scan_response(::dsn::error_c
     dassert(_rpc_started, "");
     _rpc_started = false;
     ::dsn::apps::scan_response response;
+    int ret = PERR_OK;
     if (err == ERR_OK) {
         ::dsn::unmarshall(resp, response);
         _info.app_id = response.app_id;
@@ -251,7 +427,11 @@ void pegasus_client_impl::pegasus_scanner_impl::_on_scan_response(::dsn::error_c
         _info.decree = -1;
         _info.server = response.server;
 
-        if (response.error == 0) {
+        if (response.error == 0 && _options.point_in_time && !response.__isset.read_timestamp) {
+            // the server doesn't know the read timestamp, the latest data is returned
+            derror("point-in-time scan is not supported by server %s", response.server.c_str());
+            ret = PERR_NOT_SUPPORTED;
+        } else if (response.error == 0) {
             _lock.lock();
             _kvs = std::move(response.kvs);
             _p = -1;
@@ -272,8 +452,10 @@ void pegasus_client_impl::pegasus_scanner_impl::_on_scan_response(::dsn::error_c
     }
 
     // error occured
-    auto ret =
-        get_client_error(err == ERR_OK ? get_rocksdb_server_error(response.error) : int(err));
+    if (ret == PERR_OK) {
+        ret = get_client_error(err == ERR_OK ? get_rocksdb_server_error(response.error)
+                                             : int(err));
+    }
     internal_info info = _info;
     std::list<async_scan_next_callback_t> temp;
     _lock.lock();
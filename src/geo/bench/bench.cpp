@@ -32,11 +32,78 @@
 
 static const int data_count = 10000;
 
+enum class histogram_type : uint32_t
+{
+    LATENCY,
+    RESULT_COUNT
+};
+
+// search around `test_count` points sampled from `rect`, the same points are sampled for the same
+// `seed`, which should differ from the one of the generated data
+static void search(pegasus::geo::geo_client &my_geo,
+                   const S2LatLngRect &rect,
+                   double radius,
+                   int test_count,
+                   int count,
+                   pegasus::geo::geo_client::SortType sort_type,
+                   int seed)
+{
+    S2Testing::rnd.Reset(seed);
+    auto statistics = rocksdb::CreateDBStatistics();
+    rocksdb::Env *env = rocksdb::Env::Default();
+    uint64_t start = env->NowNanos();
+    std::atomic<uint64_t> left_count(test_count);
+    dsn::utils::notify_event get_completed;
+
+    // test search_radial by lat & lng
+    for (int i = 0; i < test_count; ++i) {
+        S2LatLng latlng(S2Testing::SamplePoint(rect));
+
+        uint64_t start_nanos = env->NowNanos();
+        my_geo.async_search_radial(
+            latlng.lat().degrees(),
+            latlng.lng().degrees(),
+            radius,
+            count,
+            sort_type,
+            500,
+            [&, start_nanos](int error_code, std::list<pegasus::geo::SearchResult> &&results) {
+                statistics->measureTime(static_cast<uint32_t>(histogram_type::LATENCY),
+                                        env->NowNanos() - start_nanos);
+                statistics->measureTime(static_cast<uint32_t>(histogram_type::RESULT_COUNT),
+                                        results.size());
+                uint64_t left = left_count.fetch_sub(1);
+                if (left == 1) {
+                    get_completed.notify();
+                }
+            });
+    }
+    std::cout << "get_completed.wait" << std::endl;
+    get_completed.wait();
+    uint64_t end = env->NowNanos();
+
+    std::cout << "count: " << count << ", sort_type: " << static_cast<int>(sort_type)
+              << ", start time: " << start << ", end time: " << end
+              << ", QPS: " << test_count / ((end - start) / 1e9) << std::endl;
+    std::cout << "latency_histogram: " << std::endl;
+    std::cout << statistics->getHistogramString(static_cast<uint32_t>(histogram_type::LATENCY))
+              << std::endl;
+    std::cout << "result_count_histogram: " << std::endl;
+    std::cout << statistics->getHistogramString(static_cast<uint32_t>(histogram_type::RESULT_COUNT))
+              << std::endl;
+}
+
+// USAGE: <cluster_name> <app_name> <geo_app_name> <radius> <test_count> <max_level> [gen_data]
+//        [nearest_count]
+//     If `nearest_count` is set, the nearest `nearest_count` points are searched around the
+//     same points twice: first by sorting all the points in the radius, as it's done for
+//     'count = -1', then by the top-K search which stops once no nearer point can be found, so
+//     the gain of the early termination is shown.
 int main(int argc, char **argv)
 {
     if (argc < 7) {
         std::cerr << "USAGE: " << argv[0] << " <cluster_name> <app_name> <geo_app_name> <radius> "
-                                             "<test_count> <max_level> [gen_data]"
+                                             "<test_count> <max_level> [gen_data] [nearest_count]"
                   << std::endl;
         return -1;
     }
@@ -66,6 +133,13 @@ int main(int argc, char **argv)
             return -1;
         }
     }
+    int nearest_count = 0;
+    if (argc >= 9) {
+        if (!dsn::buf2int32(argv[8], nearest_count) || nearest_count <= 0) {
+            std::cerr << "nearest_count is invalid: " << argv[8] << std::endl;
+            return -1;
+        }
+    }
 
     pegasus::geo::geo_client my_geo(
         "config.ini", cluster_name.c_str(), app_name.c_str(), geo_app_name.c_str());
@@ -93,52 +167,20 @@ int main(int argc, char **argv)
         }
     }
 
-    enum class histogram_type : uint32_t
-    {
-        LATENCY,
-        RESULT_COUNT
-    };
-    auto statistics = rocksdb::CreateDBStatistics();
-    rocksdb::Env *env = rocksdb::Env::Default();
-    uint64_t start = env->NowNanos();
-    std::atomic<uint64_t> count(test_count);
-    dsn::utils::notify_event get_completed;
-
-    // test search_radial by lat & lng
-    for (int i = 0; i < test_count; ++i) {
-        S2LatLng latlng(S2Testing::SamplePoint(rect));
-
-        uint64_t start_nanos = env->NowNanos();
-        my_geo.async_search_radial(
-            latlng.lat().degrees(),
-            latlng.lng().degrees(),
-            radius,
-            -1,
-            pegasus::geo::geo_client::SortType::random,
-            500,
-            [&, start_nanos](int error_code, std::list<pegasus::geo::SearchResult> &&results) {
-                statistics->measureTime(static_cast<uint32_t>(histogram_type::LATENCY),
-                                        env->NowNanos() - start_nanos);
-                statistics->measureTime(static_cast<uint32_t>(histogram_type::RESULT_COUNT),
-                                        results.size());
-                uint64_t left = count.fetch_sub(1);
-                if (left == 1) {
-                    get_completed.notify();
-                }
-            });
+    if (nearest_count <= 0) {
+        search(my_geo, rect, radius, test_count, -1, pegasus::geo::geo_client::SortType::random, 1);
+        return 0;
     }
-    std::cout << "get_completed.wait" << std::endl;
-    get_completed.wait();
-    uint64_t end = env->NowNanos();
-
-    std::cout << "start time: " << start << ", end time: " << end
-              << ", QPS: " << test_count / ((end - start) / 1e9) << std::endl;
-    std::cout << "latency_histogram: " << std::endl;
-    std::cout << statistics->getHistogramString(static_cast<uint32_t>(histogram_type::LATENCY))
-              << std::endl;
-    std::cout << "result_count_histogram: " << std::endl;
-    std::cout << statistics->getHistogramString(static_cast<uint32_t>(histogram_type::RESULT_COUNT))
-              << std::endl;
+    // all the points in the radius are read and sorted
+    search(my_geo, rect, radius, test_count, -1, pegasus::geo::geo_client::SortType::asc, 1);
+    // only the nearest `nearest_count` points are kept, and the search stops early
+    search(my_geo,
+           rect,
+           radius,
+           test_count,
+           nearest_count,
+           pegasus::geo::geo_client::SortType::asc,
+           1);
 
     return 0;
 }
@@ -19,9 +19,12 @@
 
 #include "geo_client.h"
 
+#include <algorithm>
+#include <iterator>
 #include <s2/s2earth.h>
 #include <s2/s2region_coverer.h>
 #include <s2/s2cap.h>
+#include <s2/s2metrics.h>
 #include <dsn/service_api_cpp.h>
 #include <dsn/dist/fmt_logging.h>
 #include <dsn/utility/errors.h>
@@ -48,6 +51,28 @@ struct SearchResultFarther
     }
 };
 
+// keep the first `count` results ordered by `Compare` in `heap`, whose top is the last of them,
+// so a result is dropped at once if it's not before the top. All the results are kept if `count`
+// is not positive
+template <typename Compare>
+static void
+keep_top(std::vector<SearchResult> &&results, int count, std::vector<SearchResult> &heap)
+{
+    Compare compare;
+    for (SearchResult &r : results) {
+        if (count > 0 && heap.size() >= static_cast<size_t>(count)) {
+            if (!compare(r, heap.front())) {
+                continue;
+            }
+            std::pop_heap(heap.begin(), heap.end(), compare);
+            heap.back() = std::move(r);
+        } else {
+            heap.emplace_back(std::move(r));
+        }
+        std::push_heap(heap.begin(), heap.end(), compare);
+    }
+}
+
 geo_client::geo_client(const char *config_file,
                        const char *cluster_name,
                        const char *common_app_name,
@@ -529,14 +554,34 @@ void geo_client::async_search_radial(const S2LatLng &latlng,
     S2CellUnion cids;
     gen_cells_covered_by_cap(*cap_ptr, cids);
 
-    // search data in the cell ids
-    async_get_result_from_cells(cids,
+    // generate the areas to scan in the cell ids
+    std::vector<scan_area> areas;
+    gen_scan_areas(cids, *cap_ptr, areas);
+
+    if (sort_type == SortType::asc && count > 0) {
+        // only the nearest `count` results are needed, so the areas are searched from the
+        // nearest ones, and the farther ones are skipped if they can't hold a nearer result
+        std::stable_sort(areas.begin(), areas.end(), [](const scan_area &l, const scan_area &r) {
+            return l.min_distance < r.min_distance;
+        });
+        async_get_nearest_results(std::make_shared<std::vector<scan_area>>(std::move(areas)),
+                                  0,
+                                  cap_ptr,
+                                  count,
+                                  dsn_now_ms() + timeout_ms,
+                                  std::make_shared<std::vector<SearchResult>>(),
+                                  std::move(callback));
+        return;
+    }
+
+    // search data in the areas
+    async_get_result_from_cells(std::move(areas),
                                 cap_ptr,
                                 count,
                                 sort_type,
                                 timeout_ms,
                                 [ this, count, sort_type, cb = std::move(callback) ](
-                                    std::list<std::list<SearchResult>> && results_) {
+                                    std::vector<std::vector<SearchResult>> && results_) {
                                     std::list<SearchResult> result;
                                     normalize_result(std::move(results_), count, sort_type, result);
                                     cb(PERR_OK, std::move(result));
@@ -556,45 +601,18 @@ void geo_client::gen_cells_covered_by_cap(const S2Cap &cap, S2CellUnion &cids)
     cids = rc.GetCovering(cap);
 }
 
-void geo_client::async_get_result_from_cells(const S2CellUnion &cids,
-                                             std::shared_ptr<S2Cap> cap_ptr,
-                                             int count,
-                                             SortType sort_type,
-                                             int timeout_ms,
-                                             scan_all_area_callback_t &&callback)
+void geo_client::gen_scan_areas(const S2CellUnion &cids,
+                                const S2Cap &cap,
+                                std::vector<scan_area> &areas)
 {
-    int single_scan_count = count;
-    if (sort_type == SortType::asc || sort_type == SortType::desc) {
-        single_scan_count = -1; // scan all data to make full sort
-    }
-
-    // scan all cell ids
-    std::shared_ptr<std::list<std::list<SearchResult>>> results =
-        std::make_shared<std::list<std::list<SearchResult>>>();
-    std::shared_ptr<std::atomic<bool>> send_finish = std::make_shared<std::atomic<bool>>(false);
-    std::shared_ptr<std::atomic<int>> scan_count = std::make_shared<std::atomic<int>>(0);
-    auto single_scan_finish_callback =
-        [ send_finish, scan_count, results, cb = std::move(callback) ]()
-    {
-        // NOTE: make sure fetch_sub is at first of the if expression to make it always execute
-        if (scan_count->fetch_sub(1) == 1 && send_finish->load()) {
-            cb(std::move(*results.get()));
-        }
-    };
-
+    areas.clear();
     for (const auto &cid : cids) {
-        if (cap_ptr->Contains(S2Cell(cid))) {
+        S2Cell cell(cid);
+        // no point in the cell is nearer to the center than the cell itself
+        double min_distance = S2Earth::ToMeters(cell.GetDistance(cap.center()));
+        if (cap.Contains(cell)) {
             // for the full contained cell, scan all data in this cell(which is at the `_min_level`)
-            results->emplace_back(std::list<SearchResult>());
-            scan_count->fetch_add(1);
-            start_scan(cid.ToString(),
-                       "",
-                       "",
-                       cap_ptr,
-                       single_scan_count,
-                       timeout_ms,
-                       single_scan_finish_callback,
-                       results->back());
+            areas.push_back(scan_area{cid.ToString(), "", "", min_distance});
         } else {
             // for the partial contained cell, scan cells covered by the cap at the `_max_level`
             // which is more accurate than the ones at `_min_level`, but it will cost more time on
@@ -606,7 +624,7 @@ void geo_client::async_get_result_from_cells(const S2CellUnion &cids,
             // the needed ones.
             for (S2CellId cur = cid.child_begin(_max_level); cur != cid.child_end(_max_level);
                  cur = cur.next()) {
-                if (cap_ptr->MayIntersect(S2Cell(cur))) {
+                if (cap.MayIntersect(S2Cell(cur))) {
                     // only cells whose any vertex is contained by the cap is needed
                     if (!pre.is_valid()) {
                         // `cur` is the very first cell in Hilbert curve contained by the cap
@@ -617,16 +635,10 @@ void geo_client::async_get_result_from_cells(const S2CellUnion &cids,
                             // `pre` is the last cell in Hilbert curve contained by the cap
                             // `cur` is a new start cell in Hilbert curve contained by the cap
                             start_stop_sort_keys.second = gen_stop_sort_key(pre, hash_key);
-                            results->emplace_back(std::list<SearchResult>());
-                            scan_count->fetch_add(1);
-                            start_scan(hash_key,
-                                       std::move(start_stop_sort_keys.first),
-                                       std::move(start_stop_sort_keys.second),
-                                       cap_ptr,
-                                       single_scan_count,
-                                       timeout_ms,
-                                       single_scan_finish_callback,
-                                       results->back());
+                            areas.push_back(scan_area{hash_key,
+                                                      std::move(start_stop_sort_keys.first),
+                                                      std::move(start_stop_sort_keys.second),
+                                                      min_distance});
 
                             start_stop_sort_keys.first = gen_start_sort_key(cur, hash_key);
                             start_stop_sort_keys.second.clear();
@@ -640,19 +652,53 @@ void geo_client::async_get_result_from_cells(const S2CellUnion &cids,
             // the last sub slice of current `cid` on `_max_level` in Hilbert curve covered by `cap`
             if (start_stop_sort_keys.second.empty()) {
                 start_stop_sort_keys.second = gen_stop_sort_key(pre, hash_key);
-                results->emplace_back(std::list<SearchResult>());
-                scan_count->fetch_add(1);
-                start_scan(hash_key,
-                           std::move(start_stop_sort_keys.first),
-                           std::move(start_stop_sort_keys.second),
-                           cap_ptr,
-                           single_scan_count,
-                           timeout_ms,
-                           single_scan_finish_callback,
-                           results->back());
+                areas.push_back(scan_area{hash_key,
+                                          std::move(start_stop_sort_keys.first),
+                                          std::move(start_stop_sort_keys.second),
+                                          min_distance});
             }
         }
     }
+}
+
+void geo_client::async_get_result_from_cells(std::vector<scan_area> &&areas,
+                                             std::shared_ptr<S2Cap> cap_ptr,
+                                             int count,
+                                             SortType sort_type,
+                                             int timeout_ms,
+                                             scan_all_area_callback_t &&callback)
+{
+    int single_scan_count = count;
+    if (sort_type == SortType::asc || sort_type == SortType::desc) {
+        single_scan_count = -1; // scan all data to make full sort
+    }
+
+    // scan all areas, the results of an area are placed at the position of the area, which is
+    // allocated before any scan is started
+    std::shared_ptr<std::vector<std::vector<SearchResult>>> results =
+        std::make_shared<std::vector<std::vector<SearchResult>>>(areas.size());
+    std::shared_ptr<std::atomic<bool>> send_finish = std::make_shared<std::atomic<bool>>(false);
+    std::shared_ptr<std::atomic<int>> scan_count = std::make_shared<std::atomic<int>>(0);
+    auto single_scan_finish_callback =
+        [ send_finish, scan_count, results, cb = std::move(callback) ]()
+    {
+        // NOTE: make sure fetch_sub is at first of the if expression to make it always execute
+        if (scan_count->fetch_sub(1) == 1 && send_finish->load()) {
+            cb(std::move(*results.get()));
+        }
+    };
+
+    for (size_t i = 0; i < areas.size(); ++i) {
+        scan_count->fetch_add(1);
+        start_scan(areas[i].hash_key,
+                   std::move(areas[i].start_sort_key),
+                   std::move(areas[i].stop_sort_key),
+                   cap_ptr,
+                   single_scan_count,
+                   timeout_ms,
+                   single_scan_finish_callback,
+                   (*results)[i]);
+    }
 
     // when all scan rpc have received before send_finish is set to true, the callback will never be
     // called, so we add 2 lines tricky code as follows
@@ -661,25 +707,89 @@ void geo_client::async_get_result_from_cells(const S2CellUnion &cids,
     single_scan_finish_callback();
 }
 
-void geo_client::normalize_result(std::list<std::list<SearchResult>> &&results,
+void geo_client::async_get_nearest_results(std::shared_ptr<std::vector<scan_area>> areas,
+                                           size_t next,
+                                           std::shared_ptr<S2Cap> cap_ptr,
+                                           int count,
+                                           uint64_t deadline_ms,
+                                           std::shared_ptr<std::vector<SearchResult>> nearest,
+                                           geo_search_callback_t &&callback)
+{
+    uint64_t now_ms = dsn_now_ms();
+    bool complete = next >= areas->size() || now_ms >= deadline_ms;
+    if (!complete && nearest->size() >= static_cast<size_t>(count)) {
+        // the farthest of the nearest results is at the top of the heap, the remaining areas
+        // can't hold a nearer result if the nearest of them is not nearer than it
+        complete = nearest->front().distance <= (*areas)[next].min_distance;
+    }
+    if (complete) {
+        std::sort_heap(nearest->begin(), nearest->end(), SearchResultNearer());
+        std::list<SearchResult> result(std::make_move_iterator(nearest->begin()),
+                                       std::make_move_iterator(nearest->end()));
+        callback(PERR_OK, std::move(result));
+        return;
+    }
+
+    // the ring is the areas whose min distances are within the edge length of a cell at
+    // `_min_level` from the nearest remaining area, they are scanned concurrently
+    double ring_end = (*areas)[next].min_distance +
+                      S2Earth::ToMeters(S1Angle::Radians(S2::kAvgEdge.GetValue(_min_level)));
+    size_t end = next;
+    std::vector<scan_area> ring;
+    while (end < areas->size() && (*areas)[end].min_distance < ring_end) {
+        ring.push_back((*areas)[end]);
+        ++end;
+    }
+
+    async_get_result_from_cells(
+        std::move(ring),
+        cap_ptr,
+        count,
+        SortType::asc,
+        static_cast<int>(deadline_ms - now_ms),
+        [ this, areas, end, cap_ptr, count, deadline_ms, nearest, cb = std::move(callback) ](
+            std::vector<std::vector<SearchResult>> && results_) mutable {
+            for (auto &r : results_) {
+                keep_top<SearchResultNearer>(std::move(r), count, *nearest);
+            }
+            async_get_nearest_results(
+                areas, end, cap_ptr, count, deadline_ms, nearest, std::move(cb));
+        });
+}
+
+void geo_client::normalize_result(std::vector<std::vector<SearchResult>> &&results,
                                   int count,
                                   SortType sort_type,
                                   std::list<SearchResult> &result)
 {
     result.clear();
-    for (auto &r : results) {
-        result.splice(result.end(), r);
-        if (sort_type == SortType::random && count > 0 && result.size() >= count) {
-            break;
+    if (sort_type == SortType::asc || sort_type == SortType::desc) {
+        // only the first `count` results are kept in a heap, rather than sorting all of them
+        std::vector<SearchResult> top;
+        for (auto &r : results) {
+            if (sort_type == SortType::asc) {
+                keep_top<SearchResultNearer>(std::move(r), count, top);
+            } else {
+                keep_top<SearchResultFarther>(std::move(r), count, top);
+            }
+        }
+        if (sort_type == SortType::asc) {
+            std::sort_heap(top.begin(), top.end(), SearchResultNearer());
+        } else {
+            std::sort_heap(top.begin(), top.end(), SearchResultFarther());
         }
+        result.insert(
+            result.end(), std::make_move_iterator(top.begin()), std::make_move_iterator(top.end()));
+        return;
     }
 
-    if (sort_type == SortType::asc) {
-        result = utils::top_n<SearchResult, SearchResultNearer>(result, count).to();
-    } else if (sort_type == SortType::desc) {
-        result = utils::top_n<SearchResult, SearchResultFarther>(result, count).to();
-    } else if (count > 0 && result.size() > count) {
-        result.resize((size_t)count);
+    for (auto &r : results) {
+        for (auto &e : r) {
+            if (count > 0 && result.size() >= count) {
+                return;
+            }
+            result.emplace_back(std::move(e));
+        }
     }
 }
 
@@ -826,7 +936,7 @@ void geo_client::start_scan(const std::string &hash_key,
                             int count,
                             int timeout_ms,
                             scan_one_area_callback_t &&callback,
-                            std::list<SearchResult> &result)
+                            std::vector<SearchResult> &result)
 {
     pegasus_client::scan_options options;
     options.start_inclusive = true;
@@ -853,7 +963,7 @@ void geo_client::do_scan(pegasus_client::pegasus_scanner_wrapper scanner_wrapper
                          std::shared_ptr<S2Cap> cap_ptr,
                          int count,
                          scan_one_area_callback_t &&callback,
-                         std::list<SearchResult> &result)
+                         std::vector<SearchResult> &result)
 {
     scanner_wrapper->async_next(
         [ this, cap_ptr, count, scanner_wrapper, cb = std::move(callback), &result ](
@@ -20,6 +20,7 @@
 #pragma once
 
 #include <sstream>
+#include <vector>
 #include <s2/s2latlng_rect.h>
 #include <s2/s2cell_union.h>
 #include <s2/util/units/length-units.h>
@@ -379,7 +380,7 @@ private:
     using update_callback_t = std::function<void(
         int error_code, pegasus_client::internal_info &&info, DataType data_type)>;
     using scan_all_area_callback_t =
-        std::function<void(std::list<std::list<SearchResult>> &&results)>;
+        std::function<void(std::vector<std::vector<SearchResult>> &&results)>;
     using scan_one_area_callback_t = std::function<void()>;
 
     // generate hash_key and sort_key in geo database from hash_key and sort_key in common data
@@ -435,16 +436,43 @@ private:
     // generate cell ids covered by the cap on a pre-defined level
     void gen_cells_covered_by_cap(const S2Cap &cap, S2CellUnion &cids);
 
-    // search data covered by `cap` in all `cids`
-    void async_get_result_from_cells(const S2CellUnion &cids,
+    // an area to scan, which is a range of sort keys under the hash key of a cell at `_min_level`
+    struct scan_area
+    {
+        std::string hash_key;
+        std::string start_sort_key;
+        std::string stop_sort_key;
+        // the distance in meters from the center of the cap to the cell at `_min_level` holding
+        // this area, no point in this area is nearer than it
+        double min_distance;
+    };
+
+    // generate the areas covered by `cap` in all `cids`
+    void gen_scan_areas(const S2CellUnion &cids, const S2Cap &cap, std::vector<scan_area> &areas);
+
+    // search data covered by `cap` in all `areas` concurrently, the results of each area are
+    // returned at the position of the area
+    void async_get_result_from_cells(std::vector<scan_area> &&areas,
                                      std::shared_ptr<S2Cap> cap_ptr,
                                      int count,
                                      SortType sort_type,
                                      int timeout_ms,
                                      scan_all_area_callback_t &&callback);
 
+    // search the nearest `count` results covered by `cap` in `areas` sorted by `min_distance`,
+    // starting from `areas[next]`. The areas are scanned ring by ring, and the nearest results
+    // found are kept in the max-heap `nearest`. The search stops once the remaining areas can't
+    // hold a result nearer than the `count`th nearest one, or `deadline_ms` has passed
+    void async_get_nearest_results(std::shared_ptr<std::vector<scan_area>> areas,
+                                   size_t next,
+                                   std::shared_ptr<S2Cap> cap_ptr,
+                                   int count,
+                                   uint64_t deadline_ms,
+                                   std::shared_ptr<std::vector<SearchResult>> nearest,
+                                   geo_search_callback_t &&callback);
+
     // normalize the result by count, sort type, ...
-    void normalize_result(std::list<std::list<SearchResult>> &&results,
+    void normalize_result(std::vector<std::vector<SearchResult>> &&results,
                           int count,
                           SortType sort_type,
                           std::list<SearchResult> &result);
@@ -463,13 +491,13 @@ private:
                     int count,
                     int timeout_ms,
                     scan_one_area_callback_t &&callback,
-                    std::list<SearchResult> &result);
+                    std::vector<SearchResult> &result);
 
     void do_scan(pegasus_client::pegasus_scanner_wrapper scanner_wrapper,
                  std::shared_ptr<S2Cap> cap_ptr,
                  int count,
                  scan_one_area_callback_t &&callback,
-                 std::list<SearchResult> &result);
+                 std::vector<SearchResult> &result);
 
 private:
     // cell id at this level is the hash-key in pegasus
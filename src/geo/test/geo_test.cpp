@@ -60,7 +60,7 @@ public:
         return _geo_client->restore_origin_keys(geo_sort_key, origin_hash_key, origin_sort_key);
     }
 
-    void normalize_result(std::list<std::list<SearchResult>> &&results,
+    void normalize_result(std::vector<std::vector<SearchResult>> &&results,
                           int count,
                           geo::geo_client::SortType sort_type,
                           std::list<SearchResult> &result)
@@ -416,6 +416,54 @@ TEST_F(geo_client_test, generate_and_restore_geo_keys)
     ASSERT_EQ(test_sort_key, restore_sort_key);
 }
 
+TEST_F(geo_client_test, search_nearest)
+{
+    // the points are spread over many cells at `_min_level`, so the nearest ones are searched
+    // ring by ring
+    double center_lat_degrees = 30.123;
+    double center_lng_degrees = 60.456;
+    const int point_count = 20;
+    for (int i = 0; i < point_count; ++i) {
+        std::string value = gen_value(center_lat_degrees + 0.01 * (i + 1), center_lng_degrees);
+        int ret = _geo_client->set("search_nearest_" + std::to_string(i), "", value);
+        ASSERT_EQ(ret, pegasus::PERR_OK);
+    }
+
+    std::list<geo::SearchResult> all;
+    int ret = _geo_client->search_radial(center_lat_degrees,
+                                         center_lng_degrees,
+                                         30000,
+                                         -1,
+                                         geo::geo_client::SortType::asc,
+                                         5000,
+                                         all);
+    ASSERT_EQ(ret, pegasus::PERR_OK);
+    ASSERT_EQ(point_count, all.size());
+
+    for (int count : {1, 3, point_count, point_count + 1}) {
+        std::list<geo::SearchResult> nearest;
+        ret = _geo_client->search_radial(center_lat_degrees,
+                                         center_lng_degrees,
+                                         30000,
+                                         count,
+                                         geo::geo_client::SortType::asc,
+                                         5000,
+                                         nearest);
+        ASSERT_EQ(ret, pegasus::PERR_OK);
+        ASSERT_EQ(std::min(count, point_count), nearest.size());
+        auto iter = all.begin();
+        for (const geo::SearchResult &r : nearest) {
+            ASSERT_EQ(iter->hash_key, r.hash_key);
+            ASSERT_DOUBLE_EQ(iter->distance, r.distance);
+            ++iter;
+        }
+    }
+
+    for (int i = 0; i < point_count; ++i) {
+        ASSERT_EQ(pegasus::PERR_OK, _geo_client->del("search_nearest_" + std::to_string(i), ""));
+    }
+}
+
 TEST_F(geo_client_test, normalize_result_random_order)
 {
     geo::SearchResult r1(1.1, 1.1, 1, "test_hash_key_1", "test_sort_key_1", "value_1");
@@ -424,7 +472,7 @@ TEST_F(geo_client_test, normalize_result_random_order)
     std::list<geo::SearchResult> result;
 
     {
-        std::list<std::list<geo::SearchResult>> results;
+        std::vector<std::vector<geo::SearchResult>> results;
         results.push_back({geo::SearchResult(r1)});
         normalize_result(std::move(results), count, geo::geo_client::SortType::random, result);
         ASSERT_EQ(result.size(), 1);
@@ -432,7 +480,7 @@ TEST_F(geo_client_test, normalize_result_random_order)
     }
 
     {
-        std::list<std::list<geo::SearchResult>> results;
+        std::vector<std::vector<geo::SearchResult>> results;
         results.push_back({geo::SearchResult(r1)});
         results.push_back({geo::SearchResult(r2)});
         normalize_result(std::move(results), 1, geo::geo_client::SortType::random, result);
@@ -441,7 +489,7 @@ TEST_F(geo_client_test, normalize_result_random_order)
     }
 
     {
-        std::list<std::list<geo::SearchResult>> results;
+        std::vector<std::vector<geo::SearchResult>> results;
         results.push_back({geo::SearchResult(r1)});
         results.push_back({geo::SearchResult(r2)});
         normalize_result(std::move(results), count, geo::geo_client::SortType::random, result);
@@ -451,7 +499,7 @@ TEST_F(geo_client_test, normalize_result_random_order)
     }
 
     {
-        std::list<std::list<geo::SearchResult>> results;
+        std::vector<std::vector<geo::SearchResult>> results;
         results.push_back({geo::SearchResult(r1)});
         results.push_back({geo::SearchResult(r2)});
         normalize_result(std::move(results), -1, geo::geo_client::SortType::random, result);
@@ -469,7 +517,7 @@ TEST_F(geo_client_test, normalize_result_distance_order)
     std::list<geo::SearchResult> result;
 
     {
-        std::list<std::list<geo::SearchResult>> results;
+        std::vector<std::vector<geo::SearchResult>> results;
         results.push_back({geo::SearchResult(r2)});
         normalize_result(std::move(results), count, geo::geo_client::SortType::asc, result);
         ASSERT_EQ(result.size(), 1);
@@ -477,7 +525,7 @@ TEST_F(geo_client_test, normalize_result_distance_order)
     }
 
     {
-        std::list<std::list<geo::SearchResult>> results;
+        std::vector<std::vector<geo::SearchResult>> results;
         results.push_back({geo::SearchResult(r1)});
         normalize_result(std::move(results), 1, geo::geo_client::SortType::asc, result);
         ASSERT_EQ(result.size(), 1);
@@ -485,7 +533,7 @@ TEST_F(geo_client_test, normalize_result_distance_order)
     }
 
     {
-        std::list<std::list<geo::SearchResult>> results;
+        std::vector<std::vector<geo::SearchResult>> results;
         results.push_back({geo::SearchResult(r1)});
         results.push_back({geo::SearchResult(r2)});
         normalize_result(std::move(results), count, geo::geo_client::SortType::asc, result);
@@ -495,7 +543,7 @@ TEST_F(geo_client_test, normalize_result_distance_order)
     }
 
     {
-        std::list<std::list<geo::SearchResult>> results;
+        std::vector<std::vector<geo::SearchResult>> results;
         results.push_back({geo::SearchResult(r1)});
         results.push_back({geo::SearchResult(r2)});
         normalize_result(std::move(results), -1, geo::geo_client::SortType::asc, result);
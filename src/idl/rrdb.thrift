@@ -64,6 +64,13 @@ enum mutate_operation
     MO_DELETE
 }
 
+enum duplicate_compression_type
+{
+    DCT_NONE,
+    DCT_LZ4,
+    DCT_ZSTD
+}
+
 struct update_request
 {
     1:dsn.blob      key;
@@ -255,6 +262,10 @@ struct get_scanner_request
     10:dsn.blob    sort_key_filter_pattern;
     11:optional bool    validate_partition_hash;
     12:optional bool    return_expire_ts;
+    // Scan as of this timestamp in microseconds: the records written after it are skipped, and
+    // a rocksdb snapshot is pinned for it on the replica, so that all the batches and the
+    // restarted scans with the same read_timestamp see the same data. 0 means the latest data.
+    13:optional i64     read_timestamp;
 }
 
 struct scan_request
@@ -270,6 +281,27 @@ struct scan_response
     4:i32           app_id;
     5:i32           partition_index;
     6:string        server;
+    // the read_timestamp of the point-in-time scan, set only if it's supported by the server
+    7:optional i64  read_timestamp;
+}
+
+struct duplicate_entry
+{
+    // The timestamp of this write.
+    1: optional i64 timestamp
+
+    // The code to identify this write.
+    2: optional dsn.task_code task_code
+
+    // The binary form of the write.
+    3: optional dsn.blob raw_message
+}
+
+// The batched writes of a compressed DUPLICATE, which are serialized and compressed as one
+// frame into `duplicate_request.raw_message`.
+struct duplicate_entries
+{
+    1: optional list<duplicate_entry> entries
 }
 
 struct duplicate_request
@@ -288,6 +320,17 @@ struct duplicate_request
 
     // Whether to compare the timetag of old value with the new write's.
     5: optional bool verify_timetag
+
+    // The batched writes, which are applied in order as one write batch.
+    // If set, `task_code` is ignored, and `timestamp` is of the first write.
+    6: optional list<duplicate_entry> entries
+
+    // How `raw_message` is compressed into a self-contained lz4 or zstd frame. Not set means
+    // not compressed. If the request is batched, `entries` is left empty, and the writes are
+    // serialized as `duplicate_entries` and compressed as one frame into `raw_message`.
+    // An older remote doesn't know this field and takes the compressed frame as a write, so
+    // it's only set for the remote clusters in `duplicate_compression_remote_clusters`.
+    7: optional duplicate_compression_type compression_type
 }
 
 struct duplicate_response
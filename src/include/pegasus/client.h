@@ -252,6 +252,16 @@ public:
         std::string sort_key_filter_pattern;
         bool no_value; // only fetch hash_key and sort_key, but not fetch value
         bool return_expire_ts;
+        // read all the partitions as of the same timestamp, the k-v written after it are not
+        // returned, even if the scan is restarted or resumed by a resume token.
+        // the snapshots of all the partitions are pinned when the scanners are got, and they
+        // are unpinned if not scanned for a while (`scan_snapshot_ttl_seconds` on the server),
+        // after which the scan fails with PERR_EXPIRED rather than returning a different cut.
+        bool point_in_time;
+        // the read timestamp in microseconds of the point-in-time scan, the current time is
+        // used if it's 0. it must be close to now (`scan_snapshot_max_pin_delay_ms` on the
+        // server), otherwise the scanners can't be got and PERR_EXPIRED is returned.
+        int64_t read_timestamp_us;
         scan_options()
             : timeout_ms(5000),
               batch_size(100),
@@ -260,7 +270,9 @@ public:
               hash_key_filter_type(FT_NO_FILTER),
               sort_key_filter_type(FT_NO_FILTER),
               no_value(false),
-              return_expire_ts(false)
+              return_expire_ts(false),
+              point_in_time(false),
+              read_timestamp_us(0)
         {
         }
         scan_options(const scan_options &o)
@@ -273,7 +285,9 @@ public:
               sort_key_filter_type(o.sort_key_filter_type),
               sort_key_filter_pattern(o.sort_key_filter_pattern),
               no_value(o.no_value),
-              return_expire_ts(o.return_expire_ts)
+              return_expire_ts(o.return_expire_ts),
+              point_in_time(o.point_in_time),
+              read_timestamp_us(o.read_timestamp_us)
         {
         }
     };
@@ -301,6 +315,8 @@ public:
     typedef std::function<void(
         int /*error_code*/, int64_t /*new_value*/, internal_info && /*info*/)>
         async_incr_callback_t;
+    typedef std::function<void(int /*error_code*/, int64_t /*value*/)>
+        async_get_sharded_counter_callback_t;
     typedef std::function<void(
         int /*error_code*/, check_and_set_results && /*results*/, internal_info && /*info*/)>
         async_check_and_set_callback_t;
@@ -377,6 +393,19 @@ public:
         /// and the original scanner pointer should not be used anymore
         ///
         virtual pegasus_scanner_wrapper get_smart_wrapper() = 0;
+
+        ///
+        /// \brief get a token of the current position of this scanner, from which the scan
+        /// could be resumed by get_scanner_by_resume_token(), even after this scanner is deleted.
+        /// the read timestamp of the point-in-time scan is carried in the token, so the resumed
+        /// scan reads the data as of the same timestamp.
+        /// should not be called while next() or async_next() is in progress
+        /// \param token
+        /// out param, a printable string
+        /// \return
+        /// int, the error indicates whether or not the operation is succeeded.
+        ///
+        virtual int get_resume_token(std::string &token) const = 0;
     };
 
 public:
@@ -913,6 +942,112 @@ public:
                             int timeout_milliseconds = 5000,
                             int ttl_seconds = 0) = 0;
 
+    ///
+    /// \brief incr_sharded_counter
+    ///     atomically increment one shard of a sharded counter from the cluster.
+    ///
+    ///     a sharded counter spreads the value of the counter <hashkey,sortkey> over
+    ///     `shard_count' records to avoid a hot key when the counter is incremented frequently:
+    ///       - the shard 0 is <hashkey,sortkey> itself, so a normal counter is a sharded counter
+    ///         with only 1 shard.
+    ///       - the other shards are stored under hash keys derived from `hashkey', so they are
+    ///         spread over the partitions.
+    ///     each increment is applied to a random shard, which is a normal counter with the same
+    ///     increment semantic as incr(). the value of the counter is the sum of all the shards,
+    ///     see get_sharded_counter().
+    ///
+    ///     the shard count of a counter can be increased at any time, but should only be
+    ///     decreased after the removed shards are folded by fold_sharded_counter().
+    ///
+    /// \param hashkey
+    /// the hash key of the counter.
+    /// \param sortkey
+    /// the sort key of the counter.
+    /// \param increment
+    /// the value we want to increment.
+    /// \param shard_count
+    /// the number of shards of the counter, should be in [1, 1024].
+    /// \param timeout_milliseconds
+    /// if wait longer than this value, will return time out error
+    /// \param ttl_seconds
+    /// time to live of the incremented shard, the same as incr().
+    /// \return
+    /// int, the error indicates whether or not the operation is succeeded.
+    /// this error can be converted to a string using get_error_string().
+    ///
+    virtual int incr_sharded_counter(const std::string &hashkey,
+                                     const std::string &sortkey,
+                                     int64_t increment,
+                                     int shard_count,
+                                     int timeout_milliseconds = 5000,
+                                     int ttl_seconds = 0) = 0;
+
+    ///
+    /// \brief get_sharded_counter
+    ///     get the value of a sharded counter from the cluster, which is the sum of all the
+    ///     shards. the shards are read in parallel, and a missing shard is counted as 0.
+    ///     \see incr_sharded_counter
+    /// \param hashkey
+    /// the hash key of the counter.
+    /// \param sortkey
+    /// the sort key of the counter.
+    /// \param shard_count
+    /// the number of shards of the counter, should be in [1, 1024].
+    /// \param value
+    /// out param to return the value of the counter.
+    /// \param timeout_milliseconds
+    /// if wait longer than this value, will return time out error
+    /// \return
+    /// int, the error indicates whether or not the operation is succeeded.
+    /// this error can be converted to a string using get_error_string().
+    /// returns PERR_NOT_FOUND if none of the shards is found, and PERR_INVALID_ARGUMENT if any
+    /// shard is not an integer or the sum is out of range.
+    ///
+    virtual int get_sharded_counter(const std::string &hashkey,
+                                    const std::string &sortkey,
+                                    int shard_count,
+                                    int64_t &value,
+                                    int timeout_milliseconds = 5000) = 0;
+
+    ///
+    /// \brief asynchronous get_sharded_counter
+    ///     get the value of a sharded counter from the cluster.
+    ///     will not be blocked, return immediately.
+    ///     \see get_sharded_counter
+    ///
+    virtual void
+    async_get_sharded_counter(const std::string &hashkey,
+                              const std::string &sortkey,
+                              int shard_count,
+                              async_get_sharded_counter_callback_t &&callback = nullptr,
+                              int timeout_milliseconds = 5000) = 0;
+
+    ///
+    /// \brief fold_sharded_counter
+    ///     move the values of the shards 1 ~ shard_count-1 of a sharded counter into the shard
+    ///     0, and remove the shards whose value is 0, so that a cold counter is stored in only 1
+    ///     record. it's safe to increment the counter concurrently.
+    ///
+    ///     NOTICE: the value of each shard is moved by 2 increments on different partitions,
+    ///     so a concurrent get_sharded_counter() may miss the moving value temporarily.
+    ///
+    /// \param hashkey
+    /// the hash key of the counter.
+    /// \param sortkey
+    /// the sort key of the counter.
+    /// \param shard_count
+    /// the number of shards of the counter, should be in [1, 1024].
+    /// \param timeout_milliseconds
+    /// if wait longer than this value for each operation, will return time out error
+    /// \return
+    /// int, the error indicates whether or not the operation is succeeded.
+    /// this error can be converted to a string using get_error_string().
+    ///
+    virtual int fold_sharded_counter(const std::string &hashkey,
+                                     const std::string &sortkey,
+                                     int shard_count,
+                                     int timeout_milliseconds = 5000) = 0;
+
     ///
     /// \brief check_and_set
     ///     atomically check and set value by key from the cluster.
@@ -1157,6 +1292,26 @@ public:
                                  const scan_options &options,
                                  async_get_unordered_scanners_callback_t &&callback) = 0;
 
+    ///
+    /// \brief resume a scan from the token got by pegasus_scanner::get_resume_token()
+    ///        the scanner should be deleted when scan complete
+    /// \param token
+    /// the resume token
+    /// \param options
+    /// which used to indicate scan options, except the inclusiveness of the bounds and the read
+    /// timestamp, which are carried in the token
+    /// \param scanner
+    /// out param, used to get the k-v after the position of the token
+    /// \return
+    /// int, the error indicates whether or not the operation is succeeded.
+    /// PERR_INVALID_ARGUMENT means the token is invalid.
+    /// the snapshots of the point-in-time scan are not pinned again, the resumed scanner fails
+    /// with PERR_EXPIRED if they have been unpinned.
+    ///
+    virtual int get_scanner_by_resume_token(const std::string &token,
+                                            const scan_options &options,
+                                            pegasus_scanner *&scanner) = 0;
+
     ///
     /// \brief get_error_string
     /// get error string
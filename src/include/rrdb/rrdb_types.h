@@ -71,6 +71,18 @@ struct mutate_operation
 
 extern const std::map<int, const char *> _mutate_operation_VALUES_TO_NAMES;
 
+struct duplicate_compression_type
+{
+    enum type
+    {
+        DCT_NONE = 0,
+        DCT_LZ4 = 1,
+        DCT_ZSTD = 2
+    };
+};
+
+extern const std::map<int, const char *> _duplicate_compression_type_VALUES_TO_NAMES;
+
 class update_request;
 
 class update_response;
@@ -113,6 +125,10 @@ class scan_request;
 
 class scan_response;
 
+class duplicate_entry;
+
+class duplicate_entries;
+
 class duplicate_request;
 
 class duplicate_response;
@@ -1568,7 +1584,8 @@ typedef struct _get_scanner_request__isset
           sort_key_filter_type(false),
           sort_key_filter_pattern(false),
           validate_partition_hash(false),
-          return_expire_ts(false)
+          return_expire_ts(false),
+          read_timestamp(false)
     {
     }
     bool start_key : 1;
@@ -1583,6 +1600,7 @@ typedef struct _get_scanner_request__isset
     bool sort_key_filter_pattern : 1;
     bool validate_partition_hash : 1;
     bool return_expire_ts : 1;
+    bool read_timestamp : 1;
 } _get_scanner_request__isset;
 
 class get_scanner_request
@@ -1600,7 +1618,8 @@ public:
           hash_key_filter_type((filter_type::type)0),
           sort_key_filter_type((filter_type::type)0),
           validate_partition_hash(0),
-          return_expire_ts(0)
+          return_expire_ts(0),
+          read_timestamp(0)
     {
     }
 
@@ -1617,6 +1636,7 @@ public:
     ::dsn::blob sort_key_filter_pattern;
     bool validate_partition_hash;
     bool return_expire_ts;
+    int64_t read_timestamp;
 
     _get_scanner_request__isset __isset;
 
@@ -1644,6 +1664,8 @@ public:
 
     void __set_return_expire_ts(const bool val);
 
+    void __set_read_timestamp(const int64_t val);
+
     bool operator==(const get_scanner_request &rhs) const
     {
         if (!(start_key == rhs.start_key))
@@ -1675,6 +1697,10 @@ public:
             return false;
         else if (__isset.return_expire_ts && !(return_expire_ts == rhs.return_expire_ts))
             return false;
+        if (__isset.read_timestamp != rhs.__isset.read_timestamp)
+            return false;
+        else if (__isset.read_timestamp && !(read_timestamp == rhs.read_timestamp))
+            return false;
         return true;
     }
     bool operator!=(const get_scanner_request &rhs) const { return !(*this == rhs); }
@@ -1749,7 +1775,8 @@ typedef struct _scan_response__isset
           context_id(false),
           app_id(false),
           partition_index(false),
-          server(false)
+          server(false),
+          read_timestamp(false)
     {
     }
     bool error : 1;
@@ -1758,6 +1785,7 @@ typedef struct _scan_response__isset
     bool app_id : 1;
     bool partition_index : 1;
     bool server : 1;
+    bool read_timestamp : 1;
 } _scan_response__isset;
 
 class scan_response
@@ -1767,7 +1795,10 @@ public:
     scan_response(scan_response &&);
     scan_response &operator=(const scan_response &);
     scan_response &operator=(scan_response &&);
-    scan_response() : error(0), context_id(0), app_id(0), partition_index(0), server() {}
+    scan_response()
+        : error(0), context_id(0), app_id(0), partition_index(0), server(), read_timestamp(0)
+    {
+    }
 
     virtual ~scan_response() throw();
     int32_t error;
@@ -1776,6 +1807,7 @@ public:
     int32_t app_id;
     int32_t partition_index;
     std::string server;
+    int64_t read_timestamp;
 
     _scan_response__isset __isset;
 
@@ -1791,6 +1823,8 @@ public:
 
     void __set_server(const std::string &val);
 
+    void __set_read_timestamp(const int64_t val);
+
     bool operator==(const scan_response &rhs) const
     {
         if (!(error == rhs.error))
@@ -1805,6 +1839,10 @@ public:
             return false;
         if (!(server == rhs.server))
             return false;
+        if (__isset.read_timestamp != rhs.__isset.read_timestamp)
+            return false;
+        else if (__isset.read_timestamp && !(read_timestamp == rhs.read_timestamp))
+            return false;
         return true;
     }
     bool operator!=(const scan_response &rhs) const { return !(*this == rhs); }
@@ -1825,6 +1863,118 @@ inline std::ostream &operator<<(std::ostream &out, const scan_response &obj)
     return out;
 }
 
+typedef struct _duplicate_entry__isset
+{
+    _duplicate_entry__isset() : timestamp(false), task_code(false), raw_message(false) {}
+    bool timestamp : 1;
+    bool task_code : 1;
+    bool raw_message : 1;
+} _duplicate_entry__isset;
+
+class duplicate_entry
+{
+public:
+    duplicate_entry(const duplicate_entry &);
+    duplicate_entry(duplicate_entry &&);
+    duplicate_entry &operator=(const duplicate_entry &);
+    duplicate_entry &operator=(duplicate_entry &&);
+    duplicate_entry() : timestamp(0) {}
+
+    virtual ~duplicate_entry() throw();
+    int64_t timestamp;
+    ::dsn::task_code task_code;
+    ::dsn::blob raw_message;
+
+    _duplicate_entry__isset __isset;
+
+    void __set_timestamp(const int64_t val);
+
+    void __set_task_code(const ::dsn::task_code &val);
+
+    void __set_raw_message(const ::dsn::blob &val);
+
+    bool operator==(const duplicate_entry &rhs) const
+    {
+        if (__isset.timestamp != rhs.__isset.timestamp)
+            return false;
+        else if (__isset.timestamp && !(timestamp == rhs.timestamp))
+            return false;
+        if (__isset.task_code != rhs.__isset.task_code)
+            return false;
+        else if (__isset.task_code && !(task_code == rhs.task_code))
+            return false;
+        if (__isset.raw_message != rhs.__isset.raw_message)
+            return false;
+        else if (__isset.raw_message && !(raw_message == rhs.raw_message))
+            return false;
+        return true;
+    }
+    bool operator!=(const duplicate_entry &rhs) const { return !(*this == rhs); }
+
+    bool operator<(const duplicate_entry &) const;
+
+    uint32_t read(::apache::thrift::protocol::TProtocol *iprot);
+    uint32_t write(::apache::thrift::protocol::TProtocol *oprot) const;
+
+    virtual void printTo(std::ostream &out) const;
+};
+
+void swap(duplicate_entry &a, duplicate_entry &b);
+
+inline std::ostream &operator<<(std::ostream &out, const duplicate_entry &obj)
+{
+    obj.printTo(out);
+    return out;
+}
+
+typedef struct _duplicate_entries__isset
+{
+    _duplicate_entries__isset() : entries(false) {}
+    bool entries : 1;
+} _duplicate_entries__isset;
+
+class duplicate_entries
+{
+public:
+    duplicate_entries(const duplicate_entries &);
+    duplicate_entries(duplicate_entries &&);
+    duplicate_entries &operator=(const duplicate_entries &);
+    duplicate_entries &operator=(duplicate_entries &&);
+    duplicate_entries() {}
+
+    virtual ~duplicate_entries() throw();
+    std::vector<duplicate_entry> entries;
+
+    _duplicate_entries__isset __isset;
+
+    void __set_entries(const std::vector<duplicate_entry> &val);
+
+    bool operator==(const duplicate_entries &rhs) const
+    {
+        if (__isset.entries != rhs.__isset.entries)
+            return false;
+        else if (__isset.entries && !(entries == rhs.entries))
+            return false;
+        return true;
+    }
+    bool operator!=(const duplicate_entries &rhs) const { return !(*this == rhs); }
+
+    bool operator<(const duplicate_entries &) const;
+
+    uint32_t read(::apache::thrift::protocol::TProtocol *iprot);
+    uint32_t write(::apache::thrift::protocol::TProtocol *oprot) const;
+
+    virtual void printTo(std::ostream &out) const;
+};
+
+void swap(duplicate_entries &a, duplicate_entries &b);
+
+inline std::ostream &operator<<(std::ostream &out, const duplicate_entries &obj)
+{
+    obj.printTo(out);
+    return out;
+}
+
 typedef struct _duplicate_request__isset
 {
     _duplicate_request__isset()
@@ -1832,7 +1982,9 @@ typedef struct _duplicate_request__isset
           task_code(false),
           raw_message(false),
           cluster_id(false),
-          verify_timetag(false)
+          verify_timetag(false),
+          entries(false),
+          compression_type(false)
     {
     }
     bool timestamp : 1;
@@ -1840,6 +1992,8 @@ typedef struct _duplicate_request__isset
     bool raw_message : 1;
     bool cluster_id : 1;
     bool verify_timetag : 1;
+    bool entries : 1;
+    bool compression_type : 1;
 } _duplicate_request__isset;
 
 class duplicate_request
@@ -1849,7 +2003,13 @@ public:
     duplicate_request(duplicate_request &&);
     duplicate_request &operator=(const duplicate_request &);
     duplicate_request &operator=(duplicate_request &&);
-    duplicate_request() : timestamp(0), cluster_id(0), verify_timetag(0) {}
+    duplicate_request()
+        : timestamp(0),
+          cluster_id(0),
+          verify_timetag(0),
+          compression_type((duplicate_compression_type::type)0)
+    {
+    }
 
     virtual ~duplicate_request() throw();
     int64_t timestamp;
@@ -1857,6 +2017,8 @@ public:
     ::dsn::blob raw_message;
     int8_t cluster_id;
     bool verify_timetag;
+    std::vector<duplicate_entry> entries;
+    duplicate_compression_type::type compression_type;
 
     _duplicate_request__isset __isset;
 
@@ -1870,6 +2032,10 @@ public:
 
     void __set_verify_timetag(const bool val);
 
+    void __set_entries(const std::vector<duplicate_entry> &val);
+
+    void __set_compression_type(const duplicate_compression_type::type val);
+
     bool operator==(const duplicate_request &rhs) const
     {
         if (__isset.timestamp != rhs.__isset.timestamp)
@@ -1892,6 +2058,14 @@ public:
             return false;
         else if (__isset.verify_timetag && !(verify_timetag == rhs.verify_timetag))
             return false;
+        if (__isset.entries != rhs.__isset.entries)
+            return false;
+        else if (__isset.entries && !(entries == rhs.entries))
+            return false;
+        if (__isset.compression_type != rhs.__isset.compression_type)
+            return false;
+        else if (__isset.compression_type && !(compression_type == rhs.compression_type))
+            return false;
         return true;
     }
     bool operator!=(const duplicate_request &rhs) const { return !(*this == rhs); }
@@ -0,0 +1,274 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+
+// Micro benchmarks of the redis proxy.
+//
+// USAGE: pegasus_rproxy_bench parse <rounds> [buffer_size] [recorded_pipeline_file]
+//     The pipelines are split into receive buffers as the network does, and fed to the parser,
+//     which only counts the parsed commands, so the cost of parsing is measured alone. Without a
+//     recorded pipeline, pipelines of SET commands with several value sizes are generated. A
+//     recorded pipeline is the raw bytes sent by redis clients, e.g. captured by tcpdump.
+//
+// USAGE: pegasus_rproxy_bench dispatch <rounds>
+//     Measure the cost to look up the handler of each supported command, in upper and lower
+//     case, and of an unknown command.
+//
+// USAGE: pegasus_rproxy_bench near_cache <rounds> [clients]
+//     Like 'redis-benchmark -t get', the clients read a set of hot keys concurrently, and the
+//     GETs served by the near cache per second are measured, which is the upper bound of the
+//     QPS of the cached keys in a proxy. The end-to-end gain can be measured by redis-benchmark
+//     against a proxy with and without 'near_cache_key_prefix'.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dsn/service_api_c.h>
+#include <dsn/utility/string_conv.h>
+
+#include "near_cache.h"
+#include "redis_parser.h"
+
+using namespace ::pegasus::proxy;
+
+class bench_parser : public redis_parser
+{
+public:
+    explicit bench_parser(dsn::message_ex *first_msg) : redis_parser(nullptr, first_msg) {}
+
+    bool feed(dsn::message_ex *msg) { return parse(msg); }
+    int64_t parsed_count() const { return _parsed_count; }
+
+    using redis_parser::get_handler;
+    static std::vector<std::string> command_names()
+    {
+        std::vector<std::string> names;
+        for (size_t i = 0; i < s_dispatcher_size; ++i) {
+            names.emplace_back(s_dispatcher[i].name);
+        }
+        return names;
+    }
+
+protected:
+    void handle_command(std::unique_ptr<message_entry> &&entry) override { ++_parsed_count; }
+
+private:
+    int64_t _parsed_count = 0;
+};
+
+static dsn::message_ex *create_message(const char *data, size_t length)
+{
+    dsn::message_ex *msg = dsn::message_ex::create_received_request(
+        RPC_CALL_RAW_MESSAGE, dsn::DSF_THRIFT_BINARY, (void *)data, length);
+    msg->header->from_address = dsn::rpc_address("127.0.0.1", 123);
+    return msg;
+}
+
+static std::string generate_pipeline(size_t value_size, size_t total_size)
+{
+    std::string value(value_size, 'v');
+    std::string pipeline;
+    for (int i = 0; pipeline.size() < total_size; ++i) {
+        std::string key = "key_" + std::to_string(i);
+        pipeline += "*3\r\n$3\r\nSET\r\n$" + std::to_string(key.size()) + "\r\n" + key + "\r\n$" +
+                    std::to_string(value.size()) + "\r\n" + value + "\r\n";
+    }
+    return pipeline;
+}
+
+static void
+bench_parse(const std::string &name, const std::string &pipeline, int rounds, size_t buffer)
+{
+    dsn::message_ex *first_msg = create_message("dummy", 5);
+    first_msg->add_ref();
+    auto parser = std::make_shared<bench_parser>(first_msg);
+    first_msg->release_ref();
+
+    std::chrono::nanoseconds elapsed(0);
+    for (int r = 0; r < rounds; ++r) {
+        // the messages are created out of the measurement, and released by the parser
+        std::vector<dsn::message_ex *> msgs;
+        for (size_t offset = 0; offset < pipeline.size(); offset += buffer) {
+            msgs.push_back(create_message(pipeline.data() + offset,
+                                          std::min(buffer, pipeline.size() - offset)));
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        for (dsn::message_ex *msg : msgs) {
+            if (!parser->feed(msg)) {
+                std::cerr << name << ": parse failed" << std::endl;
+                return;
+            }
+        }
+        elapsed += std::chrono::steady_clock::now() - start;
+    }
+
+    double seconds = std::max(elapsed.count() / 1e9, 1e-9);
+    std::cout << name << ": " << parser->parsed_count() << " commands, "
+              << pipeline.size() * rounds / seconds / (1 << 20) << " MB/s, "
+              << parser->parsed_count() / seconds << " commands/s" << std::endl;
+}
+
+static void bench_dispatch(int rounds)
+{
+    std::vector<std::string> commands;
+    for (const std::string &name : bench_parser::command_names()) {
+        std::string lower = name;
+        std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+        commands.push_back(name);
+        commands.push_back(lower);
+    }
+    commands.push_back("UNKNOWN");
+
+    // accumulate the handlers to prevent the lookups from being optimized out
+    uintptr_t checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        for (const std::string &command : commands) {
+            checksum += reinterpret_cast<uintptr_t>(
+                bench_parser::get_handler(command.data(), command.length()));
+        }
+    }
+    std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - start;
+
+    int64_t lookups = static_cast<int64_t>(rounds) * commands.size();
+    std::cout << "dispatch: " << lookups << " lookups of " << commands.size() << " commands, "
+              << static_cast<double>(elapsed.count()) / lookups << " ns/lookup, checksum "
+              << checksum << std::endl;
+}
+
+static void bench_near_cache(int rounds, int clients)
+{
+    const int key_count = 1000;
+    near_cache cache(64 << 20, 100000, 3600 * 1000);
+    std::vector<std::string> keys;
+    auto value = dsn::blob::create_from_bytes(std::string(100, 'v'));
+    for (int i = 0; i < key_count; ++i) {
+        keys.push_back("config_key_" + std::to_string(i));
+        // a key is admitted when it's missed again
+        cache.put(keys.back(), true, value, cache.generation(keys.back()));
+        cache.put(keys.back(), true, value, cache.generation(keys.back()));
+    }
+
+    std::atomic<int64_t> hits(0);
+    std::vector<std::thread> workers;
+    auto start = std::chrono::steady_clock::now();
+    for (int c = 0; c < clients; ++c) {
+        workers.emplace_back([&cache, &keys, &hits, rounds, c]() {
+            bool found = false;
+            dsn::blob cached;
+            int64_t local_hits = 0;
+            for (int r = 0; r < rounds; ++r) {
+                // the clients start from different keys, like the independent clients
+                for (size_t i = 0; i < keys.size(); ++i) {
+                    const std::string &key = keys[(i + c * 97) % keys.size()];
+                    if (cache.get(key, found, cached)) {
+                        ++local_hits;
+                    }
+                }
+            }
+            hits.fetch_add(local_hits);
+        });
+    }
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+    std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - start;
+
+    int64_t gets = static_cast<int64_t>(rounds) * clients * keys.size();
+    double seconds = std::max(elapsed.count() / 1e9, 1e-9);
+    std::cout << "near_cache: " << gets << " GETs by " << clients << " clients, "
+              << gets / seconds << " GETs/s, hit ratio " << static_cast<double>(hits) / gets
+              << std::endl;
+}
+
+static int usage(const char *program)
+{
+    std::cerr << "USAGE: " << program << " parse <rounds> [buffer_size] [recorded_pipeline_file]"
+              << std::endl
+              << "       " << program << " dispatch <rounds>" << std::endl
+              << "       " << program << " near_cache <rounds> [clients]" << std::endl;
+    return -1;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3) {
+        return usage(argv[0]);
+    }
+    std::string mode = argv[1];
+    int rounds = 0;
+    if (!dsn::buf2int32(argv[2], rounds) || rounds <= 0) {
+        std::cerr << "rounds is invalid: " << argv[2] << std::endl;
+        return -1;
+    }
+
+    if (mode == "dispatch") {
+        bench_dispatch(rounds);
+        return 0;
+    }
+    if (mode == "near_cache") {
+        int clients = 50;
+        if (argc >= 4 && (!dsn::buf2int32(argv[3], clients) || clients <= 0)) {
+            std::cerr << "clients is invalid: " << argv[3] << std::endl;
+            return -1;
+        }
+        // the perf counters of the cache need the runtime
+        dsn_run_config("config.ini", false);
+        bench_near_cache(rounds, clients);
+        dsn_exit(0);
+    }
+    if (mode != "parse") {
+        return usage(argv[0]);
+    }
+
+    // the size of a receive buffer of the network
+    int buffer_size = 65536;
+    if (argc >= 4 && (!dsn::buf2int32(argv[3], buffer_size) || buffer_size <= 0)) {
+        std::cerr << "buffer_size is invalid: " << argv[3] << std::endl;
+        return -1;
+    }
+
+    dsn_run_config("config.ini", false);
+
+    if (argc >= 5) {
+        std::ifstream file(argv[4], std::ios::binary);
+        if (!file) {
+            std::cerr << "open recorded pipeline file failed: " << argv[4] << std::endl;
+            dsn_exit(-1);
+        }
+        std::stringstream pipeline;
+        pipeline << file.rdbuf();
+        bench_parse(argv[4], pipeline.str(), rounds, buffer_size);
+    } else {
+        for (size_t value_size : {16, 256, 4096, 65536, 1048576}) {
+            bench_parse("SET with " + std::to_string(value_size) + " bytes value",
+                        generate_pipeline(value_size, 16 << 20),
+                        rounds,
+                        buffer_size);
+        }
+    }
+
+    dsn_exit(0);
+}
@@ -0,0 +1,195 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "near_cache.h"
+
+#include <algorithm>
+#include <dsn/c/api_layer1.h>
+
+namespace pegasus {
+namespace proxy {
+
+near_cache::near_cache(uint64_t capacity_bytes, uint32_t max_entries, uint64_t ttl_ms)
+    : _shard_capacity_bytes(capacity_bytes / kShardCount), _ttl_ms(ttl_ms), _shards(kShardCount)
+{
+    size_t shard_entries = std::max(max_entries / kShardCount, static_cast<size_t>(1));
+    for (shard &s : _shards) {
+        s.slots.resize(shard_entries);
+        s.free_slots.reserve(shard_entries);
+        for (size_t i = shard_entries; i > 0; --i) {
+            s.free_slots.push_back(i - 1);
+        }
+    }
+
+    _pfc_hit_qps.init_app_counter(
+        "app.pegasus", "near_cache.hit_qps", COUNTER_TYPE_RATE, "statistic the hits of near cache");
+    _pfc_miss_qps.init_app_counter("app.pegasus",
+                                   "near_cache.miss_qps",
+                                   COUNTER_TYPE_RATE,
+                                   "statistic the misses of near cache");
+    _pfc_memory_bytes.init_app_counter("app.pegasus",
+                                       "near_cache.memory_bytes",
+                                       COUNTER_TYPE_NUMBER,
+                                       "statistic the memory used by near cache");
+    _pfc_entry_count.init_app_counter("app.pegasus",
+                                      "near_cache.entry_count",
+                                      COUNTER_TYPE_NUMBER,
+                                      "statistic the entries in near cache");
+}
+
+near_cache::shard &near_cache::shard_of(dsn::string_view key, size_t &hash) const
+{
+    hash = std::hash<std::string>()(std::string(key.data(), key.size()));
+    return _shards[hash % kShardCount];
+}
+
+uint64_t near_cache::generation(dsn::string_view key) const
+{
+    size_t hash;
+    shard &s = shard_of(key, hash);
+    std::lock_guard<std::mutex> l(s.lock);
+    return s.generation;
+}
+
+bool near_cache::get(dsn::string_view key, /*out*/ bool &found, /*out*/ dsn::blob &value)
+{
+    size_t hash;
+    shard &s = shard_of(key, hash);
+    {
+        std::lock_guard<std::mutex> l(s.lock);
+        auto iter = s.index.find(std::string(key.data(), key.size()));
+        if (iter != s.index.end()) {
+            slot &e = s.slots[iter->second];
+            if (dsn_now_ms() < e.expire_ms) {
+                e.referenced = true;
+                found = e.found;
+                value = e.value;
+                _pfc_hit_qps->increment();
+                return true;
+            }
+            remove(s, iter->second);
+        }
+    }
+    _pfc_miss_qps->increment();
+    return false;
+}
+
+void near_cache::put(dsn::string_view key,
+                     bool found,
+                     const dsn::blob &value,
+                     uint64_t generation)
+{
+    size_t hash;
+    shard &s = shard_of(key, hash);
+    std::lock_guard<std::mutex> l(s.lock);
+    if (s.generation != generation) {
+        return;
+    }
+
+    std::string cache_key(key.data(), key.size());
+    auto iter = s.index.find(cache_key);
+    if (iter != s.index.end()) {
+        remove(s, iter->second);
+    } else if (s.doorkeeper.erase(hash) == 0) {
+        // the first miss of the key recently, remember it only
+        if (s.doorkeeper.size() >= s.slots.size()) {
+            s.doorkeeper.clear();
+        }
+        s.doorkeeper.insert(hash);
+        return;
+    }
+
+    slot e;
+    e.key = std::move(cache_key);
+    // the value references the buffer of the whole response, copy it to hold only the value
+    e.value = found ? dsn::blob::create_from_bytes(value.to_string()) : dsn::blob();
+    e.found = found;
+    e.used = true;
+    e.referenced = false;
+    e.expire_ms = dsn_now_ms() + _ttl_ms;
+    if (e.size() > _shard_capacity_bytes) {
+        return;
+    }
+    while (s.free_slots.empty() || s.bytes + e.size() > _shard_capacity_bytes) {
+        if (!evict_one(s)) {
+            return;
+        }
+    }
+
+    size_t pos = s.free_slots.back();
+    s.free_slots.pop_back();
+    s.bytes += e.size();
+    _memory_bytes.fetch_add(e.size(), std::memory_order_relaxed);
+    _entry_count.fetch_add(1, std::memory_order_relaxed);
+    s.index.emplace(e.key, pos);
+    s.slots[pos] = std::move(e);
+
+    _pfc_memory_bytes->set(memory_bytes());
+    _pfc_entry_count->set(entry_count());
+}
+
+void near_cache::invalidate(dsn::string_view key)
+{
+    size_t hash;
+    shard &s = shard_of(key, hash);
+    std::lock_guard<std::mutex> l(s.lock);
+    ++s.generation;
+    auto iter = s.index.find(std::string(key.data(), key.size()));
+    if (iter != s.index.end()) {
+        remove(s, iter->second);
+        _pfc_memory_bytes->set(memory_bytes());
+        _pfc_entry_count->set(entry_count());
+    }
+}
+
+void near_cache::remove(shard &s, size_t pos)
+{
+    slot &e = s.slots[pos];
+    s.bytes -= e.size();
+    _memory_bytes.fetch_sub(e.size(), std::memory_order_relaxed);
+    _entry_count.fetch_sub(1, std::memory_order_relaxed);
+    s.index.erase(e.key);
+    e = slot();
+    s.free_slots.push_back(pos);
+}
+
+bool near_cache::evict_one(shard &s)
+{
+    if (s.index.empty()) {
+        return false;
+    }
+    // the hand clears the reference bits it passes, so it stops within two rounds
+    while (true) {
+        slot &e = s.slots[s.hand];
+        size_t pos = s.hand;
+        s.hand = (s.hand + 1) % s.slots.size();
+        if (!e.used) {
+            continue;
+        }
+        if (e.referenced) {
+            e.referenced = false;
+            continue;
+        }
+        remove(s, pos);
+        return true;
+    }
+}
+
+} // namespace proxy
+} // namespace pegasus
@@ -0,0 +1,120 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <dsn/perf_counter/perf_counter_wrapper.h>
+#include <dsn/utility/blob.h>
+#include <dsn/utility/string_view.h>
+
+namespace pegasus {
+namespace proxy {
+
+// near_cache caches the values of the read-mostly keys read by GET in the proxy, so that the
+// repeated reads are served without an rpc to the replica.
+//
+// - The cache is split into shards by the hash of the key, each shard is bounded by both the
+//   number of entries and the bytes of the keys and values, and the entries are evicted by the
+//   CLOCK algorithm.
+// - A key is admitted only when it's missed again after its first miss recently, so the keys
+//   read only once don't evict the hot ones.
+// - The writes through the proxy invalidate the key before they're sent and after they're
+//   replied, and the values read before an invalidation are refused by the generation check in
+//   put().
+// - The writes made elsewhere are not seen by the cache, so each entry expires after `ttl_ms`,
+//   which bounds the staleness.
+class near_cache
+{
+public:
+    near_cache(uint64_t capacity_bytes, uint32_t max_entries, uint64_t ttl_ms);
+
+    // Returns the generation which should be got before reading `key` and passed to put().
+    uint64_t generation(dsn::string_view key) const;
+
+    // Returns true if `key` is cached and not expired, `found` is false if the key is cached as
+    // not existing.
+    bool get(dsn::string_view key, /*out*/ bool &found, /*out*/ dsn::blob &value);
+
+    // Caches the `value` of `key` read from the replica, unless the key has been invalidated
+    // since `generation`, or it's not admitted.
+    void put(dsn::string_view key, bool found, const dsn::blob &value, uint64_t generation);
+
+    void invalidate(dsn::string_view key);
+
+    uint64_t memory_bytes() const { return _memory_bytes.load(std::memory_order_relaxed); }
+    uint64_t entry_count() const { return _entry_count.load(std::memory_order_relaxed); }
+
+private:
+    struct slot
+    {
+        std::string key;
+        dsn::blob value;
+        bool found = false;
+        bool used = false;
+        // the CLOCK reference bit, set on every hit and cleared when the hand passes
+        bool referenced = false;
+        uint64_t expire_ms = 0;
+
+        size_t size() const { return key.size() + value.length() + sizeof(slot); }
+    };
+
+    struct shard
+    {
+        std::mutex lock; // protects all the members
+        uint64_t generation = 0;
+        std::unordered_map<std::string, size_t> index; // key => position in slots
+        std::vector<slot> slots;
+        std::vector<size_t> free_slots;
+        size_t hand = 0;
+        uint64_t bytes = 0;
+        // the hashes of the keys missed recently but not admitted, it's cleared when it holds
+        // as many keys as the slots
+        std::unordered_set<size_t> doorkeeper;
+    };
+
+    shard &shard_of(dsn::string_view key, size_t &hash) const;
+    // remove the entry at `pos` in `s`, the lock of `s` is held
+    void remove(shard &s, size_t pos);
+    // evict an entry by CLOCK, returns false if `s` is empty, the lock of `s` is held
+    bool evict_one(shard &s);
+
+    static const size_t kShardCount = 16;
+
+    const uint64_t _shard_capacity_bytes;
+    const uint64_t _ttl_ms;
+    mutable std::vector<shard> _shards;
+
+    std::atomic<uint64_t> _memory_bytes{0};
+    std::atomic<uint64_t> _entry_count{0};
+
+    ::dsn::perf_counter_wrapper _pfc_hit_qps;
+    ::dsn::perf_counter_wrapper _pfc_miss_qps;
+    ::dsn::perf_counter_wrapper _pfc_memory_bytes;
+    ::dsn::perf_counter_wrapper _pfc_entry_count;
+};
+
+} // namespace proxy
+} // namespace pegasus
@@ -50,29 +50,51 @@ proxy_stub::proxy_stub(const proxy_session::factory &f,
     dsn::task_spec::get(dsn::apps::RPC_RRDB_RRDB_SCAN_ACK)->allow_inline = true;
     dsn::task_spec::get(dsn::apps::RPC_RRDB_RRDB_CLEAR_SCANNER_ACK)->allow_inline = true;
     dsn::task_spec::get(dsn::apps::RPC_RRDB_RRDB_INCR_ACK)->allow_inline = true;
+    dsn::task_spec::get(dsn::apps::RPC_RRDB_RRDB_CHECK_AND_MUTATE_ACK)->allow_inline = true;
+
+    _pfc_session_count.init_app_counter("app.pegasus",
+                                        "proxy.session_count",
+                                        COUNTER_TYPE_NUMBER,
+                                        "statistic the sessions of proxy");
+    _pfc_session_create_qps.init_app_counter("app.pegasus",
+                                             "proxy.session_create_qps",
+                                             COUNTER_TYPE_RATE,
+                                             "statistic the qps of creating sessions of proxy");
+    _pfc_session_remove_qps.init_app_counter("app.pegasus",
+                                             "proxy.session_remove_qps",
+                                             COUNTER_TYPE_RATE,
+                                             "statistic the qps of removing sessions of proxy");
 
     open_service();
 }
 
+proxy_stub::session_shard &proxy_stub::shard_of(::dsn::rpc_address address)
+{
+    return _session_shards[std::hash<::dsn::rpc_address>()(address) % kSessionShardCount];
+}
+
 void proxy_stub::on_rpc_request(dsn::message_ex *request)
 {
     ::dsn::rpc_address source = request->header->from_address;
+    session_shard &shard = shard_of(source);
     std::shared_ptr<proxy_session> session;
     {
-        ::dsn::zauto_read_lock l(_lock);
-        auto it = _sessions.find(source);
-        if (it != _sessions.end()) {
+        ::dsn::zauto_read_lock l(shard.lock);
+        auto it = shard.sessions.find(source);
+        if (it != shard.sessions.end()) {
             session = it->second;
         }
     }
     if (nullptr == session) {
-        ::dsn::zauto_write_lock l(_lock);
-        auto it = _sessions.find(source);
-        if (it != _sessions.end()) {
+        ::dsn::zauto_write_lock l(shard.lock);
+        auto it = shard.sessions.find(source);
+        if (it != shard.sessions.end()) {
             session = it->second;
         } else {
             session = _factory(this, request);
-            _sessions.emplace(source, session);
+            shard.sessions.emplace(source, session);
+            _pfc_session_count->increment();
+            _pfc_session_create_qps->increment();
         }
     }
 
@@ -87,18 +109,21 @@ void proxy_stub::on_recv_remove_session_request(dsn::message_ex *request)
 
 void proxy_stub::remove_session(dsn::rpc_address remote_address)
 {
+    session_shard &shard = shard_of(remote_address);
     std::shared_ptr<proxy_session> session;
     {
-        ::dsn::zauto_write_lock l(_lock);
-        auto iter = _sessions.find(remote_address);
-        if (iter == _sessions.end()) {
+        ::dsn::zauto_write_lock l(shard.lock);
+        auto iter = shard.sessions.find(remote_address);
+        if (iter == shard.sessions.end()) {
             dwarn("%s has been removed from proxy stub", remote_address.to_string());
             return;
         }
         ddebug("remove %s from proxy stub", remote_address.to_string());
         session = std::move(iter->second);
-        _sessions.erase(iter);
+        shard.sessions.erase(iter);
     }
+    _pfc_session_count->decrement();
+    _pfc_session_remove_qps->increment();
     session->on_remove_session();
 }
 
@@ -19,8 +19,10 @@
 
 #pragma once
 
+#include <dsn/perf_counter/perf_counter_wrapper.h>
 #include <dsn/service_api_cpp.h>
 #include <dsn/tool-api/zlocks.h>
+#include <array>
 #include <unordered_map>
 #include <functional>
 
@@ -98,13 +100,26 @@ private:
     void on_rpc_request(dsn::message_ex *request);
     void on_recv_remove_session_request(dsn::message_ex *);
 
-    ::dsn::zrwlock_nr _lock;
-    std::unordered_map<::dsn::rpc_address, std::shared_ptr<proxy_session>> _sessions;
+    // the sessions are split into shards by the client address, so that the lookups of the
+    // messages from different connections don't contend on one lock
+    struct session_shard
+    {
+        ::dsn::zrwlock_nr lock;
+        std::unordered_map<::dsn::rpc_address, std::shared_ptr<proxy_session>> sessions;
+    };
+    static const int kSessionShardCount = 64;
+    session_shard &shard_of(::dsn::rpc_address address);
+
+    std::array<session_shard, kSessionShardCount> _session_shards;
     proxy_session::factory _factory;
     ::dsn::rpc_address _uri_address;
     std::string _cluster;
     std::string _app;
     std::string _geo_app;
+
+    ::dsn::perf_counter_wrapper _pfc_session_count;
+    ::dsn::perf_counter_wrapper _pfc_session_create_qps;
+    ::dsn::perf_counter_wrapper _pfc_session_remove_qps;
 };
 } // namespace proxy
 } // namespace pegasus
@@ -18,10 +18,19 @@
  */
 
 #include "redis_parser.h"
-
+#include "near_cache.h"
+#include "scan_cursor_table.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <limits>
+#include <unordered_set>
 #include <rocksdb/status.h>
 #include <dsn/dist/fmt_logging.h>
 #include <dsn/dist/replication/replication_other_types.h>
+#include <dsn/perf_counter/perf_counter_wrapper.h>
+#include <dsn/utility/flags.h>
 #include <dsn/utility/string_conv.h>
 
 #include <rrdb/rrdb.client.h>
@@ -29,51 +38,147 @@
 #include <pegasus_key_schema.h>
 #include <pegasus_utils.h>
 #include "base/pegasus_const.h"
+#include "base/pegasus_sharded_counter.h"
 
 namespace pegasus {
 namespace proxy {
 
+DSN_DEFINE_string("pegasus.proxy",
+                  sharded_counter_key_prefix,
+                  "",
+                  "the keys with this prefix are sharded counters, whose value is spread over "
+                  "several shard keys to avoid hotspots of INCR, empty means disabled");
+DSN_DEFINE_int32("pegasus.proxy",
+                 sharded_counter_shard_count,
+                 8,
+                 "the number of shards of each sharded counter, it should only be decreased "
+                 "after the counters are folded");
+DSN_DEFINE_validator(sharded_counter_shard_count, [](int32_t count) -> bool {
+    return sharded_counter_shard_count_valid(count);
+});
+DSN_DEFINE_bool("pegasus.proxy",
+                sharded_counter_incr_reply_shard,
+                false,
+                "whether INCR/DECR of a sharded counter reply with the new value of the "
+                "incremented shard, which saves getting all the shards after each increment, "
+                "otherwise they reply with the value of the counter as redis does");
+DSN_TAG_VARIABLE(sharded_counter_incr_reply_shard, FT_MUTABLE);
+DSN_DEFINE_string("pegasus.proxy",
+                  near_cache_key_prefix,
+                  "",
+                  "the values of the keys with this prefix read by GET are cached in the proxy, "
+                  "it's only for the read-mostly keys, empty means disabled");
+DSN_DEFINE_uint32("pegasus.proxy",
+                  near_cache_capacity_mb,
+                  64,
+                  "the max memory used by the near cache of the proxy");
+DSN_DEFINE_uint32("pegasus.proxy",
+                  near_cache_max_entries,
+                  100000,
+                  "the max number of keys in the near cache of the proxy");
+DSN_DEFINE_uint32("pegasus.proxy",
+                  near_cache_ttl_ms,
+                  1000,
+                  "the time a value is cached in the near cache of the proxy, which bounds the "
+                  "staleness of the value if the key is written by other proxies or clients");
+DSN_DEFINE_uint32("pegasus.proxy",
+                  scan_cursor_max_count,
+                  100000,
+                  "the max number of the unfinished SCAN and HSCAN cursors kept in the proxy, the "
+                  "oldest ones are refused once there're more");
+DSN_DEFINE_uint32("pegasus.proxy",
+                  scan_cursor_ttl_ms,
+                  600000,
+                  "the time a SCAN or HSCAN cursor can be continued after it's replied");
+
 std::atomic_llong redis_parser::s_next_seqid(0);
 const char redis_parser::CR = '\015';
 const char redis_parser::LF = '\012';
 
-std::unordered_map<std::string, redis_parser::redis_call_handler> redis_parser::s_dispatcher = {
-    {"SET", redis_parser::g_set},
-    {"GET", redis_parser::g_get},
-    {"DEL", redis_parser::g_del},
-    {"SETEX", redis_parser::g_setex},
-    {"TTL", redis_parser::g_ttl},
-    {"PTTL", redis_parser::g_ttl},
-    {"GEOADD", redis_parser::g_geo_add},
-    {"GEODIST", redis_parser::g_geo_dist},
-    {"GEOPOS", redis_parser::g_geo_pos},
-    {"GEORADIUS", redis_parser::g_geo_radius},
-    {"GEORADIUSBYMEMBER", redis_parser::g_geo_radius_by_member},
-    {"INCR", redis_parser::g_incr},
-    {"INCRBY", redis_parser::g_incr_by},
-    {"DECR", redis_parser::g_decr},
-    {"DECRBY", redis_parser::g_decr_by},
+#define REDIS_COMMAND(name, function_name)                                                         \
+    {                                                                                              \
+        #name, sizeof(#name) - 1, redis_parser::g_##function_name                                  \
+    }
+
+const redis_parser::redis_command redis_parser::s_dispatcher[] = {
+    REDIS_COMMAND(SET, set),
+    REDIS_COMMAND(GET, get),
+    REDIS_COMMAND(DEL, del),
+    REDIS_COMMAND(SETEX, setex),
+    REDIS_COMMAND(TTL, ttl),
+    REDIS_COMMAND(PTTL, ttl),
+    REDIS_COMMAND(GEOADD, geo_add),
+    REDIS_COMMAND(GEODIST, geo_dist),
+    REDIS_COMMAND(GEOPOS, geo_pos),
+    REDIS_COMMAND(GEORADIUS, geo_radius),
+    REDIS_COMMAND(GEORADIUSBYMEMBER, geo_radius_by_member),
+    REDIS_COMMAND(INCR, incr),
+    REDIS_COMMAND(INCRBY, incr_by),
+    REDIS_COMMAND(DECR, decr),
+    REDIS_COMMAND(DECRBY, decr_by),
+    REDIS_COMMAND(MGET, mget),
+    REDIS_COMMAND(MSET, mset),
+    REDIS_COMMAND(EXISTS, exists),
+    REDIS_COMMAND(UNLINK, unlink),
+    REDIS_COMMAND(HSET, hset),
+    REDIS_COMMAND(HMSET, hmset),
+    REDIS_COMMAND(HGET, hget),
+    REDIS_COMMAND(HMGET, hmget),
+    REDIS_COMMAND(HGETALL, hgetall),
+    REDIS_COMMAND(HDEL, hdel),
+    REDIS_COMMAND(HLEN, hlen),
+    REDIS_COMMAND(HSCAN, hscan),
+    REDIS_COMMAND(SCAN, scan),
+    REDIS_COMMAND(ZADD, zadd),
+    REDIS_COMMAND(ZREM, zrem),
+    REDIS_COMMAND(ZSCORE, zscore),
+    REDIS_COMMAND(ZCARD, zcard),
+    REDIS_COMMAND(ZRANGE, zrange),
+    REDIS_COMMAND(ZREVRANGE, zrevrange),
+    REDIS_COMMAND(ZRANGEBYSCORE, zrangebyscore),
+    REDIS_COMMAND(ZREVRANGEBYSCORE, zrevrangebyscore),
 };
+#undef REDIS_COMMAND
+
+const size_t redis_parser::s_dispatcher_size =
+    sizeof(redis_parser::s_dispatcher) / sizeof(redis_parser::s_dispatcher[0]);
+
+// Compare `command` with `name` case-insensitively, `name` is in upper case and consists of
+// letters only, thus clearing the bit 0x20 of a byte of `command` makes it equal to the letter
+// in `name` if and only if it's the letter in either case.
+static inline bool command_equals(const char *name, const char *command, unsigned int length)
+{
+    for (unsigned int i = 0; i < length; ++i) {
+        if ((command[i] & ~0x20) != name[i]) {
+            return false;
+        }
+    }
+    return true;
+}
 
 redis_parser::redis_call_handler redis_parser::get_handler(const char *command, unsigned int length)
 {
-    std::string key(command, length);
-    std::transform(key.begin(), key.end(), key.begin(), toupper);
-    auto iter = s_dispatcher.find(key);
-    if (iter == s_dispatcher.end())
-        return redis_parser::g_default_handler;
-    return iter->second;
+    for (size_t i = 0; i < s_dispatcher_size; ++i) {
+        const redis_command &cmd = s_dispatcher[i];
+        if (cmd.length == length && command_equals(cmd.name, command, length)) {
+            return cmd.handler;
+        }
+    }
+    return redis_parser::g_default_handler;
 }
 
 redis_parser::redis_parser(proxy_stub *op, dsn::message_ex *first_msg)
     : proxy_session(op, first_msg),
       _current_msg(new message_entry()),
       _status(kStartArray),
-      _current_size(),
+      _current_size(0),
+      _current_size_digits(0),
+      _current_size_negative(false),
       _total_length(0),
       _current_buffer(nullptr),
       _current_buffer_length(0),
-      _current_cursor(0)
+      _current_cursor(0),
+      _scan_client(nullptr)
 {
     ::dsn::apps::rrdb_client *r;
     if (op) {
@@ -85,6 +190,9 @@ redis_parser::redis_parser(proxy_stub *op, dsn::message_ex *first_msg)
             _geo_client = dsn::make_unique<geo::geo_client>(
                 "config.ini", op->get_cluster(), op->get_app(), op->get_geo_app());
         }
+        static bool client_factory_initialized = pegasus_client_factory::initialize(nullptr);
+        dassert(client_factory_initialized, "initialize the pegasus client factory failed");
+        _scan_client = pegasus_client_factory::get_client(op->get_cluster(), op->get_app());
     } else {
         r = new ::dsn::apps::rrdb_client();
     }
@@ -98,6 +206,17 @@ redis_parser::~redis_parser()
     ddebug("%s: redis parser destroyed", _remote_address.to_string());
 }
 
+// Find the blob of `msg` which holds `buffer` returned by read_next.
+static dsn::blob locate_buffer(dsn::message_ex *msg, const char *buffer, size_t length)
+{
+    for (const dsn::blob &bb : msg->buffers) {
+        if (buffer >= bb.data() && buffer + length <= bb.data() + bb.length()) {
+            return bb.range(static_cast<int>(buffer - bb.data()), length);
+        }
+    }
+    return dsn::blob();
+}
+
 void redis_parser::prepare_current_buffer()
 {
     void *msg_buffer;
@@ -111,12 +230,14 @@ void redis_parser::prepare_current_buffer()
             first_msg->header->rpc_name);
         _current_buffer = reinterpret_cast<char *>(msg_buffer);
         _current_cursor = 0;
+        _current_blob = locate_buffer(first_msg, _current_buffer, _current_buffer_length);
     } else if (_current_cursor >= _current_buffer_length) {
         dsn::message_ex *first_msg = _recv_buffers.front();
         first_msg->read_commit(_current_buffer_length);
         if (first_msg->read_next(&msg_buffer, &_current_buffer_length)) {
             _current_buffer = reinterpret_cast<char *>(msg_buffer);
             _current_cursor = 0;
+            _current_blob = locate_buffer(first_msg, _current_buffer, _current_buffer_length);
         } else {
             // we have consume this message all over
             // reference is added in append message
@@ -134,7 +255,9 @@ void redis_parser::reset_parser()
     _current_msg->request.sub_request_count = 0;
     _current_msg->request.sub_requests.clear();
     _status = kStartArray;
-    _current_size.clear();
+    _current_size = 0;
+    _current_size_digits = 0;
+    _current_size_negative = false;
 
     // clear the data stream
     _total_length = 0;
@@ -144,6 +267,7 @@ void redis_parser::reset_parser()
     _current_buffer = nullptr;
     _current_buffer_length = 0;
     _current_cursor = 0;
+    _current_blob = dsn::blob();
     while (!_recv_buffers.empty()) {
         _recv_buffers.front()->release_ref();
         _recv_buffers.pop();
@@ -185,12 +309,47 @@ void redis_parser::eat_all(char *dest, size_t length)
     }
 }
 
+bool redis_parser::append_size(const char *digits, size_t length)
+{
+    // 10 digits are enough for int32
+    static const int kMaxSizeDigits = 10;
+    for (size_t i = 0; i < length; ++i) {
+        char c = digits[i];
+        if (c == '-' && _current_size_digits == 0 && !_current_size_negative) {
+            _current_size_negative = true;
+            continue;
+        }
+        if (dsn_unlikely(c < '0' || c > '9' || _current_size_digits >= kMaxSizeDigits)) {
+            derror_f("{}: invalid character '{}' in size", _remote_address.to_string(), c);
+            return false;
+        }
+        _current_size = _current_size * 10 + (c - '0');
+        ++_current_size_digits;
+    }
+    return true;
+}
+
+bool redis_parser::end_size(int32_t &size)
+{
+    int64_t value = _current_size_negative ? -_current_size : _current_size;
+    bool valid = _current_size_digits > 0 && value >= INT32_MIN && value <= INT32_MAX;
+    if (dsn_unlikely(!valid)) {
+        derror_f("{}: invalid size {}{}",
+                 _remote_address.to_string(),
+                 _current_size_negative ? "-" : "",
+                 _current_size_digits > 0 ? std::to_string(_current_size) : "");
+    }
+    _current_size = 0;
+    _current_size_digits = 0;
+    _current_size_negative = false;
+    size = static_cast<int32_t>(value);
+    return valid;
+}
+
 bool redis_parser::end_array_size()
 {
     int32_t count = 0;
-    if (dsn_unlikely(!dsn::buf2int32(dsn::string_view(_current_size), count))) {
-        derror_f(
-            "{}: invalid size string \"{}\"", _remote_address.to_string(), _current_size.c_str());
+    if (dsn_unlikely(!end_size(count))) {
         return false;
     }
     if (dsn_unlikely(count <= 0)) {
@@ -204,7 +363,6 @@ bool redis_parser::end_array_size()
     current_request.sub_request_count = count;
     current_request.sub_requests.reserve(count);
 
-    _current_size.clear();
     _status = kStartBulkString;
     return true;
 }
@@ -212,7 +370,7 @@ bool redis_parser::end_array_size()
 void redis_parser::append_current_bulk_string()
 {
     redis_request &current_array = _current_msg->request;
-    current_array.sub_requests.push_back(_current_str);
+    current_array.sub_requests.push_back(std::move(_current_str));
     if (current_array.sub_requests.size() == current_array.sub_request_count) {
         // we get a full request command
         handle_command(std::move(_current_msg));
@@ -226,16 +384,12 @@ void redis_parser::append_current_bulk_string()
 bool redis_parser::end_bulk_string_size()
 {
     int32_t length = 0;
-    if (dsn_unlikely(!dsn::buf2int32(
-            dsn::string_view(_current_size.c_str(), _current_size.length()), length))) {
-        derror_f(
-            "{}: invalid size string \"{}\"", _remote_address.to_string(), _current_size.c_str());
+    if (dsn_unlikely(!end_size(length))) {
         return false;
     }
 
     _current_str.length = length;
     _current_str.data.assign(nullptr, 0, 0);
-    _current_size.clear();
 
     if (-1 == _current_str.length) {
         append_current_bulk_string();
@@ -264,7 +418,6 @@ void redis_parser::append_message(dsn::message_ex *msg)
 // refererence: http://redis.io/topics/protocol
 bool redis_parser::parse_stream()
 {
-    char t;
     while (_total_length > 0) {
         switch (_status) {
         case kStartArray:
@@ -276,9 +429,17 @@ bool redis_parser::parse_stream()
             _status = kInBulkStringSize;
             break;
         case kInArraySize:
-        case kInBulkStringSize:
-            t = peek();
-            if (t == CR) {
+        case kInBulkStringSize: {
+            // consume all the digits in the current buffer at once
+            prepare_current_buffer();
+            const char *begin = _current_buffer + _current_cursor;
+            size_t available = _current_buffer_length - _current_cursor;
+            const char *cr = static_cast<const char *>(memchr(begin, CR, available));
+            size_t digits_length = (cr == nullptr) ? available : (cr - begin);
+            dverify(append_size(begin, digits_length));
+            _current_cursor += digits_length;
+            _total_length -= digits_length;
+            if (cr != nullptr) {
                 if (_total_length > 1) {
                     dverify(eat(CR));
                     dverify(eat(LF));
@@ -290,18 +451,28 @@ bool redis_parser::parse_stream()
                 } else {
                     return true;
                 }
-            } else {
-                _current_size.push_back(t);
-                dverify(eat(t));
             }
             break;
+        }
         case kStartBulkStringData:
             // string content + CR + LF
             if (_total_length >= _current_str.length + 2) {
                 if (_current_str.length > 0) {
-                    std::string str_data(_current_str.length, '\0');
-                    eat_all(const_cast<char *>(str_data.data()), _current_str.length);
-                    _current_str.data = dsn::blob::create_from_bytes(std::move(str_data));
+                    size_t length = _current_str.length;
+                    prepare_current_buffer();
+                    if (_current_blob.length() > 0 &&
+                        _current_buffer_length - _current_cursor >= length) {
+                        // the string lies in the current buffer, so it refers to the buffer
+                        // directly
+                        _current_str.data =
+                            _current_blob.range(static_cast<int>(_current_cursor), length);
+                        _current_cursor += length;
+                        _total_length -= length;
+                    } else {
+                        std::shared_ptr<char> buffer(dsn::utils::make_shared_array<char>(length));
+                        eat_all(buffer.get(), length);
+                        _current_str.data.assign(std::move(buffer), 0, length);
+                    }
                 }
                 dverify(eat(CR));
                 dverify(eat(LF));
@@ -320,7 +491,10 @@ bool redis_parser::parse_stream()
 bool redis_parser::parse(dsn::message_ex *msg)
 {
     append_message(msg);
-    if (parse_stream()) {
+    bool ok = parse_stream();
+    // the commands parsed before the failure are still served
+    flush_read_batches();
+    if (ok) {
         return true;
     } else {
         // when parse a new message failed, we only reset the parser.
@@ -436,8 +610,11 @@ void redis_parser::set_internal(redis_parser::message_entry &entry)
         // with a reference to prevent the object from being destroyed
         std::shared_ptr<proxy_session> ref_this = shared_from_this();
         dinfo("%s: send set command(%" PRId64 ")", _remote_address.to_string(), entry.sequence_id);
-        auto on_set_reply = [ref_this, this, &entry](
+        ::dsn::blob key = request.sub_requests[1].data;
+        invalidate_near_cache(key);
+        auto on_set_reply = [ref_this, this, key, &entry](
             ::dsn::error_code ec, dsn::message_ex *, dsn::message_ex *response) {
+            invalidate_near_cache(key);
             // when the "is_session_reset" flag is set, the socket may be broken.
             // so continue to reply the message is not necessary
             if (_is_session_reset.load(std::memory_order_acquire)) {
@@ -504,7 +681,11 @@ void redis_parser::set_geo_internal(message_entry &entry)
 
         // with a reference to prevent the object from being destroyed
         std::shared_ptr<proxy_session> ref_this = shared_from_this();
-        auto set_callback = [ref_this, this, &entry](int ec, pegasus_client::internal_info &&) {
+        ::dsn::blob key = redis_request.sub_requests[1].data;
+        invalidate_near_cache(key);
+        auto set_callback = [ref_this, this, key, &entry](int ec,
+                                                         pegasus_client::internal_info &&) {
+            invalidate_near_cache(key);
             if (_is_session_reset.load(std::memory_order_acquire)) {
                 ddebug("%s: setex command seqid(%" PRId64 ") got reply, but session has reset",
                        _remote_address.to_string(),
@@ -552,8 +733,11 @@ void redis_parser::setex(message_entry &entry)
         }
 
         std::shared_ptr<proxy_session> ref_this = shared_from_this();
-        auto on_setex_reply = [ref_this, this, &entry](
+        ::dsn::blob key = redis_req.sub_requests[1].data;
+        invalidate_near_cache(key);
+        auto on_setex_reply = [ref_this, this, key, &entry](
             ::dsn::error_code ec, dsn::message_ex *, dsn::message_ex *response) {
+            invalidate_near_cache(key);
             if (_is_session_reset.load(std::memory_order_acquire)) {
                 ddebug("%s: setex command seqid(%" PRId64 ") got reply, but session has reset",
                        _remote_address.to_string(),
@@ -607,7 +791,44 @@ void redis_parser::get(message_entry &entry)
               _remote_address.to_string(),
               entry.sequence_id);
         std::shared_ptr<proxy_session> ref_this = shared_from_this();
-        auto on_get_reply = [ref_this, this, &entry](
+        if (is_sharded_counter_key(redis_req.sub_requests[1].data)) {
+            get_sharded_counter(
+                redis_req.sub_requests[1].data,
+                [ref_this, this, &entry](const std::string &error, bool found, int64_t sum) {
+                    if (_is_session_reset.load(std::memory_order_acquire)) {
+                        ddebug("%s: get command(%" PRId64 ") got reply, but session has reset",
+                               _remote_address.to_string(),
+                               entry.sequence_id);
+                        return;
+                    }
+                    if (!error.empty()) {
+                        simple_error_reply(entry, error);
+                    } else if (!found) {
+                        reply_message(entry, redis_bulk_string());
+                    } else {
+                        reply_message(entry, redis_bulk_string(std::to_string(sum)));
+                    }
+                });
+            return;
+        }
+
+        const ::dsn::blob &key = redis_req.sub_requests[1].data;
+        near_cache *cache = near_cache_of(key);
+        uint64_t generation = 0;
+        if (cache != nullptr) {
+            bool found = false;
+            ::dsn::blob value;
+            if (cache->get(dsn::string_view(key.data(), key.length()), found, value)) {
+                if (found) {
+                    reply_message(entry, redis_bulk_string(value));
+                } else {
+                    reply_message(entry, redis_bulk_string());
+                }
+                return;
+            }
+            generation = cache->generation(dsn::string_view(key.data(), key.length()));
+        }
+        auto on_get_reply = [ref_this, this, cache, generation, &entry](
             ::dsn::error_code ec, dsn::message_ex *, dsn::message_ex *response) {
             if (_is_session_reset.load(std::memory_order_acquire)) {
                 ddebug("%s: get command(%" PRId64 ") got reply, but session has reset",
@@ -625,6 +846,14 @@ void redis_parser::get(message_entry &entry)
             } else {
                 ::dsn::apps::read_response rrdb_response;
                 ::dsn::unmarshall(response, rrdb_response);
+                if (cache != nullptr && (rrdb_response.error == 0 ||
+                                         rrdb_response.error == rocksdb::Status::kNotFound)) {
+                    const ::dsn::blob &key = entry.request.sub_requests[1].data;
+                    cache->put(dsn::string_view(key.data(), key.length()),
+                               rrdb_response.error == 0,
+                               rrdb_response.value,
+                               generation);
+                }
                 if (rrdb_response.error != 0) {
                     if (rrdb_response.error == rocksdb::Status::kNotFound) {
                         reply_message(entry, redis_bulk_string());
@@ -639,7 +868,7 @@ void redis_parser::get(message_entry &entry)
         };
         ::dsn::blob req;
         ::dsn::blob null_blob;
-        pegasus_generate_key(req, redis_req.sub_requests[1].data, null_blob);
+        pegasus_generate_key(req, key, null_blob);
         auto partition_hash = pegasus_key_hash(req);
         // TODO: set the timeout
         client->get(req, on_get_reply, std::chrono::milliseconds(2000), 0, partition_hash);
@@ -655,59 +884,22 @@ void redis_parser::del(message_entry &entry)
     }
 }
 
+// origin command format:
+// DEL key [key ...]
+// NOTE: the values of all the types are removed, that is all the sort keys of the hash key. A
+// key is counted if it's a hash or a sorted set, or if it's removed as a string, which is done
+// without reading the value, so a key not existing is counted too, the same as the DEL of pegasus
+// before
 void redis_parser::del_internal(message_entry &entry)
 {
     redis_request &redis_req = entry.request;
-    if (redis_req.sub_requests.size() != 2) {
+    if (redis_req.sub_requests.size() < 2) {
         ddebug("%s: del command seqid(%" PRId64 ") with invalid arguments",
                _remote_address.to_string(),
                entry.sequence_id);
         simple_error_reply(entry, "wrong number of arguments for 'del' command");
     } else {
-        dinfo("%s: send del command seqid(%" PRId64 ")",
-              _remote_address.to_string(),
-              entry.sequence_id);
-        std::shared_ptr<proxy_session> ref_this = shared_from_this();
-        auto on_del_reply = [ref_this, this, &entry](
-            ::dsn::error_code ec, dsn::message_ex *, dsn::message_ex *response) {
-            if (_is_session_reset.load(std::memory_order_acquire)) {
-                ddebug("%s: del command seqid(%" PRId64 ") got reply, but session has reset",
-                       _remote_address.to_string(),
-                       entry.sequence_id);
-                return;
-            }
-
-            dinfo("%s: del command seqid(%" PRId64 ") got reply",
-                  _remote_address.to_string(),
-                  entry.sequence_id);
-            if (::dsn::ERR_OK != ec) {
-                ddebug("%s: del command seqid(%" PRId64 ") got reply with error = %s",
-                       _remote_address.to_string(),
-                       entry.sequence_id,
-                       ec.to_string());
-                simple_error_reply(entry, ec.to_string());
-            } else {
-                ::dsn::apps::read_response rrdb_response;
-                ::dsn::unmarshall(response, rrdb_response);
-                if (rrdb_response.error != 0) {
-                    simple_error_reply(entry,
-                                       "internal error " + std::to_string(rrdb_response.error));
-                } else {
-                    // NOTE: Deleting a non-existed key returns 1 too. But standard Redis returns 0.
-                    // Pegasus behaves
-                    // differently in this case intentionally for performance.
-                    // Because if we need to check the existence, we should use check_and_mutate
-                    // instead.
-                    simple_integer_reply(entry, 1);
-                }
-            }
-        };
-        ::dsn::blob req;
-        ::dsn::blob null_blob;
-        pegasus_generate_key(req, redis_req.sub_requests[1].data, null_blob);
-        auto partition_hash = pegasus_key_hash(req);
-        // TODO: set the timeout
-        client->remove(req, on_del_reply, std::chrono::milliseconds(2000), 0, partition_hash);
+        del_keys(entry);
     }
 }
 
@@ -725,7 +917,11 @@ void redis_parser::del_geo_internal(message_entry &entry)
     } else {
         // with a reference to prevent the object from being destroyed
         std::shared_ptr<proxy_session> ref_this = shared_from_this();
-        auto del_callback = [ref_this, this, &entry](int ec, pegasus_client::internal_info &&) {
+        ::dsn::blob key = redis_request.sub_requests[1].data;
+        invalidate_near_cache(key);
+        auto del_callback = [ref_this, this, key, &entry](int ec,
+                                                         pegasus_client::internal_info &&) {
+            invalidate_near_cache(key);
             if (_is_session_reset.load(std::memory_order_acquire)) {
                 ddebug("%s: setex command seqid(%" PRId64 ") got reply, but session has reset",
                        _remote_address.to_string(),
@@ -935,9 +1131,10 @@ void redis_parser::counter_internal(message_entry &entry)
 {
     dassert(!entry.request.sub_requests.empty(), "");
     dassert(entry.request.sub_requests[0].length > 0, "");
-    const char *command = entry.request.sub_requests[0].data.data();
+    // the bulk string may refer to the receive buffer, which is not terminated by '\0'
+    std::string command = entry.request.sub_requests[0].data.to_string();
     int64_t increment = 1;
-    if (strcasecmp(command, "INCR") == 0 || strcasecmp(command, "DECR") == 0) {
+    if (strcasecmp(command.c_str(), "INCR") == 0 || strcasecmp(command.c_str(), "DECR") == 0) {
         if (entry.request.sub_requests.size() != 2) {
             dwarn_f("{}: command {} seqid({}) with invalid arguments count: {}",
                     _remote_address.to_string(),
@@ -947,7 +1144,8 @@ void redis_parser::counter_internal(message_entry &entry)
             simple_error_reply(entry, fmt::format("wrong number of arguments for '{}'", command));
             return;
         }
-    } else if (strcasecmp(command, "INCRBY") == 0 || strcasecmp(command, "DECRBY") == 0) {
+    } else if (strcasecmp(command.c_str(), "INCRBY") == 0 ||
+               strcasecmp(command.c_str(), "DECRBY") == 0) {
         if (entry.request.sub_requests.size() != 3) {
             dwarn_f("{}: command {} seqid({}) with invalid arguments count: {}",
                     _remote_address.to_string(),
@@ -970,13 +1168,15 @@ void redis_parser::counter_internal(message_entry &entry)
     } else {
         dfatal_f("command not support: {}", command);
     }
-    if (strncasecmp(command, "DECR", 4) == 0) {
+    if (strncasecmp(command.c_str(), "DECR", 4) == 0) {
         increment = -increment;
     }
 
     std::shared_ptr<proxy_session> ref_this = shared_from_this();
+    invalidate_near_cache(entry.request.sub_requests[1].data);
     auto on_incr_reply = [ref_this, this, command, &entry](
         ::dsn::error_code ec, dsn::message_ex *, dsn::message_ex *response) {
+        invalidate_near_cache(entry.request.sub_requests[1].data);
         if (_is_session_reset.load(std::memory_order_acquire)) {
             dwarn_f("{}: command {} seqid({}) got reply, but session has reset",
                     _remote_address.to_string(),
@@ -997,185 +1197,2443 @@ void redis_parser::counter_internal(message_entry &entry)
             ::dsn::unmarshall(response, incr_resp);
             if (incr_resp.error != 0) {
                 simple_error_reply(entry, "internal error " + std::to_string(incr_resp.error));
+            } else if (!FLAGS_sharded_counter_incr_reply_shard &&
+                       is_sharded_counter_key(entry.request.sub_requests[1].data)) {
+                // only a shard is incremented, reply with the sum of all the shards
+                get_sharded_counter(
+                    entry.request.sub_requests[1].data,
+                    [ref_this, this, command, &entry](
+                        const std::string &error, bool, int64_t sum) {
+                        if (_is_session_reset.load(std::memory_order_acquire)) {
+                            dwarn_f("{}: command {} seqid({}) got reply, but session has reset",
+                                    _remote_address.to_string(),
+                                    command,
+                                    entry.sequence_id);
+                            return;
+                        }
+                        if (!error.empty()) {
+                            simple_error_reply(entry, error);
+                        } else {
+                            simple_integer_reply(entry, sum);
+                        }
+                    });
             } else {
+                // the new value of the incremented shard if `sharded_counter_incr_reply_shard`
                 simple_integer_reply(entry, incr_resp.new_value);
             }
         }
     };
     dsn::apps::incr_request req;
-    pegasus_generate_key(req.key, entry.request.sub_requests[1].data, dsn::blob());
+    const ::dsn::blob &key = entry.request.sub_requests[1].data;
+    if (is_sharded_counter_key(key)) {
+        int shard = sharded_counter_random_shard(FLAGS_sharded_counter_shard_count);
+        pegasus_generate_key(req.key,
+                             sharded_counter_hash_key(dsn::string_view(key.data(), key.length()),
+                                                      shard),
+                             std::string());
+    } else {
+        pegasus_generate_key(req.key, key, dsn::blob());
+    }
     req.increment = increment;
     client->incr(req, on_incr_reply, std::chrono::milliseconds(2000), 0, pegasus_key_hash(req.key));
 }
 
-void redis_parser::parse_set_parameters(const std::vector<redis_bulk_string> &opts,
-                                        int &ttl_seconds)
+namespace {
+// the replies of the shards of a sharded counter, each shard has its own slots
+struct sharded_counter_context
 {
-    // [EX seconds]
-    ttl_seconds = 0;
-    for (int i = 3; i < opts.size(); ++i) {
-        const std::string &opt = opts[i].data.to_string();
-        if (strcasecmp(opt.c_str(), "EX") == 0 && i + 1 < opts.size()) {
-            const std::string &str_ttl_seconds = opts[i + 1].data.to_string();
-            if (!dsn::buf2int32(str_ttl_seconds, ttl_seconds)) {
-                dwarn_f("'EX {}' option is error, use {}", str_ttl_seconds, ttl_seconds);
-            }
-        } else {
-            dwarn_f("only 'EX' option is supported");
-        }
+    explicit sharded_counter_context(int shard_count)
+        : errors(shard_count), found(shard_count, 0), values(shard_count, 0),
+          pending_count(shard_count)
+    {
     }
-}
 
-void redis_parser::parse_geo_radius_parameters(const std::vector<redis_bulk_string> &opts,
-                                               int base_index,
-                                               double &radius_m,
-                                               std::string &unit,
-                                               geo::geo_client::SortType &sort_type,
-                                               int &count,
-                                               bool &WITHCOORD,
-                                               bool &WITHDIST,
-                                               bool &WITHHASH)
+    std::vector<std::string> errors;
+    std::vector<char> found;
+    std::vector<int64_t> values;
+    std::atomic<int> pending_count;
+};
+} // anonymous namespace
+
+/*static*/ bool redis_parser::is_sharded_counter_key(const ::dsn::blob &key)
 {
-    // radius
-    if (base_index >= opts.size()) {
-        return;
-    }
-    const std::string &str_radius = opts[base_index++].data.to_string();
-    if (!dsn::buf2double(str_radius, radius_m)) {
-        dwarn_f("radius parameter '{}' is error, use {}", str_radius, radius_m);
-    }
+    size_t prefix_length = strlen(FLAGS_sharded_counter_key_prefix);
+    return prefix_length > 0 && key.length() >= prefix_length &&
+           memcmp(key.data(), FLAGS_sharded_counter_key_prefix, prefix_length) == 0;
+}
 
-    // m|km|ft|mi
-    if (base_index >= opts.size()) {
-        return;
-    }
-    unit = opts[base_index++].data.to_string();
-    if (unit == "km") {
-        radius_m *= 1000;
-    } else if (unit == "mi") {
-        radius_m *= 1609.344;
-    } else if (unit == "ft") {
-        radius_m *= 0.3048;
-    } else {
-        // keep as meter unit
-        unit = "m";
-        base_index--;
+/*static*/ near_cache *redis_parser::near_cache_of(const ::dsn::blob &key)
+{
+    static std::unique_ptr<near_cache> s_near_cache(
+        strlen(FLAGS_near_cache_key_prefix) == 0
+            ? nullptr
+            : new near_cache(static_cast<uint64_t>(FLAGS_near_cache_capacity_mb) << 20,
+                             FLAGS_near_cache_max_entries,
+                             FLAGS_near_cache_ttl_ms));
+    if (s_near_cache == nullptr) {
+        return nullptr;
     }
-
-    // [WITHCOORD] [WITHDIST] [WITHHASH] [COUNT count] [ASC|DESC]
-    while (base_index < opts.size()) {
-        const std::string &opt = opts[base_index].data.to_string();
-        if (strcasecmp(opt.c_str(), "WITHCOORD") == 0) {
-            WITHCOORD = true;
-        } else if (strcasecmp(opt.c_str(), "WITHDIST") == 0) {
-            WITHDIST = true;
-        } else if (strcasecmp(opt.c_str(), "WITHHASH") == 0) {
-            WITHHASH = true;
-        } else if (strcasecmp(opt.c_str(), "COUNT") == 0 && base_index + 1 < opts.size()) {
-            const std::string &str_count = opts[base_index + 1].data.to_string();
-            if (!dsn::buf2int32(str_count, count)) {
-                derror_f("'COUNT {}' option is error, use {}", str_count, count);
-            }
-        } else if (strcasecmp(opt.c_str(), "ASC") == 0) {
-            sort_type = geo::geo_client::SortType::asc;
-        } else if (strcasecmp(opt.c_str(), "DESC") == 0) {
-            sort_type = geo::geo_client::SortType::desc;
-        }
-        base_index++;
+    // the value of a sharded counter is the sum of the shards, which is not cached
+    size_t prefix_length = strlen(FLAGS_near_cache_key_prefix);
+    if (key.length() < prefix_length ||
+        memcmp(key.data(), FLAGS_near_cache_key_prefix, prefix_length) != 0 ||
+        is_sharded_counter_key(key)) {
+        return nullptr;
     }
+    return s_near_cache.get();
 }
 
-void redis_parser::process_geo_radius_result(message_entry &entry,
-                                             const std::string &unit,
-                                             bool WITHCOORD,
-                                             bool WITHDIST,
-                                             bool WITHHASH,
-                                             int ec,
-                                             std::list<geo::SearchResult> &&results)
+/*static*/ void redis_parser::invalidate_near_cache(const ::dsn::blob &key)
 {
-    if (_is_session_reset.load(std::memory_order_acquire)) {
-        ddebug("%s: setex command seqid(%" PRId64 ") got reply, but session has reset",
-               _remote_address.to_string(),
-               entry.sequence_id);
-        return;
+    near_cache *cache = near_cache_of(key);
+    if (cache != nullptr) {
+        cache->invalidate(dsn::string_view(key.data(), key.length()));
     }
+}
 
-    if (PERR_OK != ec) {
-        simple_error_reply(entry, _geo_client->get_error_string(ec));
-    } else {
-        redis_array result;
-        result.resize(results.size());
-        size_t i = 0;
-        for (const auto &elem : results) {
-            std::shared_ptr<redis_base_type> key =
-                std::make_shared<redis_bulk_string>(elem.hash_key); // hash_key => member
-            if (!WITHCOORD && !WITHDIST && !WITHHASH) {
-                // only member
-                result.array[i++] = key;
+void redis_parser::get_sharded_counter(const ::dsn::blob &key, sharded_counter_callback &&callback)
+{
+    int shard_count = FLAGS_sharded_counter_shard_count;
+    auto context = std::make_shared<sharded_counter_context>(shard_count);
+    auto user_callback = std::make_shared<sharded_counter_callback>(std::move(callback));
+    for (int i = 0; i < shard_count; ++i) {
+        auto on_get_reply = [context, user_callback, i](
+            ::dsn::error_code ec, dsn::message_ex *, dsn::message_ex *response) {
+            if (::dsn::ERR_OK != ec) {
+                context->errors[i] = ec.to_string();
             } else {
-                // member and some WITH* parameters
-                std::shared_ptr<redis_array> sub_array = std::make_shared<redis_array>();
-
-                // member
-                sub_array->resize(1 + (WITHDIST ? 1 : 0) + (WITHCOORD ? 1 : 0) +
-                                  (WITHHASH ? 1 : 0));
-                size_t index = 0;
-                sub_array->array[index++] = key;
-
-                // NOTE: the order of WITH* parameters should not be changed for the redis
-                // protocol
-                if (WITHDIST) {
-                    // with distance
-                    double distance = elem.distance;
-                    if (unit == "km") {
-                        distance /= 1000;
-                    } else if (unit == "mi") {
-                        distance /= 1609.344;
-                    } else if (unit == "ft") {
-                        distance /= 0.3048;
-                    } else {
-                        // keep as meter unit
-                    }
-                    sub_array->array[index++] = construct_bulk_string(distance);
+                ::dsn::apps::read_response rrdb_response;
+                ::dsn::unmarshall(response, rrdb_response);
+                const ::dsn::blob &value = rrdb_response.value;
+                if (rrdb_response.error == rocksdb::Status::kNotFound) {
+                    // a missing shard is counted as 0
+                } else if (rrdb_response.error != 0) {
+                    context->errors[i] = "internal error " + std::to_string(rrdb_response.error);
+                } else if (!parse_sharded_counter_shard(
+                               dsn::string_view(value.data(), value.length()),
+                               context->values[i])) {
+                    context->errors[i] = "value is not an integer or out of range";
+                } else {
+                    context->found[i] = 1;
                 }
-                if (WITHCOORD) {
-                    // with coordinate
-                    std::shared_ptr<redis_array> coordinate = std::make_shared<redis_array>();
-                    coordinate->resize(2);
-                    coordinate->array[0] = construct_bulk_string(elem.lng_degrees);
-                    coordinate->array[1] = construct_bulk_string(elem.lat_degrees);
+            }
+            if (context->pending_count.fetch_sub(1) != 1) {
+                return;
+            }
 
-                    sub_array->array[index++] = coordinate;
+            bool found = false;
+            int64_t sum = 0;
+            for (size_t j = 0; j < context->errors.size(); ++j) {
+                if (!context->errors[j].empty()) {
+                    (*user_callback)(context->errors[j], false, 0);
+                    return;
                 }
-                if (WITHHASH) {
-                    // with origin value
-                    sub_array->array[index++] = std::make_shared<redis_bulk_string>(elem.value);
+                if (context->found[j] == 0) {
+                    continue;
                 }
-                result.array[i++] = sub_array;
+                int64_t v = context->values[j];
+                if ((v > 0 && sum > INT64_MAX - v) || (v < 0 && sum < INT64_MIN - v)) {
+                    (*user_callback)("increment or decrement would overflow", false, 0);
+                    return;
+                }
+                sum += v;
+                found = true;
             }
+            (*user_callback)(std::string(), found, sum);
+        };
+        ::dsn::blob req;
+        pegasus_generate_key(
+            req,
+            sharded_counter_hash_key(dsn::string_view(key.data(), key.length()), i),
+            std::string());
+        auto partition_hash = pegasus_key_hash(req);
+        // TODO: set the timeout
+        client->get(req, on_get_reply, std::chrono::milliseconds(2000), 0, partition_hash);
+    }
+}
+
+/*static*/ std::vector<std::vector<size_t>>
+redis_parser::group_keys(const redis_request &request, size_t step, size_t first)
+{
+    std::vector<std::vector<size_t>> groups;
+    std::unordered_map<std::string, size_t> group_of_key;
+    for (size_t i = first; i < request.sub_requests.size(); i += step) {
+        auto result = group_of_key.emplace(request.sub_requests[i].data.to_string(), groups.size());
+        if (result.second) {
+            groups.emplace_back();
         }
-        reply_message(entry, result);
+        groups[result.first->second].push_back(i);
     }
+    return groups;
 }
 
-// command format:
-// GEOADD key longitude latitude member [longitude latitude member ...]
-void redis_parser::geo_add(message_entry &entry)
+namespace {
+// the replies of the requests of a multi-key command, each request has its own slot
+struct multi_key_context
 {
-    if (!_geo_client) {
-        return simple_error_reply(entry, "redis proxy is not on GEO mode");
+    explicit multi_key_context(size_t request_count)
+        : errors(request_count), pending_count(request_count)
+    {
     }
 
-    redis_request &redis_request = entry.request;
-    if (redis_request.sub_requests.size() < 5 || (redis_request.sub_requests.size() - 2) % 3 != 0) {
-        simple_error_reply(entry, "wrong number of arguments for 'geoadd' command");
-        return;
+    // returns true if it's the last reply
+    bool reply_once() { return pending_count.fetch_sub(1) == 1; }
+
+    std::string first_error() const
+    {
+        for (const std::string &error : errors) {
+            if (!error.empty()) {
+                return error;
+            }
+        }
+        return std::string();
     }
 
-    int member_count = (redis_request.sub_requests.size() - 2) / 3;
-    std::shared_ptr<proxy_session> ref_this = shared_from_this();
-    std::shared_ptr<std::atomic<int32_t>> set_count =
-        std::make_shared<std::atomic<int32_t>>(member_count);
+    std::vector<std::string> errors;
+    std::atomic<size_t> pending_count;
+};
+} // anonymous namespace
+
+// origin command format:
+// MGET key [key ...]
+void redis_parser::mget(message_entry &entry)
+{
+    redis_request &redis_req = entry.request;
+    if (redis_req.sub_requests.size() < 2) {
+        ddebug("%s: mget command seqid(%" PRId64 ") with invalid arguments",
+               _remote_address.to_string(),
+               entry.sequence_id);
+        simple_error_reply(entry, "wrong number of arguments for 'mget' command");
+        return;
+    }
+
+    auto groups = std::make_shared<std::vector<std::vector<size_t>>>(group_keys(redis_req, 1));
+    auto context = std::make_shared<multi_key_context>(groups->size());
+    auto result = std::make_shared<redis_array>();
+    result->resize(redis_req.sub_requests.size() - 1);
+    std::shared_ptr<proxy_session> ref_this = shared_from_this();
+    // the values are placed at the positions of the keys in the command, and replied as a whole
+    // after all the keys are replied
+    auto on_key_replied = [ref_this, this, context, result, &entry]() {
+        if (!context->reply_once()) {
+            return;
+        }
+        if (_is_session_reset.load(std::memory_order_acquire)) {
+            ddebug("%s: mget command seqid(%" PRId64 ") got reply, but session has reset",
+                   _remote_address.to_string(),
+                   entry.sequence_id);
+            return;
+        }
+        std::string error = context->first_error();
+        if (!error.empty()) {
+            simple_error_reply(entry, error);
+        } else {
+            reply_message(entry, *result);
+        }
+    };
+
+    for (size_t g = 0; g < groups->size(); ++g) {
+        auto set_value = [groups, result, g](std::shared_ptr<redis_bulk_string> value) {
+            for (size_t index : (*groups)[g]) {
+                result->array[index - 1] = value;
+            }
+        };
+        const ::dsn::blob &key = redis_req.sub_requests[(*groups)[g][0]].data;
+        if (is_sharded_counter_key(key)) {
+            get_sharded_counter(key,
+                                [context, g, set_value, on_key_replied](
+                                    const std::string &error, bool found, int64_t sum) {
+                                    if (!error.empty()) {
+                                        context->errors[g] = error;
+                                    } else if (!found) {
+                                        set_value(std::make_shared<redis_bulk_string>());
+                                    } else {
+                                        set_value(std::make_shared<redis_bulk_string>(
+                                            std::to_string(sum)));
+                                    }
+                                    on_key_replied();
+                                });
+            continue;
+        }
+
+        auto on_get_reply = [context, g, set_value, on_key_replied](
+            ::dsn::error_code ec, dsn::message_ex *, dsn::message_ex *response) {
+            if (::dsn::ERR_OK != ec) {
+                context->errors[g] = ec.to_string();
+            } else {
+                ::dsn::apps::read_response rrdb_response;
+                ::dsn::unmarshall(response, rrdb_response);
+                if (rrdb_response.error == rocksdb::Status::kNotFound) {
+                    set_value(std::make_shared<redis_bulk_string>());
+                } else if (rrdb_response.error != 0) {
+                    context->errors[g] = "internal error " + std::to_string(rrdb_response.error);
+                } else {
+                    set_value(std::make_shared<redis_bulk_string>(rrdb_response.value));
+                }
+            }
+            on_key_replied();
+        };
+        ::dsn::blob req;
+        pegasus_generate_key(req, key, ::dsn::blob());
+        auto partition_hash = pegasus_key_hash(req);
+        // TODO: set the timeout
+        client->get(req, on_get_reply, std::chrono::milliseconds(2000), 0, partition_hash);
+    }
+}
+
+// origin command format:
+// MSET key value [key value ...]
+// NOTE: the keys are set concurrently, thus MSET is not atomic
+void redis_parser::mset(message_entry &entry)
+{
+    redis_request &redis_req = entry.request;
+    if (redis_req.sub_requests.size() < 3 || redis_req.sub_requests.size() % 2 == 0) {
+        ddebug("%s: mset command seqid(%" PRId64 ") with invalid arguments",
+               _remote_address.to_string(),
+               entry.sequence_id);
+        simple_error_reply(entry, "wrong number of arguments for 'mset' command");
+        return;
+    }
+    if (_geo_client != nullptr) {
+        simple_error_reply(entry, "'mset' command is not supported on GEO mode");
+        return;
+    }
+
+    auto groups = group_keys(redis_req, 2);
+    auto context = std::make_shared<multi_key_context>(groups.size());
+    std::shared_ptr<proxy_session> ref_this = shared_from_this();
+    for (size_t g = 0; g < groups.size(); ++g) {
+        ::dsn::blob key = redis_req.sub_requests[groups[g][0]].data;
+        invalidate_near_cache(key);
+        auto on_set_reply = [ref_this, this, context, g, key, &entry](
+            ::dsn::error_code ec, dsn::message_ex *, dsn::message_ex *response) {
+            invalidate_near_cache(key);
+            if (::dsn::ERR_OK != ec) {
+                context->errors[g] = ec.to_string();
+            } else {
+                ::dsn::apps::update_response rrdb_response;
+                ::dsn::unmarshall(response, rrdb_response);
+                if (rrdb_response.error != 0) {
+                    context->errors[g] = "internal error " + std::to_string(rrdb_response.error);
+                }
+            }
+            if (!context->reply_once()) {
+                return;
+            }
+
+            if (_is_session_reset.load(std::memory_order_acquire)) {
+                ddebug("%s: mset command seqid(%" PRId64 ") got reply, but session has reset",
+                       _remote_address.to_string(),
+                       entry.sequence_id);
+                return;
+            }
+            std::string error = context->first_error();
+            if (!error.empty()) {
+                simple_error_reply(entry, error);
+            } else {
+                simple_ok_reply(entry);
+            }
+        };
+
+        // the last value wins if a key is set more than once
+        ::dsn::apps::update_request req;
+        pegasus_generate_key(req.key, key, ::dsn::blob());
+        req.value = redis_req.sub_requests[groups[g].back() + 1].data;
+        req.expire_ts_seconds = 0;
+        auto partition_hash = pegasus_key_hash(req.key);
+        // TODO: set the timeout
+        client->put(req, on_set_reply, std::chrono::milliseconds(2000), 0, partition_hash);
+    }
+}
+
+// origin command format:
+// EXISTS key [key ...]
+// NOTE: the same as redis, a key is counted as many times as it's mentioned, and a key with a
+// value of any type is counted
+void redis_parser::exists(message_entry &entry)
+{
+    redis_request &redis_req = entry.request;
+    if (redis_req.sub_requests.size() < 2) {
+        ddebug("%s: exists command seqid(%" PRId64 ") with invalid arguments",
+               _remote_address.to_string(),
+               entry.sequence_id);
+        simple_error_reply(entry, "wrong number of arguments for 'exists' command");
+        return;
+    }
+
+    auto groups = group_keys(redis_req, 1);
+    auto context = std::make_shared<multi_key_context>(groups.size());
+    auto exist_count = std::make_shared<std::atomic<int64_t>>(0);
+    std::shared_ptr<proxy_session> ref_this = shared_from_this();
+    auto on_key_replied = [ref_this, this, context, exist_count, &entry]() {
+        if (!context->reply_once()) {
+            return;
+        }
+        if (_is_session_reset.load(std::memory_order_acquire)) {
+            ddebug("%s: exists command seqid(%" PRId64 ") got reply, but session has reset",
+                   _remote_address.to_string(),
+                   entry.sequence_id);
+            return;
+        }
+        std::string error = context->first_error();
+        if (!error.empty()) {
+            simple_error_reply(entry, error);
+        } else {
+            simple_integer_reply(entry, exist_count->load());
+        }
+    };
+
+    for (size_t g = 0; g < groups.size(); ++g) {
+        int64_t mentioned_count = groups[g].size();
+        const ::dsn::blob &key = redis_req.sub_requests[groups[g][0]].data;
+        if (is_sharded_counter_key(key)) {
+            get_sharded_counter(key,
+                                [context, exist_count, g, mentioned_count, on_key_replied](
+                                    const std::string &error, bool found, int64_t) {
+                                    if (!error.empty()) {
+                                        context->errors[g] = error;
+                                    } else if (found) {
+                                        exist_count->fetch_add(mentioned_count);
+                                    }
+                                    on_key_replied();
+                                });
+            continue;
+        }
+        check_key_exists(
+            key,
+            [context, exist_count, g, mentioned_count, on_key_replied](const std::string &error,
+                                                                       bool existed) {
+                if (!error.empty()) {
+                    context->errors[g] = error;
+                } else if (existed) {
+                    exist_count->fetch_add(mentioned_count);
+                }
+                on_key_replied();
+            });
+    }
+}
+
+// origin command format:
+// UNLINK key [key ...]
+// NOTE: the same as DEL
+void redis_parser::unlink(message_entry &entry) { del(entry); }
+
+void redis_parser::del_keys(message_entry &entry)
+{
+    redis_request &redis_req = entry.request;
+    auto groups = group_keys(redis_req, 1);
+
+    auto context = std::make_shared<multi_key_context>(groups.size());
+    auto removed_count = std::make_shared<std::atomic<int64_t>>(0);
+    std::shared_ptr<proxy_session> ref_this = shared_from_this();
+    auto on_key_replied = [ref_this, this, context, removed_count, &entry]() {
+        if (!context->reply_once()) {
+            return;
+        }
+        if (_is_session_reset.load(std::memory_order_acquire)) {
+            ddebug("%s: del command seqid(%" PRId64 ") got reply, but session has reset",
+                   _remote_address.to_string(),
+                   entry.sequence_id);
+            return;
+        }
+        std::string error = context->first_error();
+        if (!error.empty()) {
+            simple_error_reply(entry, error);
+        } else {
+            simple_integer_reply(entry, removed_count->load());
+        }
+    };
+
+    for (size_t g = 0; g < groups.size(); ++g) {
+        const ::dsn::blob &key = redis_req.sub_requests[groups[g][0]].data;
+        invalidate_near_cache(key);
+        auto on_key_removed = [this, context, removed_count, g, key, on_key_replied](
+            const std::string &error, bool existed) {
+            invalidate_near_cache(key);
+            if (!error.empty()) {
+                context->errors[g] = error;
+            } else if (existed) {
+                removed_count->fetch_add(1);
+            }
+            on_key_replied();
+        };
+        if (is_sharded_counter_key(key)) {
+            remove_sharded_counter(key, std::move(on_key_removed));
+        } else {
+            remove_key(key, std::move(on_key_removed));
+        }
+    }
+}
+
+void redis_parser::remove_sharded_counter(const ::dsn::blob &key, key_callback &&callback)
+{
+    int shard_count = FLAGS_sharded_counter_shard_count;
+    auto context = std::make_shared<multi_key_context>(shard_count);
+    auto user_callback = std::make_shared<key_callback>(std::move(callback));
+    for (int i = 0; i < shard_count; ++i) {
+        auto on_del_reply = [context, i, user_callback](
+            ::dsn::error_code ec, dsn::message_ex *, dsn::message_ex *response) {
+            if (::dsn::ERR_OK != ec) {
+                context->errors[i] = ec.to_string();
+            } else {
+                ::dsn::apps::update_response rrdb_response;
+                ::dsn::unmarshall(response, rrdb_response);
+                if (rrdb_response.error != 0) {
+                    context->errors[i] = "internal error " + std::to_string(rrdb_response.error);
+                }
+            }
+            if (context->reply_once()) {
+                // NOTE: the shards are removed without checking the existence, so the counter
+                // is counted as removed
+                (*user_callback)(context->first_error(), true);
+            }
+        };
+        ::dsn::blob req;
+        pegasus_generate_key(
+            req,
+            sharded_counter_hash_key(dsn::string_view(key.data(), key.length()), i),
+            std::string());
+        auto partition_hash = pegasus_key_hash(req);
+        // TODO: set the timeout
+        client->remove(req, on_del_reply, std::chrono::milliseconds(2000), 0, partition_hash);
+    }
+}
+
+void redis_parser::get_range(::dsn::apps::multi_get_request &&req,
+                             int64_t limit,
+                             range_callback &&callback)
+{
+    get_range_page(std::make_shared<::dsn::apps::multi_get_request>(std::move(req)),
+                   limit,
+                   std::make_shared<std::vector<::dsn::apps::key_value>>(),
+                   std::make_shared<range_callback>(std::move(callback)));
+}
+
+// each page is limited by the server, and the next page starts after the last kv of the
+// previous one in the direction of the iteration
+void redis_parser::get_range_page(std::shared_ptr<::dsn::apps::multi_get_request> req,
+                                  int64_t limit,
+                                  std::shared_ptr<std::vector<::dsn::apps::key_value>> result,
+                                  std::shared_ptr<range_callback> callback)
+{
+    if (limit > 0) {
+        req->max_kv_count = static_cast<int32_t>(
+            std::min(limit - static_cast<int64_t>(result->size()), int64_t(INT32_MAX)));
+    }
+
+    std::shared_ptr<proxy_session> ref_this = shared_from_this();
+    auto on_multi_get_reply = [ref_this, this, req, limit, result, callback](
+        ::dsn::error_code ec, dsn::message_ex *, dsn::message_ex *response) {
+        if (::dsn::ERR_OK != ec) {
+            (*callback)(ec.to_string(), {}, true);
+            return;
+        }
+        ::dsn::apps::multi_get_response rrdb_response;
+        ::dsn::unmarshall(response, rrdb_response);
+        if (rrdb_response.error != 0 && rrdb_response.error != rocksdb::Status::kIncomplete) {
+            (*callback)("internal error " + std::to_string(rrdb_response.error), {}, true);
+            return;
+        }
+
+        bool complete = rrdb_response.error != rocksdb::Status::kIncomplete;
+        std::vector<::dsn::apps::key_value> &kvs = rrdb_response.kvs;
+        if (!complete && kvs.empty()) {
+            // the iteration limit of the server is exhausted by the expired or filtered kvs, no
+            // progress can be made
+            (*callback)("too many expired or filtered entries in the range", {}, true);
+            return;
+        }
+        // the kvs of a page are always in ascending order
+        if (req->reverse) {
+            std::reverse(kvs.begin(), kvs.end());
+        }
+        if (!kvs.empty()) {
+            if (req->reverse) {
+                req->stop_sortkey = kvs.back().key;
+                req->stop_inclusive = false;
+            } else {
+                req->start_sortkey = kvs.back().key;
+                req->start_inclusive = false;
+            }
+        }
+        std::move(kvs.begin(), kvs.end(), std::back_inserter(*result));
+
+        if (complete || (limit > 0 && static_cast<int64_t>(result->size()) >= limit) ||
+            _is_session_reset.load(std::memory_order_acquire)) {
+            (*callback)(std::string(), std::move(*result), complete);
+        } else {
+            get_range_page(req, limit, result, callback);
+        }
+    };
+    ::dsn::blob tmp_key;
+    pegasus_generate_key(tmp_key, req->hash_key, ::dsn::blob());
+    auto partition_hash = pegasus_key_hash(tmp_key);
+    // TODO: set the timeout
+    client->multi_get(*req, on_multi_get_reply, std::chrono::milliseconds(2000), 0, partition_hash);
+}
+
+namespace {
+// the key of a hash is used as the hash key, which should not be empty, and its length should be
+// less than UINT16_MAX
+inline bool is_valid_hash_key(const ::dsn::blob &key)
+{
+    return key.length() > 0 && key.length() < UINT16_MAX;
+}
+
+// the max number of the sort keys removed by a multi_remove request of DEL
+const size_t kMaxRemoveCountPerRequest = 1000;
+
+// the sort key written along with the fields of a hash or the members of a sorted set, so a key
+// without it has at most a string value. It's the least non-empty sort key
+const std::string kTypeMarkerSortKey("\0", 1);
+
+// the empty field and the type marker are reserved
+inline bool is_valid_field(const ::dsn::blob &field)
+{
+    return field.length() > 0 && dsn::string_view(field) != kTypeMarkerSortKey;
+}
+
+// a ranged multi_get request on all the sort keys of `hash_key` except the empty one, which
+// holds the string value of the key, and the type marker
+::dsn::apps::multi_get_request make_range_request(const ::dsn::blob &hash_key)
+{
+    ::dsn::apps::multi_get_request req;
+    req.hash_key = hash_key;
+    req.max_kv_count = 0;
+    req.max_kv_size = 0;
+    req.no_value = false;
+    req.start_sortkey = ::dsn::blob::create_from_bytes(std::string(kTypeMarkerSortKey));
+    req.start_inclusive = false;
+    req.stop_inclusive = false;
+    req.sort_key_filter_type = ::dsn::apps::filter_type::FT_NO_FILTER;
+    req.reverse = false;
+    return req;
+}
+} // anonymous namespace
+
+void redis_parser::check_key_exists(const ::dsn::blob &key, key_callback &&callback)
+{
+    auto user_callback = std::make_shared<key_callback>(std::move(callback));
+    if (!is_valid_hash_key(key)) {
+        // such a key can only have a string value, ttl is used instead of get to check the
+        // existence, so the value is not transferred
+        auto on_ttl_reply = [user_callback](
+            ::dsn::error_code ec, dsn::message_ex *, dsn::message_ex *response) {
+            if (::dsn::ERR_OK != ec) {
+                (*user_callback)(ec.to_string(), false);
+                return;
+            }
+            ::dsn::apps::ttl_response rrdb_response;
+            ::dsn::unmarshall(response, rrdb_response);
+            if (rrdb_response.error != 0 && rrdb_response.error != rocksdb::Status::kNotFound) {
+                (*user_callback)("internal error " + std::to_string(rrdb_response.error), false);
+            } else {
+                (*user_callback)(std::string(), rrdb_response.error == 0);
+            }
+        };
+        ::dsn::blob req;
+        pegasus_generate_key(req, key, ::dsn::blob());
+        auto partition_hash = pegasus_key_hash(req);
+        // TODO: set the timeout
+        client->ttl(req, on_ttl_reply, std::chrono::milliseconds(2000), 0, partition_hash);
+        return;
+    }
+
+    // the first two sort keys, including the empty one holding the string value, tell the
+    // existence, the type marker alone is left by a hash or a sorted set emptied by HDEL or ZREM
+    ::dsn::apps::multi_get_request req = make_range_request(key);
+    req.start_sortkey = ::dsn::blob();
+    req.start_inclusive = true;
+    req.no_value = true;
+    get_range(std::move(req),
+              2,
+              [user_callback](const std::string &error,
+                              std::vector<::dsn::apps::key_value> &&kvs,
+                              bool) {
+                  bool existed = !kvs.empty() &&
+                                 (dsn::string_view(kvs[0].key) != kTypeMarkerSortKey ||
+                                  kvs.size() > 1);
+                  (*user_callback)(error, error.empty() && existed);
+              });
+}
+
+void redis_parser::remove_key(const ::dsn::blob &key, key_callback &&callback)
+{
+    auto user_callback = std::make_shared<key_callback>(std::move(callback));
+    ::dsn::blob tmp_key;
+    pegasus_generate_key(tmp_key, key, ::dsn::blob());
+    auto partition_hash = pegasus_key_hash(tmp_key);
+    if (!is_valid_hash_key(key)) {
+        // such a key can only have a string value
+        auto on_del_reply = [user_callback](
+            ::dsn::error_code ec, dsn::message_ex *, dsn::message_ex *response) {
+            if (::dsn::ERR_OK != ec) {
+                (*user_callback)(ec.to_string(), false);
+                return;
+            }
+            ::dsn::apps::update_response rrdb_response;
+            ::dsn::unmarshall(response, rrdb_response);
+            if (rrdb_response.error != 0) {
+                (*user_callback)("internal error " + std::to_string(rrdb_response.error), false);
+            } else {
+                // NOTE: the value is removed without checking the existence, so it's counted as
+                // removed
+                (*user_callback)(std::string(), true);
+            }
+        };
+        // TODO: set the timeout
+        client->remove(tmp_key, on_del_reply, std::chrono::milliseconds(2000), 0, partition_hash);
+        return;
+    }
+
+    // the string value is removed only if the type marker doesn't exist, otherwise nothing is
+    // mutated, and the key is a hash or a sorted set whose sort keys are all removed
+    ::dsn::apps::check_and_mutate_request req;
+    req.hash_key = key;
+    req.check_sort_key = ::dsn::blob::create_from_bytes(std::string(kTypeMarkerSortKey));
+    req.check_type = ::dsn::apps::cas_check_type::CT_VALUE_NOT_EXIST;
+    req.return_check_value = false;
+    ::dsn::apps::mutate mu;
+    mu.operation = ::dsn::apps::mutate_operation::MO_DELETE;
+    mu.set_expire_ts_seconds = 0;
+    req.mutate_list.emplace_back(std::move(mu));
+    std::shared_ptr<proxy_session> ref_this = shared_from_this();
+    auto on_check_and_mutate_reply = [ref_this, this, key, user_callback](
+        ::dsn::error_code ec, dsn::message_ex *, dsn::message_ex *response) {
+        if (::dsn::ERR_OK != ec) {
+            (*user_callback)(ec.to_string(), false);
+            return;
+        }
+        ::dsn::apps::check_and_mutate_response rrdb_response;
+        ::dsn::unmarshall(response, rrdb_response);
+        if (rrdb_response.error == rocksdb::Status::kTryAgain) {
+            remove_sort_keys(key, key_callback(*user_callback));
+        } else if (rrdb_response.error != 0) {
+            (*user_callback)("internal error " + std::to_string(rrdb_response.error), false);
+        } else {
+            // NOTE: the value is removed without checking the existence, so it's counted as
+            // removed
+            (*user_callback)(std::string(), true);
+        }
+    };
+    // TODO: set the timeout
+    client->check_and_mutate(
+        req, on_check_and_mutate_reply, std::chrono::milliseconds(2000), 0, partition_hash);
+}
+
+void redis_parser::remove_sort_keys(const ::dsn::blob &key, key_callback &&callback)
+{
+    auto user_callback = std::make_shared<key_callback>(std::move(callback));
+    ::dsn::blob tmp_key;
+    pegasus_generate_key(tmp_key, key, ::dsn::blob());
+    auto partition_hash = pegasus_key_hash(tmp_key);
+
+    // all the sort keys are read and removed in batches, the sort keys added in the meantime
+    // are not removed
+    ::dsn::apps::multi_get_request req = make_range_request(key);
+    req.start_sortkey = ::dsn::blob();
+    req.start_inclusive = true;
+    req.no_value = true;
+    std::shared_ptr<proxy_session> ref_this = shared_from_this();
+    auto on_range_reply = [ref_this, this, key, partition_hash, user_callback](
+        const std::string &error, std::vector<::dsn::apps::key_value> &&kvs, bool) {
+        if (!error.empty() || kvs.empty()) {
+            (*user_callback)(error, false);
+            return;
+        }
+        size_t request_count = (kvs.size() + kMaxRemoveCountPerRequest - 1) /
+                               kMaxRemoveCountPerRequest;
+        auto context = std::make_shared<multi_key_context>(request_count);
+        for (size_t r = 0; r < request_count; ++r) {
+            ::dsn::apps::multi_remove_request remove_req;
+            remove_req.hash_key = key;
+            remove_req.max_count = 0;
+            size_t end = std::min(kvs.size(), (r + 1) * kMaxRemoveCountPerRequest);
+            for (size_t i = r * kMaxRemoveCountPerRequest; i < end; ++i) {
+                remove_req.sort_keys.emplace_back(std::move(kvs[i].key));
+            }
+            auto on_multi_remove_reply = [context, r, user_callback](
+                ::dsn::error_code ec, dsn::message_ex *, dsn::message_ex *response) {
+                if (::dsn::ERR_OK != ec) {
+                    context->errors[r] = ec.to_string();
+                } else {
+                    ::dsn::apps::multi_remove_response rrdb_response;
+                    ::dsn::unmarshall(response, rrdb_response);
+                    if (rrdb_response.error != 0) {
+                        context->errors[r] =
+                            "internal error " + std::to_string(rrdb_response.error);
+                    }
+                }
+                if (context->reply_once()) {
+                    (*user_callback)(context->first_error(), true);
+                }
+            };
+            // TODO: set the timeout
+            client->multi_remove(remove_req,
+                                 on_multi_remove_reply,
+                                 std::chrono::milliseconds(2000),
+                                 0,
+                                 partition_hash);
+        }
+    };
+    get_range(std::move(req), 0, on_range_reply);
+}
+
+// origin command format:
+// HSET key field value [field value ...]
+// NOTE: the number of the distinct fields is replied, whether the fields exist or not, because
+// it's unknown whether a field is newly added without reading it
+void redis_parser::hset(message_entry &entry) { hset_internal(entry, true); }
+
+// origin command format:
+// HMSET key field value [field value ...]
+void redis_parser::hmset(message_entry &entry) { hset_internal(entry, false); }
+
+void redis_parser::hset_internal(message_entry &entry, bool reply_count)
+{
+    redis_request &redis_req = entry.request;
+    if (redis_req.sub_requests.size() < 4 || redis_req.sub_requests.size() % 2 != 0) {
+        ddebug("%s: hset command seqid(%" PRId64 ") with invalid arguments",
+               _remote_address.to_string(),
+               entry.sequence_id);
+        simple_error_reply(entry, "wrong number of arguments for 'hset' command");
+        return;
+    }
+    const ::dsn::blob &key = redis_req.sub_requests[1].data;
+    if (!is_valid_hash_key(key)) {
+        simple_error_reply(entry, "invalid key for hash");
+        return;
+    }
+
+    // all the fields are set in a single multi_put along with the type marker, if a field is
+    // set more than once, the last value wins
+    auto groups = group_keys(redis_req, 2, 2);
+    ::dsn::apps::multi_put_request req;
+    req.hash_key = key;
+    req.expire_ts_seconds = 0;
+    req.kvs.reserve(groups.size() + 1);
+    req.kvs.emplace_back();
+    req.kvs.back().key = ::dsn::blob::create_from_bytes(std::string(kTypeMarkerSortKey));
+    for (const std::vector<size_t> &indexes : groups) {
+        const ::dsn::blob &field = redis_req.sub_requests[indexes[0]].data;
+        if (!is_valid_field(field)) {
+            simple_error_reply(entry, "empty or reserved field is not supported");
+            return;
+        }
+        ::dsn::apps::key_value kv;
+        kv.key = field;
+        kv.value = redis_req.sub_requests[indexes.back() + 1].data;
+        req.kvs.emplace_back(std::move(kv));
+    }
+
+    int64_t field_count = groups.size();
+    std::shared_ptr<proxy_session> ref_this = shared_from_this();
+    auto on_multi_put_reply = [ref_this, this, reply_count, field_count, &entry](
+        ::dsn::error_code ec, dsn::message_ex *, dsn::message_ex *response) {
+        if (_is_session_reset.load(std::memory_order_acquire)) {
+            ddebug("%s: hset command seqid(%" PRId64 ") got reply, but session has reset",
+                   _remote_address.to_string(),
+                   entry.sequence_id);
+            return;
+        }
+
+        if (::dsn::ERR_OK != ec) {
+            ddebug("%s: hset command seqid(%" PRId64 ") got reply with error = %s",
+                   _remote_address.to_string(),
+                   entry.sequence_id,
+                   ec.to_string());
+            simple_error_reply(entry, ec.to_string());
+            return;
+        }
+        ::dsn::apps::update_response rrdb_response;
+        ::dsn::unmarshall(response, rrdb_response);
+        if (rrdb_response.error != 0) {
+            simple_error_reply(entry, "internal error " + std::to_string(rrdb_response.error));
+        } else if (reply_count) {
+            simple_integer_reply(entry, field_count);
+        } else {
+            simple_ok_reply(entry);
+        }
+    };
+    ::dsn::blob tmp_key;
+    pegasus_generate_key(tmp_key, key, ::dsn::blob());
+    auto partition_hash = pegasus_key_hash(tmp_key);
+    // TODO: set the timeout
+    client->multi_put(req, on_multi_put_reply, std::chrono::milliseconds(2000), 0, partition_hash);
+}
+
+// origin command format:
+// HGET key field
+void redis_parser::hget(message_entry &entry)
+{
+    redis_request &redis_req = entry.request;
+    if (redis_req.sub_requests.size() != 3) {
+        ddebug("%s: hget command seqid(%" PRId64 ") with invalid arguments",
+               _remote_address.to_string(),
+               entry.sequence_id);
+        simple_error_reply(entry, "wrong number of arguments for 'hget' command");
+        return;
+    }
+    const ::dsn::blob &key = redis_req.sub_requests[1].data;
+    const ::dsn::blob &field = redis_req.sub_requests[2].data;
+    if (!is_valid_hash_key(key)) {
+        simple_error_reply(entry, "invalid key for hash");
+        return;
+    }
+    if (!is_valid_field(field)) {
+        simple_error_reply(entry, "empty or reserved field is not supported");
+        return;
+    }
+
+    std::shared_ptr<proxy_session> ref_this = shared_from_this();
+    auto on_get_reply = [ref_this, this, &entry](
+        ::dsn::error_code ec, dsn::message_ex *, dsn::message_ex *response) {
+        if (_is_session_reset.load(std::memory_order_acquire)) {
+            ddebug("%s: hget command seqid(%" PRId64 ") got reply, but session has reset",
+                   _remote_address.to_string(),
+                   entry.sequence_id);
+            return;
+        }
+
+        if (::dsn::ERR_OK != ec) {
+            ddebug("%s: hget command seqid(%" PRId64 ") got reply with error = %s",
+                   _remote_address.to_string(),
+                   entry.sequence_id,
+                   ec.to_string());
+            simple_error_reply(entry, ec.to_string());
+            return;
+        }
+        ::dsn::apps::read_response rrdb_response;
+        ::dsn::unmarshall(response, rrdb_response);
+        if (rrdb_response.error == rocksdb::Status::kNotFound) {
+            reply_message(entry, redis_bulk_string());
+        } else if (rrdb_response.error != 0) {
+            simple_error_reply(entry, "internal error " + std::to_string(rrdb_response.error));
+        } else {
+            reply_message(entry, redis_bulk_string(rrdb_response.value));
+        }
+    };
+    ::dsn::blob req;
+    pegasus_generate_key(req, key, field);
+    auto partition_hash = pegasus_key_hash(req);
+    // TODO: set the timeout
+    client->get(req, on_get_reply, std::chrono::milliseconds(2000), 0, partition_hash);
+}
+
+// origin command format:
+// HMGET key field [field ...]
+void redis_parser::hmget(message_entry &entry)
+{
+    redis_request &redis_req = entry.request;
+    if (redis_req.sub_requests.size() < 3) {
+        ddebug("%s: hmget command seqid(%" PRId64 ") with invalid arguments",
+               _remote_address.to_string(),
+               entry.sequence_id);
+        simple_error_reply(entry, "wrong number of arguments for 'hmget' command");
+        return;
+    }
+    const ::dsn::blob &key = redis_req.sub_requests[1].data;
+    if (!is_valid_hash_key(key)) {
+        simple_error_reply(entry, "invalid key for hash");
+        return;
+    }
+
+    // all the distinct fields are read in a single multi_get
+    auto groups = std::make_shared<std::vector<std::vector<size_t>>>(group_keys(redis_req, 1, 2));
+    ::dsn::apps::multi_get_request req;
+    req.hash_key = key;
+    req.sort_keys.reserve(groups->size());
+    for (const std::vector<size_t> &indexes : *groups) {
+        const ::dsn::blob &field = redis_req.sub_requests[indexes[0]].data;
+        if (!is_valid_field(field)) {
+            simple_error_reply(entry, "empty or reserved field is not supported");
+            return;
+        }
+        req.sort_keys.emplace_back(field);
+    }
+    req.max_kv_count = 0;
+    req.max_kv_size = 0;
+    req.no_value = false;
+
+    std::shared_ptr<proxy_session> ref_this = shared_from_this();
+    auto on_multi_get_reply = [ref_this, this, groups, &entry](
+        ::dsn::error_code ec, dsn::message_ex *, dsn::message_ex *response) {
+        if (_is_session_reset.load(std::memory_order_acquire)) {
+            ddebug("%s: hmget command seqid(%" PRId64 ") got reply, but session has reset",
+                   _remote_address.to_string(),
+                   entry.sequence_id);
+            return;
+        }
+
+        if (::dsn::ERR_OK != ec) {
+            ddebug("%s: hmget command seqid(%" PRId64 ") got reply with error = %s",
+                   _remote_address.to_string(),
+                   entry.sequence_id,
+                   ec.to_string());
+            simple_error_reply(entry, ec.to_string());
+            return;
+        }
+        ::dsn::apps::multi_get_response rrdb_response;
+        ::dsn::unmarshall(response, rrdb_response);
+        if (rrdb_response.error != 0) {
+            simple_error_reply(entry, "internal error " + std::to_string(rrdb_response.error));
+            return;
+        }
+
+        // the values are placed at the positions of the fields in the command, and the missing
+        // fields are replied as nil
+        std::unordered_map<std::string, ::dsn::blob> values;
+        for (::dsn::apps::key_value &kv : rrdb_response.kvs) {
+            values.emplace(kv.key.to_string(), std::move(kv.value));
+        }
+        redis_array result;
+        result.resize(entry.request.sub_requests.size() - 2);
+        for (const std::vector<size_t> &indexes : *groups) {
+            auto iter = values.find(entry.request.sub_requests[indexes[0]].data.to_string());
+            auto value = iter == values.end() ? std::make_shared<redis_bulk_string>()
+                                              : std::make_shared<redis_bulk_string>(iter->second);
+            for (size_t index : indexes) {
+                result.array[index - 2] = value;
+            }
+        }
+        reply_message(entry, result);
+    };
+    ::dsn::blob tmp_key;
+    pegasus_generate_key(tmp_key, key, ::dsn::blob());
+    auto partition_hash = pegasus_key_hash(tmp_key);
+    // TODO: set the timeout
+    client->multi_get(req, on_multi_get_reply, std::chrono::milliseconds(2000), 0, partition_hash);
+}
+
+namespace {
+struct read_batch_counters
+{
+    read_batch_counters()
+    {
+        batch_size.init_app_counter("app.pegasus",
+                                    "proxy.read_batch_size",
+                                    COUNTER_TYPE_NUMBER_PERCENTILES,
+                                    "statistic the commands served by a batched read of proxy");
+        batched_command_qps.init_app_counter("app.pegasus",
+                                             "proxy.batched_command_qps",
+                                             COUNTER_TYPE_RATE,
+                                             "statistic the qps of the commands served by the "
+                                             "batched reads of proxy");
+    }
+
+    ::dsn::perf_counter_wrapper batch_size;
+    ::dsn::perf_counter_wrapper batched_command_qps;
+};
+
+read_batch_counters &get_read_batch_counters()
+{
+    static read_batch_counters counters;
+    return counters;
+}
+} // anonymous namespace
+
+/*static*/ bool redis_parser::get_read_batch_key(redis_call_handler handler,
+                                                 const redis_request &request,
+                                                 std::string &batch_key)
+{
+    // the invalid commands are left to the handlers to reply the errors
+    if (handler == redis_parser::g_get && request.sub_requests.size() == 2) {
+        const ::dsn::blob &key = request.sub_requests[1].data;
+        if (is_sharded_counter_key(key) || near_cache_of(key) != nullptr) {
+            return false;
+        }
+        batch_key.reserve(1 + key.length());
+        batch_key.assign("g").append(key.data(), key.length());
+        return true;
+    }
+    if (handler == redis_parser::g_hget && request.sub_requests.size() == 3) {
+        const ::dsn::blob &key = request.sub_requests[1].data;
+        if (!is_valid_hash_key(key) || !is_valid_field(request.sub_requests[2].data)) {
+            return false;
+        }
+        batch_key.reserve(1 + key.length());
+        batch_key.assign("h").append(key.data(), key.length());
+        return true;
+    }
+    return false;
+}
+
+void redis_parser::flush_read_batches()
+{
+    if (_read_batches.empty()) {
+        return;
+    }
+    std::vector<read_batch> batches;
+    batches.swap(_read_batches);
+    _read_batch_index.clear();
+    for (read_batch &batch : batches) {
+        if (batch.entries.size() == 1) {
+            if (batch.is_hget) {
+                hget(*batch.entries[0]);
+            } else {
+                get(*batch.entries[0]);
+            }
+            continue;
+        }
+        read_batch_counters &counters = get_read_batch_counters();
+        counters.batch_size->set(batch.entries.size());
+        counters.batched_command_qps->add(batch.entries.size());
+        auto entries = std::make_shared<std::vector<message_entry *>>(std::move(batch.entries));
+        if (batch.is_hget) {
+            hget_batch(std::move(entries));
+        } else {
+            get_batch(std::move(entries));
+        }
+    }
+}
+
+// GET key
+// ...
+// GET key
+void redis_parser::get_batch(std::shared_ptr<std::vector<message_entry *>> entries)
+{
+    const ::dsn::blob &key = entries->front()->request.sub_requests[1].data;
+    dinfo("%s: send %d get commands from seqid(%" PRId64 ") in a batch",
+          _remote_address.to_string(),
+          static_cast<int>(entries->size()),
+          entries->front()->sequence_id);
+    std::shared_ptr<proxy_session> ref_this = shared_from_this();
+    auto on_get_reply = [ref_this, this, entries](
+        ::dsn::error_code ec, dsn::message_ex *, dsn::message_ex *response) {
+        if (_is_session_reset.load(std::memory_order_acquire)) {
+            ddebug("%s: get command(%" PRId64 ") got reply, but session has reset",
+                   _remote_address.to_string(),
+                   entries->front()->sequence_id);
+            return;
+        }
+
+        if (::dsn::ERR_OK != ec) {
+            ddebug("%s: get command seqid(%" PRId64 ") got reply with error = %s",
+                   _remote_address.to_string(),
+                   entries->front()->sequence_id,
+                   ec.to_string());
+            for (message_entry *entry : *entries) {
+                simple_error_reply(*entry, ec.to_string());
+            }
+            return;
+        }
+        ::dsn::apps::read_response rrdb_response;
+        ::dsn::unmarshall(response, rrdb_response);
+        for (message_entry *entry : *entries) {
+            if (rrdb_response.error == rocksdb::Status::kNotFound) {
+                reply_message(*entry, redis_bulk_string());
+            } else if (rrdb_response.error != 0) {
+                simple_error_reply(*entry,
+                                   "internal error " + std::to_string(rrdb_response.error));
+            } else {
+                reply_message(*entry, redis_bulk_string(rrdb_response.value));
+            }
+        }
+    };
+    ::dsn::blob req;
+    pegasus_generate_key(req, key, ::dsn::blob());
+    auto partition_hash = pegasus_key_hash(req);
+    // TODO: set the timeout
+    client->get(req, on_get_reply, std::chrono::milliseconds(2000), 0, partition_hash);
+}
+
+// HGET key field1
+// ...
+// HGET key fieldN
+void redis_parser::hget_batch(std::shared_ptr<std::vector<message_entry *>> entries)
+{
+    const ::dsn::blob &key = entries->front()->request.sub_requests[1].data;
+    dinfo("%s: send %d hget commands from seqid(%" PRId64 ") in a batch",
+          _remote_address.to_string(),
+          static_cast<int>(entries->size()),
+          entries->front()->sequence_id);
+
+    // all the distinct fields are read in a single multi_get
+    ::dsn::apps::multi_get_request req;
+    req.hash_key = key;
+    std::unordered_set<std::string> fields;
+    for (message_entry *entry : *entries) {
+        const ::dsn::blob &field = entry->request.sub_requests[2].data;
+        if (fields.insert(field.to_string()).second) {
+            req.sort_keys.emplace_back(field);
+        }
+    }
+    req.max_kv_count = 0;
+    req.max_kv_size = 0;
+    req.no_value = false;
+
+    std::shared_ptr<proxy_session> ref_this = shared_from_this();
+    auto on_multi_get_reply = [ref_this, this, entries](
+        ::dsn::error_code ec, dsn::message_ex *, dsn::message_ex *response) {
+        if (_is_session_reset.load(std::memory_order_acquire)) {
+            ddebug("%s: hget command seqid(%" PRId64 ") got reply, but session has reset",
+                   _remote_address.to_string(),
+                   entries->front()->sequence_id);
+            return;
+        }
+
+        if (::dsn::ERR_OK != ec) {
+            ddebug("%s: hget command seqid(%" PRId64 ") got reply with error = %s",
+                   _remote_address.to_string(),
+                   entries->front()->sequence_id,
+                   ec.to_string());
+            for (message_entry *entry : *entries) {
+                simple_error_reply(*entry, ec.to_string());
+            }
+            return;
+        }
+        ::dsn::apps::multi_get_response rrdb_response;
+        ::dsn::unmarshall(response, rrdb_response);
+        if (rrdb_response.error != 0) {
+            for (message_entry *entry : *entries) {
+                simple_error_reply(*entry,
+                                   "internal error " + std::to_string(rrdb_response.error));
+            }
+            return;
+        }
+
+        std::unordered_map<std::string, ::dsn::blob> values;
+        for (::dsn::apps::key_value &kv : rrdb_response.kvs) {
+            values.emplace(kv.key.to_string(), std::move(kv.value));
+        }
+        for (message_entry *entry : *entries) {
+            auto iter = values.find(entry->request.sub_requests[2].data.to_string());
+            if (iter == values.end()) {
+                reply_message(*entry, redis_bulk_string());
+            } else {
+                reply_message(*entry, redis_bulk_string(iter->second));
+            }
+        }
+    };
+    ::dsn::blob tmp_key;
+    pegasus_generate_key(tmp_key, key, ::dsn::blob());
+    auto partition_hash = pegasus_key_hash(tmp_key);
+    // TODO: set the timeout
+    client->multi_get(req, on_multi_get_reply, std::chrono::milliseconds(2000), 0, partition_hash);
+}
+
+// origin command format:
+// HGETALL key
+void redis_parser::hgetall(message_entry &entry)
+{
+    redis_request &redis_req = entry.request;
+    if (redis_req.sub_requests.size() != 2) {
+        ddebug("%s: hgetall command seqid(%" PRId64 ") with invalid arguments",
+               _remote_address.to_string(),
+               entry.sequence_id);
+        simple_error_reply(entry, "wrong number of arguments for 'hgetall' command");
+        return;
+    }
+    if (!is_valid_hash_key(redis_req.sub_requests[1].data)) {
+        simple_error_reply(entry, "invalid key for hash");
+        return;
+    }
+
+    std::shared_ptr<proxy_session> ref_this = shared_from_this();
+    auto on_range_reply = [ref_this, this, &entry](
+        const std::string &error, std::vector<::dsn::apps::key_value> &&kvs, bool) {
+        if (_is_session_reset.load(std::memory_order_acquire)) {
+            ddebug("%s: hgetall command seqid(%" PRId64 ") got reply, but session has reset",
+                   _remote_address.to_string(),
+                   entry.sequence_id);
+            return;
+        }
+
+        if (!error.empty()) {
+            simple_error_reply(entry, error);
+            return;
+        }
+        redis_array result;
+        result.resize(kvs.size() * 2);
+        for (size_t i = 0; i < kvs.size(); ++i) {
+            result.array[i * 2] = std::make_shared<redis_bulk_string>(kvs[i].key);
+            result.array[i * 2 + 1] = std::make_shared<redis_bulk_string>(kvs[i].value);
+        }
+        reply_message(entry, result);
+    };
+    get_range(make_range_request(redis_req.sub_requests[1].data), 0, on_range_reply);
+}
+
+// origin command format:
+// HDEL key field [field ...]
+// NOTE: the number of the distinct fields is replied, whether the fields exist or not
+void redis_parser::hdel(message_entry &entry)
+{
+    redis_request &redis_req = entry.request;
+    if (redis_req.sub_requests.size() < 3) {
+        ddebug("%s: hdel command seqid(%" PRId64 ") with invalid arguments",
+               _remote_address.to_string(),
+               entry.sequence_id);
+        simple_error_reply(entry, "wrong number of arguments for 'hdel' command");
+        return;
+    }
+    const ::dsn::blob &key = redis_req.sub_requests[1].data;
+    if (!is_valid_hash_key(key)) {
+        simple_error_reply(entry, "invalid key for hash");
+        return;
+    }
+
+    auto groups = group_keys(redis_req, 1, 2);
+    ::dsn::apps::multi_remove_request req;
+    req.hash_key = key;
+    req.sort_keys.reserve(groups.size());
+    for (const std::vector<size_t> &indexes : groups) {
+        const ::dsn::blob &field = redis_req.sub_requests[indexes[0]].data;
+        if (!is_valid_field(field)) {
+            simple_error_reply(entry, "empty or reserved field is not supported");
+            return;
+        }
+        req.sort_keys.emplace_back(field);
+    }
+    req.max_count = 0;
+
+    std::shared_ptr<proxy_session> ref_this = shared_from_this();
+    auto on_multi_remove_reply = [ref_this, this, &entry](
+        ::dsn::error_code ec, dsn::message_ex *, dsn::message_ex *response) {
+        if (_is_session_reset.load(std::memory_order_acquire)) {
+            ddebug("%s: hdel command seqid(%" PRId64 ") got reply, but session has reset",
+                   _remote_address.to_string(),
+                   entry.sequence_id);
+            return;
+        }
+
+        if (::dsn::ERR_OK != ec) {
+            ddebug("%s: hdel command seqid(%" PRId64 ") got reply with error = %s",
+                   _remote_address.to_string(),
+                   entry.sequence_id,
+                   ec.to_string());
+            simple_error_reply(entry, ec.to_string());
+            return;
+        }
+        ::dsn::apps::multi_remove_response rrdb_response;
+        ::dsn::unmarshall(response, rrdb_response);
+        if (rrdb_response.error != 0) {
+            simple_error_reply(entry, "internal error " + std::to_string(rrdb_response.error));
+        } else {
+            simple_integer_reply(entry, rrdb_response.count);
+        }
+    };
+    ::dsn::blob tmp_key;
+    pegasus_generate_key(tmp_key, key, ::dsn::blob());
+    auto partition_hash = pegasus_key_hash(tmp_key);
+    // TODO: set the timeout
+    client->multi_remove(
+        req, on_multi_remove_reply, std::chrono::milliseconds(2000), 0, partition_hash);
+}
+
+// origin command format:
+// HLEN key
+// NOTE: the sort keys are counted by the server, the type marker is not counted as a field, but
+// the string value of the key, if any, is
+void redis_parser::hlen(message_entry &entry)
+{
+    redis_request &redis_req = entry.request;
+    if (redis_req.sub_requests.size() != 2) {
+        ddebug("%s: hlen command seqid(%" PRId64 ") with invalid arguments",
+               _remote_address.to_string(),
+               entry.sequence_id);
+        simple_error_reply(entry, "wrong number of arguments for 'hlen' command");
+        return;
+    }
+    const ::dsn::blob &key = redis_req.sub_requests[1].data;
+    if (!is_valid_hash_key(key)) {
+        simple_error_reply(entry, "invalid key for hash");
+        return;
+    }
+
+    std::shared_ptr<proxy_session> ref_this = shared_from_this();
+    auto on_count_reply = [ref_this, this, &entry](
+        ::dsn::error_code ec, dsn::message_ex *, dsn::message_ex *response) {
+        if (_is_session_reset.load(std::memory_order_acquire)) {
+            ddebug("%s: hlen command seqid(%" PRId64 ") got reply, but session has reset",
+                   _remote_address.to_string(),
+                   entry.sequence_id);
+            return;
+        }
+
+        if (::dsn::ERR_OK != ec) {
+            ddebug("%s: hlen command seqid(%" PRId64 ") got reply with error = %s",
+                   _remote_address.to_string(),
+                   entry.sequence_id,
+                   ec.to_string());
+            simple_error_reply(entry, ec.to_string());
+            return;
+        }
+        ::dsn::apps::count_response rrdb_response;
+        ::dsn::unmarshall(response, rrdb_response);
+        if (rrdb_response.error != 0) {
+            simple_error_reply(entry, "internal error " + std::to_string(rrdb_response.error));
+        } else {
+            // a hash always has the type marker
+            simple_integer_reply(entry, std::max(rrdb_response.count - 1, int64_t(0)));
+        }
+    };
+    ::dsn::blob tmp_key;
+    pegasus_generate_key(tmp_key, key, ::dsn::blob());
+    auto partition_hash = pegasus_key_hash(tmp_key);
+    // TODO: set the timeout
+    client->sortkey_count(key, on_count_reply, std::chrono::milliseconds(2000), 0, partition_hash);
+}
+
+// origin command format:
+// HSCAN key cursor [MATCH pattern] [COUNT count]
+// NOTE: only the patterns which can be mapped to the sort key filters are supported, see
+// parse_hscan_pattern
+void redis_parser::hscan(message_entry &entry)
+{
+    redis_request &redis_req = entry.request;
+    if (redis_req.sub_requests.size() < 3 || redis_req.sub_requests.size() % 2 != 1) {
+        ddebug("%s: hscan command seqid(%" PRId64 ") with invalid arguments",
+               _remote_address.to_string(),
+               entry.sequence_id);
+        simple_error_reply(entry, "wrong number of arguments for 'hscan' command");
+        return;
+    }
+    const ::dsn::blob &key = redis_req.sub_requests[1].data;
+    if (!is_valid_hash_key(key)) {
+        simple_error_reply(entry, "invalid key for hash");
+        return;
+    }
+    // the cursor of a hash is continued after the last field replied
+    std::string start_field;
+    if (!load_scan_cursor(redis_req.sub_requests[2].data.to_string(), key, start_field)) {
+        simple_error_reply(entry, "invalid cursor");
+        return;
+    }
+
+    int32_t count = 10;
+    pegasus_client::filter_type filter_type = pegasus_client::FT_NO_FILTER;
+    std::string filter_pattern;
+    for (size_t i = 3; i < redis_req.sub_requests.size(); i += 2) {
+        const std::string &opt = redis_req.sub_requests[i].data.to_string();
+        const std::string &arg = redis_req.sub_requests[i + 1].data.to_string();
+        if (strcasecmp(opt.c_str(), "MATCH") == 0) {
+            if (!parse_hscan_pattern(arg, filter_type, filter_pattern)) {
+                simple_error_reply(entry, "unsupported pattern '" + arg + "'");
+                return;
+            }
+        } else if (strcasecmp(opt.c_str(), "COUNT") == 0) {
+            if (!dsn::buf2int32(arg, count) || count <= 0) {
+                simple_error_reply(entry, "value is not an integer or out of range");
+                return;
+            }
+        } else {
+            simple_error_reply(entry, "syntax error");
+            return;
+        }
+    }
+
+    std::shared_ptr<proxy_session> ref_this = shared_from_this();
+    auto on_range_reply = [ref_this, this, key, &entry](
+        const std::string &error, std::vector<::dsn::apps::key_value> &&kvs, bool complete) {
+        if (_is_session_reset.load(std::memory_order_acquire)) {
+            ddebug("%s: hscan command seqid(%" PRId64 ") got reply, but session has reset",
+                   _remote_address.to_string(),
+                   entry.sequence_id);
+            return;
+        }
+
+        if (!error.empty()) {
+            simple_error_reply(entry, error);
+            return;
+        }
+        auto fields = std::make_shared<redis_array>();
+        fields->resize(kvs.size() * 2);
+        for (size_t i = 0; i < kvs.size(); ++i) {
+            fields->array[i * 2] = std::make_shared<redis_bulk_string>(kvs[i].key);
+            fields->array[i * 2 + 1] = std::make_shared<redis_bulk_string>(kvs[i].value);
+        }
+        redis_array result;
+        result.resize(2);
+        result.array[0] = std::make_shared<redis_bulk_string>(
+            complete ? std::string("0") : save_scan_cursor(key, kvs.back().key.to_string()));
+        result.array[1] = fields;
+        reply_message(entry, result);
+    };
+    auto req = make_range_request(key);
+    if (!start_field.empty()) {
+        req.start_sortkey = ::dsn::blob::create_from_bytes(std::move(start_field));
+    }
+    req.sort_key_filter_type = (::dsn::apps::filter_type::type)filter_type;
+    req.sort_key_filter_pattern = ::dsn::blob::create_from_bytes(std::move(filter_pattern));
+    get_range(std::move(req), count, on_range_reply);
+}
+
+/*static*/ scan_cursor_table *redis_parser::scan_cursors()
+{
+    static scan_cursor_table s_scan_cursors(FLAGS_scan_cursor_max_count, FLAGS_scan_cursor_ttl_ms);
+    return &s_scan_cursors;
+}
+
+/*static*/ std::string redis_parser::save_scan_cursor(dsn::string_view owner,
+                                                      std::string position)
+{
+    return std::to_string(scan_cursors()->add(owner, std::move(position)));
+}
+
+/*static*/ bool redis_parser::load_scan_cursor(const std::string &cursor,
+                                               dsn::string_view owner,
+                                               std::string &position)
+{
+    position.clear();
+    if (cursor == "0") {
+        return true;
+    }
+    uint64_t id;
+    return dsn::buf2uint64(cursor, id) && id != 0 && scan_cursors()->get(id, owner, position);
+}
+
+/*static*/ bool redis_parser::parse_hscan_pattern(const std::string &pattern,
+                                                  pegasus_client::filter_type &filter_type,
+                                                  std::string &filter_pattern)
+{
+    if (pattern == "*") {
+        filter_type = pegasus_client::FT_NO_FILTER;
+        filter_pattern.clear();
+        return true;
+    }
+
+    bool leading_star = !pattern.empty() && pattern.front() == '*';
+    bool trailing_star = pattern.size() > (leading_star ? 1 : 0) && pattern.back() == '*';
+    if (!leading_star && !trailing_star) {
+        return false;
+    }
+    std::string body =
+        pattern.substr(leading_star ? 1 : 0, pattern.size() - leading_star - trailing_star);
+    if (body.empty() || body.find_first_of("*?[]\\") != std::string::npos) {
+        return false;
+    }
+
+    if (leading_star && trailing_star) {
+        filter_type = pegasus_client::FT_MATCH_ANYWHERE;
+    } else if (leading_star) {
+        filter_type = pegasus_client::FT_MATCH_POSTFIX;
+    } else {
+        filter_type = pegasus_client::FT_MATCH_PREFIX;
+    }
+    filter_pattern = std::move(body);
+    return true;
+}
+
+// origin command format:
+// SCAN cursor [MATCH pattern] [COUNT count]
+// NOTE: the same key may be returned by more than one SCAN, e.g. a hash whose fields are scanned
+// across two SCANs, which is allowed by redis. Only the patterns supported by
+// parse_hscan_pattern are supported. At most COUNT records, that is the sort keys, are examined,
+// so fewer keys may be returned with a cursor other than "0"
+void redis_parser::scan(message_entry &entry)
+{
+    redis_request &redis_req = entry.request;
+    if (redis_req.sub_requests.size() < 2 || redis_req.sub_requests.size() % 2 != 0) {
+        ddebug("%s: scan command seqid(%" PRId64 ") with invalid arguments",
+               _remote_address.to_string(),
+               entry.sequence_id);
+        simple_error_reply(entry, "wrong number of arguments for 'scan' command");
+        return;
+    }
+    if (_scan_client == nullptr) {
+        simple_error_reply(entry, "scan is not supported");
+        return;
+    }
+    std::string token;
+    if (!load_scan_cursor(redis_req.sub_requests[1].data.to_string(), dsn::string_view(), token)) {
+        simple_error_reply(entry, "invalid cursor");
+        return;
+    }
+
+    auto context = std::make_shared<scan_context>();
+    context->count = 10;
+    context->record_count = 0;
+    pegasus_client::scan_options options;
+    options.no_value = true;
+    for (size_t i = 2; i < redis_req.sub_requests.size(); i += 2) {
+        const std::string &opt = redis_req.sub_requests[i].data.to_string();
+        const std::string &arg = redis_req.sub_requests[i + 1].data.to_string();
+        if (strcasecmp(opt.c_str(), "MATCH") == 0) {
+            if (!parse_hscan_pattern(
+                    arg, options.hash_key_filter_type, options.hash_key_filter_pattern)) {
+                simple_error_reply(entry, "unsupported pattern '" + arg + "'");
+                return;
+            }
+        } else if (strcasecmp(opt.c_str(), "COUNT") == 0) {
+            if (!dsn::buf2int32(arg, context->count) || context->count <= 0) {
+                simple_error_reply(entry, "value is not an integer or out of range");
+                return;
+            }
+        } else {
+            simple_error_reply(entry, "syntax error");
+            return;
+        }
+    }
+    // the pattern is filtered on the replicas, so the keys not matched are never transferred,
+    // and the resume token is positioned at the last record returned, which matches the pattern
+    options.batch_size = context->count;
+
+    std::shared_ptr<proxy_session> ref_this = shared_from_this();
+    auto on_scanner = [ref_this, this, &entry, context](int error_code,
+                                                       pegasus_client::pegasus_scanner *scanner) {
+        context->scanner.reset(scanner);
+        if (_is_session_reset.load(std::memory_order_acquire)) {
+            ddebug("%s: scan command seqid(%" PRId64 ") got reply, but session has reset",
+                   _remote_address.to_string(),
+                   entry.sequence_id);
+            return;
+        }
+        if (error_code != PERR_OK) {
+            simple_error_reply(entry, _scan_client->get_error_string(error_code));
+            return;
+        }
+        scan_next(entry, context);
+    };
+
+    if (token.empty()) {
+        // a single scanner for all the partitions, which are scanned one by one
+        auto on_scanners = [on_scanner](int error_code,
+                                        std::vector<pegasus_client::pegasus_scanner *> &&scanners) {
+            if (error_code == PERR_OK && scanners.empty()) {
+                error_code = PERR_UNKNOWN;
+            }
+            on_scanner(error_code, error_code == PERR_OK ? scanners[0] : nullptr);
+        };
+        _scan_client->async_get_unordered_scanners(1, options, std::move(on_scanners));
+    } else {
+        pegasus_client::pegasus_scanner *scanner = nullptr;
+        if (_scan_client->get_scanner_by_resume_token(token, options, scanner) != PERR_OK) {
+            simple_error_reply(entry, "invalid cursor");
+            return;
+        }
+        on_scanner(PERR_OK, scanner);
+    }
+}
+
+void redis_parser::scan_next(message_entry &entry, std::shared_ptr<scan_context> context)
+{
+    std::shared_ptr<proxy_session> ref_this = shared_from_this();
+    // the callback holds the scanner by the context, so that it's deleted after the last
+    // callback returns
+    context->scanner->async_next([ref_this, this, &entry, context](
+        int error_code,
+        std::string &&hash_key,
+        std::string &&,
+        std::string &&,
+        pegasus_client::internal_info &&,
+        uint32_t) {
+        if (_is_session_reset.load(std::memory_order_acquire)) {
+            ddebug("%s: scan command seqid(%" PRId64 ") got reply, but session has reset",
+                   _remote_address.to_string(),
+                   entry.sequence_id);
+            return;
+        }
+        if (error_code != PERR_OK && error_code != PERR_SCAN_COMPLETE) {
+            simple_error_reply(entry, _scan_client->get_error_string(error_code));
+            return;
+        }
+
+        // every record counts, so a hash or a sorted set with many sort keys is spread over
+        // several SCANs, and its sort keys are adjacent in the scan
+        if (error_code == PERR_OK) {
+            context->record_count++;
+            if (context->keys.empty() || context->keys.back() != hash_key) {
+                context->keys.emplace_back(std::move(hash_key));
+            }
+            if (context->record_count < context->count) {
+                scan_next(entry, context);
+                return;
+            }
+        }
+
+        std::string cursor("0");
+        if (error_code == PERR_OK) {
+            std::string token;
+            context->scanner->get_resume_token(token);
+            cursor = save_scan_cursor(dsn::string_view(), std::move(token));
+        }
+        auto key_array = std::make_shared<redis_array>();
+        key_array->resize(context->keys.size());
+        for (size_t i = 0; i < context->keys.size(); ++i) {
+            key_array->array[i] = std::make_shared<redis_bulk_string>(context->keys[i]);
+        }
+        redis_array result;
+        result.resize(2);
+        result.array[0] = std::make_shared<redis_bulk_string>(cursor);
+        result.array[1] = key_array;
+        reply_message(entry, result);
+    });
+}
+
+namespace {
+// the sort keys of a sorted set, see redis_parser.h, the score entries are in
+// [kZsetScorePrefix, kZsetScoreEnd)
+const std::string kZsetScorePrefix("\0s", 2);
+const std::string kZsetScoreEnd("\0t", 2);
+const std::string kZsetMemberPrefix("\0m", 2);
+const size_t kZsetScoreLength = sizeof(uint64_t);
+// the times to retry if a member is updated concurrently
+const int kZsetMaxRetries = 3;
+
+} // anonymous namespace
+
+/*static*/ uint64_t redis_parser::zset_score_order(double score)
+{
+    // flip all the bits of a negative number, and the sign bit of a positive number, then the
+    // order of the doubles is the same as the order of the unsigned integers
+    score += 0.0; // -0.0 => 0.0
+    uint64_t bits;
+    memcpy(&bits, &score, sizeof(bits));
+    return (bits & (1ULL << 63)) ? ~bits : (bits | (1ULL << 63));
+}
+
+/*static*/ std::string redis_parser::encode_zset_score(uint64_t order)
+{
+    // in big endian, so the bytes compare the same as the integers
+    std::string data(kZsetScoreLength, '\0');
+    for (size_t i = 0; i < kZsetScoreLength; ++i) {
+        data[i] = static_cast<char>(order >> (8 * (kZsetScoreLength - 1 - i)));
+    }
+    return data;
+}
+
+/*static*/ double redis_parser::decode_zset_score(const char *data)
+{
+    uint64_t order = 0;
+    for (size_t i = 0; i < kZsetScoreLength; ++i) {
+        order = (order << 8) | static_cast<unsigned char>(data[i]);
+    }
+    uint64_t bits = (order & (1ULL << 63)) ? (order & ~(1ULL << 63)) : ~order;
+    double score;
+    memcpy(&score, &bits, sizeof(score));
+    return score;
+}
+
+/*static*/ bool redis_parser::parse_zset_score(const std::string &str, double &score)
+{
+    if (strcasecmp(str.c_str(), "inf") == 0 || strcasecmp(str.c_str(), "+inf") == 0) {
+        score = std::numeric_limits<double>::infinity();
+        return true;
+    }
+    if (strcasecmp(str.c_str(), "-inf") == 0) {
+        score = -std::numeric_limits<double>::infinity();
+        return true;
+    }
+    return dsn::buf2double(str, score) && !std::isnan(score);
+}
+
+/*static*/ std::string redis_parser::format_zset_score(double score)
+{
+    return fmt::format("{:.17g}", score);
+}
+
+void redis_parser::update_zset_member(const ::dsn::blob &key,
+                                      const std::string &member,
+                                      double score,
+                                      bool remove,
+                                      int retries,
+                                      zset_update_callback &&callback)
+{
+    // read the score of the member, then update both the entries of the member if the score is
+    // not changed in the meantime
+    auto user_callback = std::make_shared<zset_update_callback>(std::move(callback));
+    std::string member_key = kZsetMemberPrefix + member;
+    std::shared_ptr<proxy_session> ref_this = shared_from_this();
+    auto on_get_reply = [ref_this, this, key, member, score, remove, retries, user_callback](
+        ::dsn::error_code ec, dsn::message_ex *, dsn::message_ex *response) {
+        if (::dsn::ERR_OK != ec) {
+            (*user_callback)(ec.to_string(), false);
+            return;
+        }
+        ::dsn::apps::read_response rrdb_response;
+        ::dsn::unmarshall(response, rrdb_response);
+        if (rrdb_response.error != 0 && rrdb_response.error != rocksdb::Status::kNotFound) {
+            (*user_callback)("internal error " + std::to_string(rrdb_response.error), false);
+            return;
+        }
+        bool existed = rrdb_response.error == 0;
+        if (existed && rrdb_response.value.length() != kZsetScoreLength) {
+            (*user_callback)("invalid score of member '" + member + "'", false);
+            return;
+        }
+        std::string new_score = encode_zset_score(zset_score_order(score));
+        if (remove ? !existed : (existed && rrdb_response.value.to_string() == new_score)) {
+            // nothing to update
+            (*user_callback)(std::string(), existed);
+            return;
+        }
+
+        ::dsn::apps::check_and_mutate_request req;
+        req.hash_key = key;
+        req.check_sort_key = ::dsn::blob::create_from_bytes(kZsetMemberPrefix + member);
+        if (existed) {
+            req.check_type = ::dsn::apps::cas_check_type::CT_VALUE_BYTES_EQUAL;
+            req.check_operand = rrdb_response.value;
+        } else {
+            req.check_type = ::dsn::apps::cas_check_type::CT_VALUE_NOT_EXIST;
+        }
+        req.return_check_value = false;
+        auto add_mutate = [&req](::dsn::apps::mutate_operation::type operation,
+                                 std::string &&sort_key,
+                                 std::string &&value) {
+            ::dsn::apps::mutate mu;
+            mu.operation = operation;
+            mu.sort_key = ::dsn::blob::create_from_bytes(std::move(sort_key));
+            mu.value = ::dsn::blob::create_from_bytes(std::move(value));
+            mu.set_expire_ts_seconds = 0;
+            req.mutate_list.emplace_back(std::move(mu));
+        };
+        if (existed) {
+            add_mutate(::dsn::apps::mutate_operation::MO_DELETE,
+                       kZsetScorePrefix + rrdb_response.value.to_string() + member,
+                       std::string());
+        }
+        if (remove) {
+            add_mutate(::dsn::apps::mutate_operation::MO_DELETE,
+                       kZsetMemberPrefix + member,
+                       std::string());
+        } else {
+            add_mutate(::dsn::apps::mutate_operation::MO_PUT,
+                       std::string(kTypeMarkerSortKey),
+                       std::string());
+            add_mutate(::dsn::apps::mutate_operation::MO_PUT,
+                       kZsetScorePrefix + new_score + member,
+                       std::string());
+            add_mutate(::dsn::apps::mutate_operation::MO_PUT,
+                       kZsetMemberPrefix + member,
+                       std::move(new_score));
+        }
+
+        auto on_check_and_mutate_reply =
+            [ref_this, this, key, member, score, remove, retries, existed, user_callback](
+                ::dsn::error_code ec, dsn::message_ex *, dsn::message_ex *response) {
+                if (::dsn::ERR_OK != ec) {
+                    (*user_callback)(ec.to_string(), false);
+                    return;
+                }
+                ::dsn::apps::check_and_mutate_response rrdb_response;
+                ::dsn::unmarshall(response, rrdb_response);
+                if (rrdb_response.error == rocksdb::Status::kTryAgain && retries > 0) {
+                    // the member is updated concurrently, read it and try again
+                    update_zset_member(key,
+                                       member,
+                                       score,
+                                       remove,
+                                       retries - 1,
+                                       zset_update_callback(*user_callback));
+                } else if (rrdb_response.error != 0) {
+                    (*user_callback)("internal error " + std::to_string(rrdb_response.error),
+                                     false);
+                } else {
+                    (*user_callback)(std::string(), existed);
+                }
+            };
+        ::dsn::blob tmp_key;
+        pegasus_generate_key(tmp_key, key, ::dsn::blob());
+        auto partition_hash = pegasus_key_hash(tmp_key);
+        // TODO: set the timeout
+        client->check_and_mutate(req,
+                                 on_check_and_mutate_reply,
+                                 std::chrono::milliseconds(2000),
+                                 0,
+                                 partition_hash);
+    };
+    ::dsn::blob req;
+    pegasus_generate_key(req, key, ::dsn::blob::create_from_bytes(std::move(member_key)));
+    auto partition_hash = pegasus_key_hash(req);
+    // TODO: set the timeout
+    client->get(req, on_get_reply, std::chrono::milliseconds(2000), 0, partition_hash);
+}
+
+// origin command format:
+// ZADD key score member [score member ...]
+// NOTE: the members are added concurrently, each member is updated atomically, but ZADD is not
+void redis_parser::zadd(message_entry &entry) { update_zset_members(entry, false); }
+
+// origin command format:
+// ZREM key member [member ...]
+// NOTE: the members are removed concurrently, each member is updated atomically, but ZREM is not
+void redis_parser::zrem(message_entry &entry) { update_zset_members(entry, true); }
+
+void redis_parser::update_zset_members(message_entry &entry, bool remove)
+{
+    redis_request &redis_req = entry.request;
+    const char *command = remove ? "zrem" : "zadd";
+    if (remove ? redis_req.sub_requests.size() < 3
+               : (redis_req.sub_requests.size() < 4 || redis_req.sub_requests.size() % 2 != 0)) {
+        ddebug("%s: %s command seqid(%" PRId64 ") with invalid arguments",
+               _remote_address.to_string(),
+               command,
+               entry.sequence_id);
+        simple_error_reply(entry,
+                           fmt::format("wrong number of arguments for '{}' command", command));
+        return;
+    }
+    const ::dsn::blob &key = redis_req.sub_requests[1].data;
+    if (!is_valid_hash_key(key)) {
+        simple_error_reply(entry, "invalid key for sorted set");
+        return;
+    }
+
+    // if a member is added more than once, the last score wins
+    auto groups = remove ? group_keys(redis_req, 1, 2) : group_keys(redis_req, 2, 3);
+    std::vector<double> scores(groups.size(), 0);
+    for (size_t i = 0; i < groups.size() && !remove; ++i) {
+        if (!parse_zset_score(redis_req.sub_requests[groups[i].back() - 1].data.to_string(),
+                              scores[i])) {
+            simple_error_reply(entry, "value is not a valid float");
+            return;
+        }
+    }
+
+    auto context = std::make_shared<multi_key_context>(groups.size());
+    // the number of the members added or removed
+    auto updated_count = std::make_shared<std::atomic<int64_t>>(0);
+    std::shared_ptr<proxy_session> ref_this = shared_from_this();
+    for (size_t i = 0; i < groups.size(); ++i) {
+        auto on_member_updated =
+            [ref_this, this, context, updated_count, i, remove, command, &entry](
+                const std::string &error, bool existed) {
+                if (!error.empty()) {
+                    context->errors[i] = error;
+                } else if (existed == remove) {
+                    updated_count->fetch_add(1);
+                }
+                if (!context->reply_once()) {
+                    return;
+                }
+
+                if (_is_session_reset.load(std::memory_order_acquire)) {
+                    ddebug("%s: %s command seqid(%" PRId64 ") got reply, but session has reset",
+                           _remote_address.to_string(),
+                           command,
+                           entry.sequence_id);
+                    return;
+                }
+                std::string error_message = context->first_error();
+                if (!error_message.empty()) {
+                    simple_error_reply(entry, error_message);
+                } else {
+                    simple_integer_reply(entry, updated_count->load());
+                }
+            };
+        update_zset_member(key,
+                           redis_req.sub_requests[groups[i][0]].data.to_string(),
+                           scores[i],
+                           remove,
+                           kZsetMaxRetries,
+                           on_member_updated);
+    }
+}
+
+// origin command format:
+// ZSCORE key member
+void redis_parser::zscore(message_entry &entry)
+{
+    redis_request &redis_req = entry.request;
+    if (redis_req.sub_requests.size() != 3) {
+        ddebug("%s: zscore command seqid(%" PRId64 ") with invalid arguments",
+               _remote_address.to_string(),
+               entry.sequence_id);
+        simple_error_reply(entry, "wrong number of arguments for 'zscore' command");
+        return;
+    }
+    const ::dsn::blob &key = redis_req.sub_requests[1].data;
+    if (!is_valid_hash_key(key)) {
+        simple_error_reply(entry, "invalid key for sorted set");
+        return;
+    }
+
+    std::shared_ptr<proxy_session> ref_this = shared_from_this();
+    auto on_get_reply = [ref_this, this, &entry](
+        ::dsn::error_code ec, dsn::message_ex *, dsn::message_ex *response) {
+        if (_is_session_reset.load(std::memory_order_acquire)) {
+            ddebug("%s: zscore command seqid(%" PRId64 ") got reply, but session has reset",
+                   _remote_address.to_string(),
+                   entry.sequence_id);
+            return;
+        }
+
+        if (::dsn::ERR_OK != ec) {
+            ddebug("%s: zscore command seqid(%" PRId64 ") got reply with error = %s",
+                   _remote_address.to_string(),
+                   entry.sequence_id,
+                   ec.to_string());
+            simple_error_reply(entry, ec.to_string());
+            return;
+        }
+        ::dsn::apps::read_response rrdb_response;
+        ::dsn::unmarshall(response, rrdb_response);
+        if (rrdb_response.error == rocksdb::Status::kNotFound) {
+            reply_message(entry, redis_bulk_string());
+        } else if (rrdb_response.error != 0) {
+            simple_error_reply(entry, "internal error " + std::to_string(rrdb_response.error));
+        } else if (rrdb_response.value.length() != kZsetScoreLength) {
+            simple_error_reply(entry, "invalid score of the member");
+        } else {
+            reply_message(entry,
+                          redis_bulk_string(format_zset_score(
+                              decode_zset_score(rrdb_response.value.data()))));
+        }
+    };
+    ::dsn::blob req;
+    pegasus_generate_key(
+        req,
+        key,
+        ::dsn::blob::create_from_bytes(kZsetMemberPrefix +
+                                       redis_req.sub_requests[2].data.to_string()));
+    auto partition_hash = pegasus_key_hash(req);
+    // TODO: set the timeout
+    client->get(req, on_get_reply, std::chrono::milliseconds(2000), 0, partition_hash);
+}
+
+void redis_parser::get_zset_card(const ::dsn::blob &key, zset_card_callback &&callback)
+{
+    auto user_callback = std::make_shared<zset_card_callback>(std::move(callback));
+    auto on_count_reply = [user_callback](
+        ::dsn::error_code ec, dsn::message_ex *, dsn::message_ex *response) {
+        if (::dsn::ERR_OK != ec) {
+            (*user_callback)(ec.to_string(), 0);
+            return;
+        }
+        ::dsn::apps::count_response rrdb_response;
+        ::dsn::unmarshall(response, rrdb_response);
+        if (rrdb_response.error != 0) {
+            (*user_callback)("internal error " + std::to_string(rrdb_response.error), 0);
+        } else {
+            // each member has a score entry and a member entry, and the type marker is rounded
+            // down
+            (*user_callback)(std::string(), rrdb_response.count / 2);
+        }
+    };
+    ::dsn::blob tmp_key;
+    pegasus_generate_key(tmp_key, key, ::dsn::blob());
+    auto partition_hash = pegasus_key_hash(tmp_key);
+    // TODO: set the timeout
+    client->sortkey_count(key, on_count_reply, std::chrono::milliseconds(2000), 0, partition_hash);
+}
+
+// origin command format:
+// ZCARD key
+// NOTE: the sort keys are counted by the server, so the key is assumed to hold nothing but the
+// sorted set
+void redis_parser::zcard(message_entry &entry)
+{
+    redis_request &redis_req = entry.request;
+    if (redis_req.sub_requests.size() != 2) {
+        ddebug("%s: zcard command seqid(%" PRId64 ") with invalid arguments",
+               _remote_address.to_string(),
+               entry.sequence_id);
+        simple_error_reply(entry, "wrong number of arguments for 'zcard' command");
+        return;
+    }
+    if (!is_valid_hash_key(redis_req.sub_requests[1].data)) {
+        simple_error_reply(entry, "invalid key for sorted set");
+        return;
+    }
+
+    std::shared_ptr<proxy_session> ref_this = shared_from_this();
+    get_zset_card(redis_req.sub_requests[1].data,
+                  [ref_this, this, &entry](const std::string &error, int64_t card) {
+                      if (_is_session_reset.load(std::memory_order_acquire)) {
+                          ddebug("%s: zcard command seqid(%" PRId64
+                                 ") got reply, but session has reset",
+                                 _remote_address.to_string(),
+                                 entry.sequence_id);
+                          return;
+                      }
+                      if (!error.empty()) {
+                          simple_error_reply(entry, error);
+                      } else {
+                          simple_integer_reply(entry, card);
+                      }
+                  });
+}
+
+// origin command format:
+// ZRANGE key start stop [WITHSCORES]
+void redis_parser::zrange(message_entry &entry) { zrange_by_rank(entry, false); }
+
+// origin command format:
+// ZREVRANGE key start stop [WITHSCORES]
+void redis_parser::zrevrange(message_entry &entry) { zrange_by_rank(entry, true); }
+
+void redis_parser::zrange_by_rank(message_entry &entry, bool reverse)
+{
+    redis_request &redis_req = entry.request;
+    const char *command = reverse ? "zrevrange" : "zrange";
+    int64_t start = 0;
+    int64_t stop = 0;
+    bool with_scores =
+        redis_req.sub_requests.size() == 5 &&
+        strcasecmp(redis_req.sub_requests[4].data.to_string().c_str(), "WITHSCORES") == 0;
+    if (redis_req.sub_requests.size() < 4 ||
+        (redis_req.sub_requests.size() > 4 && !with_scores)) {
+        ddebug("%s: %s command seqid(%" PRId64 ") with invalid arguments",
+               _remote_address.to_string(),
+               command,
+               entry.sequence_id);
+        simple_error_reply(entry, "syntax error");
+        return;
+    }
+    if (!dsn::buf2int64(redis_req.sub_requests[2].data, start) ||
+        !dsn::buf2int64(redis_req.sub_requests[3].data, stop)) {
+        simple_error_reply(entry, "value is not an integer or out of range");
+        return;
+    }
+    const ::dsn::blob &key = redis_req.sub_requests[1].data;
+    if (!is_valid_hash_key(key)) {
+        simple_error_reply(entry, "invalid key for sorted set");
+        return;
+    }
+
+    std::shared_ptr<proxy_session> ref_this = shared_from_this();
+    auto on_range_reply = [ref_this, this, command, with_scores, &entry](
+        const std::string &error, std::vector<::dsn::apps::key_value> &&kvs, int64_t offset) {
+        if (_is_session_reset.load(std::memory_order_acquire)) {
+            ddebug("%s: %s command seqid(%" PRId64 ") got reply, but session has reset",
+                   _remote_address.to_string(),
+                   command,
+                   entry.sequence_id);
+            return;
+        }
+        if (!error.empty()) {
+            simple_error_reply(entry, error);
+        } else {
+            reply_zset_range(entry, kvs, offset, with_scores);
+        }
+    };
+    // the members in [start, stop] by rank are the first `stop + 1` score entries in the
+    // direction of the iteration except the first `start` ones
+    auto get_ranks = [this, key, reverse, on_range_reply](int64_t start, int64_t stop) {
+        if (start > stop || stop < 0) {
+            on_range_reply(std::string(), {}, 0);
+            return;
+        }
+        auto req = make_range_request(key);
+        req.start_sortkey = ::dsn::blob::create_from_bytes(std::string(kZsetScorePrefix));
+        req.start_inclusive = true;
+        req.stop_sortkey = ::dsn::blob::create_from_bytes(std::string(kZsetScoreEnd));
+        req.stop_inclusive = false;
+        req.reverse = reverse;
+        get_range(std::move(req),
+                  stop + 1,
+                  [on_range_reply, start](const std::string &error,
+                                          std::vector<::dsn::apps::key_value> &&kvs,
+                                          bool) { on_range_reply(error, std::move(kvs), start); });
+    };
+    if (start >= 0 && stop >= 0) {
+        get_ranks(start, stop);
+        return;
+    }
+
+    // the negative ranks are counted from the end, so the cardinality is needed
+    get_zset_card(key,
+                  [get_ranks, on_range_reply, start, stop](const std::string &error,
+                                                           int64_t card) mutable {
+                      if (!error.empty()) {
+                          on_range_reply(error, {}, 0);
+                          return;
+                      }
+                      if (start < 0) {
+                          start = std::max(start + card, int64_t(0));
+                      }
+                      if (stop < 0) {
+                          stop += card;
+                      }
+                      get_ranks(start, stop);
+                  });
+}
+
+// origin command format:
+// ZRANGEBYSCORE key min max [WITHSCORES] [LIMIT offset count]
+void redis_parser::zrangebyscore(message_entry &entry) { zrange_by_score(entry, false); }
+
+// origin command format:
+// ZREVRANGEBYSCORE key max min [WITHSCORES] [LIMIT offset count]
+void redis_parser::zrevrangebyscore(message_entry &entry) { zrange_by_score(entry, true); }
+
+void redis_parser::zrange_by_score(message_entry &entry, bool reverse)
+{
+    redis_request &redis_req = entry.request;
+    const char *command = reverse ? "zrevrangebyscore" : "zrangebyscore";
+    if (redis_req.sub_requests.size() < 4) {
+        ddebug("%s: %s command seqid(%" PRId64 ") with invalid arguments",
+               _remote_address.to_string(),
+               command,
+               entry.sequence_id);
+        simple_error_reply(entry,
+                           fmt::format("wrong number of arguments for '{}' command", command));
+        return;
+    }
+    const ::dsn::blob &key = redis_req.sub_requests[1].data;
+    if (!is_valid_hash_key(key)) {
+        simple_error_reply(entry, "invalid key for sorted set");
+        return;
+    }
+
+    // the score bounds are mapped to the range [start, stop) of the encoded scores, a bound
+    // prefixed by '(' is exclusive
+    uint64_t bounds[2];
+    for (int i = 0; i < 2; ++i) {
+        std::string str = redis_req.sub_requests[2 + i].data.to_string();
+        bool exclusive = !str.empty() && str[0] == '(';
+        double score;
+        if (!parse_zset_score(exclusive ? str.substr(1) : str, score)) {
+            simple_error_reply(entry, "min or max is not a float");
+            return;
+        }
+        uint64_t order = zset_score_order(score);
+        // the lower bound is the first argument unless reversed
+        bool is_min = (i == 0) != reverse;
+        bounds[is_min ? 0 : 1] = (exclusive == is_min) ? order + 1 : order;
+    }
+
+    bool with_scores = false;
+    int64_t offset = 0;
+    int64_t count = -1;
+    for (size_t i = 4; i < redis_req.sub_requests.size(); ++i) {
+        std::string opt = redis_req.sub_requests[i].data.to_string();
+        if (strcasecmp(opt.c_str(), "WITHSCORES") == 0) {
+            with_scores = true;
+        } else if (strcasecmp(opt.c_str(), "LIMIT") == 0 &&
+                   i + 2 < redis_req.sub_requests.size()) {
+            if (!dsn::buf2int64(redis_req.sub_requests[i + 1].data, offset) ||
+                !dsn::buf2int64(redis_req.sub_requests[i + 2].data, count)) {
+                simple_error_reply(entry, "value is not an integer or out of range");
+                return;
+            }
+            i += 2;
+        } else {
+            simple_error_reply(entry, "syntax error");
+            return;
+        }
+    }
+    if (bounds[0] >= bounds[1] || offset < 0 || count == 0) {
+        reply_zset_range(entry, {}, 0, with_scores);
+        return;
+    }
+
+    auto req = make_range_request(key);
+    req.start_sortkey = ::dsn::blob::create_from_bytes(kZsetScorePrefix +
+                                                       encode_zset_score(bounds[0]));
+    req.start_inclusive = true;
+    req.stop_sortkey = ::dsn::blob::create_from_bytes(kZsetScorePrefix +
+                                                      encode_zset_score(bounds[1]));
+    req.stop_inclusive = false;
+    req.reverse = reverse;
+    std::shared_ptr<proxy_session> ref_this = shared_from_this();
+    auto on_range_reply = [ref_this, this, command, offset, with_scores, &entry](
+        const std::string &error, std::vector<::dsn::apps::key_value> &&kvs, bool) {
+        if (_is_session_reset.load(std::memory_order_acquire)) {
+            ddebug("%s: %s command seqid(%" PRId64 ") got reply, but session has reset",
+                   _remote_address.to_string(),
+                   command,
+                   entry.sequence_id);
+            return;
+        }
+        if (!error.empty()) {
+            simple_error_reply(entry, error);
+        } else {
+            reply_zset_range(entry, kvs, offset, with_scores);
+        }
+    };
+    get_range(std::move(req), count < 0 ? 0 : offset + count, on_range_reply);
+}
+
+void redis_parser::reply_zset_range(message_entry &entry,
+                                    const std::vector<::dsn::apps::key_value> &kvs,
+                                    int64_t offset,
+                                    bool with_scores)
+{
+    size_t first = std::min(static_cast<size_t>(offset), kvs.size());
+    size_t step = with_scores ? 2 : 1;
+    redis_array result;
+    result.resize((kvs.size() - first) * step);
+    for (size_t i = first; i < kvs.size(); ++i) {
+        // kZsetScorePrefix + encoded score + member
+        const ::dsn::blob &sort_key = kvs[i].key;
+        size_t member_offset = kZsetScorePrefix.size() + kZsetScoreLength;
+        if (sort_key.length() < member_offset) {
+            simple_error_reply(entry, "invalid score entry of sorted set");
+            return;
+        }
+        size_t index = (i - first) * step;
+        result.array[index] = std::make_shared<redis_bulk_string>(
+            sort_key.range(member_offset, sort_key.length() - member_offset));
+        if (with_scores) {
+            double score = decode_zset_score(sort_key.data() + kZsetScorePrefix.size());
+            result.array[index + 1] =
+                std::make_shared<redis_bulk_string>(format_zset_score(score));
+        }
+    }
+    reply_message(entry, result);
+}
+
+void redis_parser::parse_set_parameters(const std::vector<redis_bulk_string> &opts,
+                                        int &ttl_seconds)
+{
+    // [EX seconds]
+    ttl_seconds = 0;
+    for (int i = 3; i < opts.size(); ++i) {
+        const std::string &opt = opts[i].data.to_string();
+        if (strcasecmp(opt.c_str(), "EX") == 0 && i + 1 < opts.size()) {
+            const std::string &str_ttl_seconds = opts[i + 1].data.to_string();
+            if (!dsn::buf2int32(str_ttl_seconds, ttl_seconds)) {
+                dwarn_f("'EX {}' option is error, use {}", str_ttl_seconds, ttl_seconds);
+            }
+        } else {
+            dwarn_f("only 'EX' option is supported");
+        }
+    }
+}
+
+void redis_parser::parse_geo_radius_parameters(const std::vector<redis_bulk_string> &opts,
+                                               int base_index,
+                                               double &radius_m,
+                                               std::string &unit,
+                                               geo::geo_client::SortType &sort_type,
+                                               int &count,
+                                               bool &WITHCOORD,
+                                               bool &WITHDIST,
+                                               bool &WITHHASH)
+{
+    // radius
+    if (base_index >= opts.size()) {
+        return;
+    }
+    const std::string &str_radius = opts[base_index++].data.to_string();
+    if (!dsn::buf2double(str_radius, radius_m)) {
+        dwarn_f("radius parameter '{}' is error, use {}", str_radius, radius_m);
+    }
+
+    // m|km|ft|mi
+    if (base_index >= opts.size()) {
+        return;
+    }
+    unit = opts[base_index++].data.to_string();
+    if (unit == "km") {
+        radius_m *= 1000;
+    } else if (unit == "mi") {
+        radius_m *= 1609.344;
+    } else if (unit == "ft") {
+        radius_m *= 0.3048;
+    } else {
+        // keep as meter unit
+        unit = "m";
+        base_index--;
+    }
+
+    // [WITHCOORD] [WITHDIST] [WITHHASH] [COUNT count] [ASC|DESC]
+    while (base_index < opts.size()) {
+        const std::string &opt = opts[base_index].data.to_string();
+        if (strcasecmp(opt.c_str(), "WITHCOORD") == 0) {
+            WITHCOORD = true;
+        } else if (strcasecmp(opt.c_str(), "WITHDIST") == 0) {
+            WITHDIST = true;
+        } else if (strcasecmp(opt.c_str(), "WITHHASH") == 0) {
+            WITHHASH = true;
+        } else if (strcasecmp(opt.c_str(), "COUNT") == 0 && base_index + 1 < opts.size()) {
+            const std::string &str_count = opts[base_index + 1].data.to_string();
+            if (!dsn::buf2int32(str_count, count)) {
+                derror_f("'COUNT {}' option is error, use {}", str_count, count);
+            }
+        } else if (strcasecmp(opt.c_str(), "ASC") == 0) {
+            sort_type = geo::geo_client::SortType::asc;
+        } else if (strcasecmp(opt.c_str(), "DESC") == 0) {
+            sort_type = geo::geo_client::SortType::desc;
+        }
+        base_index++;
+    }
+}
+
+void redis_parser::process_geo_radius_result(message_entry &entry,
+                                             const std::string &unit,
+                                             bool WITHCOORD,
+                                             bool WITHDIST,
+                                             bool WITHHASH,
+                                             int ec,
+                                             std::list<geo::SearchResult> &&results)
+{
+    if (_is_session_reset.load(std::memory_order_acquire)) {
+        ddebug("%s: setex command seqid(%" PRId64 ") got reply, but session has reset",
+               _remote_address.to_string(),
+               entry.sequence_id);
+        return;
+    }
+
+    if (PERR_OK != ec) {
+        simple_error_reply(entry, _geo_client->get_error_string(ec));
+    } else {
+        redis_array result;
+        result.resize(results.size());
+        size_t i = 0;
+        for (const auto &elem : results) {
+            std::shared_ptr<redis_base_type> key =
+                std::make_shared<redis_bulk_string>(elem.hash_key); // hash_key => member
+            if (!WITHCOORD && !WITHDIST && !WITHHASH) {
+                // only member
+                result.array[i++] = key;
+            } else {
+                // member and some WITH* parameters
+                std::shared_ptr<redis_array> sub_array = std::make_shared<redis_array>();
+
+                // member
+                sub_array->resize(1 + (WITHDIST ? 1 : 0) + (WITHCOORD ? 1 : 0) +
+                                  (WITHHASH ? 1 : 0));
+                size_t index = 0;
+                sub_array->array[index++] = key;
+
+                // NOTE: the order of WITH* parameters should not be changed for the redis
+                // protocol
+                if (WITHDIST) {
+                    // with distance
+                    double distance = elem.distance;
+                    if (unit == "km") {
+                        distance /= 1000;
+                    } else if (unit == "mi") {
+                        distance /= 1609.344;
+                    } else if (unit == "ft") {
+                        distance /= 0.3048;
+                    } else {
+                        // keep as meter unit
+                    }
+                    sub_array->array[index++] = construct_bulk_string(distance);
+                }
+                if (WITHCOORD) {
+                    // with coordinate
+                    std::shared_ptr<redis_array> coordinate = std::make_shared<redis_array>();
+                    coordinate->resize(2);
+                    coordinate->array[0] = construct_bulk_string(elem.lng_degrees);
+                    coordinate->array[1] = construct_bulk_string(elem.lat_degrees);
+
+                    sub_array->array[index++] = coordinate;
+                }
+                if (WITHHASH) {
+                    // with origin value
+                    sub_array->array[index++] = std::make_shared<redis_bulk_string>(elem.value);
+                }
+                result.array[i++] = sub_array;
+            }
+        }
+        reply_message(entry, result);
+    }
+}
+
+// command format:
+// GEOADD key longitude latitude member [longitude latitude member ...]
+void redis_parser::geo_add(message_entry &entry)
+{
+    if (!_geo_client) {
+        return simple_error_reply(entry, "redis proxy is not on GEO mode");
+    }
+
+    redis_request &redis_request = entry.request;
+    if (redis_request.sub_requests.size() < 5 || (redis_request.sub_requests.size() - 2) % 3 != 0) {
+        simple_error_reply(entry, "wrong number of arguments for 'geoadd' command");
+        return;
+    }
+
+    int member_count = (redis_request.sub_requests.size() - 2) / 3;
+    std::shared_ptr<proxy_session> ref_this = shared_from_this();
+    std::shared_ptr<std::atomic<int32_t>> set_count =
+        std::make_shared<std::atomic<int32_t>>(member_count);
     std::shared_ptr<redis_integer> result(new redis_integer());
     auto set_latlng_callback = [ref_this, this, &entry, result, set_count](
         int error_code, pegasus_client::internal_info &&info) {
@@ -1332,6 +3790,18 @@ void redis_parser::handle_command(std::unique_ptr<message_entry> &&entry)
             request.sub_request_count);
     ::dsn::blob &command = request.sub_requests[0].data;
     redis_call_handler handler = redis_parser::get_handler(command.data(), command.length());
+    std::string batch_key;
+    if (get_read_batch_key(handler, request, batch_key)) {
+        auto iter = _read_batch_index.find(batch_key);
+        if (iter == _read_batch_index.end()) {
+            _read_batch_index.emplace(std::move(batch_key), _read_batches.size());
+            _read_batches.push_back(read_batch{handler == redis_parser::g_hget, {&e}});
+        } else {
+            _read_batches[iter->second].entries.push_back(&e);
+        }
+        return;
+    }
+    flush_read_batches();
     handler(this, e);
 }
 
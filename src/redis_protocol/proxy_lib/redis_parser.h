@@ -22,12 +22,15 @@
 #include <queue>
 #include <deque>
 #include <list>
+#include <dsn/utility/string_view.h>
 #include "proxy_layer.h"
 #include "geo/lib/geo_client.h"
 
 namespace dsn {
 namespace apps {
 class rrdb_client;
+class key_value;
+class multi_get_request;
 }
 }
 
@@ -36,6 +39,9 @@ class proxy_test;
 namespace pegasus {
 namespace proxy {
 
+class near_cache;
+class scan_cursor_table;
+
 // http://redis.io/topics/protocol
 class redis_parser : public proxy_session
 {
@@ -135,7 +141,11 @@ private:
     redis_bulk_string _current_str;
     std::unique_ptr<message_entry> _current_msg;
     parser_status _status;
-    std::string _current_size;
+    // the size is accumulated digit by digit, so it's parsed without allocation even if it's
+    // split over the receive buffers
+    int64_t _current_size;
+    int _current_size_digits;
+    bool _current_size_negative;
 
     // data stream content
     std::queue<dsn::message_ex *> _recv_buffers;
@@ -143,11 +153,16 @@ private:
     char *_current_buffer;
     size_t _current_buffer_length;
     size_t _current_cursor;
+    // the blob which holds _current_buffer, so that the bulk strings in the buffer can reference
+    // it without copying. it's empty if the blob is not found
+    ::dsn::blob _current_blob;
     // ]
 
     // for rrdb
     std::unique_ptr<::dsn::apps::rrdb_client> client;
     std::unique_ptr<geo::geo_client> _geo_client;
+    // for SCAN, which is served by the unordered scanners, it's shared by all the sessions
+    pegasus_client *_scan_client;
 
 protected:
     // function for data stream
@@ -159,6 +174,8 @@ protected:
     void reset_parser();
 
     // function for parser
+    bool append_size(const char *digits, size_t length);
+    bool end_size(int32_t &size);
     bool end_array_size();
     bool end_bulk_string_size();
     void append_current_bulk_string();
@@ -186,6 +203,27 @@ protected:
     DECLARE_REDIS_HANDLER(incr_by)
     DECLARE_REDIS_HANDLER(decr)
     DECLARE_REDIS_HANDLER(decr_by)
+    DECLARE_REDIS_HANDLER(mget)
+    DECLARE_REDIS_HANDLER(mset)
+    DECLARE_REDIS_HANDLER(exists)
+    DECLARE_REDIS_HANDLER(unlink)
+    DECLARE_REDIS_HANDLER(hset)
+    DECLARE_REDIS_HANDLER(hmset)
+    DECLARE_REDIS_HANDLER(hget)
+    DECLARE_REDIS_HANDLER(hmget)
+    DECLARE_REDIS_HANDLER(hgetall)
+    DECLARE_REDIS_HANDLER(hdel)
+    DECLARE_REDIS_HANDLER(hlen)
+    DECLARE_REDIS_HANDLER(hscan)
+    DECLARE_REDIS_HANDLER(scan)
+    DECLARE_REDIS_HANDLER(zadd)
+    DECLARE_REDIS_HANDLER(zrem)
+    DECLARE_REDIS_HANDLER(zscore)
+    DECLARE_REDIS_HANDLER(zcard)
+    DECLARE_REDIS_HANDLER(zrange)
+    DECLARE_REDIS_HANDLER(zrevrange)
+    DECLARE_REDIS_HANDLER(zrangebyscore)
+    DECLARE_REDIS_HANDLER(zrevrangebyscore)
     DECLARE_REDIS_HANDLER(default_handler)
 
     void set_internal(message_entry &entry);
@@ -193,6 +231,135 @@ protected:
     void del_internal(message_entry &entry);
     void del_geo_internal(message_entry &entry);
     void counter_internal(message_entry &entry);
+
+    // sharded counters, see base/pegasus_sharded_counter.h
+    typedef std::function<void(const std::string & /*error*/, bool /*found*/, int64_t /*sum*/)>
+        sharded_counter_callback;
+    static bool is_sharded_counter_key(const ::dsn::blob &key);
+    // read all the shards of the counter `key` in parallel, `callback` is invoked with the sum of
+    // the shards once all of them are replied, or with a non-empty error if any read fails
+    void get_sharded_counter(const ::dsn::blob &key, sharded_counter_callback &&callback);
+
+    // the near cache of the values read by GET, see near_cache.h. nullptr is returned if `key`
+    // is not cached. The writes through the proxy invalidate the key before they're sent and
+    // after they're replied
+    static near_cache *near_cache_of(const ::dsn::blob &key);
+    static void invalidate_near_cache(const ::dsn::blob &key);
+
+    // multi-key commands, each distinct key is requested once, and all the requests are issued
+    // concurrently
+    void del_keys(message_entry &entry);
+
+    // the string value, the fields of a hash and the entries of a sorted set of a key are all
+    // stored under the hash key of the key, so the commands on the key itself (DEL, UNLINK and
+    // EXISTS) operate on all the sort keys of the hash key. A hash or a sorted set also has the
+    // type marker sort key, so DEL and UNLINK remove a key without it, i.e. a string, by a single
+    // check_and_mutate, and only read and remove the whole range of the sort keys if the marker
+    // exists. `existed` tells whether the key has a value of any type
+    typedef std::function<void(const std::string & /*error*/, bool /*existed*/)> key_callback;
+    void check_key_exists(const ::dsn::blob &key, key_callback &&callback);
+    void remove_key(const ::dsn::blob &key, key_callback &&callback);
+    // remove all the sort keys of the hash key `key` by ranged multi_get and multi_remove
+    void remove_sort_keys(const ::dsn::blob &key, key_callback &&callback);
+    // remove all the shards of the sharded counter `key`
+    void remove_sharded_counter(const ::dsn::blob &key, key_callback &&callback);
+    // group the keys in the arguments of a multi-key command by the keys, the argument indexes
+    // of each distinct key are returned in the order of their first appearance. `step` is the
+    // distance between the keys in the arguments, e.g. 2 for 'MSET key value [key value ...]',
+    // and `first` is the index of the first key in the arguments
+    static std::vector<std::vector<size_t>>
+    group_keys(const redis_request &request, size_t step, size_t first = 1);
+
+    // ranged multi_get on the sort keys of a hash key
+    typedef std::function<void(const std::string & /*error*/,
+                               std::vector<::dsn::apps::key_value> && /*kvs*/,
+                               bool /*complete*/)>
+        range_callback;
+    // read the range of `req` page by page, until the range is complete or `limit` kvs are read
+    // (<= 0 means no limit). The kvs are returned in the order of the iteration, that is
+    // descending by sort key if `req.reverse` is set, and `complete` is false if there may be
+    // more kvs after the last one returned
+    void get_range(::dsn::apps::multi_get_request &&req, int64_t limit, range_callback &&callback);
+    void get_range_page(std::shared_ptr<::dsn::apps::multi_get_request> req,
+                        int64_t limit,
+                        std::shared_ptr<std::vector<::dsn::apps::key_value>> result,
+                        std::shared_ptr<range_callback> callback);
+
+    // hash commands, the key of a hash is mapped to the hash key, and each field is mapped to a
+    // sort key, so all the fields of a hash are in the same partition and can be operated in a
+    // single request. The empty sort key holds the string value of the key, and "\0" is the type
+    // marker written along with the fields, so neither of them is supported as a field, and
+    // they're skipped when the fields are scanned.
+    void hset_internal(message_entry &entry, bool reply_count);
+    // the cursors of HSCAN and SCAN are 64-bit integers as the clients expect, and the positions
+    // they continue from are kept in a scan_cursor_table shared by all the sessions, see
+    // scan_cursor_table.h. "0" means starting from or arriving at the end, and an unknown cursor
+    // is refused
+    static scan_cursor_table *scan_cursors();
+    static std::string save_scan_cursor(dsn::string_view owner, std::string position);
+    static bool
+    load_scan_cursor(const std::string &cursor, dsn::string_view owner, std::string &position);
+    // only the glob patterns which can be mapped to the sort key filters are supported, that is
+    // '*', 'abc*', '*abc' and '*abc*', where 'abc' contains no special characters
+    static bool parse_hscan_pattern(const std::string &pattern,
+                                    pegasus_client::filter_type &filter_type,
+                                    std::string &filter_pattern);
+
+    // SCAN iterates all the partitions by a single unordered scanner, and the resume token of
+    // the scanner is kept as the position of the cursor. The MATCH pattern, which is parsed by
+    // parse_hscan_pattern, is pushed down as the hash key filter, so the keys not matched never
+    // leave the replicas. COUNT bounds the records examined by a SCAN, each sort key of a hash or
+    // a sorted set is a record, so the keys replied may be fewer than COUNT. NOTE: the replicas
+    // skip the keys not matched without replying, so a SCAN whose pattern matches few keys may
+    // take long to reply.
+    struct scan_context
+    {
+        std::shared_ptr<pegasus_client::pegasus_scanner> scanner;
+        int32_t count;
+        // the number of the records examined
+        int32_t record_count;
+        // the distinct keys of the records examined
+        std::vector<std::string> keys;
+    };
+    void scan_next(message_entry &entry, std::shared_ptr<scan_context> context);
+
+    // sorted sets, a sorted set is stored under the hash key of its key, and each member has two
+    // sort keys:
+    //   - the score entry: kZsetScorePrefix + encoded score + member => ""
+    //   - the member entry: kZsetMemberPrefix + member => encoded score
+    // the encoding of the score is order-preserving, so the score entries are ordered by
+    // (score, member), and a range by score or by rank is a single ranged multi_get. Both the
+    // entries of a member are updated atomically by a check_and_mutate on the member entry,
+    // which also writes the type marker.
+    typedef std::function<void(const std::string & /*error*/, bool /*existed*/)>
+        zset_update_callback;
+    typedef std::function<void(const std::string & /*error*/, int64_t /*card*/)>
+        zset_card_callback;
+    // add `member` with `score` to the sorted set `key`, or remove it if `remove` is true.
+    // `existed` tells whether the member existed before
+    void update_zset_member(const ::dsn::blob &key,
+                            const std::string &member,
+                            double score,
+                            bool remove,
+                            int retries,
+                            zset_update_callback &&callback);
+    void update_zset_members(message_entry &entry, bool remove);
+    void get_zset_card(const ::dsn::blob &key, zset_card_callback &&callback);
+    void zrange_by_rank(message_entry &entry, bool reverse);
+    void zrange_by_score(message_entry &entry, bool reverse);
+    // reply the members in the score entries `kvs` except the first `offset` ones
+    void reply_zset_range(message_entry &entry,
+                          const std::vector<::dsn::apps::key_value> &kvs,
+                          int64_t offset,
+                          bool with_scores);
+    // map a double to an unsigned integer in the same order, and encode it in 8 bytes which
+    // compare the same as the integer
+    static uint64_t zset_score_order(double score);
+    static std::string encode_zset_score(uint64_t order);
+    static double decode_zset_score(const char *data);
+    static bool parse_zset_score(const std::string &str, double &score);
+    static std::string format_zset_score(double score);
+
     static void parse_set_parameters(const std::vector<redis_bulk_string> &opts, int &ttl_seconds);
     static void parse_geo_radius_parameters(const std::vector<redis_bulk_string> &opts,
                                             int base_index,
@@ -239,10 +406,40 @@ protected:
     void simple_integer_reply(message_entry &entry, int64_t value);
 
     typedef void (*redis_call_handler)(redis_parser *, message_entry &);
-    static std::unordered_map<std::string, redis_call_handler> s_dispatcher;
+    struct redis_command
+    {
+        const char *name; // in upper case
+        unsigned int length;
+        redis_call_handler handler;
+    };
+    // the commands are matched by the length first, and then compared case-insensitively, so
+    // no allocation or hashing is needed to dispatch a command
+    static const redis_command s_dispatcher[];
+    static const size_t s_dispatcher_size;
     static redis_call_handler get_handler(const char *command, unsigned int length);
     static std::atomic_llong s_next_seqid;
 
+    // the pipelined reads are coalesced: the consecutive GETs and HGETs parsed from one message
+    // are grouped by the key, and the reads of the same key are served by one rpc, a get for
+    // GET and a multi_get of the distinct fields for HGET. The batches are flushed before any
+    // other command is handled and at the end of parse(), so the order of the reads and the
+    // writes in a pipeline is kept, and no latency is added
+    struct read_batch
+    {
+        bool is_hget;
+        std::vector<message_entry *> entries;
+    };
+    // returns false if the command can't be batched, otherwise `batch_key` is the key by which
+    // the command is grouped
+    static bool get_read_batch_key(redis_call_handler handler,
+                                   const redis_request &request,
+                                   std::string &batch_key);
+    void flush_read_batches();
+    void get_batch(std::shared_ptr<std::vector<message_entry *>> entries);
+    void hget_batch(std::shared_ptr<std::vector<message_entry *>> entries);
+    std::vector<read_batch> _read_batches;
+    std::unordered_map<std::string, size_t> _read_batch_index; // batch key => index of batch
+
     static const char CR;
     static const char LF;
 
@@ -0,0 +1,72 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "scan_cursor_table.h"
+
+#include <algorithm>
+#include <dsn/c/api_layer1.h>
+#include <dsn/utility/rand.h>
+
+namespace pegasus {
+namespace proxy {
+
+scan_cursor_table::scan_cursor_table(uint32_t max_count, uint64_t ttl_ms)
+    : _max_count(std::max(max_count, 1U)),
+      _ttl_ms(ttl_ms),
+      // leave enough cursors above the base, so they never wrap around to 0
+      _next_cursor(dsn::rand::next_u64(1, UINT64_MAX >> 1))
+{
+}
+
+uint64_t scan_cursor_table::add(dsn::string_view owner, std::string position)
+{
+    uint64_t now_ms = dsn_now_ms();
+    std::lock_guard<std::mutex> l(_lock);
+    while (!_entries.empty() &&
+           (_entries.size() >= _max_count || _entries.begin()->second.expire_ms <= now_ms)) {
+        _entries.erase(_entries.begin());
+    }
+    uint64_t cursor = _next_cursor++;
+    entry &e = _entries[cursor];
+    e.owner.assign(owner.data(), owner.size());
+    e.position = std::move(position);
+    e.expire_ms = now_ms + _ttl_ms;
+    return cursor;
+}
+
+bool scan_cursor_table::get(uint64_t cursor, dsn::string_view owner, /*out*/ std::string &position)
+{
+    std::lock_guard<std::mutex> l(_lock);
+    auto iter = _entries.find(cursor);
+    if (iter == _entries.end() || iter->second.expire_ms <= dsn_now_ms() ||
+        dsn::string_view(iter->second.owner) != owner) {
+        return false;
+    }
+    position = iter->second.position;
+    return true;
+}
+
+size_t scan_cursor_table::count() const
+{
+    std::lock_guard<std::mutex> l(_lock);
+    return _entries.size();
+}
+
+} // namespace proxy
+} // namespace pegasus
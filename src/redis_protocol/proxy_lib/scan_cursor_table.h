@@ -0,0 +1,74 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <string>
+
+#include <dsn/utility/string_view.h>
+
+namespace pegasus {
+namespace proxy {
+
+// scan_cursor_table keeps the positions of the unfinished SCANs and HSCANs in the proxy, so that
+// the cursor replied to the client is an opaque 64-bit integer, which is what the redis clients
+// parse it as.
+//
+// - A cursor is bound to the `owner` it's added for, e.g. the key of an HSCAN, and it's refused
+//   if it's continued by another owner.
+// - A cursor can be continued more than once, e.g. when the client retries, until it expires
+//   after `ttl_ms` or it's evicted as the oldest one by the `max_count` limit.
+// - The cursors are allocated from a random base per process, so a cursor of another proxy or of
+//   a restarted one is unknown rather than pointing to some other scan.
+class scan_cursor_table
+{
+public:
+    scan_cursor_table(uint32_t max_count, uint64_t ttl_ms);
+
+    // Saves the `position` of a scan of `owner`, returns the cursor to continue it, which is
+    // never 0.
+    uint64_t add(dsn::string_view owner, std::string position);
+
+    // Gets the position saved for `cursor`, returns false if the cursor is unknown, expired, or
+    // not added for `owner`.
+    bool get(uint64_t cursor, dsn::string_view owner, /*out*/ std::string &position);
+
+    size_t count() const;
+
+private:
+    struct entry
+    {
+        std::string owner;
+        std::string position;
+        uint64_t expire_ms;
+    };
+
+    const uint32_t _max_count;
+    const uint64_t _ttl_ms;
+
+    mutable std::mutex _lock; // protects all the members below
+    uint64_t _next_cursor;
+    // the cursors are increasing, so the oldest entry is always the first one
+    std::map<uint64_t, entry> _entries;
+};
+
+} // namespace proxy
+} // namespace pegasus
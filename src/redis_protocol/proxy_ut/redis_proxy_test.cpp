@@ -18,8 +18,10 @@
  */
 
 #include <algorithm>
+#include <limits>
 #include <memory>
 #include <string>
+#include <thread>
 #include <boost/asio.hpp>
 
 #include <dsn/utility/string_conv.h>
@@ -28,8 +30,10 @@
 #include <gtest/gtest.h>
 #include <rrdb/rrdb.client.h>
 #include <pegasus_utils.h>
+#include "near_cache.h"
 #include "proxy_layer.h"
 #include "redis_parser.h"
+#include "scan_cursor_table.h"
 
 using namespace boost::asio;
 using namespace ::pegasus::proxy;
@@ -147,6 +151,12 @@ private:
     FRIEND_TEST(proxy_test, test_nil_bulk_string);
     FRIEND_TEST(proxy_test, test_random_cases);
     FRIEND_TEST(proxy_test, test_parse_parameters);
+    FRIEND_TEST(proxy_test, test_group_keys);
+    FRIEND_TEST(proxy_test, test_get_handler);
+    FRIEND_TEST(proxy_test, test_scan_cursor);
+    FRIEND_TEST(proxy_test, test_hscan_pattern);
+    FRIEND_TEST(proxy_test, test_zset_score);
+    FRIEND_TEST(proxy_test, test_read_batch_key);
 
     std::vector<std::unique_ptr<message_entry>> _reserved_entry;
     int _entry_index;
@@ -247,6 +257,10 @@ TEST_F(proxy_test, test_error_message)
                               "*1\r\n$12\rtest_command\r\n",
                               "*2\r\n$3\r\nget\r\n*6\r\nkeykey\r\n",
                               "*2\r\n$3\r\nget\r\n$6\rkeykey\r\n",
+                              "*\r\n$1\r\nt\r\n",
+                              "*12345678901\r\n$1\r\nt\r\n",
+                              "*1\r\n$1-\r\nt\r\n",
+                              "*1\r\n$--1\r\n",
                               nullptr};
 
     for (unsigned int i = 0; bad_data[i]; ++i) {
@@ -613,6 +627,332 @@ void dsn_init()
     dsn_run_config("config.ini", false);
 }
 
+TEST_F(proxy_test, test_group_keys)
+{
+    {
+        redis_test_parser::redis_request request(
+            5, {{"MGET"}, {"foo"}, {"bar"}, {"foo"}, {"baz"}});
+        auto groups = redis_test_parser::group_keys(request, 1);
+        ASSERT_EQ(3, groups.size());
+        ASSERT_EQ(std::vector<size_t>({1, 3}), groups[0]);
+        ASSERT_EQ(std::vector<size_t>({2}), groups[1]);
+        ASSERT_EQ(std::vector<size_t>({4}), groups[2]);
+    }
+
+    {
+        // the values are not grouped as keys, even if a value equals to a key
+        redis_test_parser::redis_request request(
+            7, {{"MSET"}, {"foo"}, {"bar"}, {"bar"}, {"v1"}, {"foo"}, {"v2"}});
+        auto groups = redis_test_parser::group_keys(request, 2);
+        ASSERT_EQ(2, groups.size());
+        ASSERT_EQ(std::vector<size_t>({1, 5}), groups[0]);
+        ASSERT_EQ(std::vector<size_t>({3}), groups[1]);
+    }
+}
+
+TEST_F(proxy_test, test_get_handler)
+{
+    // the names must be in upper case letters, which is assumed by the comparison
+    for (size_t i = 0; i < redis_test_parser::s_dispatcher_size; ++i) {
+        const auto &cmd = redis_test_parser::s_dispatcher[i];
+        ASSERT_EQ(strlen(cmd.name), cmd.length);
+        for (unsigned int j = 0; j < cmd.length; ++j) {
+            ASSERT_TRUE(cmd.name[j] >= 'A' && cmd.name[j] <= 'Z') << cmd.name;
+        }
+        ASSERT_EQ(cmd.handler, redis_test_parser::get_handler(cmd.name, cmd.length));
+    }
+
+    struct test_case
+    {
+        const char *command;
+        redis_test_parser::redis_call_handler handler;
+    } tests[] = {{"SET", redis_test_parser::g_set},
+                 {"set", redis_test_parser::g_set},
+                 {"sEt", redis_test_parser::g_set},
+                 {"pttl", redis_test_parser::g_ttl},
+                 {"georadiusbymember", redis_test_parser::g_geo_radius_by_member},
+                 {"GeoRadius", redis_test_parser::g_geo_radius},
+                 {"incrby", redis_test_parser::g_incr_by},
+                 {"hgetall", redis_test_parser::g_hgetall},
+                 {"HMSET", redis_test_parser::g_hmset},
+                 {"zRevRangeByScore", redis_test_parser::g_zrevrangebyscore},
+                 {"SETS", redis_test_parser::g_default_handler},
+                 {"SE", redis_test_parser::g_default_handler},
+                 {"S\x05T", redis_test_parser::g_default_handler},
+                 {"S@T", redis_test_parser::g_default_handler},
+                 {"", redis_test_parser::g_default_handler}};
+    for (const auto &test : tests) {
+        ASSERT_EQ(test.handler, redis_test_parser::get_handler(test.command, strlen(test.command)))
+            << test.command;
+    }
+}
+
+TEST_F(proxy_test, test_scan_cursor)
+{
+    std::string position;
+    ASSERT_TRUE(redis_test_parser::load_scan_cursor("0", "key", position));
+    ASSERT_TRUE(position.empty());
+
+    // the cursor is a 64-bit integer whatever the position is, and it can be continued more
+    // than once, but only for the same key
+    std::string positions[] = {
+        "a", std::string("\0\xff\n", 3), std::string(1000, 'x'), "1|0|1|1|0|||7,6,5|4|6b6579"};
+    uint64_t last_id = 0;
+    for (const std::string &p : positions) {
+        std::string cursor = redis_test_parser::save_scan_cursor("key", p);
+        ASSERT_TRUE(dsn::buf2uint64(cursor, last_id)) << cursor;
+        ASSERT_NE(0, last_id);
+        for (int i = 0; i < 2; ++i) {
+            ASSERT_TRUE(redis_test_parser::load_scan_cursor(cursor, "key", position));
+            ASSERT_EQ(p, position);
+        }
+        ASSERT_FALSE(redis_test_parser::load_scan_cursor(cursor, "other", position));
+        ASSERT_FALSE(redis_test_parser::load_scan_cursor(cursor, dsn::string_view(), position));
+    }
+
+    std::string invalid_cursors[] = {"",
+                                     "00",
+                                     "-1",
+                                     "1a",
+                                     "18446744073709551616",
+                                     std::to_string(last_id + 1)};
+    for (const std::string &cursor : invalid_cursors) {
+        ASSERT_FALSE(redis_test_parser::load_scan_cursor(cursor, "key", position)) << cursor;
+    }
+}
+
+TEST_F(proxy_test, test_scan_cursor_table)
+{
+    std::string position;
+    {
+        // the oldest cursors are refused once there're more than the max count
+        scan_cursor_table table(2, 60000);
+        uint64_t cursors[] = {table.add("", "1"), table.add("", "2"), table.add("", "3")};
+        ASSERT_EQ(2, table.count());
+        ASSERT_FALSE(table.get(cursors[0], "", position));
+        ASSERT_TRUE(table.get(cursors[1], "", position));
+        ASSERT_EQ("2", position);
+        ASSERT_TRUE(table.get(cursors[2], "", position));
+        ASSERT_EQ("3", position);
+    }
+    {
+        // the cursors expire after the ttl
+        scan_cursor_table table(100, 1);
+        uint64_t cursor = table.add("", "1");
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        ASSERT_FALSE(table.get(cursor, "", position));
+        table.add("", "2");
+        ASSERT_EQ(1, table.count());
+    }
+}
+
+TEST_F(proxy_test, test_hscan_pattern)
+{
+    struct test_case
+    {
+        std::string pattern;
+        bool valid;
+        pegasus::pegasus_client::filter_type filter_type;
+        std::string filter_pattern;
+    } tests[] = {{"*", true, pegasus::pegasus_client::FT_NO_FILTER, ""},
+                 {"abc*", true, pegasus::pegasus_client::FT_MATCH_PREFIX, "abc"},
+                 {"*abc", true, pegasus::pegasus_client::FT_MATCH_POSTFIX, "abc"},
+                 {"*abc*", true, pegasus::pegasus_client::FT_MATCH_ANYWHERE, "abc"},
+                 {"abc", false},
+                 {"", false},
+                 {"**", false},
+                 {"a*c", false},
+                 {"a?c*", false},
+                 {"*[ab]", false},
+                 {"a\\*", false}};
+    for (const auto &test : tests) {
+        pegasus::pegasus_client::filter_type filter_type;
+        std::string filter_pattern;
+        ASSERT_EQ(test.valid,
+                  redis_test_parser::parse_hscan_pattern(test.pattern, filter_type, filter_pattern))
+            << test.pattern;
+        if (test.valid) {
+            ASSERT_EQ(test.filter_type, filter_type);
+            ASSERT_EQ(test.filter_pattern, filter_pattern);
+        }
+    }
+}
+
+TEST_F(proxy_test, test_zset_score)
+{
+    // the encoded scores are in the same order as the scores
+    double scores[] = {-std::numeric_limits<double>::infinity(),
+                       -std::numeric_limits<double>::max(),
+                       -1e10,
+                       -1.5,
+                       -std::numeric_limits<double>::denorm_min(),
+                       0,
+                       std::numeric_limits<double>::denorm_min(),
+                       1e-300,
+                       1,
+                       1.5,
+                       1e10,
+                       std::numeric_limits<double>::max(),
+                       std::numeric_limits<double>::infinity()};
+    std::string last;
+    for (double score : scores) {
+        std::string encoded =
+            redis_test_parser::encode_zset_score(redis_test_parser::zset_score_order(score));
+        ASSERT_EQ(8u, encoded.size());
+        ASSERT_LT(last, encoded) << score;
+        ASSERT_EQ(score, redis_test_parser::decode_zset_score(encoded.data()));
+        last = encoded;
+    }
+    // -0.0 is the same as 0.0
+    ASSERT_EQ(redis_test_parser::zset_score_order(0.0),
+              redis_test_parser::zset_score_order(-0.0));
+
+    struct test_case
+    {
+        std::string str;
+        bool valid;
+        double score;
+    } tests[] = {{"1", true, 1},
+                 {"-2.5", true, -2.5},
+                 {"1e3", true, 1000},
+                 {"inf", true, std::numeric_limits<double>::infinity()},
+                 {"+INF", true, std::numeric_limits<double>::infinity()},
+                 {"-inf", true, -std::numeric_limits<double>::infinity()},
+                 {"nan", false, 0},
+                 {"", false, 0},
+                 {"1x", false, 0}};
+    for (const auto &test : tests) {
+        double score = 0;
+        ASSERT_EQ(test.valid, redis_test_parser::parse_zset_score(test.str, score)) << test.str;
+        if (test.valid) {
+            ASSERT_EQ(test.score, score) << test.str;
+        }
+    }
+
+    ASSERT_EQ("1.5", redis_test_parser::format_zset_score(1.5));
+    ASSERT_EQ("-3", redis_test_parser::format_zset_score(-3));
+    ASSERT_EQ("inf", redis_test_parser::format_zset_score(std::numeric_limits<double>::infinity()));
+}
+
+TEST_F(proxy_test, test_near_cache)
+{
+    using pegasus::proxy::near_cache;
+    auto value = dsn::blob::create_from_bytes(std::string("value"));
+    bool found = false;
+    dsn::blob cached;
+    {
+        near_cache cache(1 << 20, 1000, 60000);
+
+        // a key is admitted when it's missed again
+        ASSERT_FALSE(cache.get("key", found, cached));
+        cache.put("key", true, value, cache.generation("key"));
+        ASSERT_FALSE(cache.get("key", found, cached));
+        cache.put("key", true, value, cache.generation("key"));
+        ASSERT_TRUE(cache.get("key", found, cached));
+        ASSERT_TRUE(found);
+        ASSERT_EQ("value", cached.to_string());
+        ASSERT_EQ(1, cache.entry_count());
+        ASSERT_LT(0, cache.memory_bytes());
+
+        // the keys not existing are cached too
+        cache.put("none", false, dsn::blob(), cache.generation("none"));
+        cache.put("none", false, dsn::blob(), cache.generation("none"));
+        ASSERT_TRUE(cache.get("none", found, cached));
+        ASSERT_FALSE(found);
+
+        // the values read before an invalidation are refused
+        uint64_t generation = cache.generation("key");
+        cache.invalidate("key");
+        ASSERT_FALSE(cache.get("key", found, cached));
+        cache.put("key", true, value, generation);
+        cache.put("key", true, value, generation);
+        ASSERT_FALSE(cache.get("key", found, cached));
+        cache.put("key", true, value, cache.generation("key"));
+        cache.put("key", true, value, cache.generation("key"));
+        ASSERT_TRUE(cache.get("key", found, cached));
+
+        cache.invalidate("key");
+        cache.invalidate("none");
+        ASSERT_EQ(0, cache.entry_count());
+        ASSERT_EQ(0, cache.memory_bytes());
+    }
+    {
+        // the entries expire after the ttl
+        near_cache cache(1 << 20, 1000, 1);
+        cache.put("key", true, value, cache.generation("key"));
+        cache.put("key", true, value, cache.generation("key"));
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        ASSERT_FALSE(cache.get("key", found, cached));
+        ASSERT_EQ(0, cache.entry_count());
+    }
+    {
+        // bounded by the number of entries, which is split into 16 shards
+        near_cache cache(1 << 20, 32, 60000);
+        for (int i = 0; i < 1000; ++i) {
+            std::string key = "key_" + std::to_string(i);
+            cache.put(key, true, value, cache.generation(key));
+            cache.put(key, true, value, cache.generation(key));
+            ASSERT_TRUE(cache.get(key, found, cached)) << key;
+        }
+        ASSERT_GE(32, cache.entry_count());
+    }
+    {
+        // bounded by the memory
+        near_cache cache(16 * 1024, 1000, 60000);
+        auto big_value = dsn::blob::create_from_bytes(std::string(600, 'v'));
+        for (int i = 0; i < 1000; ++i) {
+            std::string key = "key_" + std::to_string(i);
+            cache.put(key, true, big_value, cache.generation(key));
+            cache.put(key, true, big_value, cache.generation(key));
+        }
+        ASSERT_GE(16 * 1024, cache.memory_bytes());
+        ASSERT_LT(0, cache.entry_count());
+
+        // the values larger than a shard are never cached
+        auto huge_value = dsn::blob::create_from_bytes(std::string(2048, 'v'));
+        cache.put("huge", true, huge_value, cache.generation("huge"));
+        cache.put("huge", true, huge_value, cache.generation("huge"));
+        ASSERT_FALSE(cache.get("huge", found, cached));
+    }
+}
+
+TEST_F(proxy_test, test_read_batch_key)
+{
+    struct test_case
+    {
+        std::vector<std::string> command;
+        bool batched;
+        std::string batch_key;
+    } tests[] = {{{"GET", "key"}, true, "gkey"},
+                 {{"get", std::string("k\0y", 3)}, true, std::string("gk\0y", 4)},
+                 {{"GET", "key", "extra"}, false, ""},
+                 {{"HGET", "key", "field"}, true, "hkey"},
+                 {{"hget", "key", "another_field"}, true, "hkey"},
+                 {{"HGET", "", "field"}, false, ""},
+                 {{"HGET", "key", ""}, false, ""},
+                 {{"HGET", "key"}, false, ""},
+                 {{"SET", "key", "value"}, false, ""},
+                 {{"HMGET", "key", "field"}, false, ""}};
+    for (const auto &test : tests) {
+        redis_test_parser::redis_request request;
+        for (const std::string &arg : test.command) {
+            request.sub_requests.emplace_back(arg);
+        }
+        request.sub_request_count = request.sub_requests.size();
+        const ::dsn::blob &command = request.sub_requests[0].data;
+        std::string batch_key;
+        ASSERT_EQ(test.batched,
+                  redis_test_parser::get_read_batch_key(
+                      redis_test_parser::get_handler(command.data(), command.length()),
+                      request,
+                      batch_key))
+            << test.command[0];
+        if (test.batched) {
+            ASSERT_EQ(test.batch_key, batch_key);
+        }
+    }
+}
+
 GTEST_API_ int main(int argc, char **argv)
 {
     testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,148 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+// Micro benchmarks of the replica server.
+//
+// USAGE: pegasus_server_bench dup_reply <hashes> [max_threads]
+//     The DUPLICATE rpcs of `hashes` different hash keys are mocked and replied concurrently by
+//     1, 2, 4, ... up to `max_threads` threads, and the replies handled per second are measured,
+//     which shows how the in-flight rpc tracking of the mutation duplicator scales with the
+//     concurrency of replies.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dsn/cpp/message_utils.h>
+#include <dsn/cpp/pipeline.h>
+#include <dsn/dist/replication/replica_base.h>
+#include <dsn/dist/replication/replication.codes.h>
+#include <dsn/service_api_c.h>
+#include <dsn/utility/string_conv.h>
+
+#include "base/pegasus_key_schema.h"
+#include "base/pegasus_rpc_types.h"
+#include "server/pegasus_mutation_duplicator.h"
+
+namespace pegasus {
+namespace server {
+
+using namespace dsn::replication;
+
+class pegasus_mutation_duplicator_bench
+{
+public:
+    pegasus_mutation_duplicator_bench()
+    {
+        _env.thread_pool(LPC_REPLICATION_LOW).task_tracker(&_tracker);
+    }
+
+    // Replies the rpcs of `hash_count` hashes concurrently by `thread_count` threads, and
+    // returns the replies handled per second.
+    double reply_throughput(size_t hash_count, size_t thread_count)
+    {
+        replica_base replica(dsn::gpid(1, 1), "fake_replica", "temp");
+        auto duplicator = new_mutation_duplicator(&replica, "onebox2", "temp");
+        duplicator->set_task_environment(&_env);
+
+        mutation_tuple_set muts;
+        for (uint64_t i = 0; i < hash_count; i++) {
+            dsn::task_code code = dsn::apps::RPC_RRDB_RRDB_PUT;
+            dsn::apps::update_request request;
+            pegasus_generate_key(
+                request.key, std::string("hash") + std::to_string(i), std::string("sort"));
+            dsn::message_ptr msg = dsn::from_thrift_request_to_received_message(request, code);
+            muts.insert(std::make_tuple(200 + i, code, dsn::move_message_to_blob(msg.get())));
+        }
+
+        auto duplicator_impl = dynamic_cast<pegasus_mutation_duplicator *>(duplicator.get());
+        double throughput = 0;
+        RPC_MOCKING(dsn::apps::duplicate_rpc)
+        {
+            duplicator->duplicate(muts, [](size_t) {});
+            auto rpc_list = std::move(dsn::apps::duplicate_rpc::mail_box());
+
+            auto start = std::chrono::steady_clock::now();
+            std::vector<std::thread> threads;
+            for (size_t t = 0; t < thread_count; t++) {
+                threads.emplace_back([&, t]() {
+                    for (size_t i = t; i < rpc_list.size(); i += thread_count) {
+                        const auto &request = rpc_list[i].request();
+                        duplicator_impl->on_duplicate_reply(
+                            get_hash_from_request(request.task_code, request.raw_message),
+                            [](size_t) {},
+                            rpc_list[i],
+                            dsn::ERR_OK);
+                    }
+                });
+            }
+            for (auto &thread : threads) {
+                thread.join();
+            }
+            std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - start;
+            throughput = rpc_list.size() / std::max(elapsed.count() / 1e9, 1e-9);
+        }
+        _tracker.wait_outstanding_tasks();
+        return throughput;
+    }
+
+private:
+    dsn::task_tracker _tracker;
+    dsn::pipeline::environment _env;
+};
+
+} // namespace server
+} // namespace pegasus
+
+static int usage(const char *program)
+{
+    std::cerr << "USAGE: " << program << " dup_reply <hashes> [max_threads]" << std::endl;
+    return -1;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3 || std::string(argv[1]) != "dup_reply") {
+        return usage(argv[0]);
+    }
+    int hash_count = 0;
+    if (!dsn::buf2int32(argv[2], hash_count) || hash_count <= 0) {
+        std::cerr << "hashes is invalid: " << argv[2] << std::endl;
+        return -1;
+    }
+    int max_threads = 16;
+    if (argc >= 4 && (!dsn::buf2int32(argv[3], max_threads) || max_threads <= 0)) {
+        std::cerr << "max_threads is invalid: " << argv[3] << std::endl;
+        return -1;
+    }
+
+    // the duplicator needs the runtime for its perf counters, tasks and cluster configs
+    dsn_run_config("config.ini", false);
+    pegasus::server::pegasus_mutation_duplicator_bench bench;
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        double throughput = bench.reply_throughput(hash_count, threads);
+        std::cout << "dup_reply: " << hash_count << " hashes replied by " << threads
+                  << " threads, " << throughput << " replies/s" << std::endl;
+    }
+    dsn_exit(0);
+}
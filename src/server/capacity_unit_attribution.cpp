@@ -0,0 +1,220 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "capacity_unit_attribution.h"
+
+#include <algorithm>
+#include <dsn/dist/fmt_logging.h>
+#include <dsn/tool-api/rpc_message.h>
+#include <dsn/utility/flags.h>
+#include <dsn/utility/smart_pointers.h>
+
+#include "base/pegasus_utils.h"
+
+namespace pegasus {
+namespace server {
+
+DSN_DEFINE_bool("pegasus.server",
+                cu_attribution_by_client,
+                false,
+                "whether to attribute the capacity units to the ip of the clients");
+DSN_DEFINE_uint32("pegasus.server",
+                  cu_attribution_hash_key_prefix_length,
+                  0,
+                  "attribute the capacity units to the hash key prefixes of this length, 0 means "
+                  "disabled");
+DSN_DEFINE_uint32("pegasus.server",
+                  cu_attribution_max_entries,
+                  1000,
+                  "the max number of attributions tracked in a window for each dimension, the "
+                  "others are accumulated into the overflow bucket");
+DSN_DEFINE_uint32("pegasus.server",
+                  cu_attribution_report_top_n,
+                  10,
+                  "the number of attributions with most capacity units published as perf "
+                  "counters in each window for each dimension");
+DSN_TAG_VARIABLE(cu_attribution_report_top_n, FT_MUTABLE);
+
+static const char *kDimensionNames[] = {"client", "prefix"};
+// the name of the attribution which accumulates the usage of all the attributions out of top
+static const std::string kOthersAttribution = "__others__";
+
+void cu_attribution_table::add(const std::string &attribution, const cu_usage &usage)
+{
+    std::lock_guard<std::mutex> l(_lock);
+    auto iter = _usages.find(attribution);
+    if (iter != _usages.end()) {
+        iter->second.add(usage);
+    } else if (_usages.size() < _max_entries) {
+        _usages.emplace(attribution, usage);
+    } else {
+        _overflow.add(usage);
+    }
+}
+
+void cu_attribution_table::take_top(uint32_t top_n,
+                                    std::vector<std::pair<std::string, cu_usage>> &top,
+                                    cu_usage &others)
+{
+    std::unordered_map<std::string, cu_usage> usages;
+    {
+        std::lock_guard<std::mutex> l(_lock);
+        usages.swap(_usages);
+        others = _overflow;
+        _overflow = cu_usage();
+    }
+
+    top.assign(usages.begin(), usages.end());
+    auto top_end = top.begin() + std::min(static_cast<size_t>(top_n), top.size());
+    std::partial_sort(top.begin(),
+                      top_end,
+                      top.end(),
+                      [](const std::pair<std::string, cu_usage> &lhs,
+                         const std::pair<std::string, cu_usage> &rhs) {
+                          return lhs.second.total_cu() > rhs.second.total_cu();
+                      });
+    for (auto iter = top_end; iter != top.end(); ++iter) {
+        others.add(iter->second);
+    }
+    top.erase(top_end, top.end());
+}
+
+capacity_unit_attribution::capacity_unit_attribution()
+{
+    for (auto &table : _tables) {
+        table = dsn::make_unique<cu_attribution_table>(FLAGS_cu_attribution_max_entries);
+    }
+}
+
+/*static*/ bool capacity_unit_attribution::enabled()
+{
+    return FLAGS_cu_attribution_by_client || FLAGS_cu_attribution_hash_key_prefix_length > 0;
+}
+
+void capacity_unit_attribution::add(dsn::message_ex *req,
+                                    const dsn::blob *hash_key,
+                                    const cu_usage &usage)
+{
+    if (FLAGS_cu_attribution_by_client && req != nullptr) {
+        _tables[static_cast<size_t>(cu_attribution_dimension::CLIENT)]->add(
+            client_attribution(req), usage);
+    }
+    if (FLAGS_cu_attribution_hash_key_prefix_length > 0 && hash_key != nullptr) {
+        _tables[static_cast<size_t>(cu_attribution_dimension::HASH_KEY_PREFIX)]->add(
+            hash_key_prefix_attribution(*hash_key), usage);
+    }
+}
+
+/*static*/ std::string capacity_unit_attribution::client_attribution(dsn::message_ex *req)
+{
+    // The port of a client is usually ephemeral, so only the ip is used.
+    uint32_t ip = req->header->from_address.ip();
+    return fmt::format(
+        "{}.{}.{}.{}", (ip >> 24) & 0xff, (ip >> 16) & 0xff, (ip >> 8) & 0xff, ip & 0xff);
+}
+
+/*static*/ std::string
+capacity_unit_attribution::hash_key_prefix_attribution(const dsn::blob &hash_key)
+{
+    auto length = std::min(static_cast<size_t>(FLAGS_cu_attribution_hash_key_prefix_length),
+                           static_cast<size_t>(hash_key.length()));
+    return utils::c_escape_string(hash_key.range(0, length));
+}
+
+void capacity_unit_attribution::report(uint64_t window_seconds)
+{
+    std::lock_guard<std::mutex> l(_report_lock);
+    for (size_t dimension = 0; dimension < kDimensionCount; ++dimension) {
+        std::vector<std::pair<std::string, cu_usage>> top;
+        cu_usage others;
+        _tables[dimension]->take_top(FLAGS_cu_attribution_report_top_n, top, others);
+
+        std::map<std::string, cu_usage> last_window_usages(top.begin(), top.end());
+        if (!last_window_usages.empty()) {
+            last_window_usages.emplace(kOthersAttribution, others);
+        }
+
+        // remove the counters of the attributions which are not in the top any more
+        auto &counters = _counters[dimension];
+        for (auto iter = counters.begin(); iter != counters.end();) {
+            if (last_window_usages.find(iter->first) == last_window_usages.end()) {
+                iter = counters.erase(iter);
+            } else {
+                ++iter;
+            }
+        }
+        for (const auto &kv : last_window_usages) {
+            update_counters(static_cast<cu_attribution_dimension>(dimension),
+                            kv.first,
+                            kv.second,
+                            window_seconds);
+        }
+        _last_window_usages[dimension].swap(last_window_usages);
+    }
+}
+
+cu_usage capacity_unit_attribution::last_window_usage(cu_attribution_dimension dimension,
+                                                      const std::string &attribution) const
+{
+    std::lock_guard<std::mutex> l(_report_lock);
+    const auto &usages = _last_window_usages[static_cast<size_t>(dimension)];
+    auto iter = usages.find(attribution);
+    return iter == usages.end() ? cu_usage() : iter->second;
+}
+
+void capacity_unit_attribution::update_counters(cu_attribution_dimension dimension,
+                                                const std::string &attribution,
+                                                const cu_usage &usage,
+                                                uint64_t window_seconds)
+{
+    auto &counters = _counters[static_cast<size_t>(dimension)][attribution];
+    if (counters == nullptr) {
+        // The reporter splits the names of counters by '_' and ':', so they are replaced in the
+        // name of the attribution.
+        std::string name = attribution;
+        std::replace_if(name.begin(),
+                        name.end(),
+                        [](char c) { return !isalnum(static_cast<unsigned char>(c)); },
+                        '-');
+        const char *dimension_name = kDimensionNames[static_cast<size_t>(dimension)];
+        auto init_counter = [&](::dsn::perf_counter_wrapper &counter, const char *metric) {
+            counter.init_app_counter(
+                "app.pegasus",
+                fmt::format("cu_attribution.{}.{}@{}", dimension_name, metric, name).c_str(),
+                COUNTER_TYPE_NUMBER,
+                "statistic the capacity units attributed to a client or a hash key prefix");
+        };
+        counters = dsn::make_unique<attribution_counters>();
+        init_counter(counters->read_cu, "read_cu");
+        init_counter(counters->write_cu, "write_cu");
+        init_counter(counters->read_bytes, "read_bytes");
+        init_counter(counters->write_bytes, "write_bytes");
+        init_counter(counters->read_qps, "read_qps");
+        init_counter(counters->write_qps, "write_qps");
+    }
+
+    window_seconds = std::max(window_seconds, static_cast<uint64_t>(1));
+    counters->read_cu->set(usage.read_cu);
+    counters->write_cu->set(usage.write_cu);
+    counters->read_bytes->set(usage.read_bytes);
+    counters->write_bytes->set(usage.write_bytes);
+    counters->read_qps->set(usage.read_count / window_seconds);
+    counters->write_qps->set(usage.write_count / window_seconds);
+}
+
+} // namespace server
+} // namespace pegasus
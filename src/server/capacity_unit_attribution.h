@@ -0,0 +1,160 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <array>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <dsn/perf_counter/perf_counter_wrapper.h>
+#include <dsn/utility/blob.h>
+#include <dsn/utility/singleton.h>
+
+namespace dsn {
+class message_ex;
+} // namespace dsn
+
+namespace pegasus {
+namespace server {
+
+// The capacity units, bytes and request count consumed by an attribution in a window.
+struct cu_usage
+{
+    static cu_usage read(int64_t cu, int64_t bytes) { return {cu, 0, bytes, 0, 1, 0}; }
+    static cu_usage write(int64_t cu, int64_t bytes) { return {0, cu, 0, bytes, 0, 1}; }
+
+    void add(const cu_usage &other)
+    {
+        read_cu += other.read_cu;
+        write_cu += other.write_cu;
+        read_bytes += other.read_bytes;
+        write_bytes += other.write_bytes;
+        read_count += other.read_count;
+        write_count += other.write_count;
+    }
+    int64_t total_cu() const { return read_cu + write_cu; }
+
+    int64_t read_cu{0};
+    int64_t write_cu{0};
+    int64_t read_bytes{0};
+    int64_t write_bytes{0};
+    int64_t read_count{0};
+    int64_t write_count{0};
+};
+
+// cu_attribution_table accumulates the cu usage of each attribution (such as a client or a hash
+// key prefix) in the current window. At most `max_entries` attributions are tracked in a window,
+// the usage of the others is accumulated into the overflow bucket, so the memory is bounded.
+class cu_attribution_table
+{
+public:
+    explicit cu_attribution_table(uint32_t max_entries) : _max_entries(max_entries) {}
+
+    void add(const std::string &attribution, const cu_usage &usage);
+
+    // Take the usage of the current window and start a new one. The `top_n` attributions
+    // ordered by total cu descending are returned in `top`, and the usage of all the others,
+    // including the overflow bucket, is merged into `others`.
+    void take_top(uint32_t top_n,
+                  /*out*/ std::vector<std::pair<std::string, cu_usage>> &top,
+                  /*out*/ cu_usage &others);
+
+private:
+    const uint32_t _max_entries;
+
+    std::mutex _lock;
+    std::unordered_map<std::string, cu_usage> _usages;
+    cu_usage _overflow;
+};
+
+enum class cu_attribution_dimension
+{
+    CLIENT = 0,
+    HASH_KEY_PREFIX = 1,
+    COUNT
+};
+
+// capacity_unit_attribution attributes the capacity units consumed on this server to the
+// clients (the ip of the client address) and the hash key prefixes, which is shared by all the
+// replicas on this server. It's fed by capacity_unit_calculator, and every
+// `cu_attribution_report_interval_seconds` the top attributions of the window are published as
+// perf counters, so they are exported by pegasus_counter_reporter:
+//
+//   cu_attribution.{client|prefix}.{read_cu|write_cu|read_bytes|write_bytes|read_qps|write_qps}
+//   @<attribution>
+//
+// The usage of the last window can also be queried by `last_window_usage` to enforce quotas.
+class capacity_unit_attribution : public dsn::utils::singleton<capacity_unit_attribution>
+{
+public:
+    capacity_unit_attribution();
+
+    // Returns true if any dimension is enabled, otherwise nothing needs to be attributed.
+    static bool enabled();
+
+    // `req` and `hash_key` are optional, the dimension is skipped if it's nullptr.
+    void add(dsn::message_ex *req, const dsn::blob *hash_key, const cu_usage &usage);
+
+    // Publish the top attributions of the current window as perf counters, and start a new
+    // window. `window_seconds` is used to calculate the qps.
+    void report(uint64_t window_seconds);
+
+    // The usage of `attribution` in the last reported window, all zero if it's not in the top
+    // attributions of the window.
+    cu_usage last_window_usage(cu_attribution_dimension dimension,
+                               const std::string &attribution) const;
+
+    static std::string client_attribution(dsn::message_ex *req);
+    static std::string hash_key_prefix_attribution(const dsn::blob &hash_key);
+
+private:
+    struct attribution_counters
+    {
+        ::dsn::perf_counter_wrapper read_cu;
+        ::dsn::perf_counter_wrapper write_cu;
+        ::dsn::perf_counter_wrapper read_bytes;
+        ::dsn::perf_counter_wrapper write_bytes;
+        ::dsn::perf_counter_wrapper read_qps;
+        ::dsn::perf_counter_wrapper write_qps;
+    };
+
+    void update_counters(cu_attribution_dimension dimension,
+                         const std::string &attribution,
+                         const cu_usage &usage,
+                         uint64_t window_seconds);
+
+    static constexpr size_t kDimensionCount = static_cast<size_t>(cu_attribution_dimension::COUNT);
+
+    std::array<std::unique_ptr<cu_attribution_table>, kDimensionCount> _tables;
+
+    // protects the following fields, which are updated in `report`
+    mutable std::mutex _report_lock;
+    std::array<std::map<std::string, cu_usage>, kDimensionCount> _last_window_usages;
+    // the counters of the attributions published in the last window, the counters of the
+    // attributions out of the top are removed
+    std::array<std::map<std::string, std::unique_ptr<attribution_counters>>, kDimensionCount>
+        _counters;
+};
+
+} // namespace server
+} // namespace pegasus
@@ -21,6 +21,7 @@
 
 #include <dsn/utility/config_api.h>
 #include <rocksdb/status.h>
+#include "base/pegasus_key_schema.h"
 #include "hotkey_collector.h"
 
 namespace pegasus {
@@ -131,11 +132,12 @@ void capacity_unit_calculator::add_get_cu(dsn::message_ex *req,
     }
 
     if (status == rocksdb::Status::kNotFound) {
-        add_read_cu(1);
+        attribute_raw_key_cu(req, key, cu_usage::read(add_read_cu(1), total_size));
         _read_hotkey_collector->capture_raw_key(key, 1);
         return;
     }
-    add_read_cu(key.size() + value.size());
+    attribute_raw_key_cu(
+        req, key, cu_usage::read(add_read_cu(key.size() + value.size()), total_size));
     _read_hotkey_collector->capture_raw_key(key, 1);
 }
 
@@ -161,11 +163,11 @@ void capacity_unit_calculator::add_multi_get_cu(dsn::message_ex *req,
 
     uint64_t key_count = kvs.size();
     if (status == rocksdb::Status::kNotFound) {
-        add_read_cu(1);
+        attribute_cu(req, &hash_key, cu_usage::read(add_read_cu(1), total_size));
         _read_hotkey_collector->capture_hash_key(hash_key, key_count);
         return;
     }
-    add_read_cu(data_size);
+    attribute_cu(req, &hash_key, cu_usage::read(add_read_cu(data_size), total_size));
     _read_hotkey_collector->capture_hash_key(hash_key, key_count);
 }
 
@@ -179,7 +181,7 @@ void capacity_unit_calculator::add_scan_cu(dsn::message_ex *req,
     }
 
     if (status == rocksdb::Status::kNotFound) {
-        add_read_cu(1);
+        attribute_cu(req, nullptr, cu_usage::read(add_read_cu(1), 0));
         return;
     }
 
@@ -188,7 +190,8 @@ void capacity_unit_calculator::add_scan_cu(dsn::message_ex *req,
     for (const auto &kv : kvs) {
         data_size += kv.key.size() + kv.value.size();
     }
-    add_read_cu(data_size);
+    // a scan may cross hash keys, so it's attributed to the client only
+    attribute_cu(req, nullptr, cu_usage::read(add_read_cu(data_size), data_size));
     _pfc_scan_bytes->add(data_size);
     add_backup_request_bytes(req, data_size);
 }
@@ -200,7 +203,7 @@ void capacity_unit_calculator::add_sortkey_count_cu(dsn::message_ex *req,
     if (status != rocksdb::Status::kOk && status != rocksdb::Status::kNotFound) {
         return;
     }
-    add_read_cu(1);
+    attribute_cu(req, &hash_key, cu_usage::read(add_read_cu(1), 1));
     add_backup_request_bytes(req, 1);
     _read_hotkey_collector->capture_hash_key(hash_key, 1);
 }
@@ -212,7 +215,7 @@ void capacity_unit_calculator::add_ttl_cu(dsn::message_ex *req,
     if (status != rocksdb::Status::kOk && status != rocksdb::Status::kNotFound) {
         return;
     }
-    add_read_cu(1);
+    attribute_raw_key_cu(req, key, cu_usage::read(add_read_cu(1), 1));
     add_backup_request_bytes(req, 1);
     _read_hotkey_collector->capture_raw_key(key, 1);
 }
@@ -225,7 +228,9 @@ void capacity_unit_calculator::add_put_cu(int32_t status,
     if (status != rocksdb::Status::kOk) {
         return;
     }
-    add_write_cu(key.size() + value.size());
+    int64_t data_size = key.size() + value.size();
+    attribute_raw_key_cu(
+        _write_request, key, cu_usage::write(add_write_cu(data_size), data_size));
     _write_hotkey_collector->capture_raw_key(key, 1);
 }
 
@@ -234,7 +239,8 @@ void capacity_unit_calculator::add_remove_cu(int32_t status, const dsn::blob &ke
     if (status != rocksdb::Status::kOk) {
         return;
     }
-    add_write_cu(key.size());
+    attribute_raw_key_cu(
+        _write_request, key, cu_usage::write(add_write_cu(key.size()), key.size()));
     _write_hotkey_collector->capture_raw_key(key, 1);
 }
 
@@ -255,7 +261,9 @@ void capacity_unit_calculator::add_multi_put_cu(int32_t status,
     if (status != rocksdb::Status::kOk) {
         return;
     }
-    add_write_cu(data_size);
+    attribute_cu(_write_request,
+                 &hash_key,
+                 cu_usage::write(add_write_cu(data_size), hash_key.size() + multi_put_bytes));
 }
 
 void capacity_unit_calculator::add_multi_remove_cu(int32_t status,
@@ -272,7 +280,7 @@ void capacity_unit_calculator::add_multi_remove_cu(int32_t status,
     }
     uint64_t key_count = sort_keys.size();
     _write_hotkey_collector->capture_hash_key(hash_key, key_count);
-    add_write_cu(data_size);
+    attribute_cu(_write_request, &hash_key, cu_usage::write(add_write_cu(data_size), data_size));
 }
 
 void capacity_unit_calculator::add_incr_cu(int32_t status, const dsn::blob &key)
@@ -280,12 +288,14 @@ void capacity_unit_calculator::add_incr_cu(int32_t status, const dsn::blob &key)
     if (status != rocksdb::Status::kOk && status != rocksdb::Status::kInvalidArgument) {
         return;
     }
+    cu_usage usage;
     if (status == rocksdb::Status::kOk) {
-        add_write_cu(1);
+        usage.add(cu_usage::write(add_write_cu(1), 1));
         _write_hotkey_collector->capture_raw_key(key, 1);
     }
-    add_read_cu(1);
+    usage.add(cu_usage::read(add_read_cu(1), 1));
     _read_hotkey_collector->capture_raw_key(key, 1);
+    attribute_raw_key_cu(_write_request, key, usage);
 }
 
 void capacity_unit_calculator::add_check_and_set_cu(int32_t status,
@@ -302,12 +312,16 @@ void capacity_unit_calculator::add_check_and_set_cu(int32_t status,
         return;
     }
 
+    cu_usage usage;
     if (status == rocksdb::Status::kOk) {
-        add_write_cu(hash_key.size() + set_sort_key.size() + value.size());
+        int64_t write_size = hash_key.size() + set_sort_key.size() + value.size();
+        usage.add(cu_usage::write(add_write_cu(write_size), write_size));
         _write_hotkey_collector->capture_hash_key(hash_key, 1);
     }
-    add_read_cu(hash_key.size() + check_sort_key.size());
+    int64_t read_size = hash_key.size() + check_sort_key.size();
+    usage.add(cu_usage::read(add_read_cu(read_size), read_size));
     _read_hotkey_collector->capture_hash_key(hash_key, 1);
+    attribute_cu(_write_request, &hash_key, usage);
 }
 
 void capacity_unit_calculator::add_check_and_mutate_cu(
@@ -330,12 +344,35 @@ void capacity_unit_calculator::add_check_and_mutate_cu(
         return;
     }
     uint64_t key_count = mutate_list.size();
+    cu_usage usage;
     if (status == rocksdb::Status::kOk) {
-        add_write_cu(data_size);
+        usage.add(cu_usage::write(add_write_cu(data_size), data_size));
         _write_hotkey_collector->capture_hash_key(hash_key, key_count);
     }
-    add_read_cu(hash_key.size() + check_sort_key.size());
+    int64_t read_size = hash_key.size() + check_sort_key.size();
+    usage.add(cu_usage::read(add_read_cu(read_size), read_size));
     _read_hotkey_collector->capture_hash_key(hash_key, 1);
+    attribute_cu(_write_request, &hash_key, usage);
+}
+
+void capacity_unit_calculator::attribute_cu(dsn::message_ex *req,
+                                            const dsn::blob *hash_key,
+                                            const cu_usage &usage)
+{
+    if (capacity_unit_attribution::enabled()) {
+        capacity_unit_attribution::instance().add(req, hash_key, usage);
+    }
+}
+
+void capacity_unit_calculator::attribute_raw_key_cu(dsn::message_ex *req,
+                                                    const dsn::blob &key,
+                                                    const cu_usage &usage)
+{
+    if (capacity_unit_attribution::enabled()) {
+        dsn::blob hash_key, sort_key;
+        pegasus_restore_key(key, hash_key, sort_key);
+        capacity_unit_attribution::instance().add(req, &hash_key, usage);
+    }
 }
 
 void capacity_unit_calculator::add_backup_request_bytes(dsn::message_ex *req, int64_t bytes)
@@ -23,6 +23,8 @@
 #include <dsn/perf_counter/perf_counter_wrapper.h>
 #include <rrdb/rrdb_types.h>
 
+#include "capacity_unit_attribution.h"
+
 namespace pegasus {
 namespace server {
 
@@ -68,6 +70,10 @@ public:
                                  const dsn::blob &check_sort_key,
                                  const std::vector<::dsn::apps::mutate> &mutate_list);
 
+    // The request of the write being applied, the write capacity units are attributed to its
+    // client. Writes of a replica are applied one by one, so it's set before applying each write.
+    void set_write_request(dsn::message_ex *req) { _write_request = req; }
+
 protected:
     friend class capacity_unit_calculator_test;
 
@@ -82,6 +88,11 @@ protected:
 #endif
 
 private:
+    // attribute the capacity units to the client of `req` and the prefix of `hash_key`, see
+    // capacity_unit_attribution
+    void attribute_cu(dsn::message_ex *req, const dsn::blob *hash_key, const cu_usage &usage);
+    void attribute_raw_key_cu(dsn::message_ex *req, const dsn::blob &key, const cu_usage &usage);
+
     uint64_t _read_capacity_unit_size;
     uint64_t _write_capacity_unit_size;
     uint32_t _log_read_cu_size;
@@ -119,6 +130,8 @@ private:
     */
     std::shared_ptr<hotkey_collector> _read_hotkey_collector;
     std::shared_ptr<hotkey_collector> _write_hotkey_collector;
+
+    dsn::message_ex *_write_request{nullptr};
 };
 
 } // namespace server
@@ -0,0 +1,210 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "cdc_sink.h"
+
+#include <errno.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <dsn/dist/fmt_logging.h>
+#include <dsn/utility/filesystem.h>
+#include <dsn/utility/smart_pointers.h>
+#include <dsn/utility/string_conv.h>
+#include <rocksdb/env.h>
+
+namespace pegasus {
+namespace server {
+
+static const std::string kFileSinkScheme = "file://";
+static const std::string kTcpSinkScheme = "tcp://";
+
+class cdc_file_sink : public cdc_sink
+{
+public:
+    explicit cdc_file_sink(std::string path) : _path(std::move(path)) {}
+
+    dsn::error_code write(dsn::string_view data) override
+    {
+        if (_file == nullptr) {
+            // The events of the failed write may be partially appended, they're truncated
+            // before being written again, so that no broken line is left in the file.
+            if (_dirty && ::truncate(_path.c_str(), _synced_size) != 0 && errno != ENOENT) {
+                derror_f("truncate cdc sink file {} to {} failed, error = {}",
+                         _path,
+                         _synced_size,
+                         errno);
+                return dsn::ERR_FILE_OPERATION_FAILED;
+            }
+            _dirty = false;
+
+            // the file is created if it doesn't exist, otherwise the events are appended
+            auto s = rocksdb::Env::Default()->ReopenWritableFile(_path, &_file, _options);
+            if (s.ok()) {
+                s = rocksdb::Env::Default()->GetFileSize(_path, &_synced_size);
+            }
+            if (!s.ok()) {
+                derror_f("open cdc sink file {} failed, error = {}", _path, s.ToString());
+                _file.reset();
+                return dsn::ERR_FILE_OPERATION_FAILED;
+            }
+        }
+
+        auto s = _file->Append(rocksdb::Slice(data.data(), data.length()));
+        if (s.ok()) {
+            s = _file->Sync();
+        }
+        if (!s.ok()) {
+            derror_f("write cdc sink file {} failed, error = {}", _path, s.ToString());
+            // reopen the file next time, which is truncated to the last successful write first
+            _file.reset();
+            _dirty = true;
+            return dsn::ERR_FILE_OPERATION_FAILED;
+        }
+        _synced_size += data.length();
+        return dsn::ERR_OK;
+    }
+
+private:
+    const std::string _path;
+    rocksdb::EnvOptions _options;
+    std::unique_ptr<rocksdb::WritableFile> _file;
+    // the size of the file after the last successful write
+    uint64_t _synced_size{0};
+    // whether the last write failed, so the file may end with a partial write
+    bool _dirty{false};
+};
+
+class cdc_tcp_sink : public cdc_sink
+{
+public:
+    cdc_tcp_sink(std::string host, std::string port)
+        : _host(std::move(host)), _port(std::move(port))
+    {
+    }
+
+    ~cdc_tcp_sink() override { close_socket(); }
+
+    dsn::error_code write(dsn::string_view data) override
+    {
+        if (_fd < 0 && !connect_socket()) {
+            return dsn::ERR_NETWORK_FAILURE;
+        }
+
+        size_t sent = 0;
+        while (sent < data.length()) {
+            ssize_t n = ::send(_fd, data.data() + sent, data.length() - sent, MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                derror_f("send to cdc sink {}:{} failed, error = {}", _host, _port, errno);
+                // reconnect next time, the partially sent events are delivered again
+                close_socket();
+                return dsn::ERR_NETWORK_FAILURE;
+            }
+            sent += n;
+        }
+        return dsn::ERR_OK;
+    }
+
+private:
+    bool connect_socket()
+    {
+        struct addrinfo hints = {};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        struct addrinfo *addrs = nullptr;
+        int ret = ::getaddrinfo(_host.c_str(), _port.c_str(), &hints, &addrs);
+        if (ret != 0) {
+            derror_f("resolve cdc sink {}:{} failed, error = {}", _host, _port, gai_strerror(ret));
+            return false;
+        }
+
+        for (auto *addr = addrs; addr != nullptr; addr = addr->ai_next) {
+            int fd = ::socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+            if (fd < 0) {
+                continue;
+            }
+            // a stuck consumer fails the write instead of blocking the duplication forever
+            struct timeval timeout = {kSendTimeoutSeconds, 0};
+            ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+            if (::connect(fd, addr->ai_addr, addr->ai_addrlen) == 0) {
+                _fd = fd;
+                break;
+            }
+            ::close(fd);
+        }
+        ::freeaddrinfo(addrs);
+
+        if (_fd < 0) {
+            derror_f("connect to cdc sink {}:{} failed", _host, _port);
+            return false;
+        }
+        ddebug_f("connected to cdc sink {}:{}", _host, _port);
+        return true;
+    }
+
+    void close_socket()
+    {
+        if (_fd >= 0) {
+            ::close(_fd);
+            _fd = -1;
+        }
+    }
+
+    static constexpr int kSendTimeoutSeconds = 10;
+
+    const std::string _host;
+    const std::string _port;
+    int _fd{-1};
+};
+
+/*static*/ std::unique_ptr<cdc_sink> cdc_sink::create(const std::string &uri,
+                                                      const std::string &name)
+{
+    if (uri.compare(0, kFileSinkScheme.size(), kFileSinkScheme) == 0) {
+        std::string dir = uri.substr(kFileSinkScheme.size());
+        if (dir.empty() || !dsn::utils::filesystem::create_directory(dir)) {
+            derror_f("invalid directory of cdc sink: {}", uri);
+            return nullptr;
+        }
+        return dsn::make_unique<cdc_file_sink>(
+            dsn::utils::filesystem::path_combine(dir, name + ".events"));
+    }
+
+    if (uri.compare(0, kTcpSinkScheme.size(), kTcpSinkScheme) == 0) {
+        std::string address = uri.substr(kTcpSinkScheme.size());
+        auto pos = address.rfind(':');
+        int32_t port = 0;
+        if (pos == std::string::npos || pos == 0 ||
+            !dsn::buf2int32(dsn::string_view(address).substr(pos + 1), port) || port <= 0 ||
+            port > UINT16_MAX) {
+            derror_f("invalid address of cdc sink: {}", uri);
+            return nullptr;
+        }
+        return dsn::make_unique<cdc_tcp_sink>(address.substr(0, pos), std::to_string(port));
+    }
+
+    derror_f("unsupported cdc sink: {}", uri);
+    return nullptr;
+}
+
+} // namespace server
+} // namespace pegasus
@@ -0,0 +1,50 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include <dsn/utility/error_code.h>
+#include <dsn/utility/string_view.h>
+
+namespace pegasus {
+namespace server {
+
+// cdc_sink delivers the encoded change events of a partition to a cdc consumer.
+class cdc_sink
+{
+public:
+    virtual ~cdc_sink() = default;
+
+    // Delivers `data` as a whole, returns ERR_OK only if all of it is delivered.
+    virtual dsn::error_code write(dsn::string_view data) = 0;
+
+    // Creates the sink of a partition by `uri`, `name` identifies the partition:
+    //   file://<dir>         appends the events to <dir>/<name>.events, and syncs them. The
+    //                        events of a partition are delivered by its primary, which may move
+    //                        to another server, so <dir> must be shared by all the replica
+    //                        servers, e.g. a mounted network filesystem. Otherwise the stream
+    //                        of a partition is split into the files on different servers.
+    //   tcp://<host>:<port>  sends the events over a tcp connection
+    // Returns nullptr if `uri` is invalid.
+    static std::unique_ptr<cdc_sink> create(const std::string &uri, const std::string &name);
+};
+
+} // namespace server
+} // namespace pegasus
@@ -0,0 +1,167 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include "checkpoint_manifest.h"
+
+#include <rocksdb/env.h>
+#include <dsn/dist/fmt_logging.h>
+#include <dsn/utility/filesystem.h>
+
+namespace pegasus {
+namespace server {
+
+const std::string CHECKPOINT_MANIFEST_FILE_NAME = "pegasus_checkpoint_manifest.json";
+
+bool is_immutable_checkpoint_file(const std::string &name)
+{
+    static const std::string kSstSuffix = ".sst";
+    return name.size() > kSstSuffix.size() &&
+           name.compare(name.size() - kSstSuffix.size(), kSstSuffix.size(), kSstSuffix) == 0;
+}
+
+dsn::error_code build_checkpoint_manifest(const std::string &dir,
+                                          int64_t decree,
+                                          const checkpoint_manifest *base,
+                                          /*out*/ checkpoint_manifest &manifest)
+{
+    std::vector<std::string> sub_files;
+    if (!dsn::utils::filesystem::get_subfiles(dir, sub_files, false)) {
+        derror_f("list files in checkpoint dir {} failed", dir);
+        return dsn::ERR_FILE_OPERATION_FAILED;
+    }
+
+    std::map<std::string, const checkpoint_file_info *> base_files;
+    if (base != nullptr) {
+        for (const auto &f : base->files) {
+            if (is_immutable_checkpoint_file(f.name)) {
+                base_files.emplace(f.name, &f);
+            }
+        }
+    }
+
+    manifest.decree = decree;
+    manifest.files.clear();
+    manifest.files.reserve(sub_files.size());
+    for (const auto &path : sub_files) {
+        checkpoint_file_info info;
+        info.name = dsn::utils::filesystem::get_file_name(path);
+        if (info.name == CHECKPOINT_MANIFEST_FILE_NAME) {
+            continue;
+        }
+        if (!dsn::utils::filesystem::file_size(path, info.size)) {
+            derror_f("get size of file {} failed", path);
+            return dsn::ERR_FILE_OPERATION_FAILED;
+        }
+
+        auto iter = base_files.find(info.name);
+        if (iter != base_files.end() && iter->second->size == info.size) {
+            info.md5 = iter->second->md5;
+        } else {
+            auto err = dsn::utils::filesystem::md5sum(path, info.md5);
+            if (err != dsn::ERR_OK) {
+                derror_f("calculate md5 of file {} failed, err = {}", path, err.to_string());
+                return err;
+            }
+        }
+        manifest.files.emplace_back(std::move(info));
+    }
+    return dsn::ERR_OK;
+}
+
+dsn::error_code load_checkpoint_manifest(const std::string &dir,
+                                         /*out*/ checkpoint_manifest &manifest)
+{
+    auto path = dsn::utils::filesystem::path_combine(dir, CHECKPOINT_MANIFEST_FILE_NAME);
+    if (!dsn::utils::filesystem::file_exists(path)) {
+        return dsn::ERR_OBJECT_NOT_FOUND;
+    }
+
+    std::string data;
+    auto s = rocksdb::ReadFileToString(rocksdb::Env::Default(), path, &data);
+    if (!s.ok()) {
+        derror_f("read checkpoint manifest {} failed, error = {}", path, s.ToString());
+        return dsn::ERR_FILE_OPERATION_FAILED;
+    }
+    if (!dsn::json::json_forwarder<checkpoint_manifest>::decode(
+            dsn::blob::create_from_bytes(std::move(data)), manifest)) {
+        derror_f("decode checkpoint manifest {} failed", path);
+        return dsn::ERR_CORRUPTION;
+    }
+    return dsn::ERR_OK;
+}
+
+dsn::error_code save_checkpoint_manifest(const std::string &dir,
+                                         const checkpoint_manifest &manifest)
+{
+    auto path = dsn::utils::filesystem::path_combine(dir, CHECKPOINT_MANIFEST_FILE_NAME);
+    auto tmp_path = path + ".tmp";
+    dsn::blob data = dsn::json::json_forwarder<checkpoint_manifest>::encode(manifest);
+    auto s = rocksdb::WriteStringToFile(rocksdb::Env::Default(),
+                                        rocksdb::Slice(data.data(), data.length()),
+                                        tmp_path,
+                                        true /* should_sync */);
+    if (!s.ok()) {
+        derror_f("write checkpoint manifest {} failed, error = {}", tmp_path, s.ToString());
+        return dsn::ERR_FILE_OPERATION_FAILED;
+    }
+    if (!dsn::utils::filesystem::rename_path(tmp_path, path)) {
+        derror_f("rename checkpoint manifest from {} to {} failed", tmp_path, path);
+        return dsn::ERR_FILE_OPERATION_FAILED;
+    }
+    return dsn::ERR_OK;
+}
+
+std::vector<std::string> get_checkpoint_files_to_ship(const checkpoint_manifest &source,
+                                                      const checkpoint_manifest &target)
+{
+    std::map<std::string, const checkpoint_file_info *> target_files;
+    for (const auto &f : target.files) {
+        target_files.emplace(f.name, &f);
+    }
+
+    std::vector<std::string> result;
+    for (const auto &f : source.files) {
+        if (is_immutable_checkpoint_file(f.name)) {
+            auto iter = target_files.find(f.name);
+            if (iter != target_files.end() && iter->second->size == f.size &&
+                iter->second->md5 == f.md5) {
+                continue;
+            }
+        }
+        result.emplace_back(f.name);
+    }
+    return result;
+}
+
+std::vector<checkpoint_file_info> get_missing_checkpoint_files(const std::string &dir,
+                                                               const checkpoint_manifest &manifest)
+{
+    std::vector<checkpoint_file_info> result;
+    for (const auto &f : manifest.files) {
+        if (!dsn::utils::filesystem::file_exists(
+                dsn::utils::filesystem::path_combine(dir, f.name))) {
+            result.emplace_back(f);
+        }
+    }
+    return result;
+}
+
+} // namespace server
+} // namespace pegasus
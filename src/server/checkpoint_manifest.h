@@ -0,0 +1,89 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <dsn/cpp/json_helper.h>
+#include <dsn/utility/error_code.h>
+
+namespace pegasus {
+namespace server {
+
+struct checkpoint_file_info
+{
+    // file name relative to the checkpoint directory
+    std::string name;
+    int64_t size;
+    std::string md5;
+    DEFINE_JSON_SERIALIZATION(name, size, md5)
+};
+
+// The manifest of a checkpoint directory, which lists all of the files in the checkpoint with
+// their sizes and checksums. It is written into the checkpoint directory as
+// `CHECKPOINT_MANIFEST_FILE_NAME`.
+//
+// The SST files of rocksdb are immutable, so a file that appears in two manifests with the same
+// name, size and md5 has the same content. This makes it possible to ship only the missing SST
+// files of a checkpoint while learning or backing up, since most of them are already on the
+// target.
+struct checkpoint_manifest
+{
+    int64_t decree = 0;
+    std::vector<checkpoint_file_info> files;
+    DEFINE_JSON_SERIALIZATION(decree, files)
+};
+
+extern const std::string CHECKPOINT_MANIFEST_FILE_NAME;
+
+// Whether the file is an immutable sst file of rocksdb, only these files could be shared among
+// different checkpoints.
+bool is_immutable_checkpoint_file(const std::string &name);
+
+// Build the manifest of the checkpoint in `dir`.
+// The md5 of sst files will be reused from `base` if name and size are both matched, because the
+// files with the same name in checkpoints of the same rocksdb instance are hard links of each
+// other. `base` could be nullptr.
+dsn::error_code build_checkpoint_manifest(const std::string &dir,
+                                          int64_t decree,
+                                          const checkpoint_manifest *base,
+                                          /*out*/ checkpoint_manifest &manifest);
+
+dsn::error_code load_checkpoint_manifest(const std::string &dir,
+                                         /*out*/ checkpoint_manifest &manifest);
+
+// Write the manifest into `dir` atomically.
+dsn::error_code save_checkpoint_manifest(const std::string &dir,
+                                         const checkpoint_manifest &manifest);
+
+// Returns the names of files in `source` which should be shipped to a target that already has
+// the files in `target`. Mutable files (CURRENT, MANIFEST, OPTIONS, ...) are always shipped.
+std::vector<std::string> get_checkpoint_files_to_ship(const checkpoint_manifest &source,
+                                                      const checkpoint_manifest &target);
+
+// Returns the files listed in `manifest` which don't exist in `dir`.
+std::vector<checkpoint_file_info> get_missing_checkpoint_files(const std::string &dir,
+                                                               const checkpoint_manifest &manifest);
+
+} // namespace server
+} // namespace pegasus
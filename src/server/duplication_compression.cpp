@@ -0,0 +1,193 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "duplication_compression.h"
+
+#include <dsn/cpp/message_utils.h>
+#include <dsn/cpp/serialization_helper/thrift_helper.h>
+#include <dsn/dist/fmt_logging.h>
+#include <lz4frame.h>
+#include <zstd.h>
+
+namespace pegasus {
+namespace server {
+
+using dsn::apps::duplicate_compression_type;
+
+// The default level of zstd, which compresses the small thrift-encoded writes well enough
+// without costing too much cpu.
+static constexpr int kZstdCompressionLevel = 3;
+// A raw message is never larger than a rpc, this limit protects from allocating a huge buffer
+// for a corrupted frame.
+static constexpr uint64_t kMaxDecompressedSize = 256 << 20;
+
+bool parse_duplicate_compression_type(const std::string &name,
+                                      duplicate_compression_type::type &type)
+{
+    if (name == "none") {
+        type = duplicate_compression_type::DCT_NONE;
+    } else if (name == "lz4") {
+        type = duplicate_compression_type::DCT_LZ4;
+    } else if (name == "zstd") {
+        type = duplicate_compression_type::DCT_ZSTD;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool compress_duplicate_payload(duplicate_compression_type::type type,
+                                const dsn::blob &data,
+                                dsn::blob &compressed)
+{
+    std::string buf;
+    size_t size = 0;
+    if (type == duplicate_compression_type::DCT_LZ4) {
+        LZ4F_preferences_t prefs = {};
+        prefs.frameInfo.contentSize = data.length();
+        buf.resize(LZ4F_compressFrameBound(data.length(), &prefs));
+        size = LZ4F_compressFrame(&buf[0], buf.size(), data.data(), data.length(), &prefs);
+        if (LZ4F_isError(size)) {
+            derror_f("failed to compress with lz4: {}", LZ4F_getErrorName(size));
+            return false;
+        }
+    } else if (type == duplicate_compression_type::DCT_ZSTD) {
+        buf.resize(ZSTD_compressBound(data.length()));
+        size =
+            ZSTD_compress(&buf[0], buf.size(), data.data(), data.length(), kZstdCompressionLevel);
+        if (ZSTD_isError(size)) {
+            derror_f("failed to compress with zstd: {}", ZSTD_getErrorName(size));
+            return false;
+        }
+    } else {
+        return false;
+    }
+    buf.resize(size);
+    compressed = dsn::blob::create_from_bytes(std::move(buf));
+    return true;
+}
+
+static bool decompress_lz4_frame(const dsn::blob &data, std::string &buf, std::string &error_hint)
+{
+    LZ4F_dctx *dctx = nullptr;
+    size_t ret = LZ4F_createDecompressionContext(&dctx, LZ4F_VERSION);
+    if (LZ4F_isError(ret)) {
+        error_hint = fmt::format("failed to create lz4 context: {}", LZ4F_getErrorName(ret));
+        return false;
+    }
+
+    bool ok = false;
+    LZ4F_frameInfo_t info;
+    size_t consumed = data.length();
+    ret = LZ4F_getFrameInfo(dctx, &info, data.data(), &consumed);
+    if (LZ4F_isError(ret)) {
+        error_hint = fmt::format("invalid lz4 frame: {}", LZ4F_getErrorName(ret));
+    } else if (info.contentSize == 0 || info.contentSize > kMaxDecompressedSize) {
+        error_hint = fmt::format("invalid content size of lz4 frame: {}", info.contentSize);
+    } else {
+        buf.resize(info.contentSize);
+        size_t dst_size = buf.size();
+        size_t src_size = data.length() - consumed;
+        ret = LZ4F_decompress(
+            dctx, &buf[0], &dst_size, data.data() + consumed, &src_size, nullptr);
+        if (LZ4F_isError(ret)) {
+            error_hint = fmt::format("failed to decompress lz4 frame: {}", LZ4F_getErrorName(ret));
+        } else if (ret != 0 || dst_size != buf.size()) {
+            // a non-zero hint means the frame is incomplete
+            error_hint = "truncated lz4 frame";
+        } else {
+            ok = true;
+        }
+    }
+    LZ4F_freeDecompressionContext(dctx);
+    return ok;
+}
+
+static bool decompress_zstd_frame(const dsn::blob &data, std::string &buf, std::string &error_hint)
+{
+    unsigned long long content_size = ZSTD_getFrameContentSize(data.data(), data.length());
+    if (content_size == ZSTD_CONTENTSIZE_ERROR || content_size == ZSTD_CONTENTSIZE_UNKNOWN ||
+        content_size > kMaxDecompressedSize) {
+        error_hint = fmt::format("invalid content size of zstd frame: {}", content_size);
+        return false;
+    }
+
+    buf.resize(content_size);
+    size_t ret = ZSTD_decompress(&buf[0], buf.size(), data.data(), data.length());
+    if (ZSTD_isError(ret)) {
+        error_hint = fmt::format("failed to decompress zstd frame: {}", ZSTD_getErrorName(ret));
+        return false;
+    }
+    if (ret != buf.size()) {
+        error_hint = "truncated zstd frame";
+        return false;
+    }
+    return true;
+}
+
+bool decompress_duplicate_payload(duplicate_compression_type::type type,
+                                  const dsn::blob &data,
+                                  dsn::blob &decompressed,
+                                  std::string &error_hint)
+{
+    std::string buf;
+    bool ok = false;
+    if (type == duplicate_compression_type::DCT_LZ4) {
+        ok = decompress_lz4_frame(data, buf, error_hint);
+    } else if (type == duplicate_compression_type::DCT_ZSTD) {
+        ok = decompress_zstd_frame(data, buf, error_hint);
+    } else {
+        error_hint = fmt::format("unsupported compression type {}", static_cast<int>(type));
+    }
+    if (ok) {
+        decompressed = dsn::blob::create_from_bytes(std::move(buf));
+    }
+    return ok;
+}
+
+dsn::blob serialize_duplicate_entries(const std::vector<dsn::apps::duplicate_entry> &entries)
+{
+    dsn::apps::duplicate_entries batch;
+    batch.__set_entries(entries);
+    dsn::binary_writer writer;
+    dsn::marshall_thrift_binary(writer, batch);
+    return writer.get_buffer();
+}
+
+bool decompress_duplicate_entries(duplicate_compression_type::type type,
+                                  const dsn::blob &data,
+                                  std::vector<dsn::apps::duplicate_entry> &entries,
+                                  std::string &error_hint)
+{
+    dsn::blob payload;
+    if (!decompress_duplicate_payload(type, data, payload, error_hint)) {
+        return false;
+    }
+
+    dsn::apps::duplicate_entries batch;
+    try {
+        dsn::from_blob_to_thrift(payload, batch);
+    } catch (const std::exception &e) {
+        error_hint = fmt::format("invalid batched writes: {}", e.what());
+        return false;
+    }
+    entries = std::move(batch.entries);
+    return true;
+}
+
+} // namespace server
+} // namespace pegasus
@@ -0,0 +1,66 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <dsn/utility/blob.h>
+#include <rrdb/rrdb_types.h>
+
+namespace pegasus {
+namespace server {
+
+// Parses "none", "lz4" or "zstd" into `type`, returns false if `name` is unknown.
+bool parse_duplicate_compression_type(const std::string &name,
+                                      /*out*/ dsn::apps::duplicate_compression_type::type &type);
+
+// Whether the writes of `request` are compressed, see `duplicate_request.compression_type`.
+inline bool is_duplicate_compressed(const dsn::apps::duplicate_request &request)
+{
+    return request.__isset.compression_type &&
+           request.compression_type != dsn::apps::duplicate_compression_type::DCT_NONE;
+}
+
+// Compresses the raw message of a DUPLICATE into a self-contained lz4 or zstd frame, which
+// records the original size, so it can be decompressed without any other information.
+// Returns false if `type` is unsupported or the compression failed.
+bool compress_duplicate_payload(dsn::apps::duplicate_compression_type::type type,
+                                const dsn::blob &data,
+                                /*out*/ dsn::blob &compressed);
+
+// Decompresses the frame produced by `compress_duplicate_payload`. Returns false and sets
+// `error_hint` if `data` is not a valid frame of `type`.
+bool decompress_duplicate_payload(dsn::apps::duplicate_compression_type::type type,
+                                  const dsn::blob &data,
+                                  /*out*/ dsn::blob &decompressed,
+                                  /*out*/ std::string &error_hint);
+
+// Serializes the batched writes of a DUPLICATE as `duplicate_entries`, which is compressed as
+// one frame by `compress_duplicate_payload`.
+dsn::blob serialize_duplicate_entries(const std::vector<dsn::apps::duplicate_entry> &entries);
+
+// Decompresses the frame of the batched writes built from `serialize_duplicate_entries`.
+// Returns false and sets `error_hint` if `data` is not a valid frame of `type`.
+bool decompress_duplicate_entries(dsn::apps::duplicate_compression_type::type type,
+                                  const dsn::blob &data,
+                                  /*out*/ std::vector<dsn::apps::duplicate_entry> &entries,
+                                  /*out*/ std::string &error_hint);
+
+} // namespace server
+} // namespace pegasus
@@ -0,0 +1,161 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "expire_index.h"
+
+#include <endian.h>
+#include <string.h>
+#include <rocksdb/db.h>
+#include <rocksdb/rate_limiter.h>
+
+#include "base/pegasus_utils.h"
+#include "base/pegasus_value_schema.h"
+#include "logging_utils.h"
+
+namespace pegasus {
+namespace server {
+
+// Request the rate limiter in batches to avoid locking it for every index entry.
+static const int64_t kRateLimitRequestBytes = 4096;
+
+std::string encode_expire_index_key(uint32_t expire_ts, dsn::string_view raw_key)
+{
+    std::string index_key(sizeof(uint32_t) + raw_key.size(), '\0');
+    uint32_t be_expire_ts = htobe32(expire_ts);
+    ::memcpy(&index_key[0], &be_expire_ts, sizeof(uint32_t));
+    if (!raw_key.empty()) {
+        ::memcpy(&index_key[sizeof(uint32_t)], raw_key.data(), raw_key.size());
+    }
+    return index_key;
+}
+
+bool decode_expire_index_key(dsn::string_view index_key,
+                             /*out*/ uint32_t *expire_ts,
+                             /*out*/ dsn::string_view *raw_key)
+{
+    if (index_key.size() < sizeof(uint32_t)) {
+        return false;
+    }
+    uint32_t be_expire_ts = 0;
+    ::memcpy(&be_expire_ts, index_key.data(), sizeof(uint32_t));
+    *expire_ts = be32toh(be_expire_ts);
+    *raw_key = index_key.substr(sizeof(uint32_t));
+    return true;
+}
+
+expire_index_purger::expire_index_purger(dsn::replication::replica_base *r,
+                                         rocksdb::DB *db,
+                                         rocksdb::ColumnFamilyHandle *data_cf,
+                                         rocksdb::ColumnFamilyHandle *index_cf,
+                                         uint32_t pegasus_data_version,
+                                         std::shared_ptr<rocksdb::RateLimiter> rate_limiter)
+    : replica_base(r),
+      _db(db),
+      _data_cf(data_cf),
+      _index_cf(index_cf),
+      _pegasus_data_version(pegasus_data_version),
+      _rate_limiter(std::move(rate_limiter))
+{
+}
+
+uint32_t expire_index_purger::purge(uint32_t now, uint32_t max_count)
+{
+    if (max_count == 0) {
+        return 0;
+    }
+
+    // Entries with expire_ts <= now are expired, see check_if_ts_expired().
+    std::string upper_bound = encode_expire_index_key(now + 1, dsn::string_view());
+    rocksdb::Slice upper_bound_slice(upper_bound);
+    rocksdb::ReadOptions rd_opts;
+    rd_opts.fill_cache = false;
+    rd_opts.iterate_upper_bound = &upper_bound_slice;
+    std::unique_ptr<rocksdb::Iterator> it(_db->NewIterator(rd_opts, _index_cf));
+
+    // The record may have been rewritten with a new TTL or without TTL after it was indexed, so
+    // only the records which are still expired are the candidates.
+    std::vector<std::string> index_keys;
+    // indexes of the candidates in `index_keys`
+    std::vector<size_t> candidates;
+    std::string raw_value;
+    int64_t unrequested_bytes = 0;
+    for (it->SeekToFirst(); it->Valid() && index_keys.size() < max_count; it->Next()) {
+        index_keys.emplace_back(it->key().data(), it->key().size());
+        uint32_t expire_ts = 0;
+        dsn::string_view raw_key;
+        if (decode_expire_index_key(index_keys.back(), &expire_ts, &raw_key)) {
+            rocksdb::Status s = _db->Get(
+                rocksdb::ReadOptions(), _data_cf, utils::to_rocksdb_slice(raw_key), &raw_value);
+            if (s.ok()) {
+                unrequested_bytes += raw_key.size() + raw_value.size();
+                if (check_if_ts_expired(
+                        now, pegasus_extract_expire_ts(_pegasus_data_version, raw_value))) {
+                    candidates.emplace_back(index_keys.size() - 1);
+                }
+            }
+        }
+        unrequested_bytes += it->key().size();
+        if (_rate_limiter && unrequested_bytes >= kRateLimitRequestBytes) {
+            _rate_limiter->Request(unrequested_bytes, rocksdb::Env::IO_LOW);
+            unrequested_bytes = 0;
+        }
+    }
+    if (dsn_unlikely(!it->status().ok())) {
+        derror_rocksdb("expire_index_purge", it->status().ToString(), "now: {}", now);
+    }
+    it.reset();
+    if (index_keys.empty()) {
+        return 0;
+    }
+
+    // The candidates are checked again while holding the write lock, they are usually in the
+    // block cache now, so the writes of clients are blocked only shortly.
+    rocksdb::WriteBatch batch;
+    uint32_t purge_count = 0;
+    rocksdb::WriteOptions wt_opts;
+    // disable write ahead logging as replication handles logging instead now
+    wt_opts.disableWAL = true;
+    std::lock_guard<std::mutex> l(_write_lock);
+    for (size_t i : candidates) {
+        uint32_t expire_ts = 0;
+        dsn::string_view raw_key;
+        decode_expire_index_key(index_keys[i], &expire_ts, &raw_key);
+        rocksdb::Status s = _db->Get(
+            rocksdb::ReadOptions(), _data_cf, utils::to_rocksdb_slice(raw_key), &raw_value);
+        if (s.ok() && check_if_ts_expired(
+                          now, pegasus_extract_expire_ts(_pegasus_data_version, raw_value))) {
+            batch.Delete(_data_cf, utils::to_rocksdb_slice(raw_key));
+            ++purge_count;
+        }
+    }
+    // The index entries are useless whether the records are deleted or not.
+    for (const auto &index_key : index_keys) {
+        batch.Delete(_index_cf, index_key);
+    }
+    rocksdb::Status s = _db->Write(wt_opts, &batch);
+    if (dsn_unlikely(!s.ok())) {
+        // The index entries are kept, they will be purged again.
+        derror_rocksdb("Write", s.ToString(), "purge expired records error");
+        return 0;
+    }
+    return purge_count;
+}
+
+} // namespace server
+} // namespace pegasus
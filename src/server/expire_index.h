@@ -0,0 +1,88 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <dsn/dist/replication/replica_base.h>
+#include <dsn/utility/string_view.h>
+
+namespace rocksdb {
+class DB;
+class ColumnFamilyHandle;
+class RateLimiter;
+} // namespace rocksdb
+
+namespace pegasus {
+namespace server {
+
+// The expire index column family indexes the records which have TTL by their expire timestamps,
+// so that expired records can be found in time order and purged proactively, instead of being
+// skipped by every read until compaction drops them.
+//
+// index key = [expire_ts(uint32_t, big endian)] [raw_key(bytes)], index value is empty.
+//
+// The column family is dropped when a replica is opened with the expire index disabled, because
+// its entries are neither updated nor purged any more. Enabling it again starts with an empty
+// index, so the records written in the meantime are left to the compaction.
+std::string encode_expire_index_key(uint32_t expire_ts, dsn::string_view raw_key);
+
+// Returns false if `index_key` is malformed.
+bool decode_expire_index_key(dsn::string_view index_key,
+                             /*out*/ uint32_t *expire_ts,
+                             /*out*/ dsn::string_view *raw_key);
+
+// Purges the expired records found by the expire index in background, by the timer enqueued in
+// pegasus_server_impl::start(). The records are read first without any lock
+// to filter out the ones which are not expired any more, then the remaining ones are checked
+// again and deleted while holding `write_lock()`, which is also held by rocksdb_wrapper::write,
+// so purging never deletes a record which is rewritten concurrently.
+class expire_index_purger : public dsn::replication::replica_base
+{
+public:
+    expire_index_purger(dsn::replication::replica_base *r,
+                        rocksdb::DB *db,
+                        rocksdb::ColumnFamilyHandle *data_cf,
+                        rocksdb::ColumnFamilyHandle *index_cf,
+                        uint32_t pegasus_data_version,
+                        std::shared_ptr<rocksdb::RateLimiter> rate_limiter);
+
+    // Purges the records of at most `max_count` index entries whose expire timestamps are not
+    // after `now`, the reading is rate limited by `rate_limiter` if it's set.
+    // Returns the count of records purged.
+    uint32_t purge(uint32_t now, uint32_t max_count);
+
+    std::mutex &write_lock() { return _write_lock; }
+
+private:
+    rocksdb::DB *_db;
+    rocksdb::ColumnFamilyHandle *_data_cf;
+    rocksdb::ColumnFamilyHandle *_index_cf;
+    const uint32_t _pegasus_data_version;
+    std::shared_ptr<rocksdb::RateLimiter> _rate_limiter;
+
+    std::mutex _write_lock;
+};
+
+} // namespace server
+} // namespace pegasus
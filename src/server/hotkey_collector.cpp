@@ -17,10 +17,15 @@
 
 #include "hotkey_collector.h"
 
+#include <algorithm>
+#include <mutex>
+#include <set>
+#include <sstream>
 #include <dsn/dist/replication/replication_enums.h>
 #include <dsn/utility/smart_pointers.h>
 #include <boost/functional/hash.hpp>
 #include <dsn/dist/fmt_logging.h>
+#include <dsn/tool-api/command_manager.h>
 #include <dsn/utility/flags.h>
 #include "base/pegasus_key_schema.h"
 #include "base/pegasus_utils.h"
@@ -67,14 +72,42 @@ DSN_DEFINE_uint32(
     "the max time (in seconds) allowed to capture hotkey, will stop if hotkey's not found");
 DSN_TAG_VARIABLE(max_seconds_to_detect_hotkey, FT_MUTABLE);
 
-// 68–95–99.7 rule, same algorithm as hotspot_partition_calculator::stat_histories_analyse
+DSN_DEFINE_uint32("pegasus.server",
+                  hotkey_sketch_sample_rate,
+                  100,
+                  "one of about every hotkey_sketch_sample_rate captured keys is sampled into the "
+                  "always-on hotkey sketch, 0 means the sketch is disabled");
+DSN_TAG_VARIABLE(hotkey_sketch_sample_rate, FT_MUTABLE);
+
+DSN_DEFINE_uint32("pegasus.server",
+                  hotkey_sketch_shard_count,
+                  8,
+                  "the count of shards of the hotkey sketch, the capturing threads are spread over "
+                  "them to avoid contention");
+
+DSN_DEFINE_uint32("pegasus.server",
+                  hotkey_sketch_capacity,
+                  64,
+                  "the max count of keys counted in each shard of the hotkey sketch");
+
+DSN_DEFINE_uint32("pegasus.server",
+                  hotkey_sketch_top_k,
+                  10,
+                  "the count of top keys reported by the hotkey sketch");
+DSN_TAG_VARIABLE(hotkey_sketch_top_k, FT_MUTABLE);
+
+// All the hotkey collectors on this server, used by the remote command.
+static std::mutex s_collectors_lock;
+static std::set<hotkey_collector *> s_collectors;
+
+// 68–95–99.7 rule, same algorithm as hotspot_partition_calculator::decayed_rates_analyse
 /*extern*/ bool
 find_outlier_index(const std::vector<uint64_t> &captured_keys, int threshold, int &hot_index)
 {
     dcheck_gt(captured_keys.size(), 2);
     int data_size = captured_keys.size();
     // empirical rule to calculate hot point of each partition
-    // same algorithm as hotspot_partition_calculator::stat_histories_analyse
+    // same algorithm as hotspot_partition_calculator::decayed_rates_analyse
     double table_captured_key_sum = 0;
     int hot_value = 0;
     for (int i = 0; i < data_size; i++) {
@@ -112,7 +145,9 @@ find_outlier_index(const std::vector<uint64_t> &captured_keys, int threshold, in
 
 hotkey_collector::hotkey_collector(dsn::replication::hotkey_type::type hotkey_type,
                                    dsn::replication::replica_base *r_base)
-    : replica_base(r_base), _hotkey_type(hotkey_type)
+    : replica_base(r_base),
+      _hotkey_type(hotkey_type),
+      _sketch(FLAGS_hotkey_sketch_shard_count, FLAGS_hotkey_sketch_capacity)
 {
     int now_hash_bucket_num = FLAGS_hotkey_buckets_num;
     _internal_coarse_collector =
@@ -121,6 +156,28 @@ hotkey_collector::hotkey_collector(dsn::replication::hotkey_type::type hotkey_ty
         std::make_shared<hotkey_fine_data_collector>(this, now_hash_bucket_num);
     _internal_empty_collector = std::make_shared<hotkey_empty_data_collector>(this);
     _state.store(hotkey_collector_state::STOPPED);
+
+    const char *type = _hotkey_type == dsn::replication::hotkey_type::READ ? "read" : "write";
+    std::string str_gpid = get_gpid().to_string();
+    _pfc_top_key_weight.init_app_counter(
+        "app.pegasus",
+        fmt::format("{}.hotkey.top.weight@{}", type, str_gpid).c_str(),
+        COUNTER_TYPE_NUMBER,
+        "the estimated weight of the heaviest key sampled in the last analyse period");
+    _pfc_top_key_percent.init_app_counter(
+        "app.pegasus",
+        fmt::format("{}.hotkey.top.percent@{}", type, str_gpid).c_str(),
+        COUNTER_TYPE_NUMBER,
+        "the percentage of the heaviest key in the total weight of the last analyse period");
+
+    std::lock_guard<std::mutex> l(s_collectors_lock);
+    s_collectors.insert(this);
+}
+
+hotkey_collector::~hotkey_collector()
+{
+    std::lock_guard<std::mutex> l(s_collectors_lock);
+    s_collectors.erase(this);
 }
 
 inline void hotkey_collector::change_state_to_stopped()
@@ -211,6 +268,12 @@ void hotkey_collector::capture_raw_key(const dsn::blob &raw_key, int64_t weight)
 
 void hotkey_collector::capture_hash_key(const dsn::blob &hash_key, int64_t weight)
 {
+    uint32_t sample_rate = FLAGS_hotkey_sketch_sample_rate;
+    if (hotkey_sketch::should_sample(sample_rate)) {
+        // scale the weight to estimate the weight of all the captured keys
+        _sketch.add(hash_key, static_cast<uint64_t>(weight > 0 ? weight : 1) * sample_rate);
+    }
+
     // TODO: (Tangyanzhao) add a unit test to ensure data integrity
     switch (_state.load()) {
     case hotkey_collector_state::COARSE_DETECTING:
@@ -224,6 +287,8 @@ void hotkey_collector::capture_hash_key(const dsn::blob &hash_key, int64_t weigh
 
 void hotkey_collector::analyse_data()
 {
+    analyse_sketch();
+
     switch (_state.load()) {
     case hotkey_collector_state::COARSE_DETECTING:
     case hotkey_collector_state::FINE_DETECTING:
@@ -295,6 +360,74 @@ void hotkey_collector::query_result(dsn::replication::detect_hotkey_response &re
     }
 }
 
+void hotkey_collector::analyse_sketch()
+{
+    _sketch.merge(FLAGS_hotkey_sketch_top_k);
+    std::vector<hotkey_weight> top_keys = _sketch.top_keys();
+    uint64_t total_weight = _sketch.total_weight();
+    if (top_keys.empty() || total_weight == 0) {
+        _pfc_top_key_weight->set(0);
+        _pfc_top_key_percent->set(0);
+        return;
+    }
+    _pfc_top_key_weight->set(top_keys[0].weight);
+    _pfc_top_key_percent->set(top_keys[0].weight * 100 / total_weight);
+}
+
+std::vector<std::string> hotkey_collector::get_hot_hash_keys(uint32_t min_percent) const
+{
+    std::vector<std::string> hash_keys;
+    uint64_t total_weight = _sketch.total_weight();
+    if (total_weight > 0) {
+        for (const auto &key_weight : _sketch.top_keys()) {
+            if (key_weight.weight * 100 < total_weight * min_percent) {
+                break;
+            }
+            hash_keys.push_back(key_weight.key);
+        }
+    }
+    if (_state.load() == hotkey_collector_state::FINISHED &&
+        std::find(hash_keys.begin(), hash_keys.end(), _result.hot_hash_key) == hash_keys.end()) {
+        hash_keys.push_back(_result.hot_hash_key);
+    }
+    return hash_keys;
+}
+
+std::string hotkey_collector::dump_top_keys() const
+{
+    std::stringstream out;
+    out << replica_name() << " " << dsn::enum_to_string(_hotkey_type)
+        << ": total_weight=" << _sketch.total_weight();
+    for (const auto &key_weight : _sketch.top_keys()) {
+        out << ", " << pegasus::utils::c_escape_string(key_weight.key) << "="
+            << key_weight.weight;
+    }
+    return out.str();
+}
+
+void register_hotkey_commands()
+{
+    dsn::command_manager::instance().register_command(
+        {"hotkey-topk"},
+        "hotkey-topk - query the top keys sampled by the hotkey sketch of each replica",
+        "hotkey-topk [read|write]",
+        [](const std::vector<std::string> &args) {
+            std::string type = args.empty() ? "" : args[0];
+            if (!type.empty() && type != "read" && type != "write") {
+                return std::string("invalid hotkey type, should be read or write");
+            }
+            std::stringstream out;
+            std::lock_guard<std::mutex> l(s_collectors_lock);
+            for (const auto *collector : s_collectors) {
+                bool is_read = collector->get_hotkey_type() == dsn::replication::hotkey_type::READ;
+                if (type.empty() || (type == "read") == is_read) {
+                    out << collector->dump_top_keys() << std::endl;
+                }
+            }
+            return out.str();
+        });
+}
+
 bool hotkey_collector::terminate_if_timeout()
 {
     if (dsn_now_s() >= _collector_start_time_second.load() + FLAGS_max_seconds_to_detect_hotkey) {
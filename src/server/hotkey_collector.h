@@ -20,7 +20,9 @@
 #include <dsn/dist/replication/replication_types.h>
 #include <concurrentqueue/concurrentqueue.h>
 #include <dsn/dist/replication/replica_base.h>
+#include <dsn/perf_counter/perf_counter_wrapper.h>
 #include "hotkey_collector_state.h"
+#include "hotkey_sketch.h"
 
 namespace pegasus {
 namespace server {
@@ -81,12 +83,17 @@ find_outlier_index(const std::vector<uint64_t> &captured_keys, int threshold, in
 //    | +----------------+ |  |                       v                            |
 //    |                    |  |                     Hotkey                         |
 //    +--------------------+  +----------------------------------------------------+
+//
+//    Besides the detection above which has to be started by RPC, the captured keys are
+//    always sampled into a top-K sketch (see hotkey_sketch), whose result is refreshed every
+//    analyse period, and can be queried by the remote command "hotkey-topk".
 
 class hotkey_collector : public dsn::replication::replica_base
 {
 public:
     hotkey_collector(dsn::replication::hotkey_type::type hotkey_type,
                      dsn::replication::replica_base *r_base);
+    ~hotkey_collector();
     // TODO: (Tangyanzhao) capture_*_key should be consistent with hotspot detection
     // weight: calculate the weight according to the specific situation
     void capture_raw_key(const dsn::blob &raw_key, int64_t weight);
@@ -95,7 +102,20 @@ public:
     void handle_rpc(const dsn::replication::detect_hotkey_request &req,
                     /*out*/ dsn::replication::detect_hotkey_response &resp);
 
+    dsn::replication::hotkey_type::type get_hotkey_type() const { return _hotkey_type; }
+
+    // The top keys sampled by the sketch in the last analyse period, with estimated weights.
+    std::vector<hotkey_weight> top_keys() const { return _sketch.top_keys(); }
+    // The hash keys found to be hot: the keys of the sketch whose weights are no less than
+    // `min_percent` of the total weight in the last analyse period, and the key found by the
+    // detection if it's finished.
+    std::vector<std::string> get_hot_hash_keys(uint32_t min_percent) const;
+    // Describes the top keys of the sketch, used by the remote command.
+    std::string dump_top_keys() const;
+
 private:
+    void analyse_sketch();
+
     void on_start_detect(dsn::replication::detect_hotkey_response &resp);
     void on_stop_detect(dsn::replication::detect_hotkey_response &resp);
     void query_result(dsn::replication::detect_hotkey_response &resp);
@@ -118,9 +138,16 @@ private:
     std::shared_ptr<hotkey_coarse_data_collector> _internal_coarse_collector;
     std::shared_ptr<hotkey_fine_data_collector> _internal_fine_collector;
 
+    hotkey_sketch _sketch;
+    ::dsn::perf_counter_wrapper _pfc_top_key_weight;
+    ::dsn::perf_counter_wrapper _pfc_top_key_percent;
+
     friend class hotkey_collector_test;
 };
 
+// Registers the remote command to query the top keys of all the replicas on this server.
+void register_hotkey_commands();
+
 // Be sure every function in internal_collector_base should be thread safe
 class internal_collector_base : public dsn::replication::replica_base
 {
@@ -0,0 +1,152 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+
+#include "hotkey_read_cache.h"
+
+#include <algorithm>
+#include <dsn/c/api_layer1.h>
+#include <dsn/utility/crc.h>
+#include "base/pegasus_key_schema.h"
+
+namespace pegasus {
+namespace server {
+
+static uint64_t hash_of(dsn::string_view hash_key)
+{
+    return dsn::utils::crc64_calc(hash_key.data(), hash_key.size(), 0);
+}
+
+// the hash key in `raw_key`, no data copied
+static dsn::string_view hash_key_of(dsn::string_view raw_key)
+{
+    if (raw_key.size() < 2) {
+        return dsn::string_view();
+    }
+    // hash_key_len is in big endian
+    uint16_t hash_key_len = be16toh(*(int16_t *)(raw_key.data()));
+    return raw_key.substr(2, hash_key_len);
+}
+
+const size_t hotkey_read_cache::kMaxHotHashKeys;
+
+hotkey_read_cache::hotkey_read_cache(uint32_t capacity, uint64_t ttl_ms)
+    : _capacity(capacity), _ttl_ms(ttl_ms)
+{
+    for (auto &hash : _hot_hash_key_hashes) {
+        hash.store(0, std::memory_order_relaxed);
+    }
+}
+
+void hotkey_read_cache::set_hot_hash_keys(const std::vector<std::string> &hash_keys)
+{
+    std::lock_guard<std::mutex> l(_lock);
+    uint32_t count = std::min(hash_keys.size(), kMaxHotHashKeys);
+    // The readers may see a mix of the old and new hashes while they are being replaced, which
+    // only routes some keys to the cache or not for a moment.
+    _hot_hash_key_count.store(std::min(count, _hot_hash_key_count.load()),
+                              std::memory_order_relaxed);
+    for (uint32_t i = 0; i < count; ++i) {
+        _hot_hash_key_hashes[i].store(hash_of(hash_keys[i]), std::memory_order_relaxed);
+    }
+    _hot_hash_key_count.store(count, std::memory_order_release);
+
+    uint64_t now_ms = dsn_now_ms();
+    for (auto iter = _entries.begin(); iter != _entries.end();) {
+        if (!is_hot_hash(hash_of(hash_key_of(iter->first))) ||
+            now_ms >= iter->second.cached_time_ms + _ttl_ms) {
+            iter = _entries.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+}
+
+bool hotkey_read_cache::is_hot_hash(uint64_t hash) const
+{
+    uint32_t count = _hot_hash_key_count.load(std::memory_order_acquire);
+    for (uint32_t i = 0; i < count; ++i) {
+        if (_hot_hash_key_hashes[i].load(std::memory_order_relaxed) == hash) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool hotkey_read_cache::is_hot_hash_key(dsn::string_view hash_key) const
+{
+    if (!has_hot_hash_keys()) {
+        return false;
+    }
+    return is_hot_hash(hash_of(hash_key));
+}
+
+bool hotkey_read_cache::is_hot_raw_key(dsn::string_view raw_key) const
+{
+    if (!has_hot_hash_keys()) {
+        return false;
+    }
+    return is_hot_hash(hash_of(hash_key_of(raw_key)));
+}
+
+bool hotkey_read_cache::get(dsn::string_view raw_key, /*out*/ std::string *raw_value)
+{
+    std::lock_guard<std::mutex> l(_lock);
+    auto iter = _entries.find(std::string(raw_key.data(), raw_key.size()));
+    if (iter == _entries.end()) {
+        return false;
+    }
+    if (dsn_now_ms() >= iter->second.cached_time_ms + _ttl_ms) {
+        _entries.erase(iter);
+        return false;
+    }
+    *raw_value = iter->second.raw_value;
+    return true;
+}
+
+void hotkey_read_cache::put(dsn::string_view raw_key,
+                            dsn::string_view raw_value,
+                            uint64_t generation)
+{
+    std::lock_guard<std::mutex> l(_lock);
+    if (_generation.load(std::memory_order_relaxed) != generation ||
+        _entries.size() >= _capacity) {
+        return;
+    }
+    entry &e = _entries[std::string(raw_key.data(), raw_key.size())];
+    e.raw_value.assign(raw_value.data(), raw_value.size());
+    e.cached_time_ms = dsn_now_ms();
+}
+
+void hotkey_read_cache::invalidate(const std::vector<std::string> &raw_keys)
+{
+    std::lock_guard<std::mutex> l(_lock);
+    _generation.fetch_add(1, std::memory_order_release);
+    for (const auto &raw_key : raw_keys) {
+        _entries.erase(raw_key);
+    }
+}
+
+void hotkey_read_cache::clear()
+{
+    std::lock_guard<std::mutex> l(_lock);
+    _generation.fetch_add(1, std::memory_order_release);
+    _entries.clear();
+}
+
+} // namespace server
+} // namespace pegasus
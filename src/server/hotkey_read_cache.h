@@ -0,0 +1,104 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <dsn/utility/string_view.h>
+
+namespace pegasus {
+namespace server {
+
+// hotkey_read_cache caches the rocksdb values of the hot hash keys reported by the read hotkey
+// collector, so that the skewed reads are served without reading rocksdb.
+//
+// - Only the keys of the hot hash keys are cached, and the hot hash keys are refreshed every
+//   hotkey analyse period.
+// - The cached values are the raw values in rocksdb, so the TTL of records is still checked by
+//   the readers.
+// - The writes on the hot hash keys invalidate the cached keys after they're applied, and the
+//   values read before the writes applied are refused by the generation check in put().
+// - Entries are also dropped after hotkey_read_cache_ttl_ms, which bounds the staleness in rare
+//   cases like the hot hash keys changing while a write is being applied.
+// - Every get and write checks whether its key is hot, so the hot hash keys are kept as the
+//   crc64 of them in a fixed array, which is read without any lock or allocation. A hash
+//   collision only makes another hash key cached as well, which is still consistent because
+//   the reads and the writes check by the same hashes.
+class hotkey_read_cache
+{
+public:
+    hotkey_read_cache(uint32_t capacity, uint64_t ttl_ms);
+
+    static const size_t kMaxHotHashKeys = 64;
+
+    // Replaces the hot hash keys, the cached keys of the other hash keys are removed.
+    // At most kMaxHotHashKeys of `hash_keys` are used.
+    void set_hot_hash_keys(const std::vector<std::string> &hash_keys);
+
+    bool has_hot_hash_keys() const
+    {
+        return _hot_hash_key_count.load(std::memory_order_relaxed) > 0;
+    }
+    bool is_hot_hash_key(dsn::string_view hash_key) const;
+    bool is_hot_raw_key(dsn::string_view raw_key) const;
+
+    // Returns the generation which should be got before reading rocksdb and passed to put().
+    uint64_t generation() const { return _generation.load(std::memory_order_acquire); }
+
+    // Returns true and fills `raw_value` if `raw_key` is cached and not timed out.
+    bool get(dsn::string_view raw_key, /*out*/ std::string *raw_value);
+
+    // Caches the `raw_value` read from rocksdb, unless any key has been invalidated since
+    // `generation`, or the cache is full.
+    void put(dsn::string_view raw_key, dsn::string_view raw_value, uint64_t generation);
+
+    // Called after the writes on `raw_keys` are applied.
+    void invalidate(const std::vector<std::string> &raw_keys);
+
+    void clear();
+
+private:
+    struct entry
+    {
+        std::string raw_value;
+        uint64_t cached_time_ms;
+    };
+
+    bool is_hot_hash(uint64_t hash) const;
+
+    const uint32_t _capacity;
+    const uint64_t _ttl_ms;
+
+    // crc64 of the hot hash keys, only the first `_hot_hash_key_count` ones are valid. They are
+    // only updated by set_hot_hash_keys() under `_lock`.
+    std::array<std::atomic<uint64_t>, kMaxHotHashKeys> _hot_hash_key_hashes;
+    std::atomic<uint32_t> _hot_hash_key_count{0};
+    std::atomic<uint64_t> _generation{0};
+
+    mutable std::mutex _lock; // protects the following members
+    std::unordered_map<std::string, entry> _entries;
+};
+
+} // namespace server
+} // namespace pegasus
@@ -0,0 +1,140 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+
+#include "hotkey_sketch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <dsn/utility/rand.h>
+
+namespace pegasus {
+namespace server {
+
+void space_saving_counter::add(dsn::string_view key, uint64_t weight)
+{
+    std::string key_str(key.data(), key.size());
+    auto iter = _weights.find(key_str);
+    if (iter != _weights.end()) {
+        iter->second += weight;
+        return;
+    }
+    if (_weights.size() < _capacity) {
+        _weights.emplace(std::move(key_str), weight);
+        return;
+    }
+
+    auto min_iter = _weights.begin();
+    for (auto it = _weights.begin(); it != _weights.end(); ++it) {
+        if (it->second < min_iter->second) {
+            min_iter = it;
+        }
+    }
+    uint64_t min_weight = min_iter->second;
+    _weights.erase(min_iter);
+    _weights.emplace(std::move(key_str), min_weight + weight);
+}
+
+void space_saving_counter::drain(/*out*/ std::unordered_map<std::string, uint64_t> &weights)
+{
+    for (auto &kv : _weights) {
+        weights[kv.first] += kv.second;
+    }
+    _weights.clear();
+}
+
+hotkey_sketch::hotkey_sketch(uint32_t shard_count, uint32_t capacity_per_shard)
+{
+    shard_count = std::max(shard_count, 1U);
+    _shards.reserve(shard_count);
+    for (uint32_t i = 0; i < shard_count; ++i) {
+        _shards.emplace_back(new shard(capacity_per_shard));
+    }
+}
+
+/*static*/ bool hotkey_sketch::should_sample(uint32_t sample_rate)
+{
+    if (sample_rate <= 1) {
+        return sample_rate == 1;
+    }
+    // xorshift is used rather than a plain tick, in case the sampling is in step with a periodic
+    // access pattern.
+    static thread_local uint32_t seed = dsn::rand::next_u32() | 1;
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed % sample_rate == 0;
+}
+
+void hotkey_sketch::add(dsn::string_view key, uint64_t weight)
+{
+    // Spread the threads over the shards to avoid contention.
+    static std::atomic<uint32_t> next_thread_index{0};
+    static thread_local uint32_t thread_index = next_thread_index.fetch_add(1);
+
+    shard &s = *_shards[thread_index % _shards.size()];
+    std::lock_guard<std::mutex> l(s.lock);
+    s.counter.add(key, weight);
+    s.total_weight += weight;
+}
+
+void hotkey_sketch::merge(uint32_t top_k)
+{
+    std::unordered_map<std::string, uint64_t> weights;
+    uint64_t total_weight = 0;
+    for (auto &s : _shards) {
+        std::lock_guard<std::mutex> l(s->lock);
+        s->counter.drain(weights);
+        total_weight += s->total_weight;
+        s->total_weight = 0;
+    }
+
+    std::vector<hotkey_weight> top_keys;
+    top_keys.reserve(weights.size());
+    for (auto &kv : weights) {
+        top_keys.push_back({kv.first, kv.second});
+    }
+    auto by_weight_desc = [](const hotkey_weight &lhs, const hotkey_weight &rhs) {
+        return lhs.weight > rhs.weight;
+    };
+    if (top_keys.size() > top_k) {
+        std::partial_sort(
+            top_keys.begin(), top_keys.begin() + top_k, top_keys.end(), by_weight_desc);
+        top_keys.resize(top_k);
+    } else {
+        std::sort(top_keys.begin(), top_keys.end(), by_weight_desc);
+    }
+
+    std::lock_guard<std::mutex> l(_result_lock);
+    _top_keys = std::move(top_keys);
+    _total_weight = total_weight;
+}
+
+std::vector<hotkey_weight> hotkey_sketch::top_keys() const
+{
+    std::lock_guard<std::mutex> l(_result_lock);
+    return _top_keys;
+}
+
+uint64_t hotkey_sketch::total_weight() const
+{
+    std::lock_guard<std::mutex> l(_result_lock);
+    return _total_weight;
+}
+
+} // namespace server
+} // namespace pegasus
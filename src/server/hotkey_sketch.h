@@ -0,0 +1,102 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <dsn/utility/string_view.h>
+
+namespace pegasus {
+namespace server {
+
+struct hotkey_weight
+{
+    std::string key;
+    uint64_t weight;
+};
+
+// space_saving_counter keeps the approximate heaviest keys within bounded memory by the
+// Space-Saving algorithm: once it's full, the key with the minimum weight is replaced by the new
+// key, which inherits the minimum weight, so the weight of a key is never under-estimated.
+class space_saving_counter
+{
+public:
+    explicit space_saving_counter(uint32_t capacity) : _capacity(capacity) {}
+
+    void add(dsn::string_view key, uint64_t weight);
+
+    // Moves the weights of all the counted keys into `weights` and clears the counter.
+    void drain(/*out*/ std::unordered_map<std::string, uint64_t> &weights);
+
+    size_t size() const { return _weights.size(); }
+
+private:
+    const uint32_t _capacity;
+    std::unordered_map<std::string, uint64_t> _weights;
+};
+
+// hotkey_sketch is an always-on sketch of the heaviest keys of a replica.
+//
+// Keys are sampled by the callers (see should_sample()), so that the cost of most requests is
+// only a thread-local random number. The sampled keys are counted into one of the shards chosen
+// by the capturing thread, and the shards are merged periodically into the top-K keys of the last
+// window.
+class hotkey_sketch
+{
+public:
+    hotkey_sketch(uint32_t shard_count, uint32_t capacity_per_shard);
+
+    // Returns true for one of about every `sample_rate` calls on this thread, and always false if
+    // `sample_rate` is 0.
+    static bool should_sample(uint32_t sample_rate);
+
+    void add(dsn::string_view key, uint64_t weight);
+
+    // Merges the shards into the top `top_k` keys of the window since the last merge, and starts
+    // a new window.
+    void merge(uint32_t top_k);
+
+    // The top keys of the last window, ordered by weight descending.
+    std::vector<hotkey_weight> top_keys() const;
+
+    // The total weight of the keys captured in the last window.
+    uint64_t total_weight() const;
+
+private:
+    struct shard
+    {
+        explicit shard(uint32_t capacity) : counter(capacity) {}
+
+        std::mutex lock;
+        space_saving_counter counter;
+        uint64_t total_weight{0};
+    };
+    std::vector<std::unique_ptr<shard>> _shards;
+
+    mutable std::mutex _result_lock; // protects the following result
+    std::vector<hotkey_weight> _top_keys;
+    uint64_t _total_weight{0};
+};
+
+} // namespace server
+} // namespace pegasus
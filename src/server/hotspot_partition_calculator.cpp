@@ -28,14 +28,19 @@
 namespace pegasus {
 namespace server {
 
-DSN_DEFINE_int64("pegasus.collector",
-                 max_hotspot_store_size,
-                 100,
-                 "the max count of historical data "
-                 "stored in calculator, The FIFO "
-                 "queue design is used to "
-                 "eliminate outdated historical "
-                 "data");
+DSN_DEFINE_uint64("pegasus.collector",
+                  hotspot_partition_rate_half_life_ms,
+                  1000,
+                  "half life in milliseconds of the decayed qps and cu of each partition, the "
+                  "smaller it is, the sooner a burst is detected, 0 means no decay");
+DSN_TAG_VARIABLE(hotspot_partition_rate_half_life_ms, FT_MUTABLE);
+
+DSN_DEFINE_uint64("pegasus.collector",
+                  hotspot_table_baseline_half_life_ms,
+                  600000,
+                  "half life in milliseconds of the decayed mean and standard deviation of all "
+                  "partitions in a table, which are the baseline to find the hot partitions");
+DSN_TAG_VARIABLE(hotspot_table_baseline_half_life_ms, FT_MUTABLE);
 
 DSN_DEFINE_bool("pegasus.collector",
                 enable_detect_hotkey,
@@ -50,22 +55,98 @@ DSN_DEFINE_uint32("pegasus.collector",
                   "FLAGS_hotpartition_threshold, this partition is a hot partition");
 DSN_TAG_VARIABLE(hot_partition_threshold, FT_MUTABLE);
 
+// The decayed rates already smooth the short noises, so the hotkey detection is started as soon as
+// a partition is found hot by default.
 DSN_DEFINE_uint32("pegasus.collector",
                   occurrence_threshold,
-                  3,
+                  1,
                   "hot paritiotion occurrence times' threshold to send rpc to detect hotkey");
 DSN_TAG_VARIABLE(occurrence_threshold, FT_MUTABLE);
 
+DSN_DEFINE_uint32("pegasus.collector",
+                  hotkey_detect_start_interval_seconds,
+                  150,
+                  "min interval in seconds to send START of hotkey detection to the same "
+                  "partition, it should be no less than [pegasus.server]max_seconds_to_detect_hotkey "
+                  "so that no START is sent while a detection is running");
+DSN_TAG_VARIABLE(hotkey_detect_start_interval_seconds, FT_MUTABLE);
+
+// The weight of a new sample after `elapsed_ms`, so that the weight of old samples halves every
+// `half_life_ms`.
+static double decay_weight(uint64_t elapsed_ms, uint64_t half_life_ms)
+{
+    if (half_life_ms == 0) {
+        return 1;
+    }
+    return 1 - exp2(-static_cast<double>(elapsed_ms) / half_life_ms);
+}
+
+void decayed_partition_rates::update(const std::vector<double> &snapshot,
+                                     double rate_weight,
+                                     double baseline_weight)
+{
+    if (rates.size() != snapshot.size()) {
+        rates.assign(snapshot.size(), 0);
+        rate_weight = 1;
+        baseline_weight = 1;
+    }
+    double rates_sum = 0, rates_square_sum = 0;
+    for (int i = 0; i < snapshot.size(); i++) {
+        rates[i] = rate_weight * snapshot[i] + (1 - rate_weight) * rates[i];
+        rates_sum += rates[i];
+        rates_square_sum += rates[i] * rates[i];
+    }
+    if (snapshot.empty()) {
+        return;
+    }
+    mean = baseline_weight * (rates_sum / rates.size()) + (1 - baseline_weight) * mean;
+    square_mean = baseline_weight * (rates_square_sum / rates.size()) +
+                  (1 - baseline_weight) * square_mean;
+}
+
+void decayed_partition_rates::calculate_hot_points(/*out*/ std::vector<double> &hot_points) const
+{
+    hot_points.assign(rates.size(), 0);
+    double variance = square_mean - mean * mean;
+    // the variance may be a tiny negative number because of the rounding errors
+    if (variance <= 0) {
+        return;
+    }
+    double standard_deviation = sqrt(variance);
+    for (int i = 0; i < rates.size(); i++) {
+        hot_points[i] = std::max((rates[i] - mean) / standard_deviation, double(0));
+    }
+}
+
 void hotspot_partition_calculator::data_aggregate(const std::vector<row_data> &partition_stats)
 {
-    while (_partitions_stat_histories.size() >= FLAGS_max_hotspot_store_size) {
-        _partitions_stat_histories.pop_front();
+    data_aggregate(partition_stats, dsn_now_ms());
+}
+
+void hotspot_partition_calculator::data_aggregate(const std::vector<row_data> &partition_stats,
+                                                  uint64_t now_ms)
+{
+    double rate_weight = 1, baseline_weight = 1;
+    if (_last_aggregate_time_ms != 0) {
+        uint64_t elapsed_ms =
+            now_ms > _last_aggregate_time_ms ? now_ms - _last_aggregate_time_ms : 0;
+        rate_weight = decay_weight(elapsed_ms, FLAGS_hotspot_partition_rate_half_life_ms);
+        baseline_weight = decay_weight(elapsed_ms, FLAGS_hotspot_table_baseline_half_life_ms);
     }
-    std::vector<hotspot_partition_stat> temp;
-    for (const auto &partition_stat : partition_stats) {
-        temp.emplace_back(hotspot_partition_stat(partition_stat));
+    _last_aggregate_time_ms = now_ms;
+
+    for (int data_type = 0; data_type <= 1; data_type++) {
+        std::vector<double> qps, cu;
+        qps.reserve(partition_stats.size());
+        cu.reserve(partition_stats.size());
+        for (const auto &partition_stat : partition_stats) {
+            hotspot_partition_stat stat(partition_stat);
+            qps.push_back(stat.total_qps[data_type]);
+            cu.push_back(stat.total_cu[data_type]);
+        }
+        _qps_rates[data_type].update(qps, rate_weight, baseline_weight);
+        _cu_rates[data_type].update(cu, rate_weight, baseline_weight);
     }
-    _partitions_stat_histories.emplace_back(temp);
 }
 
 void hotspot_partition_calculator::init_perf_counter(int partition_count)
@@ -93,39 +174,18 @@ void hotspot_partition_calculator::init_perf_counter(int partition_count)
     }
 }
 
-void hotspot_partition_calculator::stat_histories_analyse(uint32_t data_type,
-                                                          std::vector<int> &hot_points)
+void hotspot_partition_calculator::decayed_rates_analyse(uint32_t data_type,
+                                                         std::vector<int> &hot_points)
 {
-    double table_qps_sum = 0, standard_deviation = 0, table_qps_avg = 0;
-    int sample_count = 0;
-    for (const auto &one_partition_stat_histories : _partitions_stat_histories) {
-        for (const auto &partition_stat : one_partition_stat_histories) {
-            table_qps_sum += partition_stat.total_qps[data_type];
-            sample_count++;
-        }
-    }
-    if (sample_count <= 1) {
-        ddebug("_partitions_stat_histories size <= 1, not enough data for calculation");
-        return;
-    }
-    table_qps_avg = table_qps_sum / sample_count;
-    for (const auto &one_partition_stat_histories : _partitions_stat_histories) {
-        for (const auto &partition_stat : one_partition_stat_histories) {
-            standard_deviation += pow((partition_stat.total_qps[data_type] - table_qps_avg), 2);
-        }
-    }
-    standard_deviation = sqrt(standard_deviation / (sample_count - 1));
-    const auto &anly_data = _partitions_stat_histories.back();
+    std::vector<double> qps_hot_points, cu_hot_points;
+    _qps_rates[data_type].calculate_hot_points(qps_hot_points);
+    _cu_rates[data_type].calculate_hot_points(cu_hot_points);
     int hot_point_size = _hot_points.size();
     hot_points.resize(hot_point_size);
     for (int i = 0; i < hot_point_size; i++) {
-        double hot_point = 0;
-        if (standard_deviation != 0) {
-            hot_point = (anly_data[i].total_qps[data_type] - table_qps_avg) / standard_deviation;
-        }
         // perf_counter->set can only be unsigned uint64_t
         // use ceil to guarantee conversion results
-        hot_points[i] = ceil(std::max(hot_point, double(0)));
+        hot_points[i] = ceil(std::max(qps_hot_points[i], cu_hot_points[i]));
     }
 }
 
@@ -146,17 +206,17 @@ void hotspot_partition_calculator::update_hot_point(uint32_t data_type,
 
 void hotspot_partition_calculator::data_analyse()
 {
-    dassert(_partitions_stat_histories.back().size() == _hot_points.size(),
+    dassert(_qps_rates[READ_HOTSPOT_DATA].rates.size() == _hot_points.size(),
             "The number of partitions in this table has changed, and hotspot analysis cannot be "
             "performed,in %s",
             _app_name.c_str());
 
     std::vector<int> read_hot_points;
-    stat_histories_analyse(READ_HOTSPOT_DATA, read_hot_points);
+    decayed_rates_analyse(READ_HOTSPOT_DATA, read_hot_points);
     update_hot_point(READ_HOTSPOT_DATA, read_hot_points);
 
     std::vector<int> write_hot_points;
-    stat_histories_analyse(WRITE_HOTSPOT_DATA, write_hot_points);
+    decayed_rates_analyse(WRITE_HOTSPOT_DATA, write_hot_points);
     update_hot_point(WRITE_HOTSPOT_DATA, write_hot_points);
 
     if (!FLAGS_enable_detect_hotkey) {
@@ -174,6 +234,15 @@ void hotspot_partition_calculator::detect_hotkey_in_hotpartition(int data_type)
     for (int index = 0; index < _hot_points.size(); index++) {
         if (_hot_points[index][data_type].get()->get_value() >= now_hot_partition_threshold) {
             if (++_hotpartition_counter[index][data_type] >= now_occurrence_threshold) {
+                // The partition keeps hot while its hotkey is being detected, so the START is
+                // sent once per detection, which also saves the list_app of every tick.
+                uint64_t &last_start_ms = _last_detect_start_time_ms[index][data_type];
+                if (last_start_ms > 0 &&
+                    _last_aggregate_time_ms <
+                        last_start_ms + FLAGS_hotkey_detect_start_interval_seconds * 1000) {
+                    continue;
+                }
+                last_start_ms = _last_aggregate_time_ms;
                 derror_f("Find a {} hot partition {}.{}",
                          (data_type == partition_qps_type::READ_HOTSPOT_DATA ? "read" : "write"),
                          _app_name,
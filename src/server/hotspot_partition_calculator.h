@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include <array>
 #include <gtest/gtest_prod.h>
 
 #include <dsn/perf_counter/perf_counter.h>
@@ -26,14 +27,17 @@
 namespace pegasus {
 namespace server {
 
-// stores the whole histories of all partitions in one table
-typedef std::list<std::vector<hotspot_partition_stat>> stat_histories;
 // hot_partition_counters c[index_of_partitions][type_of_read(0)/write(1)_stat]
 // so if we have n partitions, we will get 2*n hot_partition_counters, to demonstrate both
 // read/write hotspot value
 typedef std::vector<std::array<dsn::perf_counter_wrapper, 2>> hot_partition_counters;
 
 // hotspot_partition_calculator is used to find the hot partition in a table.
+//
+// The read/write qps and cu of each partition are exponentially decayed by every snapshot, so
+// that a burst is reflected in seconds if the snapshots are taken frequently (see
+// [pegasus.collector]hotspot_detect_interval_ms), while the baseline of the table is decayed much
+// slower. Each snapshot is processed in O(partitions).
 class hotspot_partition_calculator
 {
 public:
@@ -43,13 +47,15 @@ public:
         : _app_name(app_name),
           _hot_points(partition_count),
           _shell_context(context),
-          _hotpartition_counter(partition_count)
+          _hotpartition_counter(partition_count),
+          _last_detect_start_time_ms(partition_count)
     {
         init_perf_counter(partition_count);
     }
     // aggregate related data of hotspot detection
     void data_aggregate(const std::vector<row_data> &partitions);
-    // analyse the saved data to find hotspot partition
+    void data_aggregate(const std::vector<row_data> &partitions, uint64_t now_ms);
+    // analyse the aggregated data to find hotspot partition
     void data_analyse();
     void send_detect_hotkey_request(const std::string &app_name,
                                     const uint64_t partition_index,
@@ -57,9 +63,9 @@ public:
                                     const dsn::replication::detect_action::type action);
 
 private:
-    // empirical rule to calculate hot point of each partition
+    // empirical rule to calculate hot point of each partition, the larger one of qps and cu
     // ref: https://en.wikipedia.org/wiki/68%E2%80%9395%E2%80%9399.7_rule
-    void stat_histories_analyse(uint32_t data_type, std::vector<int> &hot_points);
+    void decayed_rates_analyse(uint32_t data_type, std::vector<int> &hot_points);
     // set hot_point to corresponding perf_counter
     void update_hot_point(uint32_t data_type, const std::vector<int> &hot_points);
     void detect_hotkey_in_hotpartition(int data_type);
@@ -72,8 +78,11 @@ private:
     // per data_analyse
     std::array<dsn::perf_counter_wrapper, 2> _total_hotspot_cnt;
 
-    // saving historical data can improve accuracy
-    stat_histories _partitions_stat_histories;
+    // decayed rates c[type_of_read(0)/write(1)_stat]
+    std::array<decayed_partition_rates, 2> _qps_rates;
+    std::array<decayed_partition_rates, 2> _cu_rates;
+    // 0 if no data has been aggregated
+    uint64_t _last_aggregate_time_ms = 0;
     std::shared_ptr<shell_context> _shell_context;
 
     // _hotpartition_counter p[index_of_partitions][type_of_read(0)/write(1)_stat]
@@ -81,6 +90,9 @@ private:
     // If the hot_point of some partitions are always high, calculator will send a RPC to detect
     // hotkey on the replica automatically
     std::vector<std::array<int, 2>> _hotpartition_counter;
+    // _last_detect_start_time_ms t[index_of_partitions][type_of_read(0)/write(1)_stat]
+    // the aggregate time when START of hotkey detection was last sent to the partition, 0 if never
+    std::vector<std::array<uint64_t, 2>> _last_detect_start_time_ms;
 
     typedef dsn::rpc_holder<detect_hotkey_request, detect_hotkey_response> detect_hotkey_rpc;
 
@@ -17,6 +17,8 @@
 
 #pragma once
 
+#include <vector>
+
 #include "shell/command_helper.h"
 
 namespace pegasus {
@@ -34,9 +36,28 @@ struct hotspot_partition_stat
     {
         total_qps[READ_HOTSPOT_DATA] = row.get_total_read_qps();
         total_qps[WRITE_HOTSPOT_DATA] = row.get_total_write_qps();
+        total_cu[READ_HOTSPOT_DATA] = row.recent_read_cu;
+        total_cu[WRITE_HOTSPOT_DATA] = row.recent_write_cu;
     }
     hotspot_partition_stat() {}
     double total_qps[2];
+    double total_cu[2];
+};
+
+// The exponentially decayed rates of one metric (qps or cu) of all the partitions in a table,
+// together with the decayed mean and the decayed mean of squares over the partitions, which are
+// the baseline of the 3-sigma rule. All of them are updated incrementally by each snapshot.
+struct decayed_partition_rates
+{
+    // `rate_weight` and `baseline_weight` are the weights of the new snapshot, in [0, 1].
+    void update(const std::vector<double> &snapshot, double rate_weight, double baseline_weight);
+
+    // hot_points[i] = (rates[i] - mean) / standard_deviation, 0 if it's not positive.
+    void calculate_hot_points(/*out*/ std::vector<double> &hot_points) const;
+
+    std::vector<double> rates;
+    double mean = 0;
+    double square_mean = 0;
 };
 
 } // namespace server
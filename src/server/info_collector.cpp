@@ -26,6 +26,7 @@
 #include <dsn/tool-api/group_address.h>
 #include <dsn/dist/replication/duplication_common.h>
 #include <dsn/dist/fmt_logging.h>
+#include <dsn/utility/flags.h>
 
 #include "base/pegasus_const.h"
 #include "result_writer.h"
@@ -44,6 +45,16 @@ DEFINE_TASK_CODE(LPC_PEGASUS_CAPACITY_UNIT_STAT_TIMER,
 DEFINE_TASK_CODE(LPC_PEGASUS_STORAGE_SIZE_STAT_TIMER,
                  TASK_PRIORITY_COMMON,
                  ::dsn::THREAD_POOL_DEFAULT)
+DEFINE_TASK_CODE(LPC_PEGASUS_HOTSPOT_DETECT_TIMER,
+                 TASK_PRIORITY_COMMON,
+                 ::dsn::THREAD_POOL_DEFAULT)
+
+DSN_DEFINE_uint32("pegasus.collector",
+                  hotspot_detect_interval_ms,
+                  0,
+                  "interval in milliseconds to poll the partition stats and detect hotspot "
+                  "partitions, 0 means detecting along with the app stat in every "
+                  "app_stat_interval_seconds");
 
 info_collector::info_collector()
 {
@@ -136,6 +147,16 @@ void info_collector::start()
         std::chrono::seconds(_storage_size_fetch_interval_seconds),
         0,
         std::chrono::minutes(1));
+
+    if (FLAGS_hotspot_detect_interval_ms > 0) {
+        _hotspot_detect_timer_task = ::dsn::tasking::enqueue_timer(
+            LPC_PEGASUS_HOTSPOT_DETECT_TIMER,
+            &_tracker,
+            [this] { on_hotspot_detect(); },
+            std::chrono::milliseconds(FLAGS_hotspot_detect_interval_ms),
+            0,
+            std::chrono::minutes(1));
+    }
 }
 
 void info_collector::stop() { _tracker.cancel_outstanding_tasks(); }
@@ -160,11 +181,10 @@ void info_collector::on_app_stat()
         // get row data statistics for all of the apps
         all_stats.aggregate(app_stats);
 
-        // hotspot_partition_calculator is used for detecting hotspots
-        auto hotspot_partition_calculator =
-            get_hotspot_calculator(app_rows.first, app_rows.second.size());
-        hotspot_partition_calculator->data_aggregate(app_rows.second);
-        hotspot_partition_calculator->data_analyse();
+        // hotspots are detected by a separate timer if hotspot_detect_interval_ms is set
+        if (FLAGS_hotspot_detect_interval_ms == 0) {
+            detect_hotspot(app_rows.first, app_rows.second);
+        }
     }
     get_app_counters(all_stats.row_name)->set(all_stats);
 
@@ -174,6 +194,27 @@ void info_collector::on_app_stat()
              all_stats.get_total_write_qps());
 }
 
+void info_collector::on_hotspot_detect()
+{
+    std::map<std::string, std::vector<row_data>> all_rows;
+    if (!get_app_partition_stat(_shell_context.get(), all_rows)) {
+        derror("call get_app_partition_stat() failed when detecting hotspot");
+        return;
+    }
+    for (const auto &app_rows : all_rows) {
+        detect_hotspot(app_rows.first, app_rows.second);
+    }
+}
+
+void info_collector::detect_hotspot(const std::string &app_name,
+                                    const std::vector<row_data> &partition_rows)
+{
+    // hotspot_partition_calculator is used for detecting hotspots
+    auto hotspot_partition_calculator = get_hotspot_calculator(app_name, partition_rows.size());
+    hotspot_partition_calculator->data_aggregate(partition_rows);
+    hotspot_partition_calculator->data_analyse();
+}
+
 info_collector::app_stat_counters *info_collector::get_app_counters(const std::string &app_name)
 {
     ::dsn::utils::auto_lock<::dsn::utils::ex_lock_nr> l(_app_stat_counter_lock);
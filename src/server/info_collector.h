@@ -175,6 +175,8 @@ public:
 
     void on_storage_size_stat(int remaining_retry_count);
 
+    void on_hotspot_detect();
+
 private:
     dsn::task_tracker _tracker;
     ::dsn::rpc_address _meta_servers;
@@ -208,6 +210,8 @@ private:
     std::map<std::string, std::shared_ptr<hotspot_partition_calculator>> _hotspot_calculator_store;
     std::shared_ptr<hotspot_partition_calculator>
     get_hotspot_calculator(const std::string &app_name, const int partition_count);
+    void detect_hotspot(const std::string &app_name, const std::vector<row_data> &partition_rows);
+    ::dsn::task_ptr _hotspot_detect_timer_task;
 };
 
 } // namespace server
@@ -22,6 +22,7 @@
 #include "info_collector_app.h"
 #include "brief_stat.h"
 #include "compaction_operation.h"
+#include "hotkey_collector.h"
 
 #include <pegasus/version.h>
 #include <pegasus/git_commit.h>
@@ -89,6 +90,7 @@ void dsn_app_registration_pegasus()
         "server-stat",
         [](const std::vector<std::string> &args) { return pegasus::get_brief_stat(); });
     pegasus::server::register_compaction_operations();
+    pegasus::server::register_hotkey_commands();
 }
 
 int main(int argc, char **argv)
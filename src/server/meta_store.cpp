@@ -29,6 +29,9 @@ const std::string meta_store::DATA_VERSION = "pegasus_data_version";
 const std::string meta_store::LAST_FLUSHED_DECREE = "pegasus_last_flushed_decree";
 const std::string meta_store::LAST_MANUAL_COMPACT_FINISH_TIME =
     "pegasus_last_manual_compact_finish_time";
+const std::string meta_store::SPLIT_CLEANED_PARTITION_VERSION =
+    "pegasus_split_cleaned_partition_version";
+const std::string meta_store::SPLIT_STALE_BYTES_REMAINING = "pegasus_split_stale_bytes_remaining";
 
 meta_store::meta_store(pegasus_server_impl *server,
                        rocksdb::DB *db,
@@ -86,6 +89,28 @@ std::string meta_store::get_usage_scenario() const
     return usage_scenario;
 }
 
+int64_t meta_store::get_split_cleaned_partition_version() const
+{
+    uint64_t partition_version = 0;
+    auto ec = get_value_from_meta_cf(false, SPLIT_CLEANED_PARTITION_VERSION, &partition_version);
+    if (ec == ::dsn::ERR_OBJECT_NOT_FOUND) {
+        return -1;
+    }
+    dcheck_eq_replica(::dsn::ERR_OK, ec);
+    return static_cast<int64_t>(partition_version);
+}
+
+uint64_t meta_store::get_split_stale_bytes_remaining() const
+{
+    uint64_t stale_bytes = 0;
+    auto ec = get_value_from_meta_cf(false, SPLIT_STALE_BYTES_REMAINING, &stale_bytes);
+    dassert_replica(ec == ::dsn::ERR_OK || ec == ::dsn::ERR_OBJECT_NOT_FOUND,
+                    "get {} from meta column family failed: {}",
+                    SPLIT_STALE_BYTES_REMAINING,
+                    ec.to_string());
+    return stale_bytes;
+}
+
 ::dsn::error_code meta_store::get_value_from_meta_cf(bool read_flushed_data,
                                                      const std::string &key,
                                                      uint64_t *value) const
@@ -183,5 +208,18 @@ void meta_store::set_usage_scenario(const std::string &usage_scenario) const
                       set_string_value_to_meta_cf(ROCKSDB_ENV_USAGE_SCENARIO_KEY, usage_scenario));
 }
 
+void meta_store::set_split_cleaned_partition_version(int32_t partition_version) const
+{
+    dcheck_eq_replica(::dsn::ERR_OK,
+                      set_value_to_meta_cf(SPLIT_CLEANED_PARTITION_VERSION,
+                                           static_cast<uint64_t>(partition_version)));
+}
+
+void meta_store::set_split_stale_bytes_remaining(uint64_t stale_bytes) const
+{
+    dcheck_eq_replica(::dsn::ERR_OK,
+                      set_value_to_meta_cf(SPLIT_STALE_BYTES_REMAINING, stale_bytes));
+}
+
 } // namespace server
 } // namespace pegasus
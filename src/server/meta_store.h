@@ -35,6 +35,8 @@ class pegasus_server_impl;
 // - pegasus_data_version
 // - pegasus_last_flushed_decree
 // - pegasus_last_manual_compact_finish_time
+// - pegasus_split_cleaned_partition_version
+// - pegasus_split_stale_bytes_remaining
 class meta_store : public dsn::replication::replica_base
 {
 public:
@@ -46,11 +48,17 @@ public:
     uint32_t get_data_version() const;
     uint64_t get_last_manual_compact_finish_time() const;
     std::string get_usage_scenario() const;
+    // Returns the partition version whose stale split data has been cleaned up, or -1 if the
+    // stale data has never been cleaned up.
+    int64_t get_split_cleaned_partition_version() const;
+    uint64_t get_split_stale_bytes_remaining() const;
 
     void set_last_flushed_decree(uint64_t decree) const;
     void set_data_version(uint32_t version) const;
     void set_last_manual_compact_finish_time(uint64_t last_manual_compact_finish_time) const;
     void set_usage_scenario(const std::string &usage_scenario) const;
+    void set_split_cleaned_partition_version(int32_t partition_version) const;
+    void set_split_stale_bytes_remaining(uint64_t stale_bytes) const;
 
 private:
     ::dsn::error_code
@@ -80,6 +88,8 @@ private:
     static const std::string DATA_VERSION;
     static const std::string LAST_FLUSHED_DECREE;
     static const std::string LAST_MANUAL_COMPACT_FINISH_TIME;
+    static const std::string SPLIT_CLEANED_PARTITION_VERSION;
+    static const std::string SPLIT_STALE_BYTES_REMAINING;
 
     rocksdb::DB *_db;
     rocksdb::ColumnFamilyHandle *_meta_cf;
@@ -0,0 +1,294 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "pegasus_cdc_duplicator.h"
+
+#include <algorithm>
+
+#include <dsn/c/api_utilities.h>
+#include <dsn/cpp/message_utils.h>
+#include <dsn/dist/fmt_logging.h>
+#include <dsn/dist/replication/replication.codes.h>
+#include <dsn/tool-api/async_calls.h>
+#include <dsn/tool-api/rpc_message.h>
+#include <dsn/utility/chrono_literals.h>
+#include <dsn/utility/flags.h>
+#include <dsn/utility/rand.h>
+#include <dsn/utility/strings.h>
+#include <rrdb/rrdb.code.definition.h>
+#include <rrdb/rrdb_types.h>
+
+#include "base/pegasus_key_schema.h"
+#include "base/pegasus_utils.h"
+#include "duplication_compression.h"
+
+namespace pegasus {
+namespace server {
+
+using namespace dsn::literals::chrono_literals;
+
+DEFINE_TASK_CODE(LPC_CDC_SHIP, TASK_PRIORITY_COMMON, THREAD_POOL_BLOCK_SERVICE)
+
+DSN_DEFINE_string("pegasus.server",
+                  cdc_consumers,
+                  "",
+                  "comma-separated names of the cdc consumers, the duplications to these remote "
+                  "clusters deliver change events to the sinks configured in [pegasus.cdc.<name>] "
+                  "instead of shipping the writes to remote clusters");
+
+static std::string escape(const dsn::blob &data) { return utils::c_escape_string(data); }
+
+static void decode_multi_put(int64_t timestamp,
+                             const dsn::apps::multi_put_request &request,
+                             std::vector<cdc_event> &events)
+{
+    cdc_event event;
+    event.timestamp = timestamp;
+    event.op = "multi_put";
+    event.hash_key = escape(request.hash_key);
+    for (const auto &kv : request.kvs) {
+        event.sort_keys.emplace_back(escape(kv.key));
+        event.values.emplace_back(escape(kv.value));
+    }
+    event.expire_ts_seconds = request.expire_ts_seconds;
+    events.emplace_back(std::move(event));
+}
+
+static bool decode_duplicate(int64_t timestamp,
+                             const dsn::blob &data,
+                             std::vector<cdc_event> &events)
+{
+    dsn::apps::duplicate_request request;
+    dsn::from_blob_to_thrift(data, request);
+
+    auto decode_write = [&](dsn::task_code code, const dsn::blob &message) {
+        // a DUPLICATE never contains another DUPLICATE
+        return code != dsn::apps::RPC_RRDB_RRDB_DUPLICATE &&
+               decode_cdc_events(timestamp, code, message, events);
+    };
+
+    std::string error_hint;
+    if (request.__isset.entries) {
+        std::vector<dsn::apps::duplicate_entry> entries;
+        if (!is_duplicate_compressed(request)) {
+            entries = request.entries;
+        } else if (!decompress_duplicate_entries(
+                       request.compression_type, request.raw_message, entries, error_hint)) {
+            derror_f("failed to decompress the DUPLICATE in mutation log: {}", error_hint);
+            return false;
+        }
+        for (const auto &entry : entries) {
+            if (!decode_write(entry.task_code, entry.raw_message)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    dsn::blob message = request.raw_message;
+    if (is_duplicate_compressed(request) &&
+        !decompress_duplicate_payload(
+            request.compression_type, request.raw_message, message, error_hint)) {
+        derror_f("failed to decompress the DUPLICATE in mutation log: {}", error_hint);
+        return false;
+    }
+    return decode_write(request.task_code, message);
+}
+
+bool decode_cdc_events(int64_t timestamp,
+                       dsn::task_code code,
+                       const dsn::blob &data,
+                       std::vector<cdc_event> &events)
+{
+    if (code == dsn::apps::RPC_RRDB_RRDB_PUT) {
+        dsn::apps::update_request request;
+        dsn::from_blob_to_thrift(data, request);
+        dsn::blob hash_key, sort_key;
+        pegasus_restore_key(request.key, hash_key, sort_key);
+
+        cdc_event event;
+        event.timestamp = timestamp;
+        event.op = "put";
+        event.hash_key = escape(hash_key);
+        event.sort_keys.emplace_back(escape(sort_key));
+        event.values.emplace_back(escape(request.value));
+        event.expire_ts_seconds = request.expire_ts_seconds;
+        events.emplace_back(std::move(event));
+        return true;
+    }
+    if (code == dsn::apps::RPC_RRDB_RRDB_REMOVE) {
+        dsn::blob key;
+        dsn::from_blob_to_thrift(data, key);
+        dsn::blob hash_key, sort_key;
+        pegasus_restore_key(key, hash_key, sort_key);
+
+        cdc_event event;
+        event.timestamp = timestamp;
+        event.op = "remove";
+        event.hash_key = escape(hash_key);
+        event.sort_keys.emplace_back(escape(sort_key));
+        events.emplace_back(std::move(event));
+        return true;
+    }
+    if (code == dsn::apps::RPC_RRDB_RRDB_MULTI_PUT) {
+        dsn::apps::multi_put_request request;
+        dsn::from_blob_to_thrift(data, request);
+        decode_multi_put(timestamp, request, events);
+        return true;
+    }
+    if (code == dsn::apps::RPC_RRDB_RRDB_MULTI_REMOVE) {
+        dsn::apps::multi_remove_request request;
+        dsn::from_blob_to_thrift(data, request);
+
+        cdc_event event;
+        event.timestamp = timestamp;
+        event.op = "multi_remove";
+        event.hash_key = escape(request.hash_key);
+        for (const auto &sort_key : request.sort_keys) {
+            event.sort_keys.emplace_back(escape(sort_key));
+        }
+        events.emplace_back(std::move(event));
+        return true;
+    }
+    if (code == dsn::apps::RPC_RRDB_RRDB_DUPLICATE) {
+        return decode_duplicate(timestamp, data, events);
+    }
+    return false;
+}
+
+bool is_cdc_consumer(dsn::string_view remote_cluster)
+{
+    std::vector<std::string> consumers;
+    dsn::utils::split_args(FLAGS_cdc_consumers, consumers, ',');
+    return std::find(consumers.begin(), consumers.end(), remote_cluster) != consumers.end();
+}
+
+pegasus_cdc_duplicator::pegasus_cdc_duplicator(dsn::replication::replica_base *r,
+                                               dsn::string_view consumer,
+                                               dsn::string_view app)
+    : mutation_duplicator(r), _consumer(consumer.data(), consumer.length())
+{
+    std::string section = fmt::format("pegasus.cdc.{}", _consumer);
+    std::string sink = dsn_config_get_value_string(
+        section.c_str(), "sink", "", "where the change events are delivered");
+
+    // e.g. temp.1.2
+    std::string name = fmt::format("{}.{}", app, get_gpid());
+    _sink = cdc_sink::create(sink, name);
+    dassert_replica(_sink != nullptr, "invalid sink of cdc consumer {}: {}", _consumer, sink);
+
+    ddebug_replica("initialize cdc duplicator for consumer {}: sink = {}", _consumer, sink);
+
+    std::string str_gpid = fmt::format("{}", get_gpid());
+    _shipped_events.init_app_counter("app.pegasus",
+                                     fmt::format("cdc_shipped_events@{}", str_gpid).c_str(),
+                                     COUNTER_TYPE_RATE,
+                                     "the qps of change events delivered to cdc consumers");
+    _shipped_bytes.init_app_counter("app.pegasus",
+                                    fmt::format("cdc_shipped_bytes@{}", str_gpid).c_str(),
+                                    COUNTER_TYPE_RATE,
+                                    "the throughput of change events delivered to cdc consumers");
+    _failed_shipping_ops.init_app_counter(
+        "app.pegasus",
+        fmt::format("cdc_failed_shipping_ops@{}", str_gpid).c_str(),
+        COUNTER_TYPE_RATE,
+        "the qps of failed deliveries of change events");
+    _shipping_lag_ms.init_app_counter(
+        "app.pegasus",
+        fmt::format("cdc_shipping_lag_ms@{}", str_gpid).c_str(),
+        COUNTER_TYPE_NUMBER,
+        "the time lag in milliseconds from the newest write of the last delivered batch being "
+        "generated to being delivered");
+    _skipped_writes.init_app_counter("app.pegasus",
+                                     fmt::format("cdc_skipped_writes@{}", str_gpid).c_str(),
+                                     COUNTER_TYPE_RATE,
+                                     "the qps of writes skipped by cdc because they can't be "
+                                     "decoded into change events");
+}
+
+void pegasus_cdc_duplicator::duplicate(mutation_tuple_set muts, callback cb)
+{
+    auto batch = std::make_shared<std::string>();
+    int64_t last_timestamp = 0;
+    size_t event_count = 0;
+    std::vector<cdc_event> events;
+    for (const auto &mut : muts) {
+        // mut: 0=timestamp, 1=rpc_code, 2=raw_message
+        int64_t timestamp = std::get<0>(mut);
+        events.clear();
+        if (!decode_cdc_events(timestamp, std::get<1>(mut), std::get<2>(mut), events)) {
+            _skipped_writes->increment();
+            derror_replica("skip the write {} of cdc consumer {} which can't be decoded "
+                           "[timestamp:{}, size:{}]",
+                           std::get<1>(mut),
+                           _consumer,
+                           timestamp,
+                           std::get<2>(mut).length());
+            continue;
+        }
+        for (const auto &event : events) {
+            dsn::blob line = dsn::json::json_forwarder<cdc_event>::encode(event);
+            batch->append(line.data(), line.length());
+            batch->push_back('\n');
+        }
+        event_count += events.size();
+        last_timestamp = std::max(last_timestamp, timestamp);
+    }
+
+    if (event_count == 0) {
+        cb(0);
+        return;
+    }
+    ship(batch, last_timestamp, event_count, cb, std::chrono::milliseconds(0));
+}
+
+void pegasus_cdc_duplicator::ship(std::shared_ptr<std::string> batch,
+                                  int64_t last_timestamp,
+                                  size_t event_count,
+                                  callback cb,
+                                  std::chrono::milliseconds delay)
+{
+    dsn::tasking::enqueue(
+        LPC_CDC_SHIP,
+        _env.__conf.tracker,
+        [this, batch, last_timestamp, event_count, cb]() {
+            auto err = _sink->write(*batch);
+            if (err != dsn::ERR_OK) {
+                _failed_shipping_ops->increment();
+                // randomly log the 1% of the failed deliveries, they're retried infinitely.
+                if (dsn::rand::next_double01() <= 0.01) {
+                    derror_replica("deliver {} change events to cdc consumer {} failed: {}",
+                                   event_count,
+                                   _consumer,
+                                   err);
+                }
+                ship(batch, last_timestamp, event_count, cb, 1_s);
+                return;
+            }
+
+            _shipped_events->add(event_count);
+            _shipped_bytes->add(batch->size());
+            _shipping_lag_ms->set((dsn_now_us() - last_timestamp) / 1000);
+            // the duplication confirms the mutations of this batch after the callback
+            cb(batch->size());
+        },
+        0,
+        delay);
+}
+
+} // namespace server
+} // namespace pegasus
@@ -0,0 +1,120 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <dsn/cpp/json_helper.h>
+#include <dsn/dist/replication/mutation_duplicator.h>
+#include <dsn/perf_counter/perf_counter_wrapper.h>
+
+#include "cdc_sink.h"
+
+namespace pegasus {
+namespace server {
+
+// A change event decoded from a write in the mutation log. The keys and values are c-escaped,
+// so the encoded event is always printable.
+struct cdc_event
+{
+    // the timestamp in microseconds of the mutation which contains this write
+    int64_t timestamp = 0;
+    // put, remove, multi_put or multi_remove
+    std::string op;
+    std::string hash_key;
+    std::vector<std::string> sort_keys;
+    // the values of put and multi_put, in the order of `sort_keys`
+    std::vector<std::string> values;
+    int32_t expire_ts_seconds = 0;
+    DEFINE_JSON_SERIALIZATION(timestamp, op, hash_key, sort_keys, values, expire_ts_seconds)
+};
+
+// Decodes the write of `code` in the mutation log into change events. A DUPLICATE from another
+// cluster is decoded into the events of the writes in it. Returns false if it can't be decoded.
+bool decode_cdc_events(int64_t timestamp,
+                       dsn::task_code code,
+                       const dsn::blob &data,
+                       /*out*/ std::vector<cdc_event> &events);
+
+// Whether the remote cluster of a duplication is a cdc consumer, see `cdc_consumers`.
+bool is_cdc_consumer(dsn::string_view remote_cluster);
+
+// pegasus_cdc_duplicator delivers the mutations loaded by the duplication to a cdc consumer
+// as an ordered stream of change events, instead of shipping them to a remote cluster.
+//
+// A consumer is a duplication whose remote cluster is listed in `cdc_consumers`, and it's
+// configured in section [pegasus.cdc.<consumer>]:
+//   - sink: where the events are delivered, see `cdc_sink::create`.
+//
+// Each batch of loaded mutations is delivered as a batch of JSON lines, and the next batch is
+// not loaded until it's delivered, so a slow consumer backs the duplication up rather than
+// buffering the events in memory. A failed delivery is retried every second. The deliveries
+// block on the sink, so they're done in THREAD_POOL_BLOCK_SERVICE rather than the pool of the
+// duplication.
+//
+// The position of the consumer is the confirmed decree of the duplication, which is advanced
+// only after a batch is delivered, and is kept by the meta server. So after a restart or a
+// primary switch, the new primary resumes from the confirmed decree on whichever server it is.
+// The events are delivered at least once: the mutations after the confirmed decree may be
+// delivered again.
+//
+// A consumer can't subscribe from a given decree. The mutations are handed to the duplicator
+// without their decrees, so the stream starts where the duplication starts, that is the
+// confirmed decree assigned by the meta server when the duplication is added.
+//
+// The writes which can't be decoded are skipped and counted by `cdc_skipped_writes`, rather
+// than stopping the stream.
+class pegasus_cdc_duplicator : public dsn::replication::mutation_duplicator
+{
+    using mutation_tuple_set = dsn::replication::mutation_tuple_set;
+
+public:
+    pegasus_cdc_duplicator(dsn::replication::replica_base *r,
+                           dsn::string_view consumer,
+                           dsn::string_view app);
+
+    ~pegasus_cdc_duplicator() override { _env.__conf.tracker->cancel_outstanding_tasks(); }
+
+    void duplicate(mutation_tuple_set muts, callback cb) override;
+
+private:
+    friend class pegasus_cdc_duplicator_test;
+
+    // Delivers `batch` to the sink in THREAD_POOL_BLOCK_SERVICE after `delay`, retries until
+    // succeeded.
+    void ship(std::shared_ptr<std::string> batch,
+              int64_t last_timestamp,
+              size_t event_count,
+              callback cb,
+              std::chrono::milliseconds delay);
+
+    const std::string _consumer;
+    std::unique_ptr<cdc_sink> _sink;
+
+    dsn::perf_counter_wrapper _shipped_events;
+    dsn::perf_counter_wrapper _shipped_bytes;
+    dsn::perf_counter_wrapper _failed_shipping_ops;
+    dsn::perf_counter_wrapper _shipping_lag_ms;
+    dsn::perf_counter_wrapper _skipped_writes;
+};
+
+} // namespace server
+} // namespace pegasus
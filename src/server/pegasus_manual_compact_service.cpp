@@ -41,7 +41,11 @@ pegasus_manual_compact_service::pegasus_manual_compact_service(pegasus_server_im
       _manual_compact_enqueue_time_ms(0),
       _manual_compact_start_running_time_ms(0),
       _manual_compact_last_finish_time_ms(0),
-      _manual_compact_last_time_used_ms(0)
+      _manual_compact_last_time_used_ms(0),
+      _split_cleanup_last_finish_time_ms(0),
+      _split_cleanup_total_ranges(0),
+      _split_cleanup_finished_ranges(0),
+      _split_cleanup_stale_bytes_remaining(0)
 {
     _manual_compact_min_interval_seconds = (int32_t)dsn_config_get_value_uint64(
         "pegasus.server",
@@ -66,6 +70,12 @@ void pegasus_manual_compact_service::init_last_finish_time_ms(uint64_t last_fini
     _manual_compact_last_finish_time_ms.store(last_finish_time_ms);
 }
 
+void pegasus_manual_compact_service::init_split_cleanup_stale_bytes_remaining(
+    uint64_t stale_bytes_remaining)
+{
+    _split_cleanup_stale_bytes_remaining.store(stale_bytes_remaining);
+}
+
 void pegasus_manual_compact_service::start_manual_compact_if_needed(
     const std::map<std::string, std::string> &envs)
 {
@@ -79,6 +89,20 @@ void pegasus_manual_compact_service::start_manual_compact_if_needed(
         return;
     }
 
+    if (check_split_cleanup(envs)) {
+        if (check_manual_compact_state()) {
+            _pfc_manual_compact_enqueue_count->increment();
+            dsn::tasking::enqueue(LPC_MANUAL_COMPACT, &_app->_tracker, [this]() {
+                _pfc_manual_compact_enqueue_count->decrement();
+                split_cleanup();
+            });
+        } else {
+            ddebug_replica("ignored split cleanup because last compact is on going or just "
+                           "finished");
+        }
+        return;
+    }
+
     std::string compact_rule;
     if (check_once_compact(envs)) {
         compact_rule = MANUAL_COMPACT_ONCE_KEY_PREFIX;
@@ -204,6 +228,27 @@ bool pegasus_manual_compact_service::check_periodic_compact(
     return false;
 }
 
+bool pegasus_manual_compact_service::check_split_cleanup(
+    const std::map<std::string, std::string> &envs)
+{
+    auto find = envs.find(MANUAL_COMPACT_SPLIT_CLEANUP_TRIGGER_TIME_KEY);
+    if (find == envs.end()) {
+        return false;
+    }
+
+    int64_t trigger_time = 0;
+    if (!dsn::buf2int64(find->second, trigger_time) || trigger_time <= 0) {
+        derror_replica("{}={} is invalid.", find->first, find->second);
+        return false;
+    }
+
+    if (_app->is_split_data_cleaned()) {
+        return false;
+    }
+
+    return trigger_time > _split_cleanup_last_finish_time_ms.load() / 1000;
+}
+
 uint64_t pegasus_manual_compact_service::now_timestamp()
 {
 #ifdef PEGASUS_UNIT_TEST
@@ -284,13 +329,7 @@ void pegasus_manual_compact_service::manual_compact(const rocksdb::CompactRangeO
         return;
     }
 
-    // if current running count exceeds the limit, it would not to be started.
-    _pfc_manual_compact_running_count->increment();
-    if (_pfc_manual_compact_running_count->get_integer_value() > _max_concurrent_running_count) {
-        _pfc_manual_compact_running_count->decrement();
-        ddebug_replica("ignored compact because exceed max_concurrent_running_count({})",
-                       _max_concurrent_running_count.load());
-        _manual_compact_enqueue_time_ms.store(0);
+    if (!begin_running()) {
         return;
     }
 
@@ -301,6 +340,47 @@ void pegasus_manual_compact_service::manual_compact(const rocksdb::CompactRangeO
     _pfc_manual_compact_running_count->decrement();
 }
 
+void pegasus_manual_compact_service::split_cleanup()
+{
+    if (_disabled.load()) {
+        ddebug_replica("ignored split cleanup because disabled");
+        _manual_compact_enqueue_time_ms.store(0);
+        return;
+    }
+
+    if (!begin_running()) {
+        return;
+    }
+
+    uint64_t start = begin_manual_compact();
+    _split_cleanup_total_ranges.store(0);
+    _split_cleanup_finished_ranges.store(0);
+    uint64_t finish = _app->do_split_cleanup_compact(
+        [this](uint32_t finished_ranges, uint32_t total_ranges, uint64_t stale_bytes_remaining) {
+            _split_cleanup_total_ranges.store(total_ranges);
+            _split_cleanup_finished_ranges.store(finished_ranges);
+            _split_cleanup_stale_bytes_remaining.store(stale_bytes_remaining);
+        });
+    _split_cleanup_last_finish_time_ms.store(finish);
+    end_manual_compact(start, finish);
+
+    _pfc_manual_compact_running_count->decrement();
+}
+
+bool pegasus_manual_compact_service::begin_running()
+{
+    // if current running count exceeds the limit, it would not to be started.
+    _pfc_manual_compact_running_count->increment();
+    if (_pfc_manual_compact_running_count->get_integer_value() > _max_concurrent_running_count) {
+        _pfc_manual_compact_running_count->decrement();
+        ddebug_replica("ignored compact because exceed max_concurrent_running_count({})",
+                       _max_concurrent_running_count.load());
+        _manual_compact_enqueue_time_ms.store(0);
+        return false;
+    }
+    return true;
+}
+
 uint64_t pegasus_manual_compact_service::begin_manual_compact()
 {
     ddebug_replica("start to execute manual compaction");
@@ -348,6 +428,18 @@ std::string pegasus_manual_compact_service::query_compact_state() const
         dsn::utils::time_ms_to_string(start_time_ms, str);
         state << ", recent start at [" << str << "]";
     }
+
+    uint32_t split_cleanup_total_ranges = _split_cleanup_total_ranges.load();
+    uint64_t split_cleanup_stale_bytes_remaining = _split_cleanup_stale_bytes_remaining.load();
+    if (split_cleanup_total_ranges > 0) {
+        state << ", split cleanup finished " << _split_cleanup_finished_ranges.load() << "/"
+              << split_cleanup_total_ranges << " ranges, about "
+              << split_cleanup_stale_bytes_remaining << " stale bytes remaining";
+    } else if (split_cleanup_stale_bytes_remaining > 0) {
+        // the split cleanup was interrupted by restart, the estimate is restored from meta_store
+        state << ", split cleanup unfinished, about " << split_cleanup_stale_bytes_remaining
+              << " stale bytes remaining";
+    }
     return state.str();
 }
 
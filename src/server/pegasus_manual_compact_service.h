@@ -36,6 +36,9 @@ public:
 
     void init_last_finish_time_ms(uint64_t last_finish_time_ms);
 
+    // restore the estimated stale bytes of an unfinished split cleanup after restart.
+    void init_split_cleanup_stale_bytes_remaining(uint64_t stale_bytes_remaining);
+
     void start_manual_compact_if_needed(const std::map<std::string, std::string> &envs);
 
     std::string query_compact_state() const;
@@ -55,12 +58,20 @@ private:
     // return true if need do periodic manual compaction.
     bool check_periodic_compact(const std::map<std::string, std::string> &envs);
 
+    // return true if need do manual compaction to clean up the stale data after partition split.
+    bool check_split_cleanup(const std::map<std::string, std::string> &envs);
+
     void extract_manual_compact_opts(const std::map<std::string, std::string> &envs,
                                      const std::string &key_prefix,
                                      rocksdb::CompactRangeOptions &options);
 
     void manual_compact(const rocksdb::CompactRangeOptions &options);
 
+    void split_cleanup();
+
+    // return true if the compaction is allowed to run now, the running count will be increased.
+    bool begin_running();
+
     // return manual compact start time in ms.
     uint64_t begin_manual_compact();
 
@@ -87,6 +98,12 @@ private:
     std::atomic<uint64_t> _manual_compact_last_finish_time_ms;
     std::atomic<uint64_t> _manual_compact_last_time_used_ms;
 
+    // split cleanup state
+    std::atomic<uint64_t> _split_cleanup_last_finish_time_ms;
+    std::atomic<uint32_t> _split_cleanup_total_ranges;
+    std::atomic<uint32_t> _split_cleanup_finished_ranges;
+    std::atomic<uint64_t> _split_cleanup_stale_bytes_remaining;
+
     ::dsn::perf_counter_wrapper _pfc_manual_compact_enqueue_count;
     ::dsn::perf_counter_wrapper _pfc_manual_compact_running_count;
 };
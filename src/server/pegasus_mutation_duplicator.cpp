@@ -18,12 +18,18 @@
  */
 
 #include "pegasus_mutation_duplicator.h"
+#include "pegasus_cdc_duplicator.h"
 #include "pegasus_server_impl.h"
+#include "duplication_compression.h"
 #include "base/pegasus_rpc_types.h"
 
+#include <algorithm>
+
 #include <dsn/cpp/message_utils.h>
 #include <dsn/utility/chrono_literals.h>
 #include <dsn/dist/replication/duplication_common.h>
+#include <dsn/utility/flags.h>
+#include <dsn/utility/strings.h>
 #include <rrdb/rrdb.client.h>
 
 namespace dsn {
@@ -33,7 +39,12 @@ namespace replication {
 /*static*/ std::function<std::unique_ptr<mutation_duplicator>(
     replica_base *, string_view, string_view)>
     mutation_duplicator::creator = [](replica_base *r, string_view remote, string_view app) {
-        return make_unique<pegasus::server::pegasus_mutation_duplicator>(r, remote, app);
+        if (pegasus::server::is_cdc_consumer(remote)) {
+            return std::unique_ptr<mutation_duplicator>(
+                make_unique<pegasus::server::pegasus_cdc_duplicator>(r, remote, app));
+        }
+        return std::unique_ptr<mutation_duplicator>(
+            make_unique<pegasus::server::pegasus_mutation_duplicator>(r, remote, app));
     };
 
 } // namespace replication
@@ -44,6 +55,51 @@ namespace server {
 
 using namespace dsn::literals::chrono_literals;
 
+DSN_DEFINE_uint32("pegasus.server",
+                  duplicate_batch_max_count,
+                  1,
+                  "max count of mutations shipped in one DUPLICATE rpc, 1 means no batching. "
+                  "If the remote cluster doesn't support batched DUPLICATE, or the remote table "
+                  "has a different partition count, the mutations are shipped one by one");
+DSN_TAG_VARIABLE(duplicate_batch_max_count, FT_MUTABLE);
+
+DSN_DEFINE_uint64("pegasus.server",
+                  duplicate_batch_max_bytes,
+                  1024 * 1024,
+                  "max bytes of mutations shipped in one batched DUPLICATE rpc");
+DSN_TAG_VARIABLE(duplicate_batch_max_bytes, FT_MUTABLE);
+
+DSN_DEFINE_uint32("pegasus.server",
+                  duplicate_batch_lane_count,
+                  16,
+                  "the mutations are divided into this number of lanes by hash when batching, "
+                  "the batches of one lane are shipped in order, and different lanes are "
+                  "shipped concurrently");
+DSN_DEFINE_validator(duplicate_batch_lane_count,
+                     [](uint32_t count) -> bool { return count > 0; });
+
+DSN_DEFINE_string("pegasus.server",
+                  duplicate_compression_type,
+                  "none",
+                  "how the DUPLICATE requests to `duplicate_compression_remote_clusters` are "
+                  "compressed, available: none, lz4, zstd");
+DSN_DEFINE_validator(duplicate_compression_type, [](const char *value) -> bool {
+    dsn::apps::duplicate_compression_type::type type;
+    return parse_duplicate_compression_type(value, type);
+});
+
+DSN_DEFINE_string("pegasus.server",
+                  duplicate_compression_remote_clusters,
+                  "",
+                  "comma-separated remote clusters which are known to decompress the DUPLICATE "
+                  "requests, the requests to other clusters are never compressed");
+
+DSN_DEFINE_uint32("pegasus.server",
+                  duplicate_compression_threshold_bytes,
+                  1024,
+                  "the DUPLICATE requests whose writes are smaller than this are not compressed");
+DSN_TAG_VARIABLE(duplicate_compression_threshold_bytes, FT_MUTABLE);
+
 /*extern*/ uint64_t get_hash_from_request(dsn::task_code tc, const dsn::blob &data)
 {
     if (tc == dsn::apps::RPC_RRDB_RRDB_PUT) {
@@ -110,15 +166,46 @@ pegasus_mutation_duplicator::pegasus_mutation_duplicator(dsn::replication::repli
         fmt::format("dup_failed_shipping_ops@{}", str_gpid).c_str(),
         COUNTER_TYPE_RATE,
         "the qps of failed DUPLICATE requests sent from this app");
+    _shipped_bytes.init_app_counter("app.pegasus",
+                                    fmt::format("dup_shipped_bytes@{}", str_gpid).c_str(),
+                                    COUNTER_TYPE_RATE,
+                                    "the throughput of DUPLICATE requests sent from this app");
+    _shipping_lag_ms.init_app_counter(
+        "app.pegasus",
+        fmt::format("dup_shipping_lag_ms@{}", str_gpid).c_str(),
+        COUNTER_TYPE_NUMBER,
+        "the time lag in milliseconds from the oldest write of the last shipped DUPLICATE "
+        "request being generated to being shipped");
+    _compress_input_bytes.init_app_counter(
+        "app.pegasus",
+        fmt::format("dup_compress_input_bytes@{}", str_gpid).c_str(),
+        COUNTER_TYPE_RATE,
+        "the throughput of the writes in DUPLICATE requests before compression");
+    _compress_output_bytes.init_app_counter(
+        "app.pegasus",
+        fmt::format("dup_compress_output_bytes@{}", str_gpid).c_str(),
+        COUNTER_TYPE_RATE,
+        "the throughput of the writes in DUPLICATE requests after compression");
+
+    // An older remote doesn't know `compression_type`, it takes the compressed frame as a write
+    // rather than refusing it, so the remote has to be opted in before compressing.
+    std::vector<std::string> compression_remotes;
+    dsn::utils::split_args(FLAGS_duplicate_compression_remote_clusters, compression_remotes, ',');
+    if (std::find(compression_remotes.begin(), compression_remotes.end(), _remote_cluster) !=
+        compression_remotes.end()) {
+        parse_duplicate_compression_type(FLAGS_duplicate_compression_type, _compression_type);
+    }
 }
 
 void pegasus_mutation_duplicator::send(uint64_t hash, callback cb)
 {
     duplicate_rpc rpc;
     {
-        dsn::zauto_lock _(_lock);
-        rpc = _inflights[hash].front();
-        _inflights[hash].pop_front();
+        auto &shard = get_inflight_shard(hash);
+        dsn::zauto_lock _(shard.lock);
+        auto &rpcs = shard.rpcs[hash];
+        rpc = rpcs.front();
+        rpcs.pop_front();
     }
 
     _client->async_duplicate(rpc,
@@ -139,6 +226,55 @@ void pegasus_mutation_duplicator::on_duplicate_reply(uint64_t hash,
             client::pegasus_client_impl::get_rocksdb_server_error(rpc.response().error));
     }
 
+    const auto &request = rpc.request();
+    bool batched = request.__isset.entries;
+    bool compressed = is_duplicate_compressed(request);
+    bool refused_batch =
+        batched && (perr == PERR_NOT_SUPPORTED || perr == PERR_INVALID_ARGUMENT);
+    bool refused_compression =
+        compressed && (perr == PERR_NOT_SUPPORTED || perr == PERR_CORRUPTION);
+    if (refused_batch || refused_compression) {
+        _failed_shipping_ops->increment();
+
+        // Nothing of the refused request is applied, its writes are rebuilt and resent in order.
+        bool unbatch = false;
+        if (perr == PERR_CORRUPTION) {
+            // The compressed frame is broken on the way, it's compressed again and retried.
+            derror_replica("DUPLICATE is refused by {} as corrupted: {} [timestamp:{}]",
+                           _remote_cluster,
+                           rpc.response().error_hint,
+                           request.timestamp);
+        } else if (batched) {
+            unbatch = true;
+            if (!_batching_disabled.exchange(true)) {
+                dwarn_replica("batched DUPLICATE is refused by {}: {}, the writes are shipped "
+                              "one by one from now on",
+                              _remote_cluster,
+                              rpc.response().error_hint);
+            }
+        } else {
+            // The remote is opted in by `duplicate_compression_remote_clusters`, but it doesn't
+            // know the compression type, which may be newer than the remote.
+            if (!_compression_disabled.exchange(true)) {
+                dwarn_replica("compressed DUPLICATE is refused by {}: {}, the writes are shipped "
+                              "uncompressed from now on",
+                              _remote_cluster,
+                              rpc.response().error_hint);
+            }
+        }
+
+        std::vector<duplicate_rpc> rpcs = rebuild_request(request, unbatch);
+        auto &shard = get_inflight_shard(hash);
+        dsn::zauto_lock _(shard.lock);
+        auto &inflight = shard.rpcs[hash];
+        for (auto iter = rpcs.rbegin(); iter != rpcs.rend(); ++iter) {
+            inflight.push_front(*iter);
+        }
+        _env.schedule([hash, cb, this]() { send(hash, cb); },
+                      perr == PERR_CORRUPTION ? 1_s : 0_s);
+        return;
+    }
+
     if (perr != PERR_OK || err != dsn::ERR_OK) {
         _failed_shipping_ops->increment();
 
@@ -153,37 +289,51 @@ void pegasus_mutation_duplicator::on_duplicate_reply(uint64_t hash,
         // duplicating an illegal write to server is unacceptable, fail fast.
         dassert_replica(perr != PERR_INVALID_ARGUMENT, rpc.response().error_hint);
     } else {
-        _shipped_ops->increment();
-        _total_shipped_size +=
+        const auto &request = rpc.request();
+        size_t shipped_size =
             rpc.dsn_request()->header->body_length + rpc.dsn_request()->header->hdr_length;
+        _shipped_bytes->add(shipped_size);
+        // the timestamp of a batch is of its oldest write
+        _shipping_lag_ms->set((dsn_now_us() - request.timestamp) / 1000);
+        _total_shipped_size += shipped_size;
     }
 
     {
-        dsn::zauto_lock _(_lock);
+        auto &shard = get_inflight_shard(hash);
+        dsn::zauto_lock _(shard.lock);
+        auto iter = shard.rpcs.find(hash);
         if (perr != PERR_OK || err != dsn::ERR_OK) {
             // retry this rpc
-            _inflights[hash].push_front(rpc);
+            iter->second.push_front(rpc);
             _env.schedule([hash, cb, this]() { send(hash, cb); }, 1_s);
             return;
         }
-        if (_inflights[hash].empty()) {
-            _inflights.erase(hash);
-            if (_inflights.empty()) {
-                // move forward to the next step.
-                cb(_total_shipped_size);
-            }
-        } else {
+        if (!iter->second.empty()) {
             // start next rpc immediately
             _env.schedule([hash, cb, this]() { send(hash, cb); });
             return;
         }
+        shard.rpcs.erase(iter);
+    }
+
+    if (_inflight_hash_count.fetch_sub(1) == 1) {
+        // all the hashes are done, move forward to the next step.
+        _shipped_ops->add(_total_shipped_ops.load());
+        cb(_total_shipped_size.load());
     }
 }
 
 void pegasus_mutation_duplicator::duplicate(mutation_tuple_set muts, callback cb)
 {
-    _total_shipped_size = 0;
+    _total_shipped_size.store(0);
+    _total_shipped_ops.store(0);
 
+    if (FLAGS_duplicate_batch_max_count > 1 && !_batching_disabled.load()) {
+        duplicate_in_batch(std::move(muts), std::move(cb));
+        return;
+    }
+
+    std::vector<uint64_t> hashes;
     for (auto mut : muts) {
         // mut: 0=timestamp, 1=rpc_code, 2=raw_message
 
@@ -201,6 +351,7 @@ void pegasus_mutation_duplicator::duplicate(mutation_tuple_set muts, callback cb
             dreq->__set_task_code(rpc_code);
             dreq->__set_timestamp(std::get<0>(mut));
             dreq->__set_cluster_id(get_current_cluster_id());
+            compress_request(*dreq);
         }
 
         uint64_t hash = get_hash_from_request(rpc_code, raw_message);
@@ -208,17 +359,200 @@ void pegasus_mutation_duplicator::duplicate(mutation_tuple_set muts, callback cb
                           dsn::apps::RPC_RRDB_RRDB_DUPLICATE,
                           10_s, // TODO(wutao1): configurable timeout.
                           hash);
-        _inflights[hash].push_back(std::move(rpc));
+        add_inflight(hash, std::move(rpc), hashes);
+        _total_shipped_ops.fetch_add(1);
+    }
+
+    start_shipping(hashes, std::move(cb));
+}
+
+void pegasus_mutation_duplicator::duplicate_in_batch(mutation_tuple_set muts, callback cb)
+{
+    struct batch
+    {
+        std::unique_ptr<dsn::apps::duplicate_request> request;
+        // the hash of the first write, which is used to route the batch
+        uint64_t hash;
+        size_t bytes;
+    };
+    // lane -> batches of the lane
+    std::map<uint64_t, std::vector<batch>> lanes;
+
+    for (auto mut : muts) {
+        // mut: 0=timestamp, 1=rpc_code, 2=raw_message
+        dsn::task_code rpc_code = std::get<1>(mut);
+        dsn::blob raw_message = std::get<2>(mut);
+        if (rpc_code == dsn::apps::RPC_RRDB_RRDB_DUPLICATE) {
+            // ignore if it is a DUPLICATE, see `duplicate`.
+            continue;
+        }
+
+        // All the writes in this partition are served by the same partition of the remote
+        // table, so the writes with different hashes can be shipped in one batch.
+        uint64_t hash = get_hash_from_request(rpc_code, raw_message);
+        auto &batches = lanes[hash % FLAGS_duplicate_batch_lane_count];
+        if (batches.empty() ||
+            batches.back().request->entries.size() >= FLAGS_duplicate_batch_max_count ||
+            batches.back().bytes + raw_message.length() > FLAGS_duplicate_batch_max_bytes) {
+            auto dreq = dsn::make_unique<dsn::apps::duplicate_request>();
+            dreq->__set_timestamp(std::get<0>(mut));
+            dreq->__set_cluster_id(get_current_cluster_id());
+            dreq->__isset.entries = true;
+            batches.push_back({std::move(dreq), hash, 0});
+        }
+
+        dsn::apps::duplicate_entry entry;
+        entry.__set_timestamp(std::get<0>(mut));
+        entry.__set_task_code(rpc_code);
+        entry.__set_raw_message(raw_message);
+        batches.back().request->entries.emplace_back(std::move(entry));
+        batches.back().bytes += raw_message.length();
+        _total_shipped_ops.fetch_add(1);
+    }
+
+    // The requests are serialized when the rpcs are created, so the rpcs are created after
+    // the batches are built.
+    std::vector<uint64_t> hashes;
+    for (auto &lane : lanes) {
+        for (auto &b : lane.second) {
+            compress_request(*b.request);
+            duplicate_rpc rpc(std::move(b.request),
+                              dsn::apps::RPC_RRDB_RRDB_DUPLICATE,
+                              10_s, // TODO(wutao1): configurable timeout.
+                              b.hash);
+            add_inflight(lane.first, std::move(rpc), hashes);
+        }
+    }
+
+    start_shipping(hashes, std::move(cb));
+}
+
+std::vector<dsn::apps::duplicate_rpc>
+pegasus_mutation_duplicator::rebuild_request(const dsn::apps::duplicate_request &request,
+                                             bool unbatch)
+{
+    // The writes of the refused request are uncompressed before being rebuilt.
+    dsn::apps::duplicate_request raw_request = request;
+    if (is_duplicate_compressed(request)) {
+        std::string error_hint;
+        bool ok = request.__isset.entries
+                      ? decompress_duplicate_entries(request.compression_type,
+                                                     request.raw_message,
+                                                     raw_request.entries,
+                                                     error_hint)
+                      : decompress_duplicate_payload(request.compression_type,
+                                                     request.raw_message,
+                                                     raw_request.raw_message,
+                                                     error_hint);
+        // never possible, it's compressed by this duplicator.
+        dassert_replica(ok, "failed to decompress the DUPLICATE: {}", error_hint);
+        if (request.__isset.entries) {
+            raw_request.__isset.raw_message = false;
+            raw_request.raw_message = dsn::blob();
+        }
+        raw_request.__isset.compression_type = false;
+    }
+
+    std::vector<duplicate_rpc> rpcs;
+    if (!raw_request.__isset.entries || !unbatch) {
+        auto dreq = dsn::make_unique<dsn::apps::duplicate_request>(std::move(raw_request));
+        uint64_t hash = dreq->__isset.entries
+                            ? get_hash_from_request(dreq->entries.front().task_code,
+                                                    dreq->entries.front().raw_message)
+                            : get_hash_from_request(dreq->task_code, dreq->raw_message);
+        compress_request(*dreq);
+        rpcs.emplace_back(std::move(dreq),
+                          dsn::apps::RPC_RRDB_RRDB_DUPLICATE,
+                          10_s, // TODO(wutao1): configurable timeout.
+                          hash);
+        return rpcs;
+    }
+
+    for (const auto &entry : raw_request.entries) {
+        auto dreq = dsn::make_unique<dsn::apps::duplicate_request>();
+        dreq->__set_raw_message(entry.raw_message);
+        dreq->__set_task_code(entry.task_code);
+        dreq->__set_timestamp(entry.timestamp);
+        dreq->__set_cluster_id(get_current_cluster_id());
+        compress_request(*dreq);
+
+        uint64_t hash = get_hash_from_request(entry.task_code, entry.raw_message);
+        rpcs.emplace_back(std::move(dreq),
+                          dsn::apps::RPC_RRDB_RRDB_DUPLICATE,
+                          10_s, // TODO(wutao1): configurable timeout.
+                          hash);
     }
+    return rpcs;
+}
 
-    if (_inflights.empty()) {
+void pegasus_mutation_duplicator::add_inflight(uint64_t hash,
+                                               duplicate_rpc rpc,
+                                               std::vector<uint64_t> &hashes)
+{
+    // No rpc is in flight before `start_shipping`, so the shard is not locked.
+    auto &rpcs = get_inflight_shard(hash).rpcs[hash];
+    if (rpcs.empty()) {
+        hashes.push_back(hash);
+    }
+    rpcs.push_back(std::move(rpc));
+}
+
+void pegasus_mutation_duplicator::start_shipping(const std::vector<uint64_t> &hashes, callback cb)
+{
+    if (hashes.empty()) {
         cb(0);
         return;
     }
-    auto inflights = _inflights;
-    for (const auto &kv : inflights) {
-        send(kv.first, cb);
+
+    // The count must be set before any rpc is sent, otherwise the callback may be called by
+    // the reply of the first hash.
+    _inflight_hash_count.store(hashes.size());
+    for (uint64_t hash : hashes) {
+        send(hash, cb);
+    }
+}
+
+void pegasus_mutation_duplicator::compress_request(dsn::apps::duplicate_request &request)
+{
+    if (_compression_type == dsn::apps::duplicate_compression_type::DCT_NONE ||
+        _compression_disabled.load()) {
+        return;
+    }
+
+    size_t raw_bytes = 0;
+    if (request.__isset.entries) {
+        for (const auto &entry : request.entries) {
+            raw_bytes += entry.raw_message.length();
+        }
+    } else {
+        raw_bytes = request.raw_message.length();
+    }
+    if (raw_bytes < FLAGS_duplicate_compression_threshold_bytes) {
+        return;
+    }
+
+    // The writes of a batch are compressed as one frame, which compresses much better than
+    // compressing them one by one, since the small writes of a batch share a lot in common.
+    dsn::blob payload = request.__isset.entries ? serialize_duplicate_entries(request.entries)
+                                                : request.raw_message;
+    dsn::blob compressed;
+    if (!compress_duplicate_payload(_compression_type, payload, compressed)) {
+        // ship it uncompressed
+        return;
+    }
+    if (compressed.length() >= payload.length()) {
+        // incompressible, the remote needn't waste cpu on decompressing it
+        return;
+    }
+
+    if (request.__isset.entries) {
+        // `entries` is left empty but set, so that the request is still taken as a batch.
+        request.entries.clear();
     }
+    request.__set_raw_message(compressed);
+    request.__set_compression_type(_compression_type);
+    _compress_input_bytes->add(payload.length());
+    _compress_output_bytes->add(compressed.length());
 }
 
 } // namespace server
@@ -19,6 +19,12 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
 #include <dsn/dist/replication/mutation_duplicator.h>
 #include <dsn/dist/replication/replica_base.h>
 #include <rrdb/rrdb.code.definition.h>
@@ -47,28 +53,87 @@ public:
     ~pegasus_mutation_duplicator() override { _env.__conf.tracker->cancel_outstanding_tasks(); }
 
 private:
+    // Ships the mutations in batches of at most `duplicate_batch_max_count` mutations.
+    void duplicate_in_batch(mutation_tuple_set muts, callback cb);
+
+    // Compresses the writes of `request` by `duplicate_compression_type` if they're not smaller
+    // than `duplicate_compression_threshold_bytes` in total. The writes of a batch are compressed
+    // as one frame, see `duplicate_request.compression_type`.
+    void compress_request(dsn::apps::duplicate_request &request);
+
+    // Appends `rpc` to the in-flight rpcs of `hash`, and records `hash` in `hashes` if it's new.
+    void add_inflight(uint64_t hash, duplicate_rpc rpc, /*out*/ std::vector<uint64_t> &hashes);
+
+    // Sends the first rpc of each hash in `hashes`, `cb` is called after all of them are done.
+    void start_shipping(const std::vector<uint64_t> &hashes, callback cb);
+
     void send(uint64_t hash, callback cb);
 
     void on_duplicate_reply(uint64_t hash, callback, duplicate_rpc, dsn::error_code err);
 
+    // Rebuilds the rpc(s) of the refused `request`, whose writes are decompressed and compressed
+    // again by `compress_request`. The batched `request` is split into the rpcs of its writes
+    // if `unbatch` is true.
+    std::vector<duplicate_rpc> rebuild_request(const dsn::apps::duplicate_request &request,
+                                               bool unbatch);
+
 private:
     friend class pegasus_mutation_duplicator_test;
+    friend class pegasus_mutation_duplicator_bench;
 
     client::pegasus_client_impl *_client{nullptr};
 
     uint8_t _remote_cluster_id{0};
     std::string _remote_cluster;
 
+    // Set once the remote refuses a batched DUPLICATE, because it's an older version which
+    // doesn't know the batched writes, or its table has a different partition count. The
+    // writes are shipped one by one since then.
+    std::atomic<bool> _batching_disabled{false};
+
+    // Set once the remote refuses a compressed DUPLICATE as an unknown compression type. The
+    // writes are shipped uncompressed since then. An older remote which doesn't know the
+    // compression never refuses it, so the compression is only enabled for the remote clusters
+    // in `duplicate_compression_remote_clusters`.
+    std::atomic<bool> _compression_disabled{false};
+
+    // how the writes are compressed, DCT_NONE if the remote cluster is not opted in, see
+    // `compress_request`
+    dsn::apps::duplicate_compression_type::type _compression_type{
+        dsn::apps::duplicate_compression_type::DCT_NONE};
+
     // The duplicate_rpc are isolated by their hash value from hash key.
     // Writes with the same hash are duplicated in mutation order to preserve data consistency,
     // otherwise they are duplicated concurrently to improve performance.
-    std::map<uint64_t, std::deque<duplicate_rpc>> _inflights; // hash -> duplicate_rpc
-    dsn::zlock _lock;
-
-    size_t _total_shipped_size{0};
+    // If batching is enabled, the key is the lane of the hash instead, see `duplicate_in_batch`.
+    //
+    // The in-flight rpcs are sharded by hash, so the replies of different hashes rarely contend
+    // for the same lock.
+    struct inflight_shard
+    {
+        dsn::zlock lock;
+        std::unordered_map<uint64_t, std::deque<duplicate_rpc>> rpcs; // hash -> duplicate_rpc
+    };
+    static constexpr size_t kInflightShardCount = 64;
+    inflight_shard &get_inflight_shard(uint64_t hash)
+    {
+        return _inflight_shards[hash % kInflightShardCount];
+    }
+    std::array<inflight_shard, kInflightShardCount> _inflight_shards;
+    // the number of hashes whose rpcs are not all done in this round
+    std::atomic<size_t> _inflight_hash_count{0};
+
+    std::atomic<size_t> _total_shipped_size{0};
+    // the number of writes in this round, the writes of a compressed batch can't be counted
+    // from its request
+    std::atomic<size_t> _total_shipped_ops{0};
 
     dsn::perf_counter_wrapper _shipped_ops;
     dsn::perf_counter_wrapper _failed_shipping_ops;
+    dsn::perf_counter_wrapper _shipped_bytes;
+    dsn::perf_counter_wrapper _shipping_lag_ms;
+    dsn::perf_counter_wrapper _compress_input_bytes;
+    dsn::perf_counter_wrapper _compress_output_bytes;
 };
 
 // Decodes the binary `request_data` into write request in thrift struct, and
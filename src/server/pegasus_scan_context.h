@@ -20,6 +20,7 @@
 #pragma once
 
 #include <map>
+#include <memory>
 #include <rocksdb/db.h>
 #include <dsn/tool_api.h>
 #include <dsn/utility/rand.h>
@@ -43,10 +44,13 @@ struct pegasus_scan_context
                          int32_t batch_size_,
                          bool no_value_,
                          bool validate_partition_hash_,
-                         bool return_expire_ts_)
+                         bool return_expire_ts_,
+                         std::shared_ptr<const rocksdb::Snapshot> &&snapshot_ = nullptr,
+                         int64_t read_timestamp_ = 0)
         : _stop_holder(std::move(stop_)),
           _hash_key_filter_pattern_holder(std::move(hash_key_filter_pattern_)),
           _sort_key_filter_pattern_holder(std::move(sort_key_filter_pattern_)),
+          snapshot(std::move(snapshot_)),
           iterator(std::move(iterator_)),
           stop(_stop_holder.data(), _stop_holder.size()),
           stop_inclusive(stop_inclusive_),
@@ -59,7 +63,8 @@ struct pegasus_scan_context
           batch_size(batch_size_),
           no_value(no_value_),
           validate_partition_hash(validate_partition_hash_),
-          return_expire_ts(return_expire_ts_)
+          return_expire_ts(return_expire_ts_),
+          read_timestamp(read_timestamp_)
     {
     }
 
@@ -69,6 +74,9 @@ private:
     std::string _sort_key_filter_pattern_holder;
 
 public:
+    // the snapshot pinned for the point-in-time scan, which must be released after the iterator
+    // reading it, so it's declared before the iterator
+    std::shared_ptr<const rocksdb::Snapshot> snapshot;
     std::unique_ptr<rocksdb::Iterator> iterator;
     rocksdb::Slice stop;
     bool stop_inclusive;
@@ -80,6 +88,8 @@ public:
     bool no_value;
     bool validate_partition_hash;
     bool return_expire_ts;
+    // 0 if it's not a point-in-time scan
+    int64_t read_timestamp;
 };
 
 class pegasus_context_cache
@@ -132,5 +142,94 @@ private:
     std::unordered_map<int64_t, std::unique_ptr<pegasus_scan_context>> _map;
     ::dsn::utils::ex_lock_nr_spin _lock;
 };
+
+// pegasus_scan_snapshot_table pins a rocksdb snapshot for each read timestamp of the
+// point-in-time scans on a replica. All the scans with the same read timestamp share the
+// snapshot, including the scans restarted after their contexts expired, so they see the same
+// data. The snapshot is unpinned if it's not used by any scan for `ttl_ms`, and it's released
+// once no scan context holds it.
+//
+// Pegasus keeps no old versions of the records, so the records updated between the read
+// timestamp and the pinning can't be read as of the read timestamp. A new snapshot is therefore
+// pinned only within `max_pin_delay_ms` after the read timestamp, and the scan whose snapshot
+// is unpinned or never pinned in time fails with kExpired rather than missing records.
+class pegasus_scan_snapshot_table
+{
+public:
+    // Gets the snapshot pinned for `read_timestamp` in `snapshot`, a new one is pinned if absent.
+    // Returns kBusy if there are `max_count` snapshots pinned already, or kExpired if it's too
+    // late to pin a new one.
+    rocksdb::Status::Code acquire(rocksdb::DB *db,
+                                  int64_t read_timestamp,
+                                  uint64_t now_ms,
+                                  uint64_t ttl_ms,
+                                  uint32_t max_count,
+                                  uint64_t max_pin_delay_ms,
+                                  /*out*/ std::shared_ptr<const rocksdb::Snapshot> &snapshot)
+    {
+        ::dsn::utils::auto_lock<::dsn::utils::ex_lock_nr> l(_lock);
+        for (auto iter = _snapshots.begin(); iter != _snapshots.end();) {
+            if (iter->second.last_acquire_ms + ttl_ms <= now_ms) {
+                iter = _snapshots.erase(iter);
+            } else {
+                ++iter;
+            }
+        }
+
+        auto iter = _snapshots.find(read_timestamp);
+        if (iter != _snapshots.end()) {
+            iter->second.last_acquire_ms = now_ms;
+            snapshot = iter->second.snapshot;
+            return rocksdb::Status::kOk;
+        }
+        if (now_ms > static_cast<uint64_t>(read_timestamp) / 1000 + max_pin_delay_ms) {
+            return rocksdb::Status::kExpired;
+        }
+        if (_snapshots.size() >= max_count) {
+            return rocksdb::Status::kBusy;
+        }
+        snapshot = std::shared_ptr<const rocksdb::Snapshot>(
+            db->GetSnapshot(), [db](const rocksdb::Snapshot *s) { db->ReleaseSnapshot(s); });
+        _snapshots.emplace(read_timestamp, pinned_snapshot{snapshot, now_ms});
+        return rocksdb::Status::kOk;
+    }
+
+    // Keeps the snapshot of `read_timestamp` pinned while a scan with it goes on. Returns
+    // kExpired if the snapshot has been unpinned, it's never pinned again here, so that the
+    // snapshots are only pinned by `acquire` within its limits.
+    rocksdb::Status::Code refresh(int64_t read_timestamp, uint64_t now_ms)
+    {
+        ::dsn::utils::auto_lock<::dsn::utils::ex_lock_nr> l(_lock);
+        auto iter = _snapshots.find(read_timestamp);
+        if (iter == _snapshots.end()) {
+            return rocksdb::Status::kExpired;
+        }
+        iter->second.last_acquire_ms = now_ms;
+        return rocksdb::Status::kOk;
+    }
+
+    // Unpin all the snapshots, it must be called before the db is closed.
+    void clear()
+    {
+        ::dsn::utils::auto_lock<::dsn::utils::ex_lock_nr> l(_lock);
+        _snapshots.clear();
+    }
+
+    size_t size() const
+    {
+        ::dsn::utils::auto_lock<::dsn::utils::ex_lock_nr> l(_lock);
+        return _snapshots.size();
+    }
+
+private:
+    struct pinned_snapshot
+    {
+        std::shared_ptr<const rocksdb::Snapshot> snapshot;
+        uint64_t last_acquire_ms;
+    };
+
+    std::map<int64_t, pinned_snapshot> _snapshots;
+    mutable ::dsn::utils::ex_lock_nr _lock;
+};
 }
 }
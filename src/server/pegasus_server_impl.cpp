@@ -20,6 +20,9 @@
 #include "pegasus_server_impl.h"
 
 #include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #include <boost/lexical_cast.hpp>
 #include <rocksdb/convenience.h>
 #include <rocksdb/utilities/checkpoint.h>
@@ -36,6 +39,9 @@
 #include "base/pegasus_value_schema.h"
 #include "base/pegasus_utils.h"
 #include "capacity_unit_calculator.h"
+#include "checkpoint_manifest.h"
+#include "expire_index.h"
+#include "hotkey_read_cache.h"
 #include "pegasus_server_write.h"
 #include "meta_store.h"
 #include "hotkey_collector.h"
@@ -48,11 +54,157 @@ namespace server {
 DEFINE_TASK_CODE(LPC_PEGASUS_SERVER_DELAY, TASK_PRIORITY_COMMON, ::dsn::THREAD_POOL_DEFAULT)
 DSN_DECLARE_int32(read_amp_bytes_per_bit);
 
+DSN_DEFINE_uint32("pegasus.server",
+                  cu_attribution_report_interval_seconds,
+                  10,
+                  "interval in seconds to publish the capacity units attributed to clients and "
+                  "hash key prefixes as perf counters");
+
 DSN_DEFINE_int32("pegasus.server",
                  hotkey_analyse_time_interval_s,
                  10,
                  "hotkey analyse interval in seconds");
 
+DSN_DEFINE_bool("pegasus.server",
+                checkpoint_incremental_shipping_enabled,
+                true,
+                "whether to ship only the sst files missing on the target when learning or "
+                "copying checkpoint, according to the checkpoint manifest");
+
+DSN_DEFINE_uint32("pegasus.server",
+                  checkpoint_learn_pin_seconds,
+                  3600,
+                  "max seconds to keep the checkpoint which is referenced by an ongoing learn "
+                  "from being garbage collected, in case the learn is aborted");
+
+DSN_DEFINE_int32("pegasus.server",
+                 rocksdb_max_concurrent_db_open,
+                 4,
+                 "max count of replicas which are opening rocksdb concurrently on one server, "
+                 "to limit the concurrent I/O while restarting, 0 means no limit");
+
+DSN_DEFINE_uint32("pegasus.server",
+                  split_cleanup_range_count,
+                  16,
+                  "count of ranges the key space is split into when cleaning up the stale data "
+                  "after partition split, each range is compacted separately");
+DSN_DEFINE_uint32("pegasus.server",
+                  split_cleanup_range_interval_ms,
+                  1000,
+                  "interval in milliseconds between compacting two ranges when cleaning up the "
+                  "stale data after partition split");
+DSN_DEFINE_uint32("pegasus.server",
+                  split_cleanup_sample_count,
+                  1000,
+                  "count of keys sampled in each range to estimate the stale data size after "
+                  "partition split, the samples are spread over the bottommost sst files of "
+                  "the range");
+
+DSN_DEFINE_uint32("pegasus.server",
+                  scan_snapshot_max_count,
+                  16,
+                  "max count of rocksdb snapshots pinned for the point-in-time scans on a replica, "
+                  "the point-in-time scans with other read timestamps are rejected as busy");
+DSN_TAG_VARIABLE(scan_snapshot_max_count, FT_MUTABLE);
+DSN_DEFINE_uint32("pegasus.server",
+                  scan_snapshot_ttl_seconds,
+                  600,
+                  "the rocksdb snapshot pinned for a read timestamp of the point-in-time scans is "
+                  "unpinned if no scan with the read timestamp is going on within this time");
+DSN_TAG_VARIABLE(scan_snapshot_ttl_seconds, FT_MUTABLE);
+DSN_DEFINE_uint32("pegasus.server",
+                  scan_snapshot_max_pin_delay_ms,
+                  5000,
+                  "a rocksdb snapshot is pinned for a read timestamp of the point-in-time scans "
+                  "only within this time after the read timestamp, the records updated in the "
+                  "meantime can't be read as of the read timestamp. The scans whose snapshot is "
+                  "not pinned in time fail as expired");
+DSN_TAG_VARIABLE(scan_snapshot_max_pin_delay_ms, FT_MUTABLE);
+
+DSN_DEFINE_bool("pegasus.server",
+                expire_index_enabled,
+                false,
+                "whether to index the records with TTL by their expire timestamps in a separate "
+                "column family, and purge the expired records proactively. The column family "
+                "is dropped when the replica is opened with it disabled");
+DSN_DEFINE_uint32("pegasus.server",
+                  expire_index_purge_interval_seconds,
+                  1,
+                  "interval in seconds to purge the expired records found by the expire index");
+DSN_DEFINE_uint32("pegasus.server",
+                  expire_index_purge_max_count,
+                  1000,
+                  "max count of expire index entries handled by each purge, which bounds the "
+                  "time the writes are blocked by the purge");
+
+DSN_DEFINE_bool("pegasus.server",
+                hotkey_read_cache_enabled,
+                false,
+                "whether to cache the values of the hot hash keys found by the read hotkey "
+                "collector for get and multi_get");
+DSN_DEFINE_uint32("pegasus.server",
+                  hotkey_read_cache_capacity,
+                  1000,
+                  "max count of keys cached by the hotkey read cache of each replica");
+DSN_DEFINE_uint64("pegasus.server",
+                  hotkey_read_cache_ttl_ms,
+                  1000,
+                  "time in milliseconds a key is cached by the hotkey read cache, which bounds "
+                  "the staleness of the cached values");
+DSN_DEFINE_uint32("pegasus.server",
+                  hotkey_read_cache_min_percent,
+                  10,
+                  "a hash key is cached by the hotkey read cache if its reads are no less than "
+                  "this percentage of the reads of the replica");
+
+// Limit the count of rocksdb instances being opened concurrently on this server.
+class db_open_limiter
+{
+public:
+    class guard
+    {
+    public:
+        explicit guard(db_open_limiter &limiter) : _limiter(limiter) { _limiter.acquire(); }
+        ~guard() { _limiter.release(); }
+
+    private:
+        db_open_limiter &_limiter;
+    };
+
+    static db_open_limiter &instance()
+    {
+        static db_open_limiter limiter;
+        return limiter;
+    }
+
+private:
+    void acquire()
+    {
+        if (FLAGS_rocksdb_max_concurrent_db_open <= 0) {
+            return;
+        }
+        std::unique_lock<std::mutex> l(_lock);
+        _cv.wait(l, [this]() { return _opening_count < FLAGS_rocksdb_max_concurrent_db_open; });
+        ++_opening_count;
+    }
+
+    void release()
+    {
+        if (FLAGS_rocksdb_max_concurrent_db_open <= 0) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> l(_lock);
+            --_opening_count;
+        }
+        _cv.notify_one();
+    }
+
+    std::mutex _lock;
+    std::condition_variable _cv;
+    int32_t _opening_count = 0;
+};
+
 static std::string chkpt_get_dir_name(int64_t decree)
 {
     char buffer[256];
@@ -76,6 +228,7 @@ std::shared_ptr<rocksdb::WriteBufferManager> pegasus_server_impl::_s_write_buffe
 const std::string pegasus_server_impl::COMPRESSION_HEADER = "per_level:";
 const std::string pegasus_server_impl::DATA_COLUMN_FAMILY_NAME = "default";
 const std::string pegasus_server_impl::META_COLUMN_FAMILY_NAME = "pegasus_meta_cf";
+const std::string pegasus_server_impl::EXPIRE_INDEX_COLUMN_FAMILY_NAME = "pegasus_expire_index_cf";
 const std::chrono::seconds pegasus_server_impl::kServerStatUpdateTimeSec = std::chrono::seconds(10);
 
 void pegasus_server_impl::parse_checkpoints()
@@ -113,6 +266,9 @@ pegasus_server_impl::~pegasus_server_impl()
 {
     if (_is_open) {
         dassert(_db != nullptr, "");
+        // the iterators and snapshots of the scans must be released before the db
+        _context_cache.clear();
+        _scan_snapshots.clear();
         release_db();
     }
 }
@@ -122,11 +278,15 @@ void pegasus_server_impl::gc_checkpoints(bool force_reserve_one)
     int min_count = force_reserve_one ? 1 : _checkpoint_reserve_min_count;
     uint64_t reserve_time = force_reserve_one ? 0 : _checkpoint_reserve_time_seconds;
     std::deque<int64_t> temp_list;
+    int64_t pinned_d = 0;
     {
         ::dsn::utils::auto_lock<::dsn::utils::ex_lock_nr> l(_checkpoints_lock);
         if (_checkpoints.size() <= min_count)
             return;
         temp_list = _checkpoints;
+        if (_pinned_checkpoint > 0 && _pinned_checkpoint_expire_ms > dsn_now_ms()) {
+            pinned_d = _pinned_checkpoint;
+        }
     }
 
     // find the max checkpoint which can be deleted
@@ -136,6 +296,10 @@ void pegasus_server_impl::gc_checkpoints(bool force_reserve_one)
         if (i + min_count >= temp_list.size())
             break;
         int64_t d = temp_list[i];
+        if (pinned_d > 0 && d >= pinned_d) {
+            // the pinned checkpoint is referenced by an ongoing learn
+            break;
+        }
         if (reserve_time > 0) {
             // we check last write time of "CURRENT" instead of directory, because the directory's
             // last write time may be updated by previous incompleted garbage collection.
@@ -173,6 +337,10 @@ void pegasus_server_impl::gc_checkpoints(bool force_reserve_one)
     {
         ::dsn::utils::auto_lock<::dsn::utils::ex_lock_nr> l(_checkpoints_lock);
         int delete_max_index = -1;
+        // the checkpoint may be pinned after "max_del_d" is calculated
+        if (_pinned_checkpoint > 0 && _pinned_checkpoint_expire_ms > dsn_now_ms()) {
+            max_del_d = std::min(max_del_d, _pinned_checkpoint - 1);
+        }
         for (int i = 0; i < _checkpoints.size(); ++i) {
             int64_t del_d = _checkpoints[i];
             if (i + min_count >= _checkpoints.size() || del_d > max_del_d)
@@ -276,7 +444,21 @@ void pegasus_server_impl::on_get(get_rpc rpc)
 
     rocksdb::Slice skey(key.data(), key.length());
     std::string value;
-    rocksdb::Status status = _db->Get(_data_cf_rd_opts, _data_cf, skey, &value);
+    rocksdb::Status status;
+    if (_hotkey_read_cache != nullptr && _hotkey_read_cache->is_hot_raw_key(key)) {
+        if (_hotkey_read_cache->get(key, &value)) {
+            _pfc_recent_hotkey_cache_hit_count->increment();
+        } else {
+            _pfc_recent_hotkey_cache_miss_count->increment();
+            uint64_t generation = _hotkey_read_cache->generation();
+            status = _db->Get(_data_cf_rd_opts, _data_cf, skey, &value);
+            if (status.ok()) {
+                _hotkey_read_cache->put(key, value, generation);
+            }
+        }
+    } else {
+        status = _db->Get(_data_cf_rd_opts, _data_cf, skey, &value);
+    }
 
     if (status.ok()) {
         if (check_if_record_expired(utils::epoch_now(), value)) {
@@ -648,7 +830,34 @@ void pegasus_server_impl::on_multi_get(multi_get_rpc rpc)
             keys_holder.emplace_back(std::move(raw_key));
         }
 
-        std::vector<rocksdb::Status> statuses = _db->MultiGet(_data_cf_rd_opts, keys, &values);
+        std::vector<rocksdb::Status> statuses;
+        // The keys of a hot hash key are served by the hotkey read cache if all of them are
+        // cached, otherwise they are read from rocksdb and cached.
+        bool is_hot_hash_key = _hotkey_read_cache != nullptr &&
+                               _hotkey_read_cache->is_hot_hash_key(request.hash_key);
+        bool all_cached = is_hot_hash_key;
+        if (is_hot_hash_key) {
+            values.resize(keys.size());
+            for (int i = 0; i < keys.size() && all_cached; i++) {
+                all_cached = _hotkey_read_cache->get(keys_holder[i], &values[i]);
+            }
+        }
+        if (all_cached) {
+            _pfc_recent_hotkey_cache_hit_count->increment();
+            statuses.resize(keys.size());
+        } else {
+            if (is_hot_hash_key) {
+                _pfc_recent_hotkey_cache_miss_count->increment();
+            }
+            uint64_t generation = is_hot_hash_key ? _hotkey_read_cache->generation() : 0;
+            values.clear();
+            statuses = _db->MultiGet(_data_cf_rd_opts, keys, &values);
+            for (int i = 0; is_hot_hash_key && i < keys.size(); i++) {
+                if (statuses[i].ok()) {
+                    _hotkey_read_cache->put(keys_holder[i], values[i], generation);
+                }
+            }
+        }
         for (int i = 0; i < keys.size(); i++) {
             rocksdb::Status &status = statuses[i];
             std::string &value = values[i];
@@ -950,6 +1159,55 @@ void pegasus_server_impl::on_get_scanner(get_scanner_rpc rpc)
             rd_opts.prefix_same_as_start = false;
         }
     }
+
+    // A point-in-time scan skips the records whose timetag is newer than the read timestamp,
+    // and reads the snapshot pinned for the read timestamp, so the records updated after the
+    // snapshot is pinned are still read as of the snapshot. The cut is exact for all the
+    // batches and the restarted scans on this replica. The records updated or removed between
+    // the read timestamp and the pinning are missing, so a new snapshot is pinned only within
+    // `scan_snapshot_max_pin_delay_ms`, and the clients pin the snapshots of all the partitions
+    // when a point-in-time scan starts.
+    int64_t read_timestamp = request.__isset.read_timestamp ? request.read_timestamp : 0;
+    std::shared_ptr<const rocksdb::Snapshot> snapshot;
+    if (read_timestamp > 0) {
+        if (_pegasus_data_version < 1) {
+            derror_replica("point-in-time scan from {} is not supported by data version {}",
+                           rpc.remote_address().to_string(),
+                           _pegasus_data_version);
+            resp.error = rocksdb::Status::kNotSupported;
+            _cu_calculator->add_scan_cu(req, resp.error, resp.kvs);
+            _pfc_scan_latency->set(dsn_now_ns() - start_time);
+            return;
+        }
+        uint64_t ttl_ms = static_cast<uint64_t>(FLAGS_scan_snapshot_ttl_seconds) * 1000;
+        auto code = _scan_snapshots.acquire(_db,
+                                            read_timestamp,
+                                            dsn_now_ms(),
+                                            ttl_ms,
+                                            FLAGS_scan_snapshot_max_count,
+                                            FLAGS_scan_snapshot_max_pin_delay_ms,
+                                            snapshot);
+        if (code != rocksdb::Status::kOk) {
+            if (code == rocksdb::Status::kBusy) {
+                dwarn_replica("too many snapshots pinned for point-in-time scans, reject the "
+                              "scan from {} with read timestamp {}",
+                              rpc.remote_address().to_string(),
+                              read_timestamp);
+            } else {
+                dwarn_replica("the snapshot of read timestamp {} is unpinned or too late to "
+                              "pin, reject the point-in-time scan from {}",
+                              read_timestamp,
+                              rpc.remote_address().to_string());
+            }
+            resp.error = code;
+            _cu_calculator->add_scan_cu(req, resp.error, resp.kvs);
+            _pfc_scan_latency->set(dsn_now_ns() - start_time);
+            return;
+        }
+        rd_opts.snapshot = snapshot.get();
+        resp.__set_read_timestamp(read_timestamp);
+    }
+
     bool start_inclusive = request.start_inclusive;
     bool stop_inclusive = request.stop_inclusive;
     rocksdb::Slice start(request.start_key.data(), request.start_key.length());
@@ -1045,7 +1303,8 @@ void pegasus_server_impl::on_get_scanner(get_scanner_rpc rpc)
             epoch_now,
             request.no_value,
             request.__isset.validate_partition_hash ? request.validate_partition_hash : true,
-            return_expire_ts);
+            return_expire_ts,
+            read_timestamp);
         switch (state) {
         case range_iteration_state::kNormal:
             count++;
@@ -1121,7 +1380,9 @@ void pegasus_server_impl::on_get_scanner(get_scanner_rpc rpc)
             batch_count,
             request.no_value,
             request.__isset.validate_partition_hash ? request.validate_partition_hash : true,
-            return_expire_ts));
+            return_expire_ts,
+            std::move(snapshot),
+            read_timestamp));
         int64_t handle = _context_cache.put(std::move(context));
         resp.context_id = handle;
         // if the context is used, it will be fetched and re-put into cache,
@@ -1172,6 +1433,23 @@ void pegasus_server_impl::on_scan(scan_rpc rpc)
         bool no_value = context->no_value;
         bool validate_hash = context->validate_partition_hash;
         bool return_expire_ts = context->return_expire_ts;
+        int64_t read_timestamp = context->read_timestamp;
+        if (read_timestamp > 0) {
+            auto code = _scan_snapshots.refresh(read_timestamp, dsn_now_ms());
+            if (code != rocksdb::Status::kOk) {
+                // The scan couldn't be restarted at the same cut once its context expires, so
+                // it's failed rather than going on without the snapshot pinned.
+                dwarn_replica("the snapshot of read timestamp {} is unpinned, reject the "
+                              "point-in-time scan from {}",
+                              read_timestamp,
+                              rpc.remote_address().to_string());
+                resp.error = code;
+                _cu_calculator->add_scan_cu(req, resp.error, resp.kvs);
+                _pfc_scan_latency->set(dsn_now_ns() - start_time);
+                return;
+            }
+            resp.__set_read_timestamp(read_timestamp);
+        }
         bool complete = false;
         uint32_t epoch_now = ::pegasus::utils::epoch_now();
         uint64_t expire_count = 0;
@@ -1205,7 +1483,8 @@ void pegasus_server_impl::on_scan(scan_rpc rpc)
                                                    epoch_now,
                                                    no_value,
                                                    validate_hash,
-                                                   return_expire_ts);
+                                                   return_expire_ts,
+                                                   read_timestamp);
             switch (state) {
             case range_iteration_state::kNormal:
                 count++;
@@ -1300,6 +1579,17 @@ void pegasus_server_impl::on_clear_scanner(const int64_t &args) { _context_cache
     dassert_replica(!_is_open, "replica is already opened.");
     ddebug_replica("start to open app {}", data_dir());
 
+    // Time used by each phase of opening, in milliseconds, they will be logged once the app is
+    // opened to find out where the restart time goes.
+    uint64_t start_time_ms = dsn_now_ms();
+    uint64_t phase_start_ms = start_time_ms;
+    auto phase_elapsed_ms = [&phase_start_ms]() {
+        uint64_t now = dsn_now_ms();
+        uint64_t elapsed = now - phase_start_ms;
+        phase_start_ms = now;
+        return elapsed;
+    };
+
     // parse envs for parameters
     // envs is compounded in replication_app_base::open() function
     std::map<std::string, std::string> envs;
@@ -1393,16 +1683,25 @@ void pegasus_server_impl::on_clear_scanner(const int64_t &args) { _context_cache
     }
 
     ddebug("%s: start to open rocksDB's rdb(%s)", replica_name(), path.c_str());
+    uint64_t prepare_dir_ms = phase_elapsed_ms();
+
+    // Hold the slot until the db is opened and the checkpoint is created, which are the most I/O
+    // intensive phases.
+    db_open_limiter::guard open_guard(db_open_limiter::instance());
+    uint64_t wait_open_slot_ms = phase_elapsed_ms();
 
     // Here we create a `tmp_data_cf_opts` because we don't want to modify `_data_cf_opts`, which
     // will be used elsewhere.
     rocksdb::ColumnFamilyOptions tmp_data_cf_opts = _data_cf_opts;
     bool has_incompatible_db_options = false;
+    bool missing_expire_index_cf = true;
     if (db_exist) {
         // When DB exists, meta CF and data CF must be present.
         bool missing_meta_cf = true;
         bool missing_data_cf = true;
-        if (check_column_families(path, &missing_meta_cf, &missing_data_cf) != ::dsn::ERR_OK) {
+        if (check_column_families(
+                path, &missing_meta_cf, &missing_data_cf, &missing_expire_index_cf) !=
+            ::dsn::ERR_OK) {
             derror_replica("check column families failed");
             return ::dsn::ERR_LOCAL_APP_FAILURE;
         }
@@ -1453,27 +1752,50 @@ void pegasus_server_impl::on_clear_scanner(const int64_t &args) { _context_cache
 
     std::vector<rocksdb::ColumnFamilyDescriptor> column_families(
         {{DATA_COLUMN_FAMILY_NAME, tmp_data_cf_opts}, {META_COLUMN_FAMILY_NAME, _meta_cf_opts}});
+    if (!missing_expire_index_cf) {
+        column_families.emplace_back(EXPIRE_INDEX_COLUMN_FAMILY_NAME, _expire_index_cf_opts);
+    }
     auto s = rocksdb::CheckOptionsCompatibility(
         path, rocksdb::Env::Default(), _db_opts, column_families, /*ignore_unknown_options=*/true);
     if (!s.ok() && !s.IsNotFound() && !has_incompatible_db_options) {
         derror_replica("rocksdb::CheckOptionsCompatibility failed, error = {}", s.ToString());
         return ::dsn::ERR_LOCAL_APP_FAILURE;
     }
+    // Expire index CF is opened once it has been created even if the expire index is disabled,
+    // because all column families must be opened by rocksdb. It's created after the options
+    // compatibility check, which requires the same column families as the option file.
+    if (missing_expire_index_cf && FLAGS_expire_index_enabled) {
+        column_families.emplace_back(EXPIRE_INDEX_COLUMN_FAMILY_NAME, _expire_index_cf_opts);
+        _db_opts.create_missing_column_families = true;
+    }
+    uint64_t load_options_ms = phase_elapsed_ms();
+
     std::vector<rocksdb::ColumnFamilyHandle *> handles_opened;
     auto status = rocksdb::DB::Open(_db_opts, path, column_families, &handles_opened, &_db);
     if (!status.ok()) {
         derror_replica("rocksdb::DB::Open failed, error = {}", status.ToString());
         return ::dsn::ERR_LOCAL_APP_FAILURE;
     }
-    dcheck_eq_replica(2, handles_opened.size());
+    dcheck_eq_replica(column_families.size(), handles_opened.size());
     dcheck_eq_replica(handles_opened[0]->GetName(), DATA_COLUMN_FAMILY_NAME);
     dcheck_eq_replica(handles_opened[1]->GetName(), META_COLUMN_FAMILY_NAME);
     _data_cf = handles_opened[0];
     _meta_cf = handles_opened[1];
+    if (handles_opened.size() > 2) {
+        dcheck_eq_replica(handles_opened[2]->GetName(), EXPIRE_INDEX_COLUMN_FAMILY_NAME);
+        _expire_index_cf = handles_opened[2];
+    }
+
+    uint64_t open_db_ms = phase_elapsed_ms();
 
     // Create _meta_store which provide Pegasus meta data read and write.
     _meta_store = dsn::make_unique<meta_store>(this, _db, _meta_cf);
 
+    if (FLAGS_hotkey_read_cache_enabled) {
+        _hotkey_read_cache = dsn::make_unique<hotkey_read_cache>(FLAGS_hotkey_read_cache_capacity,
+                                                                 FLAGS_hotkey_read_cache_ttl_ms);
+    }
+
     if (db_exist) {
         _last_committed_decree = _meta_store->get_last_flushed_decree();
         _pegasus_data_version = _meta_store->get_data_version();
@@ -1488,6 +1810,9 @@ void pegasus_server_impl::on_clear_scanner(const int64_t &args) { _context_cache
 
         // update last manual compact finish timestamp
         _manual_compact_svc.init_last_finish_time_ms(last_manual_compact_finish_time);
+        _split_cleaned_partition_version.store(_meta_store->get_split_cleaned_partition_version());
+        _manual_compact_svc.init_split_cleanup_stale_bytes_remaining(
+            _meta_store->get_split_stale_bytes_remaining());
     } else {
         // Write initial meta data to meta CF and flush when create new DB.
         _meta_store->set_data_version(PEGASUS_DATA_VERSION_MAX);
@@ -1496,12 +1821,33 @@ void pegasus_server_impl::on_clear_scanner(const int64_t &args) { _context_cache
         flush_all_family_columns(true);
     }
 
+    if (FLAGS_expire_index_enabled && _expire_index_cf != nullptr) {
+        _expire_index_purger = dsn::make_unique<expire_index_purger>(
+            this, _db, _data_cf, _expire_index_cf, _pegasus_data_version, _s_rate_limiter);
+    } else if (_expire_index_cf != nullptr) {
+        // The expire index has been disabled, its entries would never be purged or updated
+        // again, so drop them all with the column family, whose files are deleted in background.
+        auto drop_status = _db->DropColumnFamily(_expire_index_cf);
+        if (drop_status.ok()) {
+            ddebug_replica("drop column family {} since the expire index is disabled",
+                           EXPIRE_INDEX_COLUMN_FAMILY_NAME);
+            _db->DestroyColumnFamilyHandle(_expire_index_cf);
+            _expire_index_cf = nullptr;
+        } else {
+            dwarn_replica("drop column family {} failed, it's left unused: {}",
+                          EXPIRE_INDEX_COLUMN_FAMILY_NAME,
+                          drop_status.ToString());
+        }
+    }
+
     // only enable filter after correct pegasus_data_version set
     _key_ttl_compaction_filter_factory->SetPegasusDataVersion(_pegasus_data_version);
     _key_ttl_compaction_filter_factory->SetPartitionIndex(_gpid.get_partition_index());
     _key_ttl_compaction_filter_factory->SetPartitionVersion(_gpid.get_partition_index() - 1);
     _key_ttl_compaction_filter_factory->EnableFilter();
 
+    uint64_t load_meta_ms = phase_elapsed_ms();
+
     parse_checkpoints();
 
     // checkpoint if necessary to make last_durable_decree() fresh.
@@ -1521,9 +1867,21 @@ void pegasus_server_impl::on_clear_scanner(const int64_t &args) { _context_cache
         dcheck_eq_replica(last_flushed, last_durable_decree());
     }
 
+    uint64_t checkpoint_ms = phase_elapsed_ms();
+
     ddebug_replica("open app succeed, pegasus_data_version = {}, last_durable_decree = {}",
                    _pegasus_data_version,
                    last_durable_decree());
+    ddebug_replica("time used to open app: total = {}ms, prepare_dir = {}ms, "
+                   "wait_open_slot = {}ms, load_options = {}ms, open_db = {}ms, load_meta = {}ms, "
+                   "checkpoint = {}ms",
+                   dsn_now_ms() - start_time_ms,
+                   prepare_dir_ms,
+                   wait_open_slot_ms,
+                   load_options_ms,
+                   open_db_ms,
+                   load_meta_ms,
+                   checkpoint_ms);
 
     _is_open = true;
 
@@ -1551,6 +1909,17 @@ void pegasus_server_impl::on_clear_scanner(const int64_t &args) { _context_cache
             nullptr, // TODO: the tracker is nullptr, we will fix it later
             []() { update_server_rocksdb_statistics(); },
             kServerStatUpdateTimeSec);
+
+        if (capacity_unit_attribution::enabled()) {
+            ::dsn::tasking::enqueue_timer(
+                LPC_REPLICATION_LONG_COMMON,
+                nullptr,
+                []() {
+                    capacity_unit_attribution::instance().report(
+                        FLAGS_cu_attribution_report_interval_seconds);
+                },
+                std::chrono::seconds(FLAGS_cu_attribution_report_interval_seconds));
+        }
     });
 
     // initialize cu calculator and write service after server being initialized.
@@ -1560,7 +1929,14 @@ void pegasus_server_impl::on_clear_scanner(const int64_t &args) { _context_cache
 
     ::dsn::tasking::enqueue_timer(LPC_ANALYZE_HOTKEY,
                                   &_tracker,
-                                  [this]() { _read_hotkey_collector->analyse_data(); },
+                                  [this]() {
+                                      _read_hotkey_collector->analyse_data();
+                                      if (_hotkey_read_cache != nullptr) {
+                                          _hotkey_read_cache->set_hot_hash_keys(
+                                              _read_hotkey_collector->get_hot_hash_keys(
+                                                  FLAGS_hotkey_read_cache_min_percent));
+                                      }
+                                  },
                                   std::chrono::seconds(FLAGS_hotkey_analyse_time_interval_s));
 
     ::dsn::tasking::enqueue_timer(LPC_ANALYZE_HOTKEY,
@@ -1568,6 +1944,19 @@ void pegasus_server_impl::on_clear_scanner(const int64_t &args) { _context_cache
                                   [this]() { _write_hotkey_collector->analyse_data(); },
                                   std::chrono::seconds(FLAGS_hotkey_analyse_time_interval_s));
 
+    if (_expire_index_purger != nullptr) {
+        // The purging is done in background rather than by the writes, and each purge is bounded
+        // by expire_index_purge_max_count, so read-mostly tables are purged as well.
+        ::dsn::tasking::enqueue_timer(
+            LPC_REPLICATION_LONG_COMMON,
+            &_tracker,
+            [this]() {
+                _pfc_recent_expire_index_purge_count->add(_expire_index_purger->purge(
+                    utils::epoch_now(), FLAGS_expire_index_purge_max_count));
+            },
+            std::chrono::seconds(FLAGS_expire_index_purge_interval_seconds));
+    }
+
     return ::dsn::ERR_OK;
 }
 
@@ -1603,9 +1992,12 @@ void pegasus_server_impl::cancel_background_work(bool wait)
     _tracker.cancel_outstanding_tasks();
 
     _context_cache.clear();
+    _scan_snapshots.clear();
 
     _is_open = false;
     release_db();
+    _expire_index_purger.reset();
+    _hotkey_read_cache.reset();
 
     std::deque<int64_t> reserved_checkpoints;
     {
@@ -1720,6 +2112,16 @@ private:
         return ::dsn::ERR_LOCAL_APP_FAILURE;
     }
 
+    if (FLAGS_checkpoint_incremental_shipping_enabled) {
+        // failing to write the manifest is not fatal, the whole checkpoint will be shipped then.
+        auto err = write_checkpoint_manifest(checkpoint_dir, last_commit);
+        if (err != ::dsn::ERR_OK) {
+            dwarn_replica("write manifest of checkpoint {} failed, err = {}",
+                          checkpoint_dir,
+                          err.to_string());
+        }
+    }
+
     {
         ::dsn::utils::auto_lock<::dsn::utils::ex_lock_nr> l(_checkpoints_lock);
         dcheck_gt_replica(last_commit, last_durable_decree());
@@ -1806,6 +2208,15 @@ private:
         return ::dsn::ERR_LOCAL_APP_FAILURE;
     }
 
+    if (FLAGS_checkpoint_incremental_shipping_enabled) {
+        // failing to write the manifest is not fatal, the whole checkpoint will be shipped then.
+        err = write_checkpoint_manifest(tmp_dir, checkpoint_decree);
+        if (err != ::dsn::ERR_OK) {
+            dwarn_replica(
+                "write manifest of checkpoint {} failed, err = {}", tmp_dir, err.to_string());
+        }
+    }
+
     auto checkpoint_dir =
         ::dsn::utils::filesystem::path_combine(data_dir(), chkpt_get_dir_name(checkpoint_decree));
     if (::dsn::utils::filesystem::directory_exists(checkpoint_dir)) {
@@ -1856,7 +2267,27 @@ private:
         return ::dsn::ERR_WRONG_TIMING;
     }
 
-    return copy_checkpoint_to_dir_unsafe(checkpoint_dir, last_decree, flush_memtable);
+    auto err = copy_checkpoint_to_dir_unsafe(checkpoint_dir, last_decree, flush_memtable);
+    if (err != ::dsn::ERR_OK) {
+        return err;
+    }
+
+    if (FLAGS_checkpoint_incremental_shipping_enabled) {
+        // Write the manifest into the copied checkpoint, thus the uploader of cold backup could
+        // skip the sst files which already exist in the previous backup.
+        err = write_checkpoint_manifest(checkpoint_dir, last_decree != nullptr ? *last_decree : 0);
+        if (err != ::dsn::ERR_OK) {
+            derror_replica("write manifest into checkpoint dir({}) failed, err = {}",
+                           checkpoint_dir,
+                           err.to_string());
+            if (!::dsn::utils::filesystem::remove_path(checkpoint_dir)) {
+                derror_replica("remove checkpoint directory {} failed", checkpoint_dir);
+            }
+            return err;
+        }
+    }
+
+    return ::dsn::ERR_OK;
 }
 
 // not thread safe, should be protected by caller
@@ -1952,7 +2383,25 @@ private:
 
     auto chkpt_dir = ::dsn::utils::filesystem::path_combine(data_dir(), chkpt_get_dir_name(ci));
     state.files.clear();
-    if (!::dsn::utils::filesystem::get_subfiles(chkpt_dir, state.files, true)) {
+
+    checkpoint_manifest manifest;
+    checkpoint_manifest learner_manifest;
+    if (FLAGS_checkpoint_incremental_shipping_enabled && learn_request.length() > 0 &&
+        dsn::json::json_forwarder<checkpoint_manifest>::decode(learn_request, learner_manifest) &&
+        get_checkpoint_manifest(ci, manifest) == ::dsn::ERR_OK) {
+        // The manifest itself is always shipped, the learner will fill the skipped files
+        // according to it.
+        state.files.emplace_back(
+            ::dsn::utils::filesystem::path_combine(chkpt_dir, CHECKPOINT_MANIFEST_FILE_NAME));
+        for (const auto &name : get_checkpoint_files_to_ship(manifest, learner_manifest)) {
+            state.files.emplace_back(::dsn::utils::filesystem::path_combine(chkpt_dir, name));
+        }
+        ddebug_replica("ship {} of {} files in checkpoint {}, learner's checkpoint = {}",
+                       state.files.size() - 1,
+                       manifest.files.size(),
+                       ci,
+                       learner_manifest.decree);
+    } else if (!::dsn::utils::filesystem::get_subfiles(chkpt_dir, state.files, true)) {
         derror("%s: list files in checkpoint dir %s failed", replica_name(), chkpt_dir.c_str());
         return ::dsn::ERR_FILE_OPERATION_FAILED;
     }
@@ -1966,6 +2415,153 @@ private:
     return ::dsn::ERR_OK;
 }
 
+::dsn::error_code pegasus_server_impl::prepare_get_checkpoint(dsn::blob &learn_req)
+{
+    if (!FLAGS_checkpoint_incremental_shipping_enabled) {
+        return ::dsn::ERR_OK;
+    }
+
+    int64_t ci = last_durable_decree();
+    if (ci == 0) {
+        return ::dsn::ERR_OK;
+    }
+
+    // The files of the checkpoint will be the sources of hard links when the learned checkpoint
+    // is applied, so it must not be garbage collected before that.
+    if (!pin_checkpoint(ci)) {
+        dwarn_replica("checkpoint {} has been garbage collected, learn the whole checkpoint", ci);
+        return ::dsn::ERR_OK;
+    }
+
+    // Failing to get the manifest is not fatal, the learnee will ship the whole checkpoint.
+    checkpoint_manifest manifest;
+    auto err = get_checkpoint_manifest(ci, manifest);
+    if (err != ::dsn::ERR_OK) {
+        dwarn_replica("get manifest of checkpoint {} failed, err = {}, learn the whole checkpoint",
+                      ci,
+                      err.to_string());
+        unpin_checkpoint();
+        return ::dsn::ERR_OK;
+    }
+    learn_req = dsn::json::json_forwarder<checkpoint_manifest>::encode(manifest);
+    return ::dsn::ERR_OK;
+}
+
+::dsn::error_code pegasus_server_impl::get_checkpoint_manifest(int64_t decree,
+                                                               checkpoint_manifest &manifest)
+{
+    // The manifest is never built here, because calculating the md5 of the whole checkpoint
+    // would block the learn.
+    auto chkpt_dir =
+        ::dsn::utils::filesystem::path_combine(data_dir(), chkpt_get_dir_name(decree));
+    return load_checkpoint_manifest(chkpt_dir, manifest);
+}
+
+::dsn::error_code pegasus_server_impl::write_checkpoint_manifest(const std::string &dir,
+                                                                 int64_t decree)
+{
+    checkpoint_manifest base;
+    bool has_base = load_latest_checkpoint_manifest(base);
+    checkpoint_manifest manifest;
+    auto err = build_checkpoint_manifest(dir, decree, has_base ? &base : nullptr, manifest);
+    if (err != ::dsn::ERR_OK) {
+        return err;
+    }
+    return save_checkpoint_manifest(dir, manifest);
+}
+
+bool pegasus_server_impl::pin_checkpoint(int64_t decree)
+{
+    ::dsn::utils::auto_lock<::dsn::utils::ex_lock_nr> l(_checkpoints_lock);
+    if (std::find(_checkpoints.begin(), _checkpoints.end(), decree) == _checkpoints.end()) {
+        return false;
+    }
+    _pinned_checkpoint = decree;
+    _pinned_checkpoint_expire_ms = dsn_now_ms() + FLAGS_checkpoint_learn_pin_seconds * 1000;
+    return true;
+}
+
+void pegasus_server_impl::unpin_checkpoint()
+{
+    ::dsn::utils::auto_lock<::dsn::utils::ex_lock_nr> l(_checkpoints_lock);
+    _pinned_checkpoint = 0;
+    _pinned_checkpoint_expire_ms = 0;
+}
+
+bool pegasus_server_impl::load_latest_checkpoint_manifest(checkpoint_manifest &manifest)
+{
+    std::deque<int64_t> checkpoints;
+    {
+        ::dsn::utils::auto_lock<::dsn::utils::ex_lock_nr> l(_checkpoints_lock);
+        checkpoints = _checkpoints;
+    }
+    for (auto iter = checkpoints.rbegin(); iter != checkpoints.rend(); ++iter) {
+        auto chkpt_dir =
+            ::dsn::utils::filesystem::path_combine(data_dir(), chkpt_get_dir_name(*iter));
+        if (load_checkpoint_manifest(chkpt_dir, manifest) == ::dsn::ERR_OK) {
+            return true;
+        }
+    }
+    return false;
+}
+
+::dsn::error_code pegasus_server_impl::link_learned_checkpoint_files(const std::string &learn_dir)
+{
+    checkpoint_manifest manifest;
+    auto err = load_checkpoint_manifest(learn_dir, manifest);
+    if (err == ::dsn::ERR_OBJECT_NOT_FOUND) {
+        // the whole checkpoint has been shipped
+        return ::dsn::ERR_OK;
+    }
+    if (err != ::dsn::ERR_OK) {
+        return err;
+    }
+
+    auto missing_files = get_missing_checkpoint_files(learn_dir, manifest);
+    if (missing_files.empty()) {
+        return ::dsn::ERR_OK;
+    }
+
+    // Collect the sst files of local checkpoints, the newer checkpoint is preferred.
+    std::map<std::string, std::string> local_files;
+    std::deque<int64_t> checkpoints;
+    {
+        ::dsn::utils::auto_lock<::dsn::utils::ex_lock_nr> l(_checkpoints_lock);
+        checkpoints = _checkpoints;
+    }
+    for (auto iter = checkpoints.rbegin(); iter != checkpoints.rend(); ++iter) {
+        auto chkpt_dir =
+            ::dsn::utils::filesystem::path_combine(data_dir(), chkpt_get_dir_name(*iter));
+        checkpoint_manifest local;
+        if (load_checkpoint_manifest(chkpt_dir, local) != ::dsn::ERR_OK) {
+            continue;
+        }
+        for (const auto &f : local.files) {
+            local_files.emplace(f.name + "#" + std::to_string(f.size) + "#" + f.md5,
+                                ::dsn::utils::filesystem::path_combine(chkpt_dir, f.name));
+        }
+    }
+
+    auto env = rocksdb::Env::Default();
+    for (const auto &f : missing_files) {
+        auto iter = local_files.find(f.name + "#" + std::to_string(f.size) + "#" + f.md5);
+        if (iter == local_files.end()) {
+            derror_replica("file {} is neither learned nor found in local checkpoints", f.name);
+            return ::dsn::ERR_FILE_OPERATION_FAILED;
+        }
+        auto target = ::dsn::utils::filesystem::path_combine(learn_dir, f.name);
+        auto s = env->LinkFile(iter->second, target);
+        if (!s.ok()) {
+            derror_replica(
+                "link file from {} to {} failed, error = {}", iter->second, target, s.ToString());
+            return ::dsn::ERR_FILE_OPERATION_FAILED;
+        }
+    }
+    ddebug_replica(
+        "linked {} files from local checkpoints into {}", missing_files.size(), learn_dir);
+    return ::dsn::ERR_OK;
+}
+
 ::dsn::error_code
 pegasus_server_impl::storage_apply_checkpoint(chkpt_apply_mode mode,
                                               const dsn::replication::learn_state &state)
@@ -1973,6 +2569,18 @@ pegasus_server_impl::storage_apply_checkpoint(chkpt_apply_mode mode,
     ::dsn::error_code err;
     int64_t ci = state.to_decree_included;
 
+    if (state.files.size() > 0) {
+        err = link_learned_checkpoint_files(
+            ::dsn::utils::filesystem::remove_file_name(state.files[0]));
+        // the files of the pinned checkpoint have been linked (or not needed any more)
+        unpin_checkpoint();
+        if (err != ::dsn::ERR_OK) {
+            derror_replica("complete the learned checkpoint files failed, err = {}",
+                           err.to_string());
+            return err;
+        }
+    }
+
     if (mode == chkpt_apply_mode::copy) {
         dassert(ci > last_durable_decree(),
                 "state.to_decree_included(%" PRId64 ") <= last_durable_decree(%" PRId64 ")",
@@ -2101,7 +2709,8 @@ pegasus_server_impl::append_key_value_for_scan(std::vector<::dsn::apps::key_valu
                                                uint32_t epoch_now,
                                                bool no_value,
                                                bool request_validate_hash,
-                                               bool request_expire_ts)
+                                               bool request_expire_ts,
+                                               int64_t read_timestamp)
 {
     if (check_if_record_expired(epoch_now, value)) {
         if (_verbose_log) {
@@ -2110,7 +2719,16 @@ pegasus_server_impl::append_key_value_for_scan(std::vector<::dsn::apps::key_valu
         return range_iteration_state::kExpired;
     }
 
-    if (request_validate_hash && _validate_partition_hash) {
+    if (read_timestamp > 0) {
+        uint64_t timetag =
+            pegasus_extract_timetag(_pegasus_data_version, utils::to_string_view(value));
+        if (extract_timestamp_from_timetag(timetag) > static_cast<uint64_t>(read_timestamp)) {
+            // written after the read timestamp of the point-in-time scan
+            return range_iteration_state::kFiltered;
+        }
+    }
+
+    if (request_validate_hash && _validate_partition_hash && !is_split_data_cleaned()) {
         if (_partition_version < 0 || _gpid.get_partition_index() > _partition_version ||
             !check_pegasus_key_hash(key, _gpid.get_partition_index(), _partition_version)) {
             if (_verbose_log) {
@@ -2787,10 +3405,12 @@ bool pegasus_server_impl::set_options(
 
 ::dsn::error_code pegasus_server_impl::check_column_families(const std::string &path,
                                                              bool *missing_meta_cf,
-                                                             bool *missing_data_cf)
+                                                             bool *missing_data_cf,
+                                                             bool *missing_expire_index_cf)
 {
     *missing_meta_cf = true;
     *missing_data_cf = true;
+    *missing_expire_index_cf = true;
     std::vector<std::string> column_families;
     auto s = rocksdb::DB::ListColumnFamilies(rocksdb::DBOptions(), path, &column_families);
     if (!s.ok()) {
@@ -2803,6 +3423,8 @@ bool pegasus_server_impl::set_options(
             *missing_meta_cf = false;
         } else if (column_family == DATA_COLUMN_FAMILY_NAME) {
             *missing_data_cf = false;
+        } else if (column_family == EXPIRE_INDEX_COLUMN_FAMILY_NAME) {
+            *missing_expire_index_cf = false;
         } else {
             derror_replica("unknown column family name: {}", column_family);
             return ::dsn::ERR_LOCAL_APP_FAILURE;
@@ -2854,6 +3476,168 @@ uint64_t pegasus_server_impl::do_manual_compact(const rocksdb::CompactRangeOptio
     return _meta_store->get_last_manual_compact_finish_time();
 }
 
+uint64_t
+pegasus_server_impl::do_split_cleanup_compact(const split_cleanup_progress_callback &progress)
+{
+    int32_t partition_version = _partition_version.load();
+    int32_t partition_index = _gpid.get_partition_index();
+    if (!_validate_partition_hash || partition_version < 0 ||
+        partition_index > partition_version) {
+        ddebug_replica("skip split cleanup, validate_partition_hash = {}, partition_version = {}",
+                       _validate_partition_hash,
+                       partition_version);
+        return dsn_now_ms();
+    }
+
+    // wait flush before compact to make all data compacted.
+    uint64_t start_time = dsn_now_ms();
+    flush_all_family_columns(true);
+    ddebug_replica("finish flush_all_family_columns, time_used = {} ms", dsn_now_ms() - start_time);
+
+    // Split the key space into ranges by the smallest keys of the sst files in the bottommost
+    // level, which holds most of the data.
+    std::vector<rocksdb::LiveFileMetaData> files;
+    _db->GetLiveFilesMetaData(&files);
+    int bottommost_level = -1;
+    for (const auto &f : files) {
+        if (f.column_family_name == DATA_COLUMN_FAMILY_NAME) {
+            bottommost_level = std::max(bottommost_level, f.level);
+        }
+    }
+    // (smallest key, size) of the bottommost sst files, ordered by the smallest key
+    std::vector<std::pair<std::string, uint64_t>> file_keys;
+    for (const auto &f : files) {
+        if (f.column_family_name == DATA_COLUMN_FAMILY_NAME && f.level == bottommost_level) {
+            file_keys.emplace_back(f.smallestkey, f.size);
+        }
+    }
+    std::sort(file_keys.begin(), file_keys.end());
+    std::vector<std::string> boundaries;
+    size_t range_count = std::max<size_t>(
+        1, std::min<size_t>(FLAGS_split_cleanup_range_count, file_keys.size()));
+    for (size_t i = 1; i < range_count; ++i) {
+        const auto &key = file_keys[i * file_keys.size() / range_count].first;
+        if (boundaries.empty() || boundaries.back() != key) {
+            boundaries.emplace_back(key);
+        }
+    }
+    range_count = boundaries.size() + 1;
+
+    // Estimate the stale bytes of each range. Sampling only the beginning of a range is biased
+    // since the keys are ordered by hash key, so the samples are spread over the bottommost sst
+    // files in the range, and the stale ratio of each file is weighted by the file size.
+    static const std::string kMaxKey(16, '\xff');
+    rocksdb::ReadOptions rd_opts;
+    rd_opts.fill_cache = false;
+    rd_opts.total_order_seek = true;
+    std::unique_ptr<rocksdb::Iterator> iter(_db->NewIterator(rd_opts, _data_cf));
+    std::vector<uint64_t> stale_bytes(range_count, 0);
+    uint64_t stale_bytes_remaining = 0;
+    size_t file_index = 0;
+    for (size_t i = 0; i < range_count; ++i) {
+        rocksdb::Slice start = i == 0 ? rocksdb::Slice() : rocksdb::Slice(boundaries[i - 1]);
+        rocksdb::Slice limit = i + 1 == range_count ? rocksdb::Slice(kMaxKey) : boundaries[i];
+        rocksdb::Range range(start, limit);
+        uint64_t range_size = 0;
+        _db->GetApproximateSizes(_data_cf, &range, 1, &range_size);
+
+        // the sample points of the range, at least the start of the range
+        std::vector<std::pair<rocksdb::Slice, uint64_t>> points;
+        for (; file_index < file_keys.size() &&
+               (i + 1 == range_count || limit.compare(file_keys[file_index].first) > 0);
+             ++file_index) {
+            points.emplace_back(file_keys[file_index].first, file_keys[file_index].second);
+        }
+        if (points.empty()) {
+            points.emplace_back(start, 1);
+        }
+        uint32_t samples_per_point = std::max<uint32_t>(
+            1, FLAGS_split_cleanup_sample_count / static_cast<uint32_t>(points.size()));
+
+        double stale_weight = 0;
+        double total_weight = 0;
+        for (const auto &point : points) {
+            uint32_t sampled = 0;
+            uint32_t stale = 0;
+            for (iter->Seek(point.first);
+                 iter->Valid() && sampled < samples_per_point &&
+                 (i + 1 == range_count || iter->key().compare(limit) < 0);
+                 iter->Next()) {
+                ++sampled;
+                if (iter->key().size() >= 2 &&
+                    !check_pegasus_key_hash(iter->key(), partition_index, partition_version)) {
+                    ++stale;
+                }
+            }
+            if (sampled > 0) {
+                stale_weight += static_cast<double>(point.second) * stale / sampled;
+                total_weight += point.second;
+            }
+        }
+        stale_bytes[i] =
+            total_weight == 0 ? 0 : static_cast<uint64_t>(range_size * stale_weight / total_weight);
+        stale_bytes_remaining += stale_bytes[i];
+    }
+    iter.reset();
+
+    ddebug_replica("start split cleanup, partition_version = {}, range_count = {}, estimated "
+                   "stale bytes = {}",
+                   partition_version,
+                   range_count,
+                   stale_bytes_remaining);
+    _meta_store->set_split_stale_bytes_remaining(stale_bytes_remaining);
+    progress(0, range_count, stale_bytes_remaining);
+
+    // Do not block the automatic compactions, and the writes of compaction are throttled by the
+    // rate limiter shared by all replicas.
+    rocksdb::CompactRangeOptions options;
+    options.exclusive_manual_compaction = false;
+    options.bottommost_level_compaction = rocksdb::BottommostLevelCompaction::kForce;
+    start_time = dsn_now_ms();
+    for (size_t i = 0; i < range_count; ++i) {
+        rocksdb::Slice begin;
+        rocksdb::Slice end;
+        if (i > 0) {
+            begin = boundaries[i - 1];
+        }
+        if (i + 1 < range_count) {
+            end = boundaries[i];
+        }
+        auto status = _db->CompactRange(
+            options, _data_cf, i > 0 ? &begin : nullptr, i + 1 < range_count ? &end : nullptr);
+        if (!status.ok()) {
+            derror_replica("split cleanup failed to compact range {}/{}, status = {}",
+                           i + 1,
+                           range_count,
+                           status.ToString());
+            return dsn_now_ms();
+        }
+
+        stale_bytes_remaining -= stale_bytes[i];
+        _meta_store->set_split_stale_bytes_remaining(stale_bytes_remaining);
+        progress(i + 1, range_count, stale_bytes_remaining);
+        if (i + 1 < range_count && FLAGS_split_cleanup_range_interval_ms > 0) {
+            std::this_thread::sleep_for(
+                std::chrono::milliseconds(FLAGS_split_cleanup_range_interval_ms));
+        }
+    }
+    auto end_time = dsn_now_ms();
+    ddebug_replica("finish split cleanup, time_used = {}ms", end_time - start_time);
+
+    // The partition version may be changed by another split during the cleanup.
+    if (_partition_version.load() == partition_version) {
+        _meta_store->set_split_cleaned_partition_version(partition_version);
+        _split_cleaned_partition_version.store(partition_version);
+    }
+    _meta_store->set_last_manual_compact_finish_time(end_time);
+    if (!release_storage_after_manual_compact()) {
+        ddebug_replica("release storage failed after split cleanup");
+    }
+    update_replica_rocksdb_statistics();
+
+    return _meta_store->get_last_manual_compact_finish_time();
+}
+
 bool pegasus_server_impl::release_storage_after_manual_compact()
 {
     int64_t old_last_durable = last_durable_decree();
@@ -2906,7 +3690,11 @@ void pegasus_server_impl::set_partition_version(int32_t partition_version)
 {
     rocksdb::FlushOptions options;
     options.wait = wait;
-    rocksdb::Status status = _db->Flush(options, {_meta_cf, _data_cf});
+    std::vector<rocksdb::ColumnFamilyHandle *> column_families({_meta_cf, _data_cf});
+    if (_expire_index_cf != nullptr) {
+        column_families.push_back(_expire_index_cf);
+    }
+    rocksdb::Status status = _db->Flush(options, column_families);
     if (!status.ok()) {
         derror_replica("flush failed, error = {}", status.ToString());
         return ::dsn::ERR_LOCAL_APP_FAILURE;
@@ -2922,6 +3710,10 @@ void pegasus_server_impl::release_db()
         _data_cf = nullptr;
         _db->DestroyColumnFamilyHandle(_meta_cf);
         _meta_cf = nullptr;
+        if (_expire_index_cf != nullptr) {
+            _db->DestroyColumnFamilyHandle(_expire_index_cf);
+            _expire_index_cf = nullptr;
+        }
         delete _db;
         _db = nullptr;
     }
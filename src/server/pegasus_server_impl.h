@@ -44,6 +44,9 @@ class meta_store;
 class capacity_unit_calculator;
 class pegasus_server_write;
 class hotkey_collector;
+struct checkpoint_manifest;
+class expire_index_purger;
+class hotkey_read_cache;
 
 enum class range_iteration_state
 {
@@ -103,10 +106,9 @@ public:
                                   dsn::message_ex **requests,
                                   int count) override;
 
-    ::dsn::error_code prepare_get_checkpoint(dsn::blob &learn_req) override
-    {
-        return ::dsn::ERR_OK;
-    }
+    // put the manifest of the last local checkpoint into "learn_req", so that the learnee
+    // could ship only the sst files which are missing on this replica.
+    ::dsn::error_code prepare_get_checkpoint(dsn::blob &learn_req) override;
 
     // returns:
     //  - ERR_OK: checkpoint succeed
@@ -144,7 +146,8 @@ public:
 
     // get the last checkpoint
     // if succeed:
-    //  - the checkpoint files path are put into "state.files"
+    //  - the checkpoint files path are put into "state.files", the sst files which the learner
+    //    already has (according to the manifest in "learn_request") are excluded
     //  - the checkpoint_info are serialized into "state.meta"
     //  - the "state.from_decree_excluded" and "state.to_decree_excluded" are set properly
     // returns:
@@ -192,6 +195,7 @@ private:
     friend class pegasus_compression_options_test;
     friend class pegasus_server_impl_test;
     friend class hotkey_collector_test;
+    friend class expire_index_test;
     FRIEND_TEST(pegasus_server_impl_test, default_data_version);
     FRIEND_TEST(pegasus_server_impl_test, test_open_db_with_latest_options);
     FRIEND_TEST(pegasus_server_impl_test, test_open_db_with_app_envs);
@@ -206,6 +210,28 @@ private:
     // checkpoint directory format is: "checkpoint.{decree}"
     void parse_checkpoints();
 
+    // get the manifest of checkpoint "checkpoint.{decree}", which is written when the checkpoint
+    // is created. ERR_OBJECT_NOT_FOUND is returned for checkpoints created without a manifest.
+    ::dsn::error_code get_checkpoint_manifest(int64_t decree,
+                                              /*out*/ checkpoint_manifest &manifest);
+
+    // build the manifest of the newly created checkpoint in "dir" and save it into "dir", the md5
+    // of sst files are reused from the latest manifest.
+    ::dsn::error_code write_checkpoint_manifest(const std::string &dir, int64_t decree);
+
+    // pin the checkpoint whose manifest is sent to the learnee, so that its files used as the
+    // sources of hard links won't be garbage collected until the learned checkpoint is applied.
+    // returns false if the checkpoint doesn't exist any more.
+    bool pin_checkpoint(int64_t decree);
+    void unpin_checkpoint();
+
+    // load the manifest of the latest checkpoint which has one, returns false if not found.
+    bool load_latest_checkpoint_manifest(/*out*/ checkpoint_manifest &manifest);
+
+    // fill the files which were not shipped by the learnee into "learn_dir", by making hard links
+    // to the same files of local checkpoints.
+    ::dsn::error_code link_learned_checkpoint_files(const std::string &learn_dir);
+
     // garbage collection checkpoints
     // if force_reserve_one == true, then only reserve the last one checkpoint
     void gc_checkpoints(bool force_reserve_one = false);
@@ -223,7 +249,8 @@ private:
                               uint32_t epoch_now,
                               bool no_value,
                               bool request_validate_hash,
-                              bool request_expire_ts);
+                              bool request_expire_ts,
+                              int64_t read_timestamp);
 
     range_iteration_state
     append_key_value_for_multi_get(std::vector<::dsn::apps::key_value> &kvs,
@@ -285,6 +312,22 @@ private:
     // return finish time recorded in rocksdb
     uint64_t do_manual_compact(const rocksdb::CompactRangeOptions &options);
 
+    // callback with (finished_ranges, total_ranges, stale_bytes_remaining)
+    typedef std::function<void(uint32_t, uint32_t, uint64_t)> split_cleanup_progress_callback;
+
+    // compact the whole key space range by range with the compaction filter, to remove the
+    // stale data which belongs to the other half partition after partition split.
+    // return finish time recorded in rocksdb
+    uint64_t do_split_cleanup_compact(const split_cleanup_progress_callback &progress);
+
+    // return true if the stale data of the current partition version has been cleaned up, thus
+    // it is no longer necessary to validate the partition hash of the keys.
+    bool is_split_data_cleaned() const
+    {
+        int64_t cleaned_version = _split_cleaned_partition_version.load();
+        return cleaned_version >= 0 && cleaned_version == _partition_version.load();
+    }
+
     // generate new checkpoint and remove old checkpoints, in order to release storage asap
     // return true if release succeed (new checkpointed generated).
     bool release_storage_after_manual_compact();
@@ -342,8 +385,10 @@ private:
         return false;
     }
 
-    ::dsn::error_code
-    check_column_families(const std::string &path, bool *missing_meta_cf, bool *miss_data_cf);
+    ::dsn::error_code check_column_families(const std::string &path,
+                                            bool *missing_meta_cf,
+                                            bool *miss_data_cf,
+                                            bool *missing_expire_index_cf);
 
     void release_db();
 
@@ -360,6 +405,7 @@ private:
     // Column family names.
     static const std::string DATA_COLUMN_FAMILY_NAME;
     static const std::string META_COLUMN_FAMILY_NAME;
+    static const std::string EXPIRE_INDEX_COLUMN_FAMILY_NAME;
 
     dsn::gpid _gpid;
     std::string _primary_address;
@@ -378,6 +424,7 @@ private:
     rocksdb::DBOptions _db_opts;
     rocksdb::ColumnFamilyOptions _data_cf_opts;
     rocksdb::ColumnFamilyOptions _meta_cf_opts;
+    rocksdb::ColumnFamilyOptions _expire_index_cf_opts;
     rocksdb::ReadOptions _data_cf_rd_opts;
     std::string _usage_scenario;
     std::string _user_specified_compaction;
@@ -385,6 +432,8 @@ private:
     rocksdb::DB *_db;
     rocksdb::ColumnFamilyHandle *_data_cf;
     rocksdb::ColumnFamilyHandle *_meta_cf;
+    // nullptr if the expire index column family is not opened.
+    rocksdb::ColumnFamilyHandle *_expire_index_cf;
     static std::shared_ptr<rocksdb::Cache> _s_block_cache;
     static std::shared_ptr<rocksdb::WriteBufferManager> _s_write_buffer_manager;
     static std::shared_ptr<rocksdb::RateLimiter> _s_rate_limiter;
@@ -394,6 +443,8 @@ private:
     std::atomic<int64_t> _last_durable_decree;
 
     std::unique_ptr<meta_store> _meta_store;
+    // nullptr if the expire index is disabled.
+    std::unique_ptr<expire_index_purger> _expire_index_purger;
     std::unique_ptr<capacity_unit_calculator> _cu_calculator;
     std::unique_ptr<pegasus_server_write> _server_write;
 
@@ -404,8 +455,13 @@ private:
     std::atomic_bool _is_checkpointing;         // whether the db is doing checkpoint
     ::dsn::utils::ex_lock_nr _checkpoints_lock; // protected the following checkpoints vector
     std::deque<int64_t> _checkpoints;           // ordered checkpoints
+    // the checkpoint pinned by the ongoing learn, 0 if none. It won't be garbage collected before
+    // being unpinned or "_pinned_checkpoint_expire_ms", in case the learn is aborted.
+    int64_t _pinned_checkpoint;
+    uint64_t _pinned_checkpoint_expire_ms;
 
     pegasus_context_cache _context_cache;
+    pegasus_scan_snapshot_table _scan_snapshots;
 
     std::chrono::seconds _update_rdb_stat_interval;
     ::dsn::task_ptr _update_replica_rdb_stat;
@@ -415,6 +471,8 @@ private:
 
     std::atomic<int32_t> _partition_version;
     bool _validate_partition_hash{false};
+    // the partition version whose stale split data has been cleaned up, -1 means never
+    std::atomic<int64_t> _split_cleaned_partition_version{-1};
 
     dsn::replication::ingestion_status::type _ingestion_status{
         dsn::replication::ingestion_status::IS_INVALID};
@@ -423,6 +481,8 @@ private:
 
     std::shared_ptr<hotkey_collector> _read_hotkey_collector;
     std::shared_ptr<hotkey_collector> _write_hotkey_collector;
+    // nullptr if the hotkey read cache is disabled.
+    std::unique_ptr<hotkey_read_cache> _hotkey_read_cache;
 
     // perf counters
     ::dsn::perf_counter_wrapper _pfc_get_qps;
@@ -436,6 +496,9 @@ private:
     ::dsn::perf_counter_wrapper _pfc_recent_expire_count;
     ::dsn::perf_counter_wrapper _pfc_recent_filter_count;
     ::dsn::perf_counter_wrapper _pfc_recent_abnormal_count;
+    ::dsn::perf_counter_wrapper _pfc_recent_expire_index_purge_count;
+    ::dsn::perf_counter_wrapper _pfc_recent_hotkey_cache_hit_count;
+    ::dsn::perf_counter_wrapper _pfc_recent_hotkey_cache_miss_count;
 
     // rocksdb internal statistics
     // server level
@@ -94,10 +94,13 @@ pegasus_server_impl::pegasus_server_impl(dsn::replication::replica *r)
       _db(nullptr),
       _data_cf(nullptr),
       _meta_cf(nullptr),
+      _expire_index_cf(nullptr),
       _is_open(false),
       _pegasus_data_version(PEGASUS_DATA_VERSION_MAX),
       _last_durable_decree(0),
       _is_checkpointing(false),
+      _pinned_checkpoint(0),
+      _pinned_checkpoint_expire_ms(0),
       _manual_compact_svc(this),
       _partition_version(0)
 {
@@ -196,6 +199,24 @@ pegasus_server_impl::pegasus_server_impl(dsn::replication::replica *r)
                                     1024 * 1024,
                                     "rocksdb options.writable_file_max_buffer_size");
 
+    // Skip loading table properties of all sst files to update stats on opening, which costs
+    // lots of random reads when there are many sst files. The stats are only used for
+    // optimizing the compaction of deletions.
+    _db_opts.skip_stats_update_on_db_open =
+        dsn_config_get_value_bool("pegasus.server",
+                                  "rocksdb_skip_stats_update_on_db_open",
+                                  true,
+                                  "rocksdb options.skip_stats_update_on_db_open");
+
+    // If max_open_files is -1, all sst files will be opened with max_file_opening_threads
+    // threads on opening. Many replicas are opened concurrently while the server restarting, so
+    // limit it to avoid too many threads.
+    _db_opts.max_file_opening_threads =
+        (int)dsn_config_get_value_int64("pegasus.server",
+                                        "rocksdb_max_file_opening_threads",
+                                        16,
+                                        "rocksdb options.max_file_opening_threads");
+
     _statistics = rocksdb::CreateDBStatistics();
     _statistics->set_stats_level(rocksdb::kExceptDetailedTimers);
     _db_opts.statistics = _statistics;
@@ -294,6 +315,9 @@ pegasus_server_impl::pegasus_server_impl(dsn::replication::replica *r)
     // Data in meta CF is very little, disable compression to save CPU load.
     dassert(parse_compression_types("none", _meta_cf_opts.compression_per_level),
             "parse rocksdb_compression_type failed.");
+    // Entries in expire index CF are small and short-lived, the options of meta CF are reused,
+    // notice that the TTL compaction filter of data CF must not be applied on it.
+    _expire_index_cf_opts = _meta_cf_opts;
 
     rocksdb::BlockBasedTableOptions tbl_opts;
     tbl_opts.read_amp_bytes_per_bit = FLAGS_read_amp_bytes_per_bit;
@@ -506,23 +530,34 @@ pegasus_server_impl::pegasus_server_impl(dsn::replication::replica *r)
         tbl_opts.format_version = format_version;
         tbl_opts.filter_policy.reset(rocksdb::NewBloomFilterPolicy(bits_per_key, false));
 
-        std::string filter_type =
-            dsn_config_get_value_string("pegasus.server",
-                                        "rocksdb_filter_type",
-                                        "prefix",
-                                        "Bloom filter type, should be either 'common' or 'prefix'");
-        dassert(filter_type == "common" || filter_type == "prefix",
-                "[pegasus.server]rocksdb_filter_type should be either 'common' or 'prefix'.");
-        if (filter_type == "prefix") {
+        std::string filter_type = dsn_config_get_value_string(
+            "pegasus.server",
+            "rocksdb_filter_type",
+            "prefix",
+            "Bloom filter type, should be one of 'common', 'prefix' or 'prefix_and_whole_key'");
+        dassert(filter_type == "common" || filter_type == "prefix" ||
+                    filter_type == "prefix_and_whole_key",
+                "[pegasus.server]rocksdb_filter_type should be one of 'common', 'prefix' or "
+                "'prefix_and_whole_key'.");
+        if (filter_type == "prefix" || filter_type == "prefix_and_whole_key") {
             _data_cf_opts.prefix_extractor.reset(new HashkeyTransform());
             _data_cf_opts.memtable_prefix_bloom_size_ratio = 0.1;
 
             _data_cf_rd_opts.prefix_same_as_start = true;
         }
+        if (filter_type == "prefix_and_whole_key") {
+            // The SST full filters already contain both the hash key prefix and the whole key,
+            // because BlockBasedTableOptions::whole_key_filtering is true by default. Here the
+            // memtable bloom filter is also built for whole keys, thus a get on a missing sort
+            // key of a large hash key will stop at the filter of the memtable as well.
+            _data_cf_opts.memtable_whole_key_filtering = true;
+        }
+        ddebug_replica("rocksdb_filter_type = {}", filter_type);
     }
 
     _data_cf_opts.table_factory.reset(NewBlockBasedTableFactory(tbl_opts));
     _meta_cf_opts.table_factory.reset(NewBlockBasedTableFactory(tbl_opts));
+    _expire_index_cf_opts.table_factory = _meta_cf_opts.table_factory;
 
     _key_ttl_compaction_filter_factory = std::make_shared<KeyWithTTLCompactionFilterFactory>();
     _data_cf_opts.compaction_filter_factory = _key_ttl_compaction_filter_factory;
@@ -594,6 +629,27 @@ pegasus_server_impl::pegasus_server_impl(dsn::replication::replica *r)
                                                 COUNTER_TYPE_VOLATILE_NUMBER,
                                                 "statistic the recent abnormal read count");
 
+    snprintf(name, 255, "recent.expire_index.purge.count@%s", str_gpid.c_str());
+    _pfc_recent_expire_index_purge_count.init_app_counter(
+        "app.pegasus",
+        name,
+        COUNTER_TYPE_VOLATILE_NUMBER,
+        "statistic the recent count of expired records purged by the expire index");
+
+    snprintf(name, 255, "recent.hotkey_cache.hit.count@%s", str_gpid.c_str());
+    _pfc_recent_hotkey_cache_hit_count.init_app_counter(
+        "app.pegasus",
+        name,
+        COUNTER_TYPE_VOLATILE_NUMBER,
+        "statistic the recent count of reads on hot keys served by the hotkey read cache");
+
+    snprintf(name, 255, "recent.hotkey_cache.miss.count@%s", str_gpid.c_str());
+    _pfc_recent_hotkey_cache_miss_count.init_app_counter(
+        "app.pegasus",
+        name,
+        COUNTER_TYPE_VOLATILE_NUMBER,
+        "statistic the recent count of reads on hot keys missing the hotkey read cache");
+
     snprintf(name, 255, "disk.storage.sst.count@%s", str_gpid.c_str());
     _pfc_rdb_sst_count.init_app_counter(
         "app.pegasus", name, COUNTER_TYPE_NUMBER, "statistic the count of sstable files");
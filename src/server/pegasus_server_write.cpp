@@ -54,6 +54,8 @@ int pegasus_server_write::on_batched_write_requests(dsn::message_ex **requests,
     auto iter = _non_batch_write_handlers.find(requests[0]->rpc_code());
     if (iter != _non_batch_write_handlers.end()) {
         dassert_f(count == 1, "count = {}", count);
+        _write_svc->set_write_request(requests[0]);
+        auto cleanup = dsn::defer([this]() { _write_svc->set_write_request(nullptr); });
         return iter->second(requests[0]);
     }
     return on_batched_writes(requests, count);
@@ -75,6 +77,7 @@ int pegasus_server_write::on_batched_writes(dsn::message_ex **requests, int coun
             // and respond for all RPCs regardless of their result.
 
             int local_err = 0;
+            _write_svc->set_write_request(requests[i]);
             dsn::task_code rpc_code(requests[i]->rpc_code());
             if (rpc_code == dsn::apps::RPC_RRDB_RRDB_PUT) {
                 auto rpc = put_rpc::auto_reply(requests[i]);
@@ -96,6 +99,7 @@ int pegasus_server_write::on_batched_writes(dsn::message_ex **requests, int coun
                 err = local_err;
             }
         }
+        _write_svc->set_write_request(nullptr);
 
         if (err == 0) {
             err = _write_svc->batch_commit(_decree);
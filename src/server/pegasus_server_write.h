@@ -77,6 +77,7 @@ private:
     friend class pegasus_write_service_test;
     friend class pegasus_write_service_impl_test;
     friend class rocksdb_wrapper_test;
+    friend class expire_index_test;
 
     std::unique_ptr<pegasus_write_service> _write_svc;
     std::vector<put_rpc> _put_rpc_batch;
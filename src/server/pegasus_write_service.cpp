@@ -21,6 +21,7 @@
 #include "pegasus_write_service.h"
 #include "pegasus_write_service_impl.h"
 #include "capacity_unit_calculator.h"
+#include "duplication_compression.h"
 
 #include <dsn/cpp/message_utils.h>
 #include <dsn/dist/replication/replication.codes.h>
@@ -294,6 +295,14 @@ void pegasus_write_service::batch_abort(int64_t decree, int err)
 
 void pegasus_write_service::set_default_ttl(uint32_t ttl) { _impl->set_default_ttl(ttl); }
 
+void pegasus_write_service::set_write_request(dsn::message_ex *req)
+{
+    // The capacity units are only attributed on the primary, but the reset to nullptr must always
+    // be done, otherwise a request released after the batch may be referenced if this replica
+    // becomes the primary later.
+    _cu_calculator->set_write_request(req != nullptr && _server->is_primary() ? req : nullptr);
+}
+
 void pegasus_write_service::clear_up_batch_states()
 {
     uint64_t latency = dsn_now_ns() - _batch_start_time;
@@ -323,15 +332,21 @@ int pegasus_write_service::duplicate(int64_t decree,
         return empty_put(decree);
     }
 
+    if (request.__isset.entries) {
+        return duplicate_batch(decree, request, resp);
+    }
+
+    dsn::blob raw_message;
+    std::vector<dsn::apps::duplicate_entry> entries;
+    int err = decompress_duplicate_request(request, raw_message, entries, resp);
+    if (err != rocksdb::Status::kOk) {
+        resp.__set_error(err);
+        return empty_put(decree);
+    }
+
     _pfc_duplicate_qps->increment();
-    auto cleanup = dsn::defer([this, &request]() {
-        uint64_t latency_ms = (dsn_now_us() - request.timestamp) / 1000;
-        if (latency_ms > _dup_lagging_write_threshold_ms) {
-            _pfc_dup_lagging_writes->increment();
-        }
-        _pfc_dup_time_lag->set(latency_ms);
-    });
-    dsn::message_ex *write = dsn::from_blob_to_received_msg(request.task_code, request.raw_message);
+    auto cleanup = dsn::defer([this, &request]() { update_dup_time_lag(request.timestamp); });
+    dsn::message_ex *write = dsn::from_blob_to_received_msg(request.task_code, raw_message);
     bool is_delete = request.task_code == dsn::apps::RPC_RRDB_RRDB_MULTI_REMOVE ||
                      request.task_code == dsn::apps::RPC_RRDB_RRDB_REMOVE;
     auto remote_timetag = generate_timetag(request.timestamp, request.cluster_id, is_delete);
@@ -351,7 +366,6 @@ int pegasus_write_service::duplicate(int64_t decree,
     remove_rpc remove;
     if (request.task_code == dsn::apps::RPC_RRDB_RRDB_PUT ||
         request.task_code == dsn::apps::RPC_RRDB_RRDB_REMOVE) {
-        int err = 0;
         if (request.task_code == dsn::apps::RPC_RRDB_RRDB_PUT) {
             put = put_rpc(write);
             err = _impl->batch_put(ctx, put.request(), put.response());
@@ -373,6 +387,153 @@ int pegasus_write_service::duplicate(int64_t decree,
     return empty_put(ctx.decree);
 }
 
+int pegasus_write_service::duplicate_batch(int64_t decree,
+                                           const dsn::apps::duplicate_request &request,
+                                           dsn::apps::duplicate_response &resp)
+{
+    // All the writes are decoded and checked before any of them is applied, so that a batch
+    // which can't be served by this partition is refused as a whole. The decoded writes are
+    // kept until the batch is committed, because their responses are referred by the batch.
+    std::vector<put_rpc> puts;
+    std::vector<remove_rpc> removes;
+    std::vector<multi_put_rpc> multi_puts;
+    std::vector<multi_remove_rpc> multi_removes;
+    int32_t partition_version = _server->_partition_version.load();
+
+    dsn::blob raw_message;
+    std::vector<dsn::apps::duplicate_entry> entries;
+    int err = decompress_duplicate_request(request, raw_message, entries, resp);
+    if (err != rocksdb::Status::kOk) {
+        resp.__set_error(err);
+        return empty_put(decree);
+    }
+
+    for (const auto &entry : entries) {
+        const dsn::task_code &code = entry.task_code;
+        if (code != dsn::apps::RPC_RRDB_RRDB_PUT && code != dsn::apps::RPC_RRDB_RRDB_REMOVE &&
+            code != dsn::apps::RPC_RRDB_RRDB_MULTI_PUT &&
+            code != dsn::apps::RPC_RRDB_RRDB_MULTI_REMOVE) {
+            err = rocksdb::Status::kNotSupported;
+            resp.__set_error_hint(fmt::format("unrecognized task code {} in batch", code));
+            break;
+        }
+
+        dsn::message_ex *write = dsn::from_blob_to_received_msg(code, entry.raw_message);
+        uint64_t hash = 0;
+        if (code == dsn::apps::RPC_RRDB_RRDB_PUT) {
+            puts.emplace_back(write);
+            hash = pegasus_key_hash(puts.back().request().key);
+        } else if (code == dsn::apps::RPC_RRDB_RRDB_REMOVE) {
+            removes.emplace_back(write);
+            hash = pegasus_key_hash(removes.back().request());
+        } else if (code == dsn::apps::RPC_RRDB_RRDB_MULTI_PUT) {
+            multi_puts.emplace_back(write);
+            hash = pegasus_hash_key_hash(multi_puts.back().request().hash_key);
+        } else {
+            multi_removes.emplace_back(write);
+            hash = pegasus_hash_key_hash(multi_removes.back().request().hash_key);
+        }
+
+        // The writes of different hash keys are batched by the source cluster, which requires
+        // all of them to be served by this partition. It's refused as not supported rather than
+        // an invalid argument, so that the source falls back to ship the writes one by one.
+        if (partition_version > 0 &&
+            static_cast<int32_t>(hash & partition_version) != get_gpid().get_partition_index()) {
+            err = rocksdb::Status::kNotSupported;
+            resp.__set_error_hint("the batched write is not served by this partition, the "
+                                  "partition count of the source table may be different");
+            break;
+        }
+    }
+
+    if (err != rocksdb::Status::kOk) {
+        resp.__set_error(err);
+        // we should write empty record to update rocksdb's last flushed decree
+        return empty_put(decree);
+    }
+
+    size_t put_index = 0, remove_index = 0, multi_put_index = 0, multi_remove_index = 0;
+    for (const auto &entry : entries) {
+        const dsn::task_code &code = entry.task_code;
+        bool is_delete = code == dsn::apps::RPC_RRDB_RRDB_MULTI_REMOVE ||
+                         code == dsn::apps::RPC_RRDB_RRDB_REMOVE;
+        auto remote_timetag = generate_timetag(entry.timestamp, request.cluster_id, is_delete);
+        auto ctx =
+            db_write_context::create_duplicate(decree, remote_timetag, request.verify_timetag);
+
+        if (code == dsn::apps::RPC_RRDB_RRDB_PUT) {
+            auto &rpc = puts[put_index++];
+            err = _impl->batch_put(ctx, rpc.request(), rpc.response());
+        } else if (code == dsn::apps::RPC_RRDB_RRDB_REMOVE) {
+            auto &rpc = removes[remove_index++];
+            err = _impl->batch_remove(decree, rpc.request(), rpc.response());
+        } else if (code == dsn::apps::RPC_RRDB_RRDB_MULTI_PUT) {
+            err = _impl->batch_multi_put(ctx, multi_puts[multi_put_index++].request());
+        } else {
+            err = _impl->batch_multi_remove(decree, multi_removes[multi_remove_index++].request());
+        }
+        if (err != rocksdb::Status::kOk) {
+            break;
+        }
+        _pfc_duplicate_qps->increment();
+        update_dup_time_lag(entry.timestamp);
+    }
+
+    if (err == rocksdb::Status::kOk) {
+        err = _impl->batch_commit(decree);
+    } else {
+        _impl->batch_abort(decree, err);
+    }
+    resp.__set_error(err);
+    return err;
+}
+
+int pegasus_write_service::decompress_duplicate_request(
+    const dsn::apps::duplicate_request &request,
+    dsn::blob &raw_message,
+    std::vector<dsn::apps::duplicate_entry> &entries,
+    dsn::apps::duplicate_response &resp)
+{
+    if (!is_duplicate_compressed(request)) {
+        raw_message = request.raw_message;
+        entries = request.entries;
+        return rocksdb::Status::kOk;
+    }
+
+    std::string error_hint;
+    bool ok = request.__isset.entries
+                  ? decompress_duplicate_entries(
+                        request.compression_type, request.raw_message, entries, error_hint)
+                  : decompress_duplicate_payload(
+                        request.compression_type, request.raw_message, raw_message, error_hint);
+    if (ok) {
+        return rocksdb::Status::kOk;
+    }
+
+    bool known_type =
+        request.compression_type == dsn::apps::duplicate_compression_type::DCT_LZ4 ||
+        request.compression_type == dsn::apps::duplicate_compression_type::DCT_ZSTD;
+    derror_replica("failed to decompress the DUPLICATE from cluster {}: {} [compression_type:{}, "
+                   "frame_size:{}, batched:{}, timestamp:{}]",
+                   static_cast<int>(request.cluster_id),
+                   error_hint,
+                   static_cast<int>(request.compression_type),
+                   request.raw_message.length(),
+                   request.__isset.entries,
+                   request.timestamp);
+    resp.__set_error_hint(error_hint);
+    return known_type ? rocksdb::Status::kCorruption : rocksdb::Status::kNotSupported;
+}
+
+void pegasus_write_service::update_dup_time_lag(int64_t timestamp)
+{
+    uint64_t latency_ms = (dsn_now_us() - timestamp) / 1000;
+    if (latency_ms > _dup_lagging_write_threshold_ms) {
+        _pfc_dup_lagging_writes->increment();
+    }
+    _pfc_dup_time_lag->set(latency_ms);
+}
+
 int pegasus_write_service::ingestion_files(int64_t decree,
                                            const dsn::replication::ingestion_request &req,
                                            dsn::replication::ingestion_response &resp)
@@ -173,7 +173,27 @@ public:
 
     void set_default_ttl(uint32_t ttl);
 
+    // Set the request of the write being applied, nullptr after it's applied.
+    void set_write_request(dsn::message_ex *req);
+
 private:
+    // Handles the batched DUPLICATE, the writes in it are applied as one write batch.
+    int duplicate_batch(int64_t decree,
+                        const dsn::apps::duplicate_request &request,
+                        dsn::apps::duplicate_response &resp);
+
+    // Gets the writes of `request`, into `raw_message` for a single write or `entries` for a
+    // batch, which are decompressed if `request` is compressed. If failed, sets the error hint
+    // of `resp` and returns kNotSupported for an unknown compression type, or kCorruption for a
+    // broken frame. Neither is an invalid argument, so the source doesn't fail fast but resends
+    // the writes.
+    int decompress_duplicate_request(const dsn::apps::duplicate_request &request,
+                                     /*out*/ dsn::blob &raw_message,
+                                     /*out*/ std::vector<dsn::apps::duplicate_entry> &entries,
+                                     /*out*/ dsn::apps::duplicate_response &resp);
+
+    void update_dup_time_lag(int64_t timestamp);
+
     void clear_up_batch_states();
 
 private:
@@ -181,6 +201,7 @@ private:
     friend class pegasus_write_service_impl_test;
     friend class pegasus_server_write_test;
     friend class rocksdb_wrapper_test;
+    friend class expire_index_test;
 
     pegasus_server_impl *_server;
 
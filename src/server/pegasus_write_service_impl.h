@@ -520,6 +520,47 @@ public:
         return resp.error;
     }
 
+    // Appends the puts of `update` to the write batch, which are written by batch_commit.
+    int batch_multi_put(const db_write_context &ctx, const dsn::apps::multi_put_request &update)
+    {
+        if (update.kvs.empty()) {
+            derror_replica("invalid argument for multi_put in batch: decree = {}, error = {}",
+                           ctx.decree,
+                           "request.kvs is empty");
+            return rocksdb::Status::kInvalidArgument;
+        }
+        for (auto &kv : update.kvs) {
+            int err = _rocksdb_wrapper->write_batch_put_ctx(
+                ctx,
+                composite_raw_key(update.hash_key, kv.key),
+                kv.value,
+                static_cast<uint32_t>(update.expire_ts_seconds));
+            if (err) {
+                return err;
+            }
+        }
+        return rocksdb::Status::kOk;
+    }
+
+    // Appends the deletes of `update` to the write batch, which are written by batch_commit.
+    int batch_multi_remove(int64_t decree, const dsn::apps::multi_remove_request &update)
+    {
+        if (update.sort_keys.empty()) {
+            derror_replica("invalid argument for multi_remove in batch: decree = {}, error = {}",
+                           decree,
+                           "request.sort_keys is empty");
+            return rocksdb::Status::kInvalidArgument;
+        }
+        for (auto &sort_key : update.sort_keys) {
+            int err = _rocksdb_wrapper->write_batch_delete(
+                decree, composite_raw_key(update.hash_key, sort_key));
+            if (err) {
+                return err;
+            }
+        }
+        return rocksdb::Status::kOk;
+    }
+
     int batch_commit(int64_t decree)
     {
         int err = _rocksdb_wrapper->write(decree);
@@ -669,6 +710,7 @@ private:
     friend class pegasus_server_write_test;
     friend class pegasus_write_service_impl_test;
     friend class rocksdb_wrapper_test;
+    friend class expire_index_test;
     FRIEND_TEST(pegasus_write_service_impl_test, put_verify_timetag);
     FRIEND_TEST(pegasus_write_service_impl_test, verify_timetag_compatible_with_version_0);
 
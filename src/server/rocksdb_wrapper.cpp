@@ -22,6 +22,8 @@
 #include <dsn/utility/fail_point.h>
 #include <rocksdb/db.h>
 #include "pegasus_write_service_impl.h"
+#include "expire_index.h"
+#include "hotkey_read_cache.h"
 #include "base/pegasus_value_schema.h"
 
 namespace pegasus {
@@ -32,6 +34,9 @@ rocksdb_wrapper::rocksdb_wrapper(pegasus_server_impl *server)
       _db(server->_db),
       _rd_opts(server->_data_cf_rd_opts),
       _meta_cf(server->_meta_cf),
+      _expire_index_cf(server->_expire_index_purger ? server->_expire_index_cf : nullptr),
+      _expire_index_purger(server->_expire_index_purger.get()),
+      _read_cache(server->_hotkey_read_cache.get()),
       _pegasus_data_version(server->_pegasus_data_version),
       _pfc_recent_expire_count(server->_pfc_recent_expire_count),
       _default_ttl(0)
@@ -117,11 +122,20 @@ int rocksdb_wrapper::write_batch_put_ctx(const db_write_context &ctx,
         }
     }
 
+    uint32_t expire_ts = db_expire_ts(expire_sec);
     rocksdb::Slice skey = utils::to_rocksdb_slice(raw_key);
     rocksdb::SliceParts skey_parts(&skey, 1);
-    rocksdb::SliceParts svalue = _value_generator->generate_value(
-        _pegasus_data_version, value, db_expire_ts(expire_sec), new_timetag);
+    rocksdb::SliceParts svalue =
+        _value_generator->generate_value(_pegasus_data_version, value, expire_ts, new_timetag);
     rocksdb::Status s = _write_batch->Put(skey_parts, svalue);
+    if (s.ok() && _expire_index_cf != nullptr && expire_ts > 0 && !raw_key.empty()) {
+        s = _write_batch->Put(_expire_index_cf,
+                              encode_expire_index_key(expire_ts, raw_key),
+                              rocksdb::Slice());
+    }
+    if (s.ok()) {
+        add_read_cache_invalidated_key(raw_key);
+    }
     if (dsn_unlikely(!s.ok())) {
         ::dsn::blob hash_key, sort_key;
         pegasus_restore_key(::dsn::blob(raw_key.data(), 0, raw_key.size()), hash_key, sort_key);
@@ -142,6 +156,13 @@ int rocksdb_wrapper::write(int64_t decree)
 
     FAIL_POINT_INJECT_F("db_write", [](dsn::string_view) -> int { return FAIL_DB_WRITE; });
 
+    // The expired records are purged in background, the write lock prevents the purger from
+    // deleting a record which is rewritten by this batch.
+    std::unique_lock<std::mutex> purge_guard;
+    if (_expire_index_purger != nullptr) {
+        purge_guard = std::unique_lock<std::mutex>(_expire_index_purger->write_lock());
+    }
+
     rocksdb::Status status =
         _write_batch->Put(_meta_cf, meta_store::LAST_FLUSHED_DECREE, std::to_string(decree));
     if (dsn_unlikely(!status.ok())) {
@@ -156,6 +177,10 @@ int rocksdb_wrapper::write(int64_t decree)
     if (dsn_unlikely(!status.ok())) {
         derror_rocksdb("Write", status.ToString(), "write rocksdb error, decree: {}", decree);
     }
+    if (!_read_cache_invalidated_keys.empty()) {
+        _read_cache->invalidate(_read_cache_invalidated_keys);
+        _read_cache_invalidated_keys.clear();
+    }
     return status.code();
 }
 
@@ -165,6 +190,9 @@ int rocksdb_wrapper::write_batch_delete(int64_t decree, dsn::string_view raw_key
                         [](dsn::string_view) -> int { return FAIL_DB_WRITE_BATCH_DELETE; });
 
     rocksdb::Status s = _write_batch->Delete(utils::to_rocksdb_slice(raw_key));
+    if (s.ok()) {
+        add_read_cache_invalidated_key(raw_key);
+    }
     if (dsn_unlikely(!s.ok())) {
         dsn::blob hash_key, sort_key;
         pegasus_restore_key(dsn::blob(raw_key.data(), 0, raw_key.size()), hash_key, sort_key);
@@ -178,12 +206,19 @@ int rocksdb_wrapper::write_batch_delete(int64_t decree, dsn::string_view raw_key
     return s.code();
 }
 
-void rocksdb_wrapper::clear_up_write_batch() { _write_batch->Clear(); }
+void rocksdb_wrapper::clear_up_write_batch()
+{
+    _write_batch->Clear();
+    _read_cache_invalidated_keys.clear();
+}
 
 int rocksdb_wrapper::ingestion_files(int64_t decree, const std::vector<std::string> &sst_file_list)
 {
     rocksdb::IngestExternalFileOptions ifo;
     rocksdb::Status s = _db->IngestExternalFile(sst_file_list, ifo);
+    if (_read_cache != nullptr) {
+        _read_cache->clear();
+    }
     if (dsn_unlikely(!s.ok())) {
         derror_rocksdb("IngestExternalFile", s.ToString(), "decree = {}", decree);
     } else {
@@ -200,6 +235,13 @@ void rocksdb_wrapper::set_default_ttl(uint32_t ttl)
     }
 }
 
+void rocksdb_wrapper::add_read_cache_invalidated_key(dsn::string_view raw_key)
+{
+    if (_read_cache != nullptr && !raw_key.empty() && _read_cache->is_hot_raw_key(raw_key)) {
+        _read_cache_invalidated_keys.emplace_back(raw_key.data(), raw_key.size());
+    }
+}
+
 uint32_t rocksdb_wrapper::db_expire_ts(uint32_t expire_ts)
 {
     // use '_default_ttl' when ttl is not set for this write operation.
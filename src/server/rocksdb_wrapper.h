@@ -19,6 +19,9 @@
 
 #pragma once
 
+#include <string>
+#include <vector>
+
 #include <dsn/dist/replication/replica_base.h>
 #include <gtest/gtest_prod.h>
 
@@ -41,6 +44,8 @@ namespace server {
 struct db_get_context;
 struct db_write_context;
 class pegasus_server_impl;
+class expire_index_purger;
+class hotkey_read_cache;
 
 class rocksdb_wrapper : public dsn::replication::replica_base
 {
@@ -70,6 +75,8 @@ public:
 
 private:
     uint32_t db_expire_ts(uint32_t expire_ts);
+    // Remembers `raw_key` to be invalidated from the hotkey read cache after the batch is written.
+    void add_read_cache_invalidated_key(dsn::string_view raw_key);
 
     rocksdb::DB *_db;
     rocksdb::ReadOptions &_rd_opts;
@@ -77,6 +84,12 @@ private:
     std::unique_ptr<rocksdb::WriteBatch> _write_batch;
     std::unique_ptr<rocksdb::WriteOptions> _wt_opts;
     rocksdb::ColumnFamilyHandle *_meta_cf;
+    // nullptr if the expire index is disabled.
+    rocksdb::ColumnFamilyHandle *_expire_index_cf;
+    expire_index_purger *_expire_index_purger;
+    // nullptr if the hotkey read cache is disabled.
+    hotkey_read_cache *_read_cache;
+    std::vector<std::string> _read_cache_invalidated_keys;
 
     const uint32_t _pegasus_data_version;
     dsn::perf_counter_wrapper &_pfc_recent_expire_count;
@@ -23,10 +23,14 @@
 #include <dsn/dist/replication/replica_base.h>
 #include "pegasus_key_schema.h"
 #include "server/hotkey_collector.h"
+#include "server/capacity_unit_attribution.h"
 
 namespace pegasus {
 namespace server {
 
+DSN_DECLARE_bool(cu_attribution_by_client);
+DSN_DECLARE_uint32(cu_attribution_hash_key_prefix_length);
+
 class mock_capacity_unit_calculator : public capacity_unit_calculator
 {
 public:
@@ -493,5 +497,85 @@ TEST_F(capacity_unit_calculator_test, backup_request_bytes)
     _cal->reset();
 }
 
+TEST(cu_attribution_table_test, bounded_top_n)
+{
+    cu_attribution_table table(3);
+    table.add("a", cu_usage::read(10, 100));
+    table.add("b", cu_usage::write(30, 300));
+    table.add("c", cu_usage::read(20, 200));
+    table.add("a", cu_usage::write(5, 50));
+    // out of max entries, accumulated into the overflow bucket
+    table.add("d", cu_usage::read(100, 1000));
+
+    std::vector<std::pair<std::string, cu_usage>> top;
+    cu_usage others;
+    table.take_top(2, top, others);
+    ASSERT_EQ(2, top.size());
+    ASSERT_EQ("b", top[0].first);
+    ASSERT_EQ(30, top[0].second.write_cu);
+    ASSERT_EQ(1, top[0].second.write_count);
+    ASSERT_EQ("c", top[1].first);
+    ASSERT_EQ(20, top[1].second.read_cu);
+    // "a" and "d"
+    ASSERT_EQ(115, others.total_cu());
+    ASSERT_EQ(1150, others.read_bytes + others.write_bytes);
+    ASSERT_EQ(2, others.read_count);
+    ASSERT_EQ(1, others.write_count);
+
+    // a new window is started
+    table.take_top(2, top, others);
+    ASSERT_TRUE(top.empty());
+    ASSERT_EQ(0, others.total_cu());
+}
+
+TEST_F(capacity_unit_calculator_test, cu_attribution)
+{
+    FLAGS_cu_attribution_by_client = true;
+    FLAGS_cu_attribution_hash_key_prefix_length = 2;
+    auto &attribution = capacity_unit_attribution::instance();
+    // clear the usage of the previous window
+    attribution.report(1);
+
+    dsn::message_ptr msg = dsn::message_ex::create_request(RPC_TEST, static_cast<int>(1000), 1, 1);
+    msg->header->context.u.is_backup_request = false;
+    msg->header->from_address = dsn::rpc_address("10.1.2.3", 34801);
+
+    dsn::blob user_key;
+    pegasus_generate_key(
+        user_key, dsn::blob::create_from_bytes("user_1"), dsn::blob::create_from_bytes("s"));
+    _cal->add_get_cu(msg, rocksdb::Status::kOk, user_key, dsn::blob::create_from_bytes("value"));
+    _cal->reset();
+
+    std::vector<::dsn::apps::key_value> kvs;
+    generate_n_kvs(10, kvs);
+    _cal->set_write_request(msg);
+    _cal->add_multi_put_cu(rocksdb::Status::kOk, dsn::blob::create_from_bytes("order_1"), kvs);
+    _cal->set_write_request(nullptr);
+    _cal->reset();
+
+    attribution.report(1);
+    cu_usage client_usage =
+        attribution.last_window_usage(cu_attribution_dimension::CLIENT, "10.1.2.3");
+    ASSERT_EQ(1, client_usage.read_cu);
+    ASSERT_EQ(1, client_usage.write_cu);
+    ASSERT_EQ(1, client_usage.read_count);
+    ASSERT_EQ(1, client_usage.write_count);
+
+    cu_usage user_usage =
+        attribution.last_window_usage(cu_attribution_dimension::HASH_KEY_PREFIX, "us");
+    ASSERT_EQ(1, user_usage.read_cu);
+    ASSERT_EQ(0, user_usage.write_cu);
+    ASSERT_EQ(user_key.size() + 5, user_usage.read_bytes);
+
+    cu_usage order_usage =
+        attribution.last_window_usage(cu_attribution_dimension::HASH_KEY_PREFIX, "or");
+    ASSERT_EQ(0, order_usage.read_cu);
+    ASSERT_EQ(1, order_usage.write_cu);
+
+    FLAGS_cu_attribution_by_client = false;
+    FLAGS_cu_attribution_hash_key_prefix_length = 0;
+    attribution.report(1);
+}
+
 } // namespace server
 } // namespace pegasus
@@ -0,0 +1,131 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include "server/checkpoint_manifest.h"
+
+#include <gtest/gtest.h>
+#include <rocksdb/env.h>
+#include <dsn/utility/filesystem.h>
+
+namespace pegasus {
+namespace server {
+
+class checkpoint_manifest_test : public ::testing::Test
+{
+public:
+    void SetUp() override
+    {
+        dsn::utils::filesystem::remove_path(_dir);
+        ASSERT_TRUE(dsn::utils::filesystem::create_directory(_dir));
+    }
+
+    void TearDown() override { dsn::utils::filesystem::remove_path(_dir); }
+
+    void write_file(const std::string &name, const std::string &content)
+    {
+        auto s = rocksdb::WriteStringToFile(rocksdb::Env::Default(),
+                                            content,
+                                            dsn::utils::filesystem::path_combine(_dir, name));
+        ASSERT_TRUE(s.ok()) << s.ToString();
+    }
+
+protected:
+    const std::string _dir = "./checkpoint_manifest_test";
+};
+
+TEST_F(checkpoint_manifest_test, is_immutable_checkpoint_file)
+{
+    ASSERT_TRUE(is_immutable_checkpoint_file("000012.sst"));
+    ASSERT_FALSE(is_immutable_checkpoint_file(".sst"));
+    ASSERT_FALSE(is_immutable_checkpoint_file("CURRENT"));
+    ASSERT_FALSE(is_immutable_checkpoint_file("MANIFEST-000008"));
+    ASSERT_FALSE(is_immutable_checkpoint_file("OPTIONS-000010"));
+}
+
+TEST_F(checkpoint_manifest_test, build_save_and_load)
+{
+    write_file("000012.sst", "sst_12");
+    write_file("CURRENT", "MANIFEST-000008");
+
+    checkpoint_manifest manifest;
+    ASSERT_EQ(dsn::ERR_OK, build_checkpoint_manifest(_dir, 100, nullptr, manifest));
+    ASSERT_EQ(100, manifest.decree);
+    ASSERT_EQ(2, manifest.files.size());
+    ASSERT_EQ(dsn::ERR_OK, save_checkpoint_manifest(_dir, manifest));
+
+    // the manifest file itself is not listed
+    checkpoint_manifest rebuilt;
+    ASSERT_EQ(dsn::ERR_OK, build_checkpoint_manifest(_dir, 100, &manifest, rebuilt));
+    ASSERT_EQ(2, rebuilt.files.size());
+
+    checkpoint_manifest loaded;
+    ASSERT_EQ(dsn::ERR_OK, load_checkpoint_manifest(_dir, loaded));
+    ASSERT_EQ(manifest.decree, loaded.decree);
+    ASSERT_EQ(manifest.files.size(), loaded.files.size());
+    for (int i = 0; i < manifest.files.size(); ++i) {
+        ASSERT_EQ(manifest.files[i].name, loaded.files[i].name);
+        ASSERT_EQ(manifest.files[i].size, loaded.files[i].size);
+        ASSERT_EQ(manifest.files[i].md5, loaded.files[i].md5);
+    }
+
+    ASSERT_EQ(dsn::ERR_OBJECT_NOT_FOUND, load_checkpoint_manifest("./not_exist_dir", loaded));
+}
+
+TEST_F(checkpoint_manifest_test, get_checkpoint_files_to_ship)
+{
+    checkpoint_manifest source;
+    source.files = {{"000010.sst", 10, "md5_10"},
+                    {"000011.sst", 11, "md5_11"},
+                    {"000012.sst", 12, "md5_12"},
+                    {"CURRENT", 16, "md5_current"}};
+
+    struct test_case
+    {
+        std::vector<checkpoint_file_info> target_files;
+        std::vector<std::string> expected;
+    } tests[] = {
+        // nothing on the target
+        {{}, {"000010.sst", "000011.sst", "000012.sst", "CURRENT"}},
+        // all the same, mutable files are still shipped
+        {source.files, {"CURRENT"}},
+        // size or checksum mismatch
+        {{{"000010.sst", 10, "md5_10"}, {"000011.sst", 12, "md5_11"}, {"000012.sst", 12, "x"}},
+         {"000011.sst", "000012.sst", "CURRENT"}},
+    };
+    for (const auto &test : tests) {
+        checkpoint_manifest target;
+        target.files = test.target_files;
+        ASSERT_EQ(test.expected, get_checkpoint_files_to_ship(source, target));
+    }
+}
+
+TEST_F(checkpoint_manifest_test, get_missing_checkpoint_files)
+{
+    write_file("000010.sst", "sst_10");
+
+    checkpoint_manifest manifest;
+    manifest.files = {{"000010.sst", 6, "md5_10"}, {"000011.sst", 6, "md5_11"}};
+    auto missing = get_missing_checkpoint_files(_dir, manifest);
+    ASSERT_EQ(1, missing.size());
+    ASSERT_EQ("000011.sst", missing[0].name);
+}
+
+} // namespace server
+} // namespace pegasus
@@ -0,0 +1,174 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "server/expire_index.h"
+#include "server/pegasus_server_write.h"
+#include "server/pegasus_write_service_impl.h"
+#include "pegasus_server_test_base.h"
+
+#include <dsn/utility/flags.h>
+
+namespace pegasus {
+namespace server {
+
+DSN_DECLARE_bool(expire_index_enabled);
+
+TEST(expire_index_key_test, encode_and_decode)
+{
+    std::string index_key = encode_expire_index_key(1234, "raw_key");
+    uint32_t expire_ts = 0;
+    dsn::string_view raw_key;
+    ASSERT_TRUE(decode_expire_index_key(index_key, &expire_ts, &raw_key));
+    ASSERT_EQ(1234, expire_ts);
+    ASSERT_EQ("raw_key", raw_key);
+
+    // index keys are ordered by expire timestamps
+    ASSERT_LT(encode_expire_index_key(255, "b"), encode_expire_index_key(256, "a"));
+    ASSERT_LT(encode_expire_index_key(256, "a"), encode_expire_index_key(256, "b"));
+
+    ASSERT_FALSE(decode_expire_index_key("abc", &expire_ts, &raw_key));
+}
+
+class expire_index_test : public pegasus_server_test_base
+{
+public:
+    void SetUp() override
+    {
+        FLAGS_expire_index_enabled = true;
+        start();
+        _server_write = dsn::make_unique<pegasus_server_write>(_server.get(), true);
+        _rocksdb_wrapper = _server_write->_write_svc->_impl->_rocksdb_wrapper.get();
+    }
+
+    void TearDown() override { FLAGS_expire_index_enabled = false; }
+
+    void single_set(dsn::string_view sort_key, uint32_t expire_ts)
+    {
+        dsn::blob raw_key;
+        pegasus_generate_key(raw_key, dsn::string_view("hash_key"), sort_key);
+        ASSERT_EQ(0,
+                  _rocksdb_wrapper->write_batch_put_ctx(
+                      db_write_context::empty(0), raw_key, "value", expire_ts));
+        ASSERT_EQ(0, _rocksdb_wrapper->write(0));
+        _rocksdb_wrapper->clear_up_write_batch();
+    }
+
+    bool record_exists(dsn::string_view sort_key)
+    {
+        dsn::blob raw_key;
+        pegasus_generate_key(raw_key, dsn::string_view("hash_key"), sort_key);
+        db_get_context get_ctx;
+        _rocksdb_wrapper->get(raw_key, &get_ctx);
+        return get_ctx.found;
+    }
+
+    int index_count()
+    {
+        std::unique_ptr<rocksdb::Iterator> it(
+            _server->_db->NewIterator(rocksdb::ReadOptions(), _server->_expire_index_cf));
+        int count = 0;
+        for (it->SeekToFirst(); it->Valid(); it->Next()) {
+            ++count;
+        }
+        return count;
+    }
+
+    // The purging may have been done by the timer, so the count of purged records is not
+    // checked here.
+    void purge() { _server->_expire_index_purger->purge(utils::epoch_now(), 100); }
+
+protected:
+    std::unique_ptr<pegasus_server_write> _server_write;
+    rocksdb_wrapper *_rocksdb_wrapper{nullptr};
+};
+
+TEST_F(expire_index_test, purge_expired_records)
+{
+    uint32_t now = utils::epoch_now();
+    single_set("expired", now - 10);
+    single_set("not_expired", now + 3600);
+    single_set("no_ttl", 0);
+    ASSERT_EQ(2, index_count());
+
+    purge();
+    ASSERT_FALSE(record_exists("expired"));
+    ASSERT_TRUE(record_exists("not_expired"));
+    ASSERT_TRUE(record_exists("no_ttl"));
+    ASSERT_EQ(1, index_count());
+}
+
+TEST_F(expire_index_test, purge_is_bounded)
+{
+    uint32_t now = utils::epoch_now();
+    for (int i = 0; i < 10; ++i) {
+        single_set("expired_" + std::to_string(i), now - 10);
+    }
+    ASSERT_EQ(10, index_count());
+
+    // the timer may have purged some of them
+    _server->_expire_index_purger->purge(now, 3);
+    ASSERT_LE(index_count(), 7);
+    _server->_expire_index_purger->purge(now, 100);
+    ASSERT_EQ(0, index_count());
+    for (int i = 0; i < 10; ++i) {
+        ASSERT_FALSE(record_exists("expired_" + std::to_string(i)));
+    }
+}
+
+TEST_F(expire_index_test, skip_rewritten_records)
+{
+    uint32_t now = utils::epoch_now();
+    single_set("rewritten", now - 10);
+    // rewritten without TTL before purging
+    single_set("rewritten", 0);
+
+    purge();
+    ASSERT_TRUE(record_exists("rewritten"));
+    ASSERT_EQ(0, index_count());
+}
+
+TEST_F(expire_index_test, drop_when_disabled)
+{
+    single_set("not_expired", utils::epoch_now() + 3600);
+    ASSERT_EQ(1, index_count());
+
+    // reopen with the expire index disabled
+    _server_write.reset();
+    _rocksdb_wrapper = nullptr;
+    _server->stop(false);
+    FLAGS_expire_index_enabled = false;
+    ASSERT_EQ(dsn::ERR_OK, start());
+    ASSERT_EQ(nullptr, _server->_expire_index_cf);
+    ASSERT_EQ(nullptr, _server->_expire_index_purger);
+
+    // the column family is not opened any more
+    _server->stop(false);
+    ASSERT_EQ(dsn::ERR_OK, start());
+    ASSERT_EQ(nullptr, _server->_expire_index_cf);
+
+    // enabled again with an empty index
+    _server->stop(false);
+    FLAGS_expire_index_enabled = true;
+    ASSERT_EQ(dsn::ERR_OK, start());
+    ASSERT_NE(nullptr, _server->_expire_index_cf);
+    ASSERT_EQ(0, index_count());
+}
+
+} // namespace server
+} // namespace pegasus
@@ -29,6 +29,7 @@ namespace pegasus {
 namespace server {
 
 DSN_DECLARE_uint32(hotkey_buckets_num);
+DSN_DECLARE_uint32(hotkey_sketch_sample_rate);
 
 static std::string generate_hash_key_by_random(bool is_hotkey, int probability = 100)
 {
@@ -338,6 +339,32 @@ TEST_F(hotkey_collector_test, state_transform)
     _tracker.wait_outstanding_tasks();
 }
 
+TEST_F(hotkey_collector_test, always_on_sketch)
+{
+    uint32_t old_sample_rate = FLAGS_hotkey_sketch_sample_rate;
+    FLAGS_hotkey_sketch_sample_rate = 1;
+    auto cleanup = dsn::defer([old_sample_rate]() {
+        FLAGS_hotkey_sketch_sample_rate = old_sample_rate;
+    });
+
+    // the sketch works without starting detection
+    auto collector = get_read_collector();
+    ASSERT_EQ(get_collector_stat(collector), hotkey_collector_state::STOPPED);
+    for (int i = 0; i < 1000; i++) {
+        _server->on_get(generate_get_rpc(generate_hash_key_by_random(true, 50)));
+    }
+    collector->analyse_data();
+    auto top_keys = collector->top_keys();
+    ASSERT_FALSE(top_keys.empty());
+    ASSERT_EQ(top_keys[0].key, "ThisisahotkeyThisisahotkey");
+    ASSERT_EQ(get_collector_stat(collector), hotkey_collector_state::STOPPED);
+    ASSERT_NE(collector->dump_top_keys().find("ThisisahotkeyThisisahotkey"), std::string::npos);
+
+    // a new window is started after analysing
+    collector->analyse_data();
+    ASSERT_TRUE(collector->top_keys().empty());
+}
+
 TEST_F(hotkey_collector_test, data_completeness)
 {
     dsn::replication::detect_hotkey_response resp;
@@ -0,0 +1,137 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+
+#include "server/hotkey_read_cache.h"
+
+#include <thread>
+#include <gtest/gtest.h>
+#include "base/pegasus_key_schema.h"
+
+namespace pegasus {
+namespace server {
+
+static std::string generate_raw_key(const std::string &hash_key, const std::string &sort_key)
+{
+    dsn::blob raw_key;
+    pegasus_generate_key(raw_key, hash_key, sort_key);
+    return raw_key.to_string();
+}
+
+TEST(hotkey_read_cache_test, hot_hash_keys)
+{
+    hotkey_read_cache cache(10, 1000);
+    ASSERT_FALSE(cache.has_hot_hash_keys());
+    ASSERT_FALSE(cache.is_hot_raw_key(generate_raw_key("hot", "s")));
+
+    cache.set_hot_hash_keys({"hot"});
+    ASSERT_TRUE(cache.has_hot_hash_keys());
+    ASSERT_TRUE(cache.is_hot_hash_key("hot"));
+    ASSERT_TRUE(cache.is_hot_raw_key(generate_raw_key("hot", "s")));
+    ASSERT_FALSE(cache.is_hot_raw_key(generate_raw_key("cold", "s")));
+
+    // the keys of the hash keys no longer hot are removed
+    std::string raw_key = generate_raw_key("hot", "s");
+    cache.put(raw_key, "value", cache.generation());
+    std::string value;
+    ASSERT_TRUE(cache.get(raw_key, &value));
+    cache.set_hot_hash_keys({"another"});
+    ASSERT_FALSE(cache.get(raw_key, &value));
+}
+
+TEST(hotkey_read_cache_test, hot_hash_keys_bounded)
+{
+    hotkey_read_cache cache(10, 1000);
+    std::vector<std::string> hash_keys;
+    for (size_t i = 0; i < hotkey_read_cache::kMaxHotHashKeys + 1; ++i) {
+        hash_keys.emplace_back("hot_" + std::to_string(i));
+    }
+    hash_keys.emplace_back("");
+    cache.set_hot_hash_keys(hash_keys);
+    for (size_t i = 0; i < hotkey_read_cache::kMaxHotHashKeys; ++i) {
+        ASSERT_TRUE(cache.is_hot_raw_key(generate_raw_key(hash_keys[i], "s")));
+    }
+    ASSERT_FALSE(cache.is_hot_hash_key(hash_keys[hotkey_read_cache::kMaxHotHashKeys]));
+    ASSERT_FALSE(cache.is_hot_hash_key(""));
+
+    // shrinking the hot hash keys
+    cache.set_hot_hash_keys({""});
+    ASSERT_TRUE(cache.is_hot_raw_key(generate_raw_key("", "s")));
+    ASSERT_FALSE(cache.is_hot_hash_key("hot_0"));
+    cache.set_hot_hash_keys({});
+    ASSERT_FALSE(cache.has_hot_hash_keys());
+}
+
+TEST(hotkey_read_cache_test, get_and_put)
+{
+    hotkey_read_cache cache(2, 1000);
+    cache.set_hot_hash_keys({"hot"});
+    std::string raw_key1 = generate_raw_key("hot", "s1");
+    std::string raw_key2 = generate_raw_key("hot", "s2");
+    std::string raw_key3 = generate_raw_key("hot", "s3");
+
+    std::string value;
+    ASSERT_FALSE(cache.get(raw_key1, &value));
+    cache.put(raw_key1, "value1", cache.generation());
+    ASSERT_TRUE(cache.get(raw_key1, &value));
+    ASSERT_EQ("value1", value);
+
+    // the cache is full
+    cache.put(raw_key2, "value2", cache.generation());
+    cache.put(raw_key3, "value3", cache.generation());
+    ASSERT_TRUE(cache.get(raw_key2, &value));
+    ASSERT_FALSE(cache.get(raw_key3, &value));
+
+    cache.clear();
+    ASSERT_FALSE(cache.get(raw_key1, &value));
+}
+
+TEST(hotkey_read_cache_test, invalidate)
+{
+    hotkey_read_cache cache(10, 1000);
+    cache.set_hot_hash_keys({"hot"});
+    std::string raw_key = generate_raw_key("hot", "s");
+
+    cache.put(raw_key, "old_value", cache.generation());
+    uint64_t generation = cache.generation();
+    cache.invalidate({raw_key});
+    std::string value;
+    ASSERT_FALSE(cache.get(raw_key, &value));
+
+    // the value read before the write applied is refused
+    cache.put(raw_key, "old_value", generation);
+    ASSERT_FALSE(cache.get(raw_key, &value));
+
+    cache.put(raw_key, "new_value", cache.generation());
+    ASSERT_TRUE(cache.get(raw_key, &value));
+    ASSERT_EQ("new_value", value);
+}
+
+TEST(hotkey_read_cache_test, ttl)
+{
+    hotkey_read_cache cache(10, 10);
+    cache.set_hot_hash_keys({"hot"});
+    std::string raw_key = generate_raw_key("hot", "s");
+    cache.put(raw_key, "value", cache.generation());
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    std::string value;
+    ASSERT_FALSE(cache.get(raw_key, &value));
+}
+
+} // namespace server
+} // namespace pegasus
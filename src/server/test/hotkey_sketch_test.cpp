@@ -0,0 +1,87 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+
+#include "server/hotkey_sketch.h"
+
+#include <gtest/gtest.h>
+
+namespace pegasus {
+namespace server {
+
+TEST(hotkey_sketch_test, space_saving_counter)
+{
+    space_saving_counter counter(2);
+    counter.add("a", 10);
+    counter.add("b", 1);
+    counter.add("a", 5);
+    ASSERT_EQ(2, counter.size());
+
+    // "b" has the minimum weight and is replaced by "c"
+    counter.add("c", 2);
+    ASSERT_EQ(2, counter.size());
+
+    std::unordered_map<std::string, uint64_t> weights;
+    counter.drain(weights);
+    ASSERT_EQ(0, counter.size());
+    ASSERT_EQ(2, weights.size());
+    ASSERT_EQ(15, weights["a"]);
+    // the weight of "c" is over-estimated by the weight of "b"
+    ASSERT_EQ(3, weights["c"]);
+}
+
+TEST(hotkey_sketch_test, should_sample)
+{
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_FALSE(hotkey_sketch::should_sample(0));
+        ASSERT_TRUE(hotkey_sketch::should_sample(1));
+    }
+
+    int sampled = 0;
+    for (int i = 0; i < 100000; ++i) {
+        if (hotkey_sketch::should_sample(100)) {
+            ++sampled;
+        }
+    }
+    ASSERT_GT(sampled, 500);
+    ASSERT_LT(sampled, 2000);
+}
+
+TEST(hotkey_sketch_test, merge)
+{
+    hotkey_sketch sketch(4, 16);
+    for (int i = 0; i < 1000; ++i) {
+        sketch.add("hot", 2);
+        sketch.add("warm" + std::to_string(i % 2), 1);
+        sketch.add("cold" + std::to_string(i), 1);
+    }
+    sketch.merge(3);
+
+    auto top_keys = sketch.top_keys();
+    ASSERT_EQ(3, top_keys.size());
+    ASSERT_EQ("hot", top_keys[0].key);
+    ASSERT_GE(top_keys[0].weight, 2000);
+    ASSERT_EQ(4000, sketch.total_weight());
+
+    // a new window is started after merging
+    sketch.merge(3);
+    ASSERT_TRUE(sketch.top_keys().empty());
+    ASSERT_EQ(0, sketch.total_weight());
+}
+
+} // namespace server
+} // namespace pegasus
@@ -25,7 +25,10 @@ namespace pegasus {
 namespace server {
 
 DSN_DECLARE_int32(occurrence_threshold);
+DSN_DECLARE_uint32(hotkey_detect_start_interval_seconds);
 DSN_DECLARE_bool(enable_detect_hotkey);
+DSN_DECLARE_uint64(hotspot_partition_rate_half_life_ms);
+DSN_DECLARE_uint64(hotspot_table_baseline_half_life_ms);
 
 class hotspot_partition_test : public pegasus_server_test_base
 {
@@ -35,14 +38,25 @@ public:
         dsn::fail::setup();
         dsn::fail::cfg("send_detect_hotkey_request", "return()");
         FLAGS_enable_detect_hotkey = true;
+        // Let the rates of partitions be the latest stats and the baseline of the table decay by
+        // half in every round, to make the results predictable.
+        _old_rate_half_life_ms = FLAGS_hotspot_partition_rate_half_life_ms;
+        _old_baseline_half_life_ms = FLAGS_hotspot_table_baseline_half_life_ms;
+        FLAGS_hotspot_partition_rate_half_life_ms = 0;
+        FLAGS_hotspot_table_baseline_half_life_ms = 1000;
     };
     ~hotspot_partition_test()
     {
+        FLAGS_hotspot_partition_rate_half_life_ms = _old_rate_half_life_ms;
+        FLAGS_hotspot_table_baseline_half_life_ms = _old_baseline_half_life_ms;
         FLAGS_enable_detect_hotkey = false;
         dsn::fail::teardown();
     }
 
     hotspot_partition_calculator calculator;
+    uint64_t now_ms = 0;
+    uint64_t _old_rate_half_life_ms;
+    uint64_t _old_baseline_half_life_ms;
 
     std::vector<row_data> generate_row_data()
     {
@@ -85,7 +99,8 @@ public:
                                   std::vector<std::vector<double>> &expect_result,
                                   std::array<uint32_t, 2> expect_cnt)
     {
-        calculator.data_aggregate(std::move(scenario));
+        now_ms += 1000;
+        calculator.data_aggregate(std::move(scenario), now_ms);
         calculator.data_analyse();
         std::vector<std::vector<double>> result = get_calculator_result(calculator._hot_points);
         auto cnt = get_calculator_total_hotspot_cnt(calculator._total_hotspot_cnt);
@@ -99,13 +114,19 @@ public:
                                 int loop_times)
     {
         for (int i = 0; i < loop_times; i++) {
-            calculator.data_aggregate(scenario);
+            now_ms += 1000;
+            calculator.data_aggregate(scenario, now_ms);
             calculator.data_analyse();
         }
         ASSERT_EQ(calculator._hotpartition_counter, expect_result);
     }
 
-    void clear_calculator_histories() { calculator._partitions_stat_histories.clear(); }
+    void clear_calculator_histories()
+    {
+        calculator._qps_rates = {};
+        calculator._cu_rates = {};
+        calculator._last_aggregate_time_ms = 0;
+    }
 };
 
 TEST_F(hotspot_partition_test, hotspot_partition_policy)
@@ -142,7 +163,8 @@ TEST_F(hotspot_partition_test, hotspot_partition_policy)
     const int HOT_SCENARIO_1_WRITE_HOT_PARTITION = 2;
     test_rows[HOT_SCENARIO_1_READ_HOT_PARTITION].get_qps = 5000.0;
     test_rows[HOT_SCENARIO_1_WRITE_HOT_PARTITION].put_qps = 5000.0;
-    expect_vector = {{0, 0, 0, 4, 0, 0, 0, 0}, {0, 0, 4, 0, 0, 0, 0, 0}};
+    // the baseline still remembers the previous hot partitions, so the new ones stand out less
+    expect_vector = {{0, 0, 0, 3, 0, 0, 0, 0}, {0, 0, 3, 0, 0, 0, 0, 0}};
     expect_hotspot_cnt = {1, 1};
     test_policy_in_scenarios(test_rows, expect_vector, expect_hotspot_cnt);
 
@@ -155,7 +177,7 @@ TEST_F(hotspot_partition_test, hotspot_partition_policy)
     test_rows[HOT_SCENARIO_2_READ_HOT_PARTITION_1].get_qps = 8000.0;
     test_rows[HOT_SCENARIO_2_WRITE_HOT_PARTITION].put_qps = 7000.0;
 
-    expect_vector = {{0, 0, 0, 4, 0, 4, 0, 0}, {0, 0, 4, 0, 0, 0, 0, 0}};
+    expect_vector = {{0, 0, 0, 3, 0, 3, 0, 0}, {0, 0, 4, 0, 0, 0, 0, 0}};
     expect_hotspot_cnt = {2, 1};
     test_policy_in_scenarios(test_rows, expect_vector, expect_hotspot_cnt);
     clear_calculator_histories();
@@ -178,5 +200,36 @@ TEST_F(hotspot_partition_test, send_detect_hotkey_request)
     aggregate_analyse_data(generate_row_data(), expect_result, back_to_normal);
 }
 
+TEST_F(hotspot_partition_test, send_detect_hotkey_request_once)
+{
+    const int READ_HOT_PARTITION = 7;
+    std::vector<row_data> test_rows = generate_row_data();
+    test_rows[READ_HOT_PARTITION].get_qps = 5000.0;
+
+    // START is sent at the first tick the partition is found hot
+    auto old_occurrence_threshold = FLAGS_occurrence_threshold;
+    FLAGS_occurrence_threshold = 1;
+    auto expect_result = generate_result();
+    expect_result[READ_HOT_PARTITION][0] = 1;
+    aggregate_analyse_data(test_rows, expect_result, 1);
+    uint64_t first_start_ms = calculator._last_detect_start_time_ms[READ_HOT_PARTITION][0];
+    ASSERT_EQ(now_ms, first_start_ms);
+    ASSERT_EQ(0, calculator._last_detect_start_time_ms[0][0]);
+
+    // not sent again while the detection is running
+    expect_result[READ_HOT_PARTITION][0] = 10;
+    aggregate_analyse_data(test_rows, expect_result, 9);
+    ASSERT_EQ(first_start_ms, calculator._last_detect_start_time_ms[READ_HOT_PARTITION][0]);
+
+    // sent again after the interval if the partition is still hot
+    now_ms += FLAGS_hotkey_detect_start_interval_seconds * 1000;
+    expect_result[READ_HOT_PARTITION][0] = 11;
+    aggregate_analyse_data(test_rows, expect_result, 1);
+    ASSERT_EQ(now_ms, calculator._last_detect_start_time_ms[READ_HOT_PARTITION][0]);
+
+    FLAGS_occurrence_threshold = old_occurrence_threshold;
+    clear_calculator_histories();
+}
+
 } // namespace server
 } // namespace pegasus
@@ -67,6 +67,23 @@ public:
             << dsn::utils::kv_map_to_string(envs, ';', '=');
     }
 
+    void set_split_cleanup_time(int64_t ts)
+    {
+        manual_compact_svc->_split_cleanup_last_finish_time_ms.store(ts * 1000);
+    }
+
+    void set_split_data_cleaned(bool cleaned)
+    {
+        _server->_split_cleaned_partition_version.store(
+            cleaned ? _server->_partition_version.load() : -1);
+    }
+
+    void check_split_cleanup(const std::map<std::string, std::string> &envs, bool ok)
+    {
+        ASSERT_EQ(ok, manual_compact_svc->check_split_cleanup(envs))
+            << dsn::utils::kv_map_to_string(envs, ';', '=');
+    }
+
     void extract_manual_compact_opts(const std::map<std::string, std::string> &envs,
                                      const std::string &key_prefix,
                                      rocksdb::CompactRangeOptions &options)
@@ -157,6 +174,49 @@ TEST_F(manual_compact_service_test, check_once_compact)
     check_once_compact(envs, true);
 }
 
+TEST_F(manual_compact_service_test, check_split_cleanup)
+{
+    // invalid trigger time
+    std::map<std::string, std::string> envs;
+    check_split_cleanup(envs, false);
+
+    envs[MANUAL_COMPACT_SPLIT_CLEANUP_TRIGGER_TIME_KEY] = "";
+    check_split_cleanup(envs, false);
+
+    envs[MANUAL_COMPACT_SPLIT_CLEANUP_TRIGGER_TIME_KEY] = "abc";
+    check_split_cleanup(envs, false);
+
+    envs[MANUAL_COMPACT_SPLIT_CLEANUP_TRIGGER_TIME_KEY] = "-1";
+    check_split_cleanup(envs, false);
+
+    // has not been cleaned up
+    envs[MANUAL_COMPACT_SPLIT_CLEANUP_TRIGGER_TIME_KEY] = std::to_string(compacted_ts);
+    check_split_cleanup(envs, true);
+
+    // has been cleaned up after the trigger time
+    set_split_cleanup_time(compacted_ts + 1);
+    check_split_cleanup(envs, false);
+
+    // the stale data of the current partition version has been cleaned up
+    set_split_cleanup_time(0);
+    set_split_data_cleaned(true);
+    check_split_cleanup(envs, false);
+    set_split_data_cleaned(false);
+}
+
+TEST_F(manual_compact_service_test, restore_split_cleanup_stale_bytes)
+{
+    ASSERT_EQ(std::string::npos,
+              manual_compact_svc->query_compact_state().find("stale bytes remaining"));
+
+    manual_compact_svc->init_split_cleanup_stale_bytes_remaining(12345);
+    ASSERT_NE(std::string::npos,
+              manual_compact_svc->query_compact_state().find(
+                  "split cleanup unfinished, about 12345 stale bytes remaining"));
+
+    manual_compact_svc->init_split_cleanup_stale_bytes_remaining(0);
+}
+
 TEST_F(manual_compact_service_test, check_periodic_compact)
 {
     std::map<std::string, std::string> envs;
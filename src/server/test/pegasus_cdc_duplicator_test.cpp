@@ -0,0 +1,284 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include "server/pegasus_cdc_duplicator.h"
+#include "server/duplication_compression.h"
+#include "base/pegasus_key_schema.h"
+#include "pegasus_server_test_base.h"
+
+#include <gtest/gtest.h>
+#include <dsn/cpp/message_utils.h>
+#include <dsn/dist/replication/replica_base.h>
+#include <dsn/utility/filesystem.h>
+#include <dsn/utility/flags.h>
+#include <rocksdb/env.h>
+
+namespace pegasus {
+namespace server {
+
+DSN_DECLARE_string(cdc_consumers);
+
+using namespace dsn::replication;
+
+class pegasus_cdc_duplicator_test : public pegasus_server_test_base
+{
+protected:
+    dsn::task_tracker _tracker;
+    dsn::pipeline::environment _env;
+
+public:
+    pegasus_cdc_duplicator_test()
+    {
+        _env.thread_pool(LPC_REPLICATION_LOW).task_tracker(&_tracker);
+        dsn::utils::filesystem::remove_path("./cdc_test");
+    }
+
+    static dsn::blob create_put(const std::string &hash_key,
+                                const std::string &sort_key,
+                                const std::string &value)
+    {
+        dsn::apps::update_request request;
+        pegasus_generate_key(request.key, hash_key, sort_key);
+        request.value = dsn::blob::create_from_bytes(std::string(value));
+        dsn::message_ptr msg =
+            dsn::from_thrift_request_to_received_message(request, dsn::apps::RPC_RRDB_RRDB_PUT);
+        return dsn::move_message_to_blob(msg.get());
+    }
+
+    static std::vector<cdc_event> read_sink(const std::string &name)
+    {
+        std::string data;
+        rocksdb::ReadFileToString(
+            rocksdb::Env::Default(), "./cdc_test/sink/" + name + ".events", &data);
+
+        std::vector<cdc_event> events;
+        size_t begin = 0;
+        for (size_t end = data.find('\n'); end != std::string::npos;
+             begin = end + 1, end = data.find('\n', begin)) {
+            cdc_event event;
+            EXPECT_TRUE(dsn::json::json_forwarder<cdc_event>::decode(
+                dsn::blob::create_from_bytes(data.substr(begin, end - begin)), event));
+            events.emplace_back(std::move(event));
+        }
+        EXPECT_EQ(begin, data.size());
+        return events;
+    }
+
+    void duplicate(pegasus_cdc_duplicator &duplicator, const mutation_tuple_set &muts)
+    {
+        duplicator.duplicate(muts, [](size_t) {});
+        _tracker.wait_outstanding_tasks();
+    }
+
+    static int64_t skipped_writes(const pegasus_cdc_duplicator &duplicator)
+    {
+        return duplicator._skipped_writes->get_integer_value();
+    }
+};
+
+TEST_F(pegasus_cdc_duplicator_test, decode_cdc_events)
+{
+    std::vector<cdc_event> events;
+
+    ASSERT_TRUE(decode_cdc_events(
+        100, dsn::apps::RPC_RRDB_RRDB_PUT, create_put("hash", "sort\n", "value"), events));
+    ASSERT_EQ(events.size(), 1);
+    ASSERT_EQ(events[0].timestamp, 100);
+    ASSERT_EQ(events[0].op, "put");
+    ASSERT_EQ(events[0].hash_key, "hash");
+    ASSERT_EQ(events[0].sort_keys, std::vector<std::string>{"sort\\n"});
+    ASSERT_EQ(events[0].values, std::vector<std::string>{"value"});
+
+    {
+        dsn::blob key;
+        pegasus_generate_key(key, std::string("hash"), std::string("sort"));
+        dsn::message_ptr msg =
+            dsn::from_thrift_request_to_received_message(key, dsn::apps::RPC_RRDB_RRDB_REMOVE);
+        events.clear();
+        ASSERT_TRUE(decode_cdc_events(101,
+                                      dsn::apps::RPC_RRDB_RRDB_REMOVE,
+                                      dsn::move_message_to_blob(msg.get()),
+                                      events));
+        ASSERT_EQ(events.size(), 1);
+        ASSERT_EQ(events[0].op, "remove");
+        ASSERT_EQ(events[0].sort_keys, std::vector<std::string>{"sort"});
+        ASSERT_TRUE(events[0].values.empty());
+    }
+
+    {
+        dsn::apps::multi_put_request request;
+        request.hash_key = dsn::blob::create_from_bytes("hash");
+        for (int i = 0; i < 3; i++) {
+            request.kvs.emplace_back();
+            request.kvs.back().key = dsn::blob::create_from_bytes("sort" + std::to_string(i));
+            request.kvs.back().value = dsn::blob::create_from_bytes("value" + std::to_string(i));
+        }
+        request.expire_ts_seconds = 1000;
+        dsn::message_ptr msg = dsn::from_thrift_request_to_received_message(
+            request, dsn::apps::RPC_RRDB_RRDB_MULTI_PUT);
+        events.clear();
+        ASSERT_TRUE(decode_cdc_events(102,
+                                      dsn::apps::RPC_RRDB_RRDB_MULTI_PUT,
+                                      dsn::move_message_to_blob(msg.get()),
+                                      events));
+        ASSERT_EQ(events.size(), 1);
+        ASSERT_EQ(events[0].op, "multi_put");
+        ASSERT_EQ(events[0].sort_keys, (std::vector<std::string>{"sort0", "sort1", "sort2"}));
+        ASSERT_EQ(events[0].values, (std::vector<std::string>{"value0", "value1", "value2"}));
+        ASSERT_EQ(events[0].expire_ts_seconds, 1000);
+    }
+
+    {
+        dsn::apps::multi_remove_request request;
+        request.hash_key = dsn::blob::create_from_bytes("hash");
+        request.sort_keys.emplace_back(dsn::blob::create_from_bytes("sort"));
+        dsn::message_ptr msg = dsn::from_thrift_request_to_received_message(
+            request, dsn::apps::RPC_RRDB_RRDB_MULTI_REMOVE);
+        events.clear();
+        ASSERT_TRUE(decode_cdc_events(103,
+                                      dsn::apps::RPC_RRDB_RRDB_MULTI_REMOVE,
+                                      dsn::move_message_to_blob(msg.get()),
+                                      events));
+        ASSERT_EQ(events.size(), 1);
+        ASSERT_EQ(events[0].op, "multi_remove");
+        ASSERT_EQ(events[0].sort_keys, std::vector<std::string>{"sort"});
+    }
+
+    // the writes in a batched and compressed DUPLICATE from another cluster
+    {
+        dsn::apps::duplicate_request request;
+        request.__set_cluster_id(2);
+        request.__isset.entries = true;
+        request.__set_compression_type(dsn::apps::duplicate_compression_type::DCT_LZ4);
+        std::vector<dsn::apps::duplicate_entry> entries;
+        for (int i = 0; i < 2; i++) {
+            dsn::apps::duplicate_entry entry;
+            entry.__set_timestamp(50);
+            entry.__set_task_code(dsn::apps::RPC_RRDB_RRDB_PUT);
+            entry.__set_raw_message(create_put("hash", "sort", "value"));
+            entries.emplace_back(std::move(entry));
+        }
+        ASSERT_TRUE(compress_duplicate_payload(request.compression_type,
+                                               serialize_duplicate_entries(entries),
+                                               request.raw_message));
+        request.__isset.raw_message = true;
+        dsn::message_ptr msg = dsn::from_thrift_request_to_received_message(
+            request, dsn::apps::RPC_RRDB_RRDB_DUPLICATE);
+        events.clear();
+        ASSERT_TRUE(decode_cdc_events(104,
+                                      dsn::apps::RPC_RRDB_RRDB_DUPLICATE,
+                                      dsn::move_message_to_blob(msg.get()),
+                                      events));
+        ASSERT_EQ(events.size(), 2);
+        for (const auto &event : events) {
+            // ordered by the local mutation
+            ASSERT_EQ(event.timestamp, 104);
+            ASSERT_EQ(event.op, "put");
+            ASSERT_EQ(event.values, std::vector<std::string>{"value"});
+        }
+    }
+}
+
+TEST_F(pegasus_cdc_duplicator_test, deliver)
+{
+    replica_base replica(dsn::gpid(1, 1), "fake_replica", "temp");
+    const std::string name = "temp.1.1";
+
+    mutation_tuple_set muts;
+    for (uint64_t i = 0; i < 10; i++) {
+        muts.insert(std::make_tuple(
+            100 + i, dsn::apps::RPC_RRDB_RRDB_PUT, create_put("hash", std::to_string(i), "v")));
+    }
+
+    {
+        pegasus_cdc_duplicator duplicator(&replica, "cdc_test", "temp");
+        duplicator.set_task_environment(&_env);
+        duplicate(duplicator, muts);
+    }
+
+    auto events = read_sink(name);
+    ASSERT_EQ(events.size(), 10);
+    for (size_t i = 0; i < events.size(); i++) {
+        ASSERT_EQ(events[i].timestamp, static_cast<int64_t>(100 + i));
+        ASSERT_EQ(events[i].sort_keys, std::vector<std::string>{std::to_string(i)});
+    }
+
+    // The position is the confirmed decree of the duplication, so the mutations loaded by a
+    // new primary are all delivered, even if their timestamps are older, e.g. the clock of the
+    // old primary is ahead.
+    mutation_tuple_set older;
+    for (uint64_t i = 0; i < 5; i++) {
+        older.insert(std::make_tuple(
+            50 + i, dsn::apps::RPC_RRDB_RRDB_PUT, create_put("hash", std::to_string(i), "v")));
+    }
+    {
+        pegasus_cdc_duplicator duplicator(&replica, "cdc_test", "temp");
+        duplicator.set_task_environment(&_env);
+        duplicate(duplicator, older);
+    }
+
+    events = read_sink(name);
+    ASSERT_EQ(events.size(), 15);
+    for (size_t i = 10; i < events.size(); i++) {
+        ASSERT_EQ(events[i].timestamp, static_cast<int64_t>(40 + i));
+    }
+}
+
+TEST_F(pegasus_cdc_duplicator_test, skip_undecodable_writes)
+{
+    replica_base replica(dsn::gpid(1, 1), "fake_replica", "temp");
+    pegasus_cdc_duplicator duplicator(&replica, "cdc_test", "temp");
+    duplicator.set_task_environment(&_env);
+
+    mutation_tuple_set muts;
+    muts.insert(
+        std::make_tuple(100, dsn::apps::RPC_RRDB_RRDB_PUT, create_put("hash", "sort0", "v")));
+    // a write which is not decoded into change events
+    muts.insert(std::make_tuple(
+        101, dsn::apps::RPC_RRDB_RRDB_INCR, dsn::blob::create_from_bytes("unknown")));
+    muts.insert(
+        std::make_tuple(102, dsn::apps::RPC_RRDB_RRDB_PUT, create_put("hash", "sort1", "v")));
+
+    size_t shipped_size = 0;
+    duplicator.duplicate(muts, [&shipped_size](size_t size) { shipped_size = size; });
+    _tracker.wait_outstanding_tasks();
+    ASSERT_GT(shipped_size, 0);
+    ASSERT_EQ(skipped_writes(duplicator), 1);
+
+    auto events = read_sink("temp.1.1");
+    ASSERT_EQ(events.size(), 2);
+    ASSERT_EQ(events[0].sort_keys, std::vector<std::string>{"sort0"});
+    ASSERT_EQ(events[1].sort_keys, std::vector<std::string>{"sort1"});
+}
+
+TEST_F(pegasus_cdc_duplicator_test, is_cdc_consumer)
+{
+    ASSERT_FALSE(is_cdc_consumer("cdc_test"));
+
+    auto old_consumers = FLAGS_cdc_consumers;
+    FLAGS_cdc_consumers = "cdc_a,cdc_test";
+    ASSERT_TRUE(is_cdc_consumer("cdc_test"));
+    ASSERT_TRUE(is_cdc_consumer("cdc_a"));
+    ASSERT_FALSE(is_cdc_consumer("onebox2"));
+    FLAGS_cdc_consumers = old_consumers;
+}
+
+} // namespace server
+} // namespace pegasus
@@ -18,17 +18,27 @@
  */
 
 #include "server/pegasus_mutation_duplicator.h"
+#include "server/duplication_compression.h"
 #include "base/pegasus_rpc_types.h"
 #include "pegasus_server_test_base.h"
 
 #include <gtest/gtest.h>
 #include <dsn/cpp/message_utils.h>
 #include <dsn/dist/replication/replica_base.h>
+#include <dsn/utility/flags.h>
+#include <atomic>
 #include <condition_variable>
+#include <thread>
 
 namespace pegasus {
 namespace server {
 
+DSN_DECLARE_uint32(duplicate_batch_max_count);
+DSN_DECLARE_uint32(duplicate_batch_lane_count);
+DSN_DECLARE_uint32(duplicate_compression_threshold_bytes);
+DSN_DECLARE_string(duplicate_compression_type);
+DSN_DECLARE_string(duplicate_compression_remote_clusters);
+
 using namespace dsn::replication;
 
 class pegasus_mutation_duplicator_test : public pegasus_server_test_base
@@ -72,11 +82,11 @@ public:
             size_t total_size = 100;
             while (total_size > 0) {
                 // ensure mutations having the same hash are sending sequentially.
-                ASSERT_EQ(duplicator_impl->_inflights.size(), 1);
+                ASSERT_EQ(inflight_hash_count(duplicator_impl), 1);
                 ASSERT_EQ(duplicate_rpc::mail_box().size(), 1);
 
                 total_size--;
-                ASSERT_EQ(duplicator_impl->_inflights.begin()->second.size(), total_size);
+                ASSERT_EQ(pending_rpc_count(duplicator_impl), total_size);
 
                 auto rpc = duplicate_rpc::mail_box().back();
                 duplicate_rpc::mail_box().pop_back();
@@ -94,8 +104,8 @@ public:
                 _tracker.wait_outstanding_tasks();
             }
 
-            ASSERT_EQ(duplicator_impl->_total_shipped_size, total_shipped_size);
-            ASSERT_EQ(duplicator_impl->_inflights.size(), 0);
+            ASSERT_EQ(duplicator_impl->_total_shipped_size.load(), total_shipped_size);
+            ASSERT_EQ(inflight_hash_count(duplicator_impl), 0);
             ASSERT_EQ(duplicate_rpc::mail_box().size(), 0);
         }
     }
@@ -127,7 +137,7 @@ public:
 
             auto rpc = duplicate_rpc::mail_box().back();
             duplicate_rpc::mail_box().pop_back();
-            ASSERT_EQ(duplicator_impl->_inflights.begin()->second.size(), 9);
+            ASSERT_EQ(pending_rpc_count(duplicator_impl), 9);
 
             // failed
             duplicator_impl->on_duplicate_reply(
@@ -137,18 +147,18 @@ public:
             _tracker.wait_outstanding_tasks();
 
             // retry infinitely
-            ASSERT_EQ(duplicator_impl->_inflights.size(), 1);
+            ASSERT_EQ(inflight_hash_count(duplicator_impl), 1);
             ASSERT_EQ(duplicate_rpc::mail_box().size(), 1);
-            ASSERT_EQ(duplicator_impl->_inflights.begin()->second.size(), 9);
+            ASSERT_EQ(pending_rpc_count(duplicator_impl), 9);
             duplicate_rpc::mail_box().clear();
 
             // with other error
             rpc.response().error = PERR_INVALID_ARGUMENT;
             duplicator_impl->on_duplicate_reply(get_hash(rpc), [](size_t) {}, rpc, dsn::ERR_OK);
             _tracker.wait_outstanding_tasks();
-            ASSERT_EQ(duplicator_impl->_inflights.size(), 1);
+            ASSERT_EQ(inflight_hash_count(duplicator_impl), 1);
             ASSERT_EQ(duplicate_rpc::mail_box().size(), 1);
-            ASSERT_EQ(duplicator_impl->_inflights.begin()->second.size(), 9);
+            ASSERT_EQ(pending_rpc_count(duplicator_impl), 9);
             duplicate_rpc::mail_box().clear();
 
             // with other error
@@ -156,9 +166,9 @@ public:
             duplicator_impl->on_duplicate_reply(
                 get_hash(rpc), [](size_t) {}, rpc, dsn::ERR_IO_PENDING);
             _tracker.wait_outstanding_tasks();
-            ASSERT_EQ(duplicator_impl->_inflights.size(), 1);
+            ASSERT_EQ(inflight_hash_count(duplicator_impl), 1);
             ASSERT_EQ(duplicate_rpc::mail_box().size(), 1);
-            ASSERT_EQ(duplicator_impl->_inflights.begin()->second.size(), 9);
+            ASSERT_EQ(pending_rpc_count(duplicator_impl), 9);
             duplicate_rpc::mail_box().clear();
         }
     }
@@ -191,11 +201,9 @@ public:
 
             // ensure each bucket has only 1 request and each request is
             // isolated with others.
-            ASSERT_EQ(duplicator_impl->_inflights.size(), total_size);
+            ASSERT_EQ(inflight_hash_count(duplicator_impl), total_size);
             ASSERT_EQ(duplicate_rpc::mail_box().size(), total_size);
-            for (const auto &ents : duplicator_impl->_inflights) {
-                ASSERT_EQ(ents.second.size(), 0);
-            }
+            ASSERT_EQ(pending_rpc_count(duplicator_impl), 0);
 
             // reply with success
             auto rpc_list = std::move(duplicate_rpc::mail_box());
@@ -205,7 +213,357 @@ public:
             }
             _tracker.wait_outstanding_tasks();
             ASSERT_EQ(duplicate_rpc::mail_box().size(), 0);
-            ASSERT_EQ(duplicator_impl->_inflights.size(), 0);
+            ASSERT_EQ(inflight_hash_count(duplicator_impl), 0);
+        }
+    }
+
+    void test_duplicate_in_batch()
+    {
+        replica_base replica(dsn::gpid(1, 1), "fake_replica", "temp");
+        auto duplicator = new_mutation_duplicator(&replica, "onebox2", "temp");
+        duplicator->set_task_environment(&_env);
+
+        size_t total_size = 1000;
+        mutation_tuple_set muts;
+        for (uint64_t i = 0; i < total_size; i++) {
+            uint64_t ts = 200 + i;
+            dsn::task_code code = dsn::apps::RPC_RRDB_RRDB_PUT;
+
+            dsn::apps::update_request request;
+            pegasus::pegasus_generate_key(
+                request.key, std::string("hash") + std::to_string(i % 10), std::string("sort"));
+            dsn::message_ptr msg = dsn::from_thrift_request_to_received_message(request, code);
+            auto data = dsn::move_message_to_blob(msg.get());
+
+            muts.insert(std::make_tuple(ts, code, data));
+        }
+
+        auto old_max_count = FLAGS_duplicate_batch_max_count;
+        auto old_lane_count = FLAGS_duplicate_batch_lane_count;
+        FLAGS_duplicate_batch_max_count = 30;
+        FLAGS_duplicate_batch_lane_count = 4;
+
+        auto duplicator_impl = dynamic_cast<pegasus_mutation_duplicator *>(duplicator.get());
+        RPC_MOCKING(duplicate_rpc)
+        {
+            duplicator->duplicate(muts, [](size_t) {});
+
+            // one batch of each lane is in flight
+            ASSERT_LE(inflight_hash_count(duplicator_impl), FLAGS_duplicate_batch_lane_count);
+            ASSERT_EQ(duplicate_rpc::mail_box().size(), inflight_hash_count(duplicator_impl));
+
+            size_t shipped_size = 0;
+            std::map<uint64_t, int64_t> last_timestamps; // lane -> timestamp
+            while (!duplicate_rpc::mail_box().empty()) {
+                auto rpc_list = std::move(duplicate_rpc::mail_box());
+                for (const auto &rpc : rpc_list) {
+                    const auto &entries = rpc.request().entries;
+                    ASSERT_TRUE(rpc.request().__isset.entries);
+                    ASSERT_GT(entries.size(), 0);
+                    ASSERT_LE(entries.size(), FLAGS_duplicate_batch_max_count);
+
+                    // the writes of a lane are shipped in mutation order
+                    uint64_t lane = get_hash_from_request(entries.front().task_code,
+                                                          entries.front().raw_message) %
+                                    FLAGS_duplicate_batch_lane_count;
+                    for (const auto &entry : entries) {
+                        ASSERT_EQ(lane,
+                                  get_hash_from_request(entry.task_code, entry.raw_message) %
+                                      FLAGS_duplicate_batch_lane_count);
+                        ASSERT_GT(entry.timestamp, last_timestamps[lane]);
+                        last_timestamps[lane] = entry.timestamp;
+                    }
+                    shipped_size += entries.size();
+
+                    rpc.response().error = dsn::ERR_OK;
+                    duplicator_impl->on_duplicate_reply(lane, [](size_t) {}, rpc, dsn::ERR_OK);
+                }
+                _tracker.wait_outstanding_tasks();
+            }
+            ASSERT_EQ(shipped_size, total_size);
+            ASSERT_EQ(inflight_hash_count(duplicator_impl), 0);
+        }
+
+        FLAGS_duplicate_batch_max_count = old_max_count;
+        FLAGS_duplicate_batch_lane_count = old_lane_count;
+    }
+
+    void test_duplicate_batch_refused(int refused_error)
+    {
+        replica_base replica(dsn::gpid(1, 1), "fake_replica", "temp");
+        auto duplicator = new_mutation_duplicator(&replica, "onebox2", "temp");
+        duplicator->set_task_environment(&_env);
+
+        size_t total_size = 10;
+        mutation_tuple_set muts;
+        for (uint64_t i = 0; i < total_size; i++) {
+            uint64_t ts = 200 + i;
+            dsn::task_code code = dsn::apps::RPC_RRDB_RRDB_PUT;
+
+            dsn::apps::update_request request;
+            pegasus::pegasus_generate_key(
+                request.key, std::string("hash") + std::to_string(i), std::string("sort"));
+            dsn::message_ptr msg = dsn::from_thrift_request_to_received_message(request, code);
+            auto data = dsn::move_message_to_blob(msg.get());
+
+            muts.insert(std::make_tuple(ts, code, data));
+        }
+
+        auto old_max_count = FLAGS_duplicate_batch_max_count;
+        auto old_lane_count = FLAGS_duplicate_batch_lane_count;
+        FLAGS_duplicate_batch_max_count = 30;
+        FLAGS_duplicate_batch_lane_count = 1;
+
+        auto duplicator_impl = dynamic_cast<pegasus_mutation_duplicator *>(duplicator.get());
+        RPC_MOCKING(duplicate_rpc)
+        {
+            duplicator->duplicate(muts, [](size_t) {});
+            ASSERT_EQ(duplicate_rpc::mail_box().size(), 1);
+            auto rpc = duplicate_rpc::mail_box().back();
+            duplicate_rpc::mail_box().clear();
+            ASSERT_EQ(rpc.request().entries.size(), total_size);
+
+            // the refused batch is resent as single writes right away, rather than failing fast
+            rpc.response().error = refused_error;
+            duplicator_impl->on_duplicate_reply(0, [](size_t) {}, rpc, dsn::ERR_OK);
+            _tracker.wait_outstanding_tasks();
+            ASSERT_TRUE(duplicator_impl->_batching_disabled.load());
+
+            int64_t last_timestamp = 0;
+            size_t shipped_size = 0;
+            while (!duplicate_rpc::mail_box().empty()) {
+                ASSERT_EQ(duplicate_rpc::mail_box().size(), 1);
+                auto single = duplicate_rpc::mail_box().back();
+                duplicate_rpc::mail_box().clear();
+                ASSERT_FALSE(single.request().__isset.entries);
+                ASSERT_GT(single.request().timestamp, last_timestamp);
+                last_timestamp = single.request().timestamp;
+                shipped_size++;
+
+                single.response().error = dsn::ERR_OK;
+                duplicator_impl->on_duplicate_reply(0, [](size_t) {}, single, dsn::ERR_OK);
+                _tracker.wait_outstanding_tasks();
+            }
+            ASSERT_EQ(shipped_size, total_size);
+            ASSERT_EQ(inflight_hash_count(duplicator_impl), 0);
+
+            // the following mutations are not batched any more
+            duplicator->duplicate(muts, [](size_t) {});
+            ASSERT_EQ(duplicate_rpc::mail_box().size(), total_size);
+            for (const auto &single : duplicate_rpc::mail_box()) {
+                ASSERT_FALSE(single.request().__isset.entries);
+            }
+            duplicate_rpc::mail_box().clear();
+        }
+
+        FLAGS_duplicate_batch_max_count = old_max_count;
+        FLAGS_duplicate_batch_lane_count = old_lane_count;
+    }
+
+    void test_duplicate_compressed_refused(int refused_error, bool expect_compressed)
+    {
+        replica_base replica(dsn::gpid(1, 1), "fake_replica", "temp");
+        auto duplicator = new_mutation_duplicator(&replica, "onebox2", "temp");
+        duplicator->set_task_environment(&_env);
+        auto duplicator_impl = dynamic_cast<pegasus_mutation_duplicator *>(duplicator.get());
+        duplicator_impl->_compression_type = dsn::apps::duplicate_compression_type::DCT_ZSTD;
+
+        dsn::apps::update_request request;
+        pegasus::pegasus_generate_key(request.key, std::string("hash"), std::string("sort"));
+        request.value = dsn::blob::create_from_bytes(std::string(4096, 'v'));
+        dsn::message_ptr msg =
+            dsn::from_thrift_request_to_received_message(request, dsn::apps::RPC_RRDB_RRDB_PUT);
+        auto data = dsn::move_message_to_blob(msg.get());
+        mutation_tuple_set muts;
+        muts.insert(std::make_tuple(200, dsn::apps::RPC_RRDB_RRDB_PUT, data));
+
+        RPC_MOCKING(duplicate_rpc)
+        {
+            duplicator->duplicate(muts, [](size_t) {});
+            ASSERT_EQ(duplicate_rpc::mail_box().size(), 1);
+            auto rpc = duplicate_rpc::mail_box().back();
+            duplicate_rpc::mail_box().clear();
+            ASSERT_EQ(rpc.request().compression_type,
+                      dsn::apps::duplicate_compression_type::DCT_ZSTD);
+
+            // the refused write is resent rather than failing fast
+            rpc.response().error = refused_error;
+            duplicator_impl->on_duplicate_reply(get_hash(rpc), [](size_t) {}, rpc, dsn::ERR_OK);
+            _tracker.wait_outstanding_tasks();
+            ASSERT_EQ(duplicate_rpc::mail_box().size(), 1);
+            auto resent = duplicate_rpc::mail_box().back();
+            duplicate_rpc::mail_box().clear();
+            ASSERT_EQ(duplicator_impl->_compression_disabled.load(), !expect_compressed);
+
+            dsn::blob raw_message = resent.request().raw_message;
+            if (expect_compressed) {
+                ASSERT_EQ(resent.request().compression_type,
+                          dsn::apps::duplicate_compression_type::DCT_ZSTD);
+                std::string error_hint;
+                ASSERT_TRUE(decompress_duplicate_payload(resent.request().compression_type,
+                                                         resent.request().raw_message,
+                                                         raw_message,
+                                                         error_hint));
+            } else {
+                ASSERT_FALSE(resent.request().__isset.compression_type);
+            }
+            ASSERT_EQ(raw_message.to_string(), data.to_string());
+            ASSERT_EQ(resent.request().timestamp, 200);
+
+            resent.response().error = dsn::ERR_OK;
+            duplicator_impl->on_duplicate_reply(
+                get_hash(resent), [](size_t) {}, resent, dsn::ERR_OK);
+            _tracker.wait_outstanding_tasks();
+            ASSERT_EQ(inflight_hash_count(duplicator_impl), 0);
+        }
+    }
+
+    void test_compress_request(dsn::apps::duplicate_compression_type::type type)
+    {
+        replica_base replica(dsn::gpid(1, 1), "fake_replica", "temp");
+        auto duplicator = new_mutation_duplicator(&replica, "onebox2", "temp");
+        auto duplicator_impl = dynamic_cast<pegasus_mutation_duplicator *>(duplicator.get());
+        duplicator_impl->_compression_type = type;
+
+        auto create_message = [](const std::string &value) {
+            dsn::apps::update_request request;
+            pegasus::pegasus_generate_key(request.key, std::string("hash"), std::string("sort"));
+            request.value = dsn::blob::create_from_bytes(std::string(value));
+            dsn::message_ptr msg =
+                dsn::from_thrift_request_to_received_message(request, dsn::apps::RPC_RRDB_RRDB_PUT);
+            return dsn::move_message_to_blob(msg.get());
+        };
+
+        // smaller than the threshold
+        dsn::apps::duplicate_request small;
+        small.__set_raw_message(create_message("value"));
+        auto small_message = small.raw_message;
+        duplicator_impl->compress_request(small);
+        ASSERT_FALSE(small.__isset.compression_type);
+        ASSERT_EQ(small.raw_message.to_string(), small_message.to_string());
+
+        // a compressible request
+        dsn::apps::duplicate_request large;
+        large.__set_raw_message(
+            create_message(std::string(FLAGS_duplicate_compression_threshold_bytes, 'v')));
+        auto large_message = large.raw_message;
+        duplicator_impl->compress_request(large);
+        ASSERT_TRUE(large.__isset.compression_type);
+        ASSERT_EQ(large.compression_type, type);
+        ASSERT_LT(large.raw_message.length(), large_message.length());
+
+        dsn::blob decompressed;
+        std::string error_hint;
+        ASSERT_TRUE(
+            decompress_duplicate_payload(type, large.raw_message, decompressed, error_hint));
+        ASSERT_EQ(decompressed.to_string(), large_message.to_string());
+
+        // a truncated frame can't be decompressed
+        ASSERT_FALSE(decompress_duplicate_payload(type,
+                                                  large.raw_message.range(
+                                                      0, large.raw_message.length() / 2),
+                                                  decompressed,
+                                                  error_hint));
+        ASSERT_FALSE(error_hint.empty());
+
+        // the writes of a batch are compressed as one frame once the batch reaches the threshold
+        dsn::apps::duplicate_request batch;
+        batch.__isset.entries = true;
+        std::vector<dsn::apps::duplicate_entry> batch_entries;
+        for (int i = 0; i < 10; i++) {
+            batch.entries.emplace_back();
+            batch.entries.back().__set_timestamp(i);
+            batch.entries.back().__set_task_code(dsn::apps::RPC_RRDB_RRDB_PUT);
+            batch.entries.back().__set_raw_message(
+                create_message(std::string(FLAGS_duplicate_compression_threshold_bytes / 10, 'v')));
+        }
+        batch_entries = batch.entries;
+        duplicator_impl->compress_request(batch);
+        ASSERT_EQ(batch.compression_type, type);
+        ASSERT_TRUE(batch.__isset.entries);
+        ASSERT_TRUE(batch.entries.empty());
+
+        std::vector<dsn::apps::duplicate_entry> entries;
+        ASSERT_TRUE(decompress_duplicate_entries(type, batch.raw_message, entries, error_hint));
+        ASSERT_EQ(entries.size(), batch_entries.size());
+        for (size_t i = 0; i < entries.size(); i++) {
+            ASSERT_EQ(entries[i].timestamp, batch_entries[i].timestamp);
+            ASSERT_EQ(entries[i].task_code, batch_entries[i].task_code);
+            ASSERT_EQ(entries[i].raw_message.to_string(),
+                      batch_entries[i].raw_message.to_string());
+        }
+        ASSERT_FALSE(decompress_duplicate_entries(
+            type, batch.raw_message.range(0, batch.raw_message.length() / 2), entries, error_hint));
+    }
+
+    void test_compression_remote_clusters()
+    {
+        auto old_type = FLAGS_duplicate_compression_type;
+        auto old_remotes = FLAGS_duplicate_compression_remote_clusters;
+        FLAGS_duplicate_compression_type = "zstd";
+        replica_base replica(dsn::gpid(1, 1), "fake_replica", "temp");
+
+        // not compressed unless the remote is opted in
+        FLAGS_duplicate_compression_remote_clusters = "";
+        auto duplicator = new_mutation_duplicator(&replica, "onebox2", "temp");
+        auto duplicator_impl = dynamic_cast<pegasus_mutation_duplicator *>(duplicator.get());
+        ASSERT_EQ(duplicator_impl->_compression_type,
+                  dsn::apps::duplicate_compression_type::DCT_NONE);
+
+        FLAGS_duplicate_compression_remote_clusters = "onebox,onebox2";
+        duplicator = new_mutation_duplicator(&replica, "onebox2", "temp");
+        duplicator_impl = dynamic_cast<pegasus_mutation_duplicator *>(duplicator.get());
+        ASSERT_EQ(duplicator_impl->_compression_type,
+                  dsn::apps::duplicate_compression_type::DCT_ZSTD);
+
+        FLAGS_duplicate_compression_type = old_type;
+        FLAGS_duplicate_compression_remote_clusters = old_remotes;
+    }
+
+    // Replies the rpcs of `hash_count` hashes concurrently by `thread_count` threads, the
+    // callback of the round must be called exactly once after all of them are done.
+    void test_concurrent_replies(size_t hash_count, size_t thread_count)
+    {
+        replica_base replica(dsn::gpid(1, 1), "fake_replica", "temp");
+        auto duplicator = new_mutation_duplicator(&replica, "onebox2", "temp");
+        duplicator->set_task_environment(&_env);
+
+        mutation_tuple_set muts;
+        for (uint64_t i = 0; i < hash_count; i++) {
+            dsn::task_code code = dsn::apps::RPC_RRDB_RRDB_PUT;
+            dsn::apps::update_request request;
+            pegasus::pegasus_generate_key(
+                request.key, std::string("hash") + std::to_string(i), std::string("sort"));
+            dsn::message_ptr msg = dsn::from_thrift_request_to_received_message(request, code);
+            muts.insert(std::make_tuple(200 + i, code, dsn::move_message_to_blob(msg.get())));
+        }
+
+        auto duplicator_impl = dynamic_cast<pegasus_mutation_duplicator *>(duplicator.get());
+        std::atomic<int> finished{0};
+        RPC_MOCKING(duplicate_rpc)
+        {
+            duplicator->duplicate(muts, [&finished](size_t) { finished++; });
+            auto rpc_list = std::move(duplicate_rpc::mail_box());
+            ASSERT_EQ(rpc_list.size(), hash_count);
+
+            std::vector<std::thread> threads;
+            for (size_t t = 0; t < thread_count; t++) {
+                threads.emplace_back([&, t]() {
+                    for (size_t i = t; i < rpc_list.size(); i += thread_count) {
+                        duplicator_impl->on_duplicate_reply(get_hash(rpc_list[i]),
+                                                            [&finished](size_t) { finished++; },
+                                                            rpc_list[i],
+                                                            dsn::ERR_OK);
+                    }
+                });
+            }
+            for (auto &thread : threads) {
+                thread.join();
+            }
+
+            ASSERT_EQ(finished.load(), 1);
+            ASSERT_EQ(inflight_hash_count(duplicator_impl), 0);
+            ASSERT_EQ(duplicate_rpc::mail_box().size(), 0);
         }
     }
 
@@ -221,6 +579,30 @@ public:
     }
 
 private:
+    // the number of hashes having rpcs in flight
+    static size_t inflight_hash_count(pegasus_mutation_duplicator *duplicator)
+    {
+        size_t count = 0;
+        for (auto &shard : duplicator->_inflight_shards) {
+            dsn::zauto_lock _(shard.lock);
+            count += shard.rpcs.size();
+        }
+        return count;
+    }
+
+    // the number of rpcs waiting for being sent
+    static size_t pending_rpc_count(pegasus_mutation_duplicator *duplicator)
+    {
+        size_t count = 0;
+        for (auto &shard : duplicator->_inflight_shards) {
+            dsn::zauto_lock _(shard.lock);
+            for (const auto &kv : shard.rpcs) {
+                count += kv.second.size();
+            }
+        }
+        return count;
+    }
+
     static uint64_t get_hash(const duplicate_rpc &rpc)
     {
         return get_hash_from_request(rpc.request().task_code, rpc.request().raw_message);
@@ -306,6 +688,37 @@ TEST_F(pegasus_mutation_duplicator_test, duplicate_isolated_hashkeys)
     test_duplicate_isolated_hashkeys();
 }
 
+TEST_F(pegasus_mutation_duplicator_test, duplicate_in_batch) { test_duplicate_in_batch(); }
+
+TEST_F(pegasus_mutation_duplicator_test, duplicate_batch_refused)
+{
+    // refused by a remote table with a different partition count
+    test_duplicate_batch_refused(rocksdb::Status::kNotSupported);
+    // refused by an older remote which doesn't know the batched writes
+    test_duplicate_batch_refused(rocksdb::Status::kInvalidArgument);
+}
+
+TEST_F(pegasus_mutation_duplicator_test, duplicate_compressed_refused)
+{
+    // the broken frame is compressed again and retried
+    test_duplicate_compressed_refused(rocksdb::Status::kCorruption, true);
+    // the compression type is not supported by the remote
+    test_duplicate_compressed_refused(rocksdb::Status::kNotSupported, false);
+}
+
+TEST_F(pegasus_mutation_duplicator_test, compress_request)
+{
+    test_compress_request(dsn::apps::duplicate_compression_type::DCT_LZ4);
+    test_compress_request(dsn::apps::duplicate_compression_type::DCT_ZSTD);
+}
+
+TEST_F(pegasus_mutation_duplicator_test, compression_remote_clusters)
+{
+    test_compression_remote_clusters();
+}
+
+TEST_F(pegasus_mutation_duplicator_test, concurrent_replies) { test_concurrent_replies(2000, 8); }
+
 TEST_F(pegasus_mutation_duplicator_test, create_duplicator) { test_create_duplicator(); }
 
 TEST_F(pegasus_mutation_duplicator_test, duplicate_duplicate)
@@ -18,11 +18,17 @@
  */
 
 #include <base/pegasus_key_schema.h>
+#include <base/pegasus_value_schema.h>
+#include <dsn/utility/flags.h>
+#include <rocksdb/write_batch.h>
+
 #include "pegasus_server_test_base.h"
 
 namespace pegasus {
 namespace server {
 
+DSN_DECLARE_uint32(scan_snapshot_max_count);
+
 class pegasus_server_impl_test : public pegasus_server_test_base
 {
 public:
@@ -72,6 +78,182 @@ public:
             ASSERT_EQ(before_count + test.expect_perf_counter_incr, after_count);
         }
     }
+
+    void put(const std::string &sort_key, const std::string &value, uint64_t timestamp)
+    {
+        dsn::blob raw_key;
+        pegasus_generate_key(raw_key, std::string("hash_key"), sort_key);
+        rocksdb::Slice key(raw_key.data(), raw_key.length());
+        pegasus_value_generator generator;
+        rocksdb::WriteBatch batch;
+        batch.Put(_server->_data_cf,
+                  rocksdb::SliceParts(&key, 1),
+                  generator.generate_value(_server->_pegasus_data_version,
+                                           value,
+                                           0,
+                                           generate_timetag(timestamp, 0, false)));
+        ASSERT_TRUE(_server->_db->Write(rocksdb::WriteOptions(), &batch).ok());
+    }
+
+    void remove(const std::string &sort_key)
+    {
+        dsn::blob raw_key;
+        pegasus_generate_key(raw_key, std::string("hash_key"), sort_key);
+        rocksdb::Slice key(raw_key.data(), raw_key.length());
+        ASSERT_TRUE(_server->_db->Delete(rocksdb::WriteOptions(), _server->_data_cf, key).ok());
+    }
+
+    static std::string to_string(const std::vector<::dsn::apps::key_value> &kvs)
+    {
+        std::string result;
+        for (const auto &kv : kvs) {
+            dsn::blob hash_key, sort_key;
+            pegasus_restore_key(kv.key, hash_key, sort_key);
+            result += sort_key.to_string() + "=" + kv.value.to_string() + ";";
+        }
+        return result;
+    }
+
+    dsn::apps::scan_response get_scanner(int64_t read_timestamp, int32_t batch_size)
+    {
+        dsn::apps::get_scanner_request request;
+        pegasus_generate_key(request.start_key, std::string("hash_key"), std::string());
+        pegasus_generate_next_blob(request.stop_key, std::string("hash_key"));
+        request.start_inclusive = true;
+        request.stop_inclusive = false;
+        request.batch_size = batch_size;
+        request.__set_validate_partition_hash(false);
+        request.__set_read_timestamp(read_timestamp);
+        get_scanner_rpc rpc(dsn::make_unique<dsn::apps::get_scanner_request>(request),
+                            dsn::apps::RPC_RRDB_RRDB_GET_SCANNER);
+        _server->on_get_scanner(rpc);
+        return rpc.response();
+    }
+
+    dsn::apps::scan_response scan(int64_t context_id)
+    {
+        dsn::apps::scan_request request;
+        request.context_id = context_id;
+        scan_rpc rpc(dsn::make_unique<dsn::apps::scan_request>(request),
+                     dsn::apps::RPC_RRDB_RRDB_SCAN);
+        _server->on_scan(rpc);
+        return rpc.response();
+    }
+
+    void test_point_in_time_scan()
+    {
+        // the read timestamp must be close to now to pin the snapshot
+        auto base = static_cast<int64_t>(dsn_now_us());
+        put("k1", "v1", base - 100);
+        put("k2", "v2", base - 100);
+        put("k3", "v3", base - 100);
+        put("k4", "v4", base + 100);
+
+        // k4 is written after the read timestamp
+        auto resp = get_scanner(base, 1);
+        ASSERT_EQ(rocksdb::Status::kOk, resp.error);
+        ASSERT_TRUE(resp.__isset.read_timestamp);
+        ASSERT_EQ(base, resp.read_timestamp);
+        ASSERT_EQ("k1=v1;", to_string(resp.kvs));
+        ASSERT_EQ(1, _server->_scan_snapshots.size());
+
+        // the updates after the snapshot is pinned are invisible to the following batches
+        put("k2", "new_v2", base - 50);
+        remove("k3");
+        resp = scan(resp.context_id);
+        ASSERT_EQ(rocksdb::Status::kOk, resp.error);
+        ASSERT_EQ(base, resp.read_timestamp);
+        ASSERT_EQ("k2=v2;", to_string(resp.kvs));
+
+        // and to the scans restarted with the same read timestamp
+        resp = get_scanner(base, 100);
+        ASSERT_EQ(rocksdb::Status::kOk, resp.error);
+        ASSERT_EQ("k1=v1;k2=v2;k3=v3;", to_string(resp.kvs));
+        ASSERT_EQ(SCAN_CONTEXT_ID_COMPLETED, resp.context_id);
+        ASSERT_EQ(1, _server->_scan_snapshots.size());
+
+        // the scans with a new read timestamp see the updates
+        resp = get_scanner(base + 200, 100);
+        ASSERT_EQ(rocksdb::Status::kOk, resp.error);
+        ASSERT_EQ("k1=v1;k2=new_v2;k4=v4;", to_string(resp.kvs));
+        ASSERT_EQ(2, _server->_scan_snapshots.size());
+
+        // too many snapshots pinned
+        auto max_count = FLAGS_scan_snapshot_max_count;
+        FLAGS_scan_snapshot_max_count = 2;
+        resp = get_scanner(base + 300, 100);
+        ASSERT_EQ(rocksdb::Status::kBusy, resp.error);
+        FLAGS_scan_snapshot_max_count = max_count;
+
+        // too late to pin the snapshot of an old read timestamp
+        resp = get_scanner(base - 3600 * 1000000L, 100);
+        ASSERT_EQ(rocksdb::Status::kExpired, resp.error);
+        ASSERT_EQ(2, _server->_scan_snapshots.size());
+
+        // the scans without read timestamp return the latest data
+        resp = get_scanner(0, 100);
+        ASSERT_EQ(rocksdb::Status::kOk, resp.error);
+        ASSERT_FALSE(resp.__isset.read_timestamp);
+        ASSERT_EQ("k1=v1;k2=new_v2;k4=v4;", to_string(resp.kvs));
+    }
+
+    void test_scan_snapshot_table()
+    {
+        pegasus_scan_snapshot_table table;
+        uint64_t now_ms = dsn_now_ms();
+        auto read_timestamp = static_cast<int64_t>(now_ms * 1000);
+        const uint64_t ttl_ms = 1000;
+        const uint64_t max_pin_delay_ms = 5000;
+        rocksdb::DB *db = _server->_db;
+
+        std::shared_ptr<const rocksdb::Snapshot> snapshot, other;
+        ASSERT_EQ(rocksdb::Status::kOk,
+                  table.acquire(db, read_timestamp, now_ms, ttl_ms, 1, max_pin_delay_ms, snapshot));
+        ASSERT_NE(nullptr, snapshot);
+        ASSERT_EQ(rocksdb::Status::kOk,
+                  table.acquire(
+                      db, read_timestamp, now_ms + 500, ttl_ms, 1, max_pin_delay_ms, other));
+        ASSERT_EQ(snapshot, other);
+
+        // the scan batches keep it pinned
+        ASSERT_EQ(rocksdb::Status::kOk, table.refresh(read_timestamp, now_ms + 1400));
+        other = nullptr;
+        ASSERT_EQ(rocksdb::Status::kOk,
+                  table.acquire(
+                      db, read_timestamp, now_ms + 2000, ttl_ms, 1, max_pin_delay_ms, other));
+        ASSERT_EQ(snapshot, other);
+
+        // it's unpinned if not used for the ttl, and it's too late to pin a new one
+        other = nullptr;
+        ASSERT_EQ(rocksdb::Status::kExpired,
+                  table.acquire(
+                      db, read_timestamp, now_ms + 6000, ttl_ms, 1, max_pin_delay_ms, other));
+        ASSERT_EQ(nullptr, other);
+        ASSERT_EQ(0, table.size());
+
+        // the next batch of a scan with the unpinned snapshot doesn't pin it again
+        ASSERT_EQ(rocksdb::Status::kExpired, table.refresh(read_timestamp, now_ms + 6000));
+        ASSERT_EQ(0, table.size());
+
+        // too many snapshots pinned
+        auto new_read_timestamp = static_cast<int64_t>((now_ms + 6500) * 1000);
+        ASSERT_EQ(
+            rocksdb::Status::kOk,
+            table.acquire(
+                db, new_read_timestamp, now_ms + 6500, ttl_ms, 1, max_pin_delay_ms, other));
+        ASSERT_NE(nullptr, other);
+        other = nullptr;
+        ASSERT_EQ(rocksdb::Status::kBusy,
+                  table.acquire(db,
+                                new_read_timestamp + 1,
+                                now_ms + 6500,
+                                ttl_ms,
+                                1,
+                                max_pin_delay_ms,
+                                other));
+        ASSERT_EQ(nullptr, other);
+        ASSERT_EQ(1, table.size());
+    }
 };
 
 TEST_F(pegasus_server_impl_test, test_table_level_slow_query)
@@ -80,6 +262,18 @@ TEST_F(pegasus_server_impl_test, test_table_level_slow_query)
     test_table_level_slow_query();
 }
 
+TEST_F(pegasus_server_impl_test, point_in_time_scan)
+{
+    start();
+    test_point_in_time_scan();
+}
+
+TEST_F(pegasus_server_impl_test, scan_snapshot_table)
+{
+    start();
+    test_scan_snapshot_table();
+}
+
 TEST_F(pegasus_server_impl_test, default_data_version)
 {
     start();
@@ -22,6 +22,7 @@
 #include "pegasus_server_test_base.h"
 #include "server/pegasus_server_write.h"
 #include "server/pegasus_write_service_impl.h"
+#include "server/duplication_compression.h"
 #include "message_utils.h"
 
 namespace pegasus {
@@ -288,6 +289,131 @@ TEST_F(pegasus_write_service_test, duplicate_batched)
     }
 }
 
+TEST_F(pegasus_write_service_test, duplicate_entries)
+{
+    std::string hash_key = "hash_key";
+    std::string sort_key = "sort_key";
+    std::string value = "value";
+
+    dsn::apps::duplicate_request duplicate;
+    duplicate.cluster_id = 2;
+    duplicate.__isset.entries = true;
+    auto add_entry = [&duplicate](dsn::task_code code, dsn::message_ptr msg) {
+        dsn::apps::duplicate_entry entry;
+        entry.__set_timestamp(1000 + duplicate.entries.size());
+        entry.__set_task_code(code);
+        entry.__set_raw_message(dsn::move_message_to_blob(msg.get()));
+        duplicate.entries.emplace_back(std::move(entry));
+    };
+
+    dsn::apps::update_request put;
+    pegasus::pegasus_generate_key(put.key, hash_key, sort_key);
+    put.value.assign(value.data(), 0, value.size());
+    add_entry(dsn::apps::RPC_RRDB_RRDB_PUT, pegasus::create_put_request(put));
+
+    dsn::apps::multi_put_request mput;
+    mput.hash_key.assign(hash_key.data(), 0, hash_key.size());
+    mput.kvs.emplace_back();
+    mput.kvs.back().key.assign(sort_key.data(), 0, sort_key.size());
+    mput.kvs.back().value.assign(value.data(), 0, value.size());
+    add_entry(dsn::apps::RPC_RRDB_RRDB_MULTI_PUT, pegasus::create_multi_put_request(mput));
+
+    dsn::apps::multi_remove_request mremove;
+    mremove.hash_key.assign(hash_key.data(), 0, hash_key.size());
+    mremove.sort_keys.emplace_back(sort_key.data(), 0, sort_key.size());
+    add_entry(dsn::apps::RPC_RRDB_RRDB_MULTI_REMOVE,
+              pegasus::create_multi_remove_request(mremove));
+
+    add_entry(dsn::apps::RPC_RRDB_RRDB_REMOVE, pegasus::create_remove_request(put.key));
+
+    dsn::apps::duplicate_response resp;
+    _write_svc->duplicate(1, duplicate, resp);
+    ASSERT_EQ(resp.error, 0);
+    ASSERT_EQ(_write_svc->_impl->_update_responses.size(), 0);
+
+    // the batch is refused as a whole if any write is not served by this partition, and it's
+    // not an invalid argument so that the source falls back to ship the writes one by one
+    int32_t partition_version = 7;
+    std::string other_hash_key;
+    for (int i = 0; other_hash_key.empty(); i++) {
+        std::string key = "hash_key_" + std::to_string(i);
+        if ((pegasus_hash_key_hash(dsn::blob::create_from_bytes(std::string(key))) &
+             partition_version) != static_cast<uint64_t>(_gpid.get_partition_index())) {
+            other_hash_key = key;
+        }
+    }
+    _server->set_partition_version(partition_version);
+    duplicate.entries.clear();
+    add_entry(dsn::apps::RPC_RRDB_RRDB_MULTI_PUT, pegasus::create_multi_put_request(mput));
+    pegasus::pegasus_generate_key(put.key, other_hash_key, sort_key);
+    add_entry(dsn::apps::RPC_RRDB_RRDB_PUT, pegasus::create_put_request(put));
+    _write_svc->duplicate(2, duplicate, resp);
+    ASSERT_EQ(resp.error, rocksdb::Status::kNotSupported);
+    ASSERT_FALSE(resp.error_hint.empty());
+    ASSERT_EQ(_write_svc->_impl->_update_responses.size(), 0);
+    _server->set_partition_version(0);
+}
+
+TEST_F(pegasus_write_service_test, duplicate_compressed)
+{
+    std::string hash_key = "hash_key";
+    std::string sort_key = "sort_key";
+    std::string value(4096, 'v');
+
+    dsn::apps::update_request request;
+    pegasus::pegasus_generate_key(request.key, hash_key, sort_key);
+    request.value.assign(value.data(), 0, value.size());
+    dsn::message_ptr msg_ptr = pegasus::create_put_request(request);
+    dsn::blob raw_message = dsn::move_message_to_blob(msg_ptr.get());
+
+    dsn::apps::duplicate_request duplicate;
+    duplicate.timestamp = 1000;
+    duplicate.cluster_id = 2;
+    duplicate.task_code = dsn::apps::RPC_RRDB_RRDB_PUT;
+    duplicate.__set_compression_type(dsn::apps::duplicate_compression_type::DCT_ZSTD);
+    ASSERT_TRUE(
+        compress_duplicate_payload(duplicate.compression_type, raw_message, duplicate.raw_message));
+
+    dsn::apps::duplicate_response resp;
+    _write_svc->duplicate(1, duplicate, resp);
+    ASSERT_EQ(resp.error, 0);
+
+    // the message is not a zstd frame, which is not an invalid argument, so the source
+    // resends it rather than failing fast
+    duplicate.raw_message = raw_message;
+    _write_svc->duplicate(2, duplicate, resp);
+    ASSERT_EQ(resp.error, rocksdb::Status::kCorruption);
+    ASSERT_FALSE(resp.error_hint.empty());
+
+    // unknown compression type
+    duplicate.__set_compression_type(static_cast<dsn::apps::duplicate_compression_type::type>(9));
+    _write_svc->duplicate(3, duplicate, resp);
+    ASSERT_EQ(resp.error, rocksdb::Status::kNotSupported);
+    ASSERT_FALSE(resp.error_hint.empty());
+
+    // the writes of a batch are compressed as one frame
+    std::vector<dsn::apps::duplicate_entry> entries(2);
+    for (auto &entry : entries) {
+        entry.__set_timestamp(1000);
+        entry.__set_task_code(dsn::apps::RPC_RRDB_RRDB_PUT);
+        entry.__set_raw_message(raw_message);
+    }
+    dsn::apps::duplicate_request batch;
+    batch.timestamp = 1000;
+    batch.cluster_id = 2;
+    batch.__isset.entries = true;
+    batch.__set_compression_type(dsn::apps::duplicate_compression_type::DCT_LZ4);
+    ASSERT_TRUE(compress_duplicate_payload(
+        batch.compression_type, serialize_duplicate_entries(entries), batch.raw_message));
+    resp = dsn::apps::duplicate_response();
+    _write_svc->duplicate(4, batch, resp);
+    ASSERT_EQ(resp.error, 0);
+
+    batch.raw_message = batch.raw_message.range(0, batch.raw_message.length() / 2);
+    _write_svc->duplicate(5, batch, resp);
+    ASSERT_EQ(resp.error, rocksdb::Status::kCorruption);
+}
+
 TEST_F(pegasus_write_service_test, illegal_duplicate_request)
 {
     std::string hash_key = "hash_key";
@@ -22,6 +22,7 @@
 #include <vector>
 #include <climits>
 #include <map>
+#include <thread>
 
 #include <dsn/service_api_c.h>
 #include <unistd.h>
@@ -298,3 +299,61 @@ TEST(incr, reset_ttl)
     ret = client->del("incr_test_reset_ttl", "");
     ASSERT_EQ(0, ret);
 }
+
+TEST(incr, sharded_counter)
+{
+    const std::string hash_key = "incr_test_sharded_counter";
+    const int shard_count = 8;
+    int ret = client->fold_sharded_counter(hash_key, "", shard_count);
+    ASSERT_EQ(0, ret);
+    ret = client->del(hash_key, "");
+    ASSERT_EQ(0, ret);
+
+    int64_t value = 0;
+    ret = client->get_sharded_counter(hash_key, "", shard_count, value);
+    ASSERT_EQ(PERR_NOT_FOUND, ret);
+
+    // the increments of different threads are spread over the shards
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&]() {
+            for (int i = 0; i < 10; ++i) {
+                ASSERT_EQ(0, client->incr_sharded_counter(hash_key, "", 10, shard_count));
+            }
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+    ret = client->get_sharded_counter(hash_key, "", shard_count, value);
+    ASSERT_EQ(0, ret);
+    ASSERT_EQ(800, value);
+
+    // a normal counter is a sharded counter with 1 shard, it gets only the shard 0
+    ret = client->incr_sharded_counter(hash_key, "", -50, 1);
+    ASSERT_EQ(0, ret);
+    ret = client->get_sharded_counter(hash_key, "", shard_count, value);
+    ASSERT_EQ(0, ret);
+    ASSERT_EQ(750, value);
+
+    // after folding, the whole value is in the shard 0
+    ret = client->fold_sharded_counter(hash_key, "", shard_count);
+    ASSERT_EQ(0, ret);
+    std::string value_str;
+    ret = client->get(hash_key, "", value_str);
+    ASSERT_EQ(0, ret);
+    ASSERT_EQ("750", value_str);
+    ret = client->get_sharded_counter(hash_key, "", shard_count, value);
+    ASSERT_EQ(0, ret);
+    ASSERT_EQ(750, value);
+
+    ret = client->incr_sharded_counter(hash_key, "", 1, 0);
+    ASSERT_EQ(PERR_INVALID_ARGUMENT, ret);
+    ret = client->get_sharded_counter(hash_key, "", 2000, value);
+    ASSERT_EQ(PERR_INVALID_ARGUMENT, ret);
+
+    ret = client->del(hash_key, "");
+    ASSERT_EQ(0, ret);
+    ret = client->get_sharded_counter(hash_key, "", shard_count, value);
+    ASSERT_EQ(PERR_NOT_FOUND, ret);
+}
@@ -548,6 +548,63 @@ TEST_F(scan, REQUEST_EXPIRE_TS)
     compare(ttl_data, ttl_base);
 }
 
+TEST_F(scan, POINT_IN_TIME)
+{
+    ddebug("TEST POINT_IN_TIME...");
+    pegasus_client::scan_options options;
+    options.point_in_time = true;
+    options.batch_size = 10;
+    std::vector<pegasus_client::pegasus_scanner *> scanners;
+    int ret = client->get_unordered_scanners(3, options, scanners);
+    ASSERT_EQ(PERR_OK, ret) << "Error occurred when getting scanner. error="
+                            << client->get_error_string(ret);
+    ASSERT_LE(scanners.size(), 3);
+
+    // the k-v written after the scanners are got are not returned
+    std::vector<std::string> new_hash_keys;
+    for (int i = 0; i < 100; ++i) {
+        new_hash_keys.emplace_back("point_in_time_" + std::to_string(i));
+        ret = client->set(new_hash_keys.back(), "sort_key", "value");
+        ASSERT_EQ(PERR_OK, ret) << "Error occurred when set, hash_key=" << new_hash_keys.back()
+                                << ", error=" << client->get_error_string(ret);
+    }
+
+    std::string hash_key;
+    std::string sort_key;
+    std::string value;
+    std::map<std::string, std::map<std::string, std::string>> data;
+    for (auto scanner : scanners) {
+        ASSERT_NE(nullptr, scanner);
+        int count = 0;
+        while (PERR_OK == (ret = (scanner->next(hash_key, sort_key, value)))) {
+            check_and_put(data, hash_key, sort_key, value);
+            // resume the scan from a token sometimes
+            if (++count % 50 == 0) {
+                std::string token;
+                ASSERT_EQ(PERR_OK, scanner->get_resume_token(token));
+                delete scanner;
+                ret = client->get_scanner_by_resume_token(token, options, scanner);
+                ASSERT_EQ(PERR_OK, ret) << "Error occurred when resuming scanner. error="
+                                        << client->get_error_string(ret);
+            }
+        }
+        ASSERT_EQ(PERR_SCAN_COMPLETE, ret) << "Error occurred when scan. error="
+                                           << client->get_error_string(ret);
+        delete scanner;
+    }
+    compare(data, base);
+
+    for (const auto &new_hash_key : new_hash_keys) {
+        ret = client->del(new_hash_key, "sort_key");
+        ASSERT_EQ(PERR_OK, ret) << "Error occurred when del, hash_key=" << new_hash_key
+                                << ", error=" << client->get_error_string(ret);
+    }
+
+    pegasus_client::pegasus_scanner *scanner = nullptr;
+    ASSERT_EQ(PERR_INVALID_ARGUMENT,
+              client->get_scanner_by_resume_token("invalid", options, scanner));
+}
+
 TEST_F(scan, ITERATION_TIME_LIMIT)
 {
     // update iteration threshold to 1ms